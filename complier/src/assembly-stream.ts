@@ -0,0 +1,203 @@
+/**
+ * Structured Assembly Stream
+ *
+ * In-memory form of an assembly program as produced by the high-level code
+ * generators: one item per source line (instruction, label, directive,
+ * comment or blank). The stream feeds code generation directly through
+ * `buildParseResult()`, so generated code never round-trips through text,
+ * and `renderAssembly()` prints it only when a listing is requested.
+ *
+ * `buildParseResult()` applies the same address and label rules as
+ * `Parser.parse()`, and line numbers refer to the rendered listing.
+ *
+ * @fileoverview Instruction/label/directive stream shared by C front end and assembler
+ */
+
+import { ParseResult } from './parser';
+import { INSTRUCTION_SET } from './instruction-set';
+
+export interface InstructionItem {
+  kind: 'instruction';
+  instruction: string;
+  /** Immediates/addresses (numbers) or label and register names (strings) */
+  operands: (string | number)[];
+  comment?: string;
+}
+
+export interface LabelItem {
+  kind: 'label';
+  name: string;
+}
+
+export interface DirectiveItem {
+  kind: 'directive';
+  directive: string;
+  value: number;
+}
+
+export interface CommentItem {
+  kind: 'comment';
+  text: string;
+  /** Indent to instruction column instead of column 0 */
+  indent: boolean;
+}
+
+export interface BlankItem {
+  kind: 'blank';
+}
+
+export type AssemblyItem = InstructionItem | LabelItem | DirectiveItem | CommentItem | BlankItem;
+
+/**
+ * Instructions whose operand is a RAM address; rendered in hex
+ */
+const MEMORY_OPERAND_INSTRUCTIONS = new Set(['LDA', 'STA', 'LDX', 'STX', 'ADD', 'SUB', 'AND', 'OR', 'XOR']);
+
+export function buildParseResult(items: AssemblyItem[]): ParseResult {
+  const result: ParseResult = {
+    instructions: [],
+    labels: new Map(),
+    directives: [],
+    errors: []
+  };
+
+  let address = 0;
+  for (let i = 0; i < items.length; i++) {
+    const item = items[i];
+    const line = i + 1;
+
+    switch (item.kind) {
+      case 'label':
+        if (result.labels.has(item.name)) {
+          result.errors.push(`Line ${line}: Error: Label '${item.name}' already defined`);
+        } else {
+          result.labels.set(item.name, address);
+        }
+        break;
+
+      case 'directive':
+        result.directives.push({ directive: item.directive, value: item.value, line });
+        if (item.directive === '.ORG') {
+          address = item.value;
+        } else if (item.directive === '.DB') {
+          address += 1;
+        } else if (item.directive === '.DW') {
+          address += 2;
+        }
+        break;
+
+      case 'instruction': {
+        const definition = INSTRUCTION_SET[item.instruction];
+        if (!definition) {
+          result.errors.push(`Line ${line}: Error: Unknown instruction: ${item.instruction}`);
+          break;
+        }
+        result.instructions.push({ instruction: item.instruction, operands: item.operands, line });
+        address += 1 + definition.operands;
+        break;
+      }
+    }
+  }
+
+  return result;
+}
+
+export function renderAssembly(items: AssemblyItem[]): string {
+  return items.map(renderItem).join('\n');
+}
+
+function renderItem(item: AssemblyItem): string {
+  switch (item.kind) {
+    case 'instruction': {
+      const operands = item.operands.map((operand) =>
+        typeof operand === 'number' && MEMORY_OPERAND_INSTRUCTIONS.has(item.instruction)
+          ? `0x${operand.toString(16).padStart(2, '0')}`
+          : `${operand}`
+      );
+      const text = operands.length > 0 ? `    ${item.instruction} ${operands.join(', ')}` : `    ${item.instruction}`;
+      return item.comment ? `${text}    ; ${item.comment}` : text;
+    }
+    case 'label':
+      return `${item.name}:`;
+    case 'directive':
+      return `${item.directive} 0x${item.value.toString(16).padStart(2, '0').toUpperCase()}`;
+    case 'comment':
+      return item.indent ? `    ; ${item.text}` : `; ${item.text}`;
+    case 'blank':
+      return '';
+  }
+}
+
+/** Cap on the depth explored by stackDepth(); deeper means unbounded */
+const MAX_STACK_DEPTH = 256;
+
+/**
+ * Worst-case stack bytes of a program started at `entry`: one per return
+ * address on CALL (PC is 8 bits) and per PUSH. Follows every jump and
+ * assumes each CALL returns; jumps to numeric addresses are not followed.
+ * `ADI table ; PUSH ; RET` is a computed jump to each of the labels
+ * `tables` lists for `table`. Returns null when the depth has no bound,
+ * i.e. the program recurses or pushes in a loop.
+ */
+export function stackDepth(items: AssemblyItem[], entry: string = 'MAIN', tables: Map<string, string[]> = new Map()): number | null {
+  const instructions: InstructionItem[] = [];
+  const labels = new Map<string, number>();
+  for (const item of items) {
+    if (item.kind === 'label') labels.set(item.name, instructions.length);
+    if (item.kind === 'instruction') instructions.push(item);
+  }
+
+  const start = labels.get(entry);
+  if (start === undefined) return 0;
+
+  // Deepest depth each instruction was reached with
+  const reached = new Map<number, number>();
+  const work: [number, number][] = [[start, 0]];
+  let max = 0;
+  while (work.length > 0) {
+    const [index, depth] = work.pop()!;
+    const seen = reached.get(index);
+    if (index >= instructions.length || (seen !== undefined && seen >= depth)) continue;
+    if (depth > MAX_STACK_DEPTH) return null;
+    reached.set(index, depth);
+    max = Math.max(max, depth);
+
+    const item = instructions[index];
+    const operand = item.operands[0];
+    const target = typeof operand === 'string' ? labels.get(operand) : undefined;
+    switch (item.instruction) {
+      case 'RET': {
+        const push = instructions[index - 1];
+        const add = instructions[index - 2];
+        const table = push && add && push.instruction === 'PUSH' && add.instruction === 'ADI' ? tables.get(String(add.operands[0])) : undefined;
+        for (const label of table || []) {
+          const address = labels.get(label);
+          if (address !== undefined) work.push([address, depth - 1]);
+        }
+        break;
+      }
+      case 'HLT':
+        break;
+      case 'JMP':
+        if (target !== undefined) work.push([target, depth]);
+        break;
+      case 'JZ': case 'JNZ': case 'JC': case 'JNC':
+        if (target !== undefined) work.push([target, depth]);
+        work.push([index + 1, depth]);
+        break;
+      case 'CALL':
+        if (target !== undefined) work.push([target, depth + 1]);
+        work.push([index + 1, depth]);
+        break;
+      case 'PUSH':
+        work.push([index + 1, depth + 1]);
+        break;
+      case 'POP':
+        work.push([index + 1, Math.max(0, depth - 1)]);
+        break;
+      default:
+        work.push([index + 1, depth]);
+    }
+  }
+  return max;
+}
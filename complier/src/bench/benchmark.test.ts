@@ -0,0 +1,77 @@
+import { generateCorpus } from './corpus';
+import { summarize, welchTTest } from './stats';
+import { compareReports, runBenchmarks, BenchmarkReport } from './benchmark';
+import { CPU8BitCompiler } from '../compiler';
+import { CTokenizer } from '../languages/c-tokenizer';
+import { CParser } from '../languages/c-parser';
+import { PhaseTimer } from '../time-report';
+
+describe('Benchmark corpus', () => {
+  test('should generate the same corpus for the same seed', () => {
+    const options = { seed: 7, assemblyPrograms: 5, cPrograms: 1, cFunctions: 4 };
+    expect(generateCorpus(options)).toEqual(generateCorpus(options));
+    expect(generateCorpus({ ...options, seed: 8 })).not.toEqual(generateCorpus(options));
+  });
+
+  test('should generate programs the compiler accepts', () => {
+    const corpus = generateCorpus({ seed: 3, assemblyPrograms: 20, cPrograms: 2, cFunctions: 6 });
+
+    for (const source of corpus.assembly) {
+      const result = new CPU8BitCompiler().compile(source);
+      expect(result.errors).toEqual([]);
+    }
+    for (const source of corpus.c) {
+      const parsed = new CParser(new CTokenizer(source).tokenize()).parse();
+      expect(parsed.errors).toEqual([]);
+    }
+  });
+});
+
+describe('Benchmark statistics', () => {
+  test('should match reference t-test values', () => {
+    const a = { n: 6, mean: 2, stddev: 1, median: 2, min: 0, max: 4 };
+    const b = { n: 6, mean: 2 - 2 / Math.sqrt(3), stddev: 1, median: 1, min: 0, max: 3 };
+    const result = welchTTest(a, b);
+
+    expect(result.t).toBeCloseTo(2, 6);
+    expect(result.df).toBeCloseTo(10, 6);
+    expect(result.p).toBeCloseTo(0.0734, 3);
+    expect(summarize([4, 1, 3, 2]).median).toBe(2.5);
+  });
+
+  test('should flag only significant changes against a baseline', () => {
+    const report = (name: string, samples: number[]): BenchmarkReport => ({
+      version: 1,
+      timestamp: '',
+      node: '',
+      corpus: {},
+      iterations: samples.length,
+      maxRssBytes: 0,
+      benchmarks: [{ name, lines: 100, samples, summary: summarize(samples), linesPerSec: 0, heapDeltaBytes: 0 }]
+    });
+
+    const baseline = report('asm/parse', [10, 10.2, 9.9, 10.1, 9.8, 10]);
+    const slower = compareReports(report('asm/parse', [13, 13.1, 12.9, 13.2, 12.8, 13]), baseline);
+    const noisy = compareReports(report('asm/parse', [8, 12, 9, 11, 10.5, 10]), baseline);
+
+    expect(slower[0].verdict).toBe('slower');
+    expect(noisy[0].verdict).toBe('unchanged');
+  });
+
+  test('should time each selected phase', () => {
+    const result = runBenchmarks({
+      iterations: 2,
+      warmup: 0,
+      filter: 'asm/',
+      corpus: { seed: 1, assemblyPrograms: 3, cPrograms: 1, cFunctions: 2 }
+    });
+
+    expect(result.benchmarks.map((benchmark) => benchmark.name)).toEqual(['asm/tokenize', 'asm/parse', 'asm/generate']);
+    expect(result.benchmarks[0].samples.length).toBe(2);
+    // Counted like --time-report, without the empty line after the final newline
+    const corpus = generateCorpus({ seed: 1, assemblyPrograms: 3, cPrograms: 1, cFunctions: 2 });
+    const timed = corpus.assembly.map((source) => new PhaseTimer(source).getReport().sourceLines);
+    expect(result.benchmarks[0].lines).toBe(timed.reduce((total, lines) => total + lines, 0));
+    expect(result.benchmarks[0].lines).toBe(corpus.assembly.join('').split('\n').length - 1);
+  });
+});
@@ -0,0 +1,268 @@
+/**
+ * Compiler Throughput Benchmarks
+ *
+ * Times every compiler phase separately over a seeded synthetic corpus
+ * (see corpus.ts). Inputs for each phase are computed once up front, so a
+ * sample measures only that phase:
+ *
+ *   asm/tokenize   Tokenizer.tokenize()
+ *   asm/parse      Parser.parse()
+ *   asm/generate   generateBinary()
+ *   c/tokenize     CTokenizer.tokenize()
+ *   c/parse        CParser.parse()
+ *   c/generate     CToAssemblyGenerator.generateItems()
+ *   c/stream       buildParseResult()
+ *
+ * One sample is one pass over the corpus. After warmup iterations, each
+ * benchmark records per-iteration wall time and the largest heap delta of
+ * a pass (`heapUsed` at its end minus its start; garbage collected during
+ * the pass is not counted). The peak memory of the whole run is the
+ * process's maximum resident set size.
+ *
+ * Results save as JSON. A later run can be compared against that file:
+ * a change counts only when Welch's t-test rejects equal means at `alpha`
+ * and the relative difference exceeds `threshold`.
+ *
+ * @fileoverview Seeded benchmark harness with baseline comparison
+ */
+
+import { Tokenizer, Token } from '../tokenizer';
+import { Parser, ParseResult } from '../parser';
+import { generateBinary } from '../code-generator';
+import { CTokenizer, CToken } from '../languages/c-tokenizer';
+import { CParser } from '../languages/c-parser';
+import { CToAssemblyGenerator } from '../languages/c-generator';
+import { Program } from '../languages/ast';
+import { AssemblyItem, buildParseResult } from '../assembly-stream';
+import { Corpus, CorpusOptions, generateCorpus } from './corpus';
+import { SampleSummary, summarize, welchTTest } from './stats';
+import { countSourceLines } from '../time-report';
+
+export interface BenchmarkOptions {
+  /** Measured passes per benchmark */
+  iterations?: number;
+  /** Unmeasured passes before sampling (JIT warmup) */
+  warmup?: number;
+  /** Corpus generator settings */
+  corpus?: CorpusOptions;
+  /** Only run benchmarks whose name contains this string */
+  filter?: string;
+}
+
+export interface BenchmarkResult {
+  name: string;
+  /** Source lines processed per pass */
+  lines: number;
+  /** Wall time per pass, in milliseconds */
+  samples: number[];
+  summary: SampleSummary;
+  /** Lines per second at the mean pass time */
+  linesPerSec: number;
+  /** Largest heapUsed delta from the start to the end of a pass */
+  heapDeltaBytes: number;
+}
+
+export interface BenchmarkReport {
+  version: 1;
+  timestamp: string;
+  node: string;
+  corpus: CorpusOptions;
+  iterations: number;
+  /** Peak resident set size of the whole run, in bytes */
+  maxRssBytes: number;
+  benchmarks: BenchmarkResult[];
+}
+
+export interface BenchmarkComparison {
+  name: string;
+  baselineMs: number;
+  currentMs: number;
+  /** Relative change of the mean, (current - baseline) / baseline */
+  change: number;
+  p: number;
+  verdict: 'faster' | 'slower' | 'unchanged';
+}
+
+interface BenchmarkCase {
+  name: string;
+  lines: number;
+  run: () => void;
+}
+
+export function runBenchmarks(options: BenchmarkOptions = {}): BenchmarkReport {
+  const iterations = options.iterations || 20;
+  const warmup = options.warmup !== undefined ? options.warmup : 5;
+  const corpusOptions = options.corpus || {};
+
+  const corpus = generateCorpus(corpusOptions);
+  const cases = createCases(corpus).filter((benchmark) =>
+    !options.filter || benchmark.name.includes(options.filter)
+  );
+
+  const benchmarks: BenchmarkResult[] = [];
+  for (const benchmark of cases) {
+    for (let i = 0; i < warmup; i++) {
+      benchmark.run();
+    }
+
+    const samples: number[] = [];
+    let heapDeltaBytes = 0;
+    for (let i = 0; i < iterations; i++) {
+      const heapBefore = process.memoryUsage().heapUsed;
+      const started = process.hrtime.bigint();
+      benchmark.run();
+      samples.push(Number(process.hrtime.bigint() - started) / 1e6);
+      heapDeltaBytes = Math.max(heapDeltaBytes, process.memoryUsage().heapUsed - heapBefore);
+    }
+
+    const summary = summarize(samples);
+    benchmarks.push({
+      name: benchmark.name,
+      lines: benchmark.lines,
+      samples,
+      summary,
+      linesPerSec: summary.mean > 0 ? Math.round(benchmark.lines / (summary.mean / 1000)) : 0,
+      heapDeltaBytes
+    });
+  }
+
+  return {
+    version: 1,
+    timestamp: new Date().toISOString(),
+    node: process.version,
+    corpus: corpusOptions,
+    iterations,
+    maxRssBytes: process.resourceUsage().maxRSS * 1024,
+    benchmarks
+  };
+}
+
+/**
+ * Compares matching benchmarks of two reports
+ */
+export function compareReports(
+  current: BenchmarkReport,
+  baseline: BenchmarkReport,
+  alpha: number = 0.05,
+  threshold: number = 0.02
+): BenchmarkComparison[] {
+  const comparisons: BenchmarkComparison[] = [];
+
+  for (const result of current.benchmarks) {
+    const previous = baseline.benchmarks.find((benchmark) => benchmark.name === result.name);
+    if (!previous) continue;
+
+    const test = welchTTest(result.summary, previous.summary);
+    const change = previous.summary.mean > 0
+      ? (result.summary.mean - previous.summary.mean) / previous.summary.mean
+      : 0;
+
+    let verdict: BenchmarkComparison['verdict'] = 'unchanged';
+    if (test.p < alpha && Math.abs(change) > threshold) {
+      verdict = change < 0 ? 'faster' : 'slower';
+    }
+
+    comparisons.push({
+      name: result.name,
+      baselineMs: previous.summary.mean,
+      currentMs: result.summary.mean,
+      change,
+      p: test.p,
+      verdict
+    });
+  }
+  return comparisons;
+}
+
+export function formatBenchmarkReport(report: BenchmarkReport): string {
+  const lines: string[] = [];
+  lines.push(`Benchmarks (${report.iterations} iterations, node ${report.node})`);
+  lines.push(`  ${'Name'.padEnd(14)}${'Mean ms'.padStart(10)}${'± sd'.padStart(9)}${'Lines/s'.padStart(12)}${'Heap delta KB'.padStart(15)}`);
+
+  for (const result of report.benchmarks) {
+    lines.push(
+      `  ${result.name.padEnd(14)}` +
+      `${result.summary.mean.toFixed(3).padStart(10)}` +
+      `${result.summary.stddev.toFixed(3).padStart(9)}` +
+      `${String(result.linesPerSec).padStart(12)}` +
+      `${(result.heapDeltaBytes / 1024).toFixed(1).padStart(15)}`
+    );
+  }
+
+  lines.push(`  Peak RSS: ${(report.maxRssBytes / (1024 * 1024)).toFixed(1)} MB`);
+  return lines.join('\n');
+}
+
+export function formatComparison(comparisons: BenchmarkComparison[]): string {
+  const lines: string[] = [];
+  lines.push('Against baseline');
+  lines.push(`  ${'Name'.padEnd(14)}${'Base ms'.padStart(10)}${'Now ms'.padStart(10)}${'Change'.padStart(9)}${'p'.padStart(9)}  Verdict`);
+
+  for (const comparison of comparisons) {
+    const change = `${comparison.change >= 0 ? '+' : ''}${(comparison.change * 100).toFixed(1)}%`;
+    lines.push(
+      `  ${comparison.name.padEnd(14)}` +
+      `${comparison.baselineMs.toFixed(3).padStart(10)}` +
+      `${comparison.currentMs.toFixed(3).padStart(10)}` +
+      `${change.padStart(9)}` +
+      `${comparison.p.toFixed(4).padStart(9)}  ${comparison.verdict}`
+    );
+  }
+  return lines.join('\n');
+}
+
+/**
+ * Builds one case per phase, precomputing each phase's inputs
+ */
+function createCases(corpus: Corpus): BenchmarkCase[] {
+  const assemblyLines = countLines(corpus.assembly);
+  const cLines = countLines(corpus.c);
+
+  const assemblyTokens: Token[][] = corpus.assembly.map((source) => new Tokenizer(source).tokenize());
+  const assemblyParsed: ParseResult[] = assemblyTokens.map((tokens) => new Parser(tokens).parse());
+  const cTokens: CToken[][] = corpus.c.map((source) => new CTokenizer(source).tokenize());
+  const cAsts: Program[] = cTokens.map((tokens) => new CParser(tokens).parse().ast);
+  const cItems: AssemblyItem[][] = cAsts.map((ast) => new CToAssemblyGenerator().generateItems(ast));
+
+  return [
+    {
+      name: 'asm/tokenize',
+      lines: assemblyLines,
+      run: () => corpus.assembly.forEach((source) => new Tokenizer(source).tokenize())
+    },
+    {
+      name: 'asm/parse',
+      lines: assemblyLines,
+      run: () => assemblyTokens.forEach((tokens) => new Parser(tokens).parse())
+    },
+    {
+      name: 'asm/generate',
+      lines: assemblyLines,
+      run: () => assemblyParsed.forEach((parsed) => generateBinary(parsed))
+    },
+    {
+      name: 'c/tokenize',
+      lines: cLines,
+      run: () => corpus.c.forEach((source) => new CTokenizer(source).tokenize())
+    },
+    {
+      name: 'c/parse',
+      lines: cLines,
+      run: () => cTokens.forEach((tokens) => new CParser(tokens).parse())
+    },
+    {
+      name: 'c/generate',
+      lines: cLines,
+      run: () => cAsts.forEach((ast) => new CToAssemblyGenerator().generateItems(ast))
+    },
+    {
+      name: 'c/stream',
+      lines: cLines,
+      run: () => cItems.forEach((items) => buildParseResult(items))
+    }
+  ];
+}
+
+function countLines(sources: string[]): number {
+  return sources.reduce((total, source) => total + countSourceLines(source), 0);
+}
@@ -0,0 +1,218 @@
+/**
+ * Synthetic Benchmark Corpus
+ *
+ * Seeded generator of assembly and C-like programs used by the throughput
+ * benchmarks. The same seed always yields the same corpus, so timings from
+ * different builds can be compared sample for sample.
+ *
+ * Assembly programs stay inside the 256-byte address space (label operands
+ * are single bytes), so a corpus holds many of them. They are dense in
+ * labels, backward branches and mixed operand forms.
+ *
+ * C-like programs only go through the front end, so they can be large:
+ * many functions, deeply nested if/while/for blocks and long expression
+ * chains. Their variables must still fit the 128 bytes of RAM, so the
+ * working variables x and y are globals shared by every function, and
+ * each function only adds its two parameters.
+ *
+ * @fileoverview Deterministic program generator for benchmarks
+ */
+
+import { INSTRUCTION_SET } from '../instruction-set';
+
+export interface CorpusOptions {
+  /** PRNG seed */
+  seed?: number;
+  /** Number of assembly programs */
+  assemblyPrograms?: number;
+  /** Number of C-like programs */
+  cPrograms?: number;
+  /** Functions per C-like program (besides main) */
+  cFunctions?: number;
+  /** Maximum block nesting depth in C-like functions */
+  nestingDepth?: number;
+  /** Operands per generated C expression chain */
+  expressionLength?: number;
+}
+
+export interface Corpus {
+  assembly: string[];
+  c: string[];
+}
+
+export type Random = () => number;
+
+/**
+ * mulberry32: small, fast, seedable PRNG returning floats in [0, 1)
+ */
+export function createRandom(seed: number): Random {
+  let state = seed >>> 0;
+  return () => {
+    state = (state + 0x6D2B79F5) >>> 0;
+    let t = state;
+    t = Math.imul(t ^ (t >>> 15), t | 1);
+    t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+    return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+  };
+}
+
+export function generateCorpus(options: CorpusOptions = {}): Corpus {
+  const settings: Required<CorpusOptions> = {
+    seed: options.seed !== undefined ? options.seed : 1,
+    assemblyPrograms: options.assemblyPrograms || 200,
+    cPrograms: options.cPrograms || 4,
+    cFunctions: options.cFunctions || 40,
+    nestingDepth: options.nestingDepth || 5,
+    expressionLength: options.expressionLength || 12
+  };
+
+  const random = createRandom(settings.seed);
+  const corpus: Corpus = { assembly: [], c: [] };
+
+  for (let i = 0; i < settings.assemblyPrograms; i++) {
+    corpus.assembly.push(generateAssemblyProgram(random));
+  }
+  for (let i = 0; i < settings.cPrograms; i++) {
+    corpus.c.push(generateCProgram(random, settings));
+  }
+  return corpus;
+}
+
+const IMMEDIATE_OPS = ['LDI', 'ADI', 'SUI', 'ANI', 'ORI', 'XRI', 'OUT', 'IN'];
+const MEMORY_OPS = ['LDA', 'STA', 'ADD', 'SUB', 'AND', 'OR', 'XOR'];
+const IMPLIED_OPS = ['NOT', 'PUSH', 'POP', 'NOP'];
+const BRANCH_OPS = ['JZ', 'JNZ', 'JC', 'JNC', 'JMP'];
+
+/** Address budget per assembly program; leaves room for the final HLT */
+const ASSEMBLY_BUDGET = 250;
+
+export function generateAssemblyProgram(random: Random): string {
+  const lines: string[] = [];
+  const labels: string[] = [];
+  let address = 0;
+
+  lines.push(`; synthetic program ${pick(random, ['alpha', 'beta', 'gamma', 'delta'])}`);
+  lines.push('.ORG 0x00');
+
+  while (address < ASSEMBLY_BUDGET - 8) {
+    // Start a new block with a label every few instructions
+    if (labels.length === 0 || random() < 0.25) {
+      const label = `L${labels.length}_${int(random, 0, 999)}`;
+      labels.push(label);
+      lines.push(`${label}:`);
+    }
+
+    const roll = random();
+    let instruction: string;
+    let operands: string[];
+    if (roll < 0.4) {
+      instruction = pick(random, IMMEDIATE_OPS);
+      operands = [formatNumber(random, int(random, 0, 255))];
+    } else if (roll < 0.7) {
+      instruction = pick(random, MEMORY_OPS);
+      operands = [formatNumber(random, int(random, 0x80, 0xFF))];
+    } else if (roll < 0.8) {
+      instruction = pick(random, IMPLIED_OPS);
+      operands = [];
+    } else if (roll < 0.9) {
+      instruction = pick(random, BRANCH_OPS);
+      operands = [pick(random, labels)];
+    } else {
+      instruction = 'MOV';
+      operands = random() < 0.5 ? ['A', 'B'] : ['B', 'A'];
+    }
+
+    const comment = random() < 0.2 ? `    ; step ${lines.length}` : '';
+    lines.push(`    ${instruction}${operands.length ? ' ' + operands.join(', ') : ''}${comment}`);
+    address += 1 + INSTRUCTION_SET[instruction].operands;
+  }
+
+  lines.push('    HLT');
+  return lines.join('\n') + '\n';
+}
+
+export function generateCProgram(random: Random, options: Required<CorpusOptions>): string {
+  const lines: string[] = ['uint8 x;', 'uint8 y;', ''];
+  const names: string[] = [];
+
+  for (let f = 0; f < options.cFunctions; f++) {
+    const name = `fn${f}`;
+    names.push(name);
+    lines.push(`uint8 ${name}(uint8 a, uint8 b) {`);
+    lines.push('    x = a;');
+    lines.push('    y = b;');
+    generateBlock(random, lines, options, 1, options.nestingDepth, names.slice(0, -1));
+    lines.push(`    return ${expression(random, ['x', 'y', 'a', 'b'], options.expressionLength)};`);
+    lines.push('}');
+    lines.push('');
+  }
+
+  lines.push('void main() {');
+  lines.push('    uint8 r = input(0);');
+  for (const name of names) {
+    lines.push(`    r = ${name}(r, ${int(random, 0, 255)});`);
+  }
+  lines.push('    output(1, r);');
+  lines.push('    halt();');
+  lines.push('}');
+  return lines.join('\n') + '\n';
+}
+
+function generateBlock(
+  random: Random,
+  lines: string[],
+  options: Required<CorpusOptions>,
+  depth: number,
+  maxDepth: number,
+  callees: string[]
+): void {
+  const indent = '    '.repeat(depth);
+  const variables = ['x', 'y', 'a', 'b'];
+  const statements = int(random, 2, 4);
+
+  for (let s = 0; s < statements; s++) {
+    const roll = random();
+    if (depth < maxDepth && roll < 0.45) {
+      const kind = pick(random, ['if', 'while', 'for']);
+      const condition = `${expression(random, variables, 3)} ${pick(random, ['<', '>', '==', '!=', '<=', '>='])} ${int(random, 0, 255)}`;
+      if (kind === 'if') {
+        lines.push(`${indent}if (${condition}) {`);
+      } else if (kind === 'while') {
+        lines.push(`${indent}while (${condition}) {`);
+      } else {
+        lines.push(`${indent}for (x = 0; x < ${int(random, 1, 20)}; x = x + 1) {`);
+      }
+      generateBlock(random, lines, options, depth + 1, maxDepth, callees);
+      if (kind === 'if' && random() < 0.5) {
+        lines.push(`${indent}} else {`);
+        generateBlock(random, lines, options, depth + 1, maxDepth, callees);
+      }
+      lines.push(`${indent}}`);
+    } else if (callees.length > 0 && roll < 0.55) {
+      lines.push(`${indent}y = ${pick(random, callees)}(x, ${int(random, 0, 255)});`);
+    } else {
+      lines.push(`${indent}${pick(random, ['x', 'y'])} = ${expression(random, variables, options.expressionLength)};`);
+    }
+  }
+}
+
+function expression(random: Random, variables: string[], length: number): string {
+  const terms: string[] = [];
+  for (let i = 0; i < length; i++) {
+    const term = random() < 0.6 ? pick(random, variables) : formatNumber(random, int(random, 0, 255));
+    terms.push(i === 0 ? term : `${pick(random, ['+', '-', '&', '|', '^'])} ${term}`);
+  }
+  return terms.join(' ');
+}
+
+function formatNumber(random: Random, value: number): string {
+  return random() < 0.5 ? `${value}` : `0x${value.toString(16).toUpperCase().padStart(2, '0')}`;
+}
+
+function int(random: Random, min: number, max: number): number {
+  return min + Math.floor(random() * (max - min + 1));
+}
+
+function pick<T>(random: Random, values: T[]): T {
+  return values[Math.floor(random() * values.length)];
+}
@@ -0,0 +1,140 @@
+/**
+ * Benchmark Statistics
+ *
+ * Sample summaries and Welch's two-sample t-test, used to decide whether a
+ * timing change against a stored baseline is real or noise. The t
+ * distribution tail comes from the regularized incomplete beta function
+ * (continued fraction evaluation, Numerical Recipes 6.4).
+ *
+ * @fileoverview Summary statistics and significance testing
+ */
+
+export interface SampleSummary {
+  n: number;
+  mean: number;
+  stddev: number;
+  median: number;
+  min: number;
+  max: number;
+}
+
+export interface TTestResult {
+  t: number;
+  df: number;
+  /** Two-sided p-value */
+  p: number;
+}
+
+export function summarize(samples: number[]): SampleSummary {
+  const n = samples.length;
+  if (n === 0) {
+    return { n: 0, mean: 0, stddev: 0, median: 0, min: 0, max: 0 };
+  }
+
+  const sorted = samples.slice().sort((a, b) => a - b);
+  const mean = samples.reduce((total, value) => total + value, 0) / n;
+  const variance = n > 1
+    ? samples.reduce((total, value) => total + (value - mean) ** 2, 0) / (n - 1)
+    : 0;
+  const middle = Math.floor(n / 2);
+
+  return {
+    n,
+    mean,
+    stddev: Math.sqrt(variance),
+    median: n % 2 === 0 ? (sorted[middle - 1] + sorted[middle]) / 2 : sorted[middle],
+    min: sorted[0],
+    max: sorted[n - 1]
+  };
+}
+
+/**
+ * Welch's unequal-variance t-test on two independent samples
+ */
+export function welchTTest(a: SampleSummary, b: SampleSummary): TTestResult {
+  if (a.n < 2 || b.n < 2) {
+    return { t: 0, df: 0, p: 1 };
+  }
+
+  const va = (a.stddev * a.stddev) / a.n;
+  const vb = (b.stddev * b.stddev) / b.n;
+  const se = Math.sqrt(va + vb);
+
+  if (se === 0) {
+    return { t: 0, df: a.n + b.n - 2, p: a.mean === b.mean ? 1 : 0 };
+  }
+
+  const t = (a.mean - b.mean) / se;
+  const df = (va + vb) ** 2 / ((va * va) / (a.n - 1) + (vb * vb) / (b.n - 1));
+  const p = incompleteBeta(df / (df + t * t), df / 2, 0.5);
+
+  return { t, df, p: Math.min(1, Math.max(0, p)) };
+}
+
+/**
+ * Regularized incomplete beta function I_x(a, b)
+ */
+function incompleteBeta(x: number, a: number, b: number): number {
+  if (x <= 0) return 0;
+  if (x >= 1) return 1;
+
+  const front = Math.exp(
+    logGamma(a + b) - logGamma(a) - logGamma(b) + a * Math.log(x) + b * Math.log(1 - x)
+  );
+
+  // The continued fraction converges quickly only below this point
+  if (x < (a + 1) / (a + b + 2)) {
+    return (front * betaContinuedFraction(x, a, b)) / a;
+  }
+  return 1 - (front * betaContinuedFraction(1 - x, b, a)) / b;
+}
+
+function betaContinuedFraction(x: number, a: number, b: number): number {
+  const tiny = 1e-30;
+  let c = 1;
+  let d = 1 - ((a + b) * x) / (a + 1);
+  if (Math.abs(d) < tiny) d = tiny;
+  d = 1 / d;
+  let result = d;
+
+  for (let m = 1; m <= 200; m++) {
+    const m2 = 2 * m;
+
+    let term = (m * (b - m) * x) / ((a + m2 - 1) * (a + m2));
+    d = 1 + term * d;
+    if (Math.abs(d) < tiny) d = tiny;
+    c = 1 + term / c;
+    if (Math.abs(c) < tiny) c = tiny;
+    d = 1 / d;
+    result *= d * c;
+
+    term = (-(a + m) * (a + b + m) * x) / ((a + m2) * (a + m2 + 1));
+    d = 1 + term * d;
+    if (Math.abs(d) < tiny) d = tiny;
+    c = 1 + term / c;
+    if (Math.abs(c) < tiny) c = tiny;
+    d = 1 / d;
+    const delta = d * c;
+    result *= delta;
+
+    if (Math.abs(delta - 1) < 1e-12) break;
+  }
+  return result;
+}
+
+/**
+ * Lanczos approximation of ln(Gamma(x)) for x > 0
+ */
+function logGamma(x: number): number {
+  const coefficients = [
+    76.18009172947146, -86.50532032941677, 24.01409824083091,
+    -1.231739572450155, 0.1208650973866179e-2, -0.5395239384953e-5
+  ];
+  let y = x;
+  const tmp = x + 5.5 - (x + 0.5) * Math.log(x + 5.5);
+  let series = 1.000000000190015;
+  for (const coefficient of coefficients) {
+    series += coefficient / ++y;
+  }
+  return -tmp + Math.log((2.5066282746310005 * series) / x);
+}
@@ -0,0 +1,57 @@
+import { RomBundler, DIRECTORY_HEADER_SIZE, DIRECTORY_ENTRY_SIZE } from './bundler';
+
+describe('RomBundler', () => {
+  const image = (name: string, bytes: number[]) => ({ name, binary: new Uint8Array(bytes) });
+
+  test('should write a directory table and place images on aligned bases', () => {
+    const result = new RomBundler({ align: 16 }).bundle([
+      image('FIRST', [0x10, 0x01, 0xFF]),
+      image('SECOND', [0x10, 0x02, 0xFF])
+    ]);
+
+    expect(result.success).toBe(true);
+    expect(Array.from(result.rom.slice(0, 3))).toEqual([0x43, 0x38, 2]);
+
+    const entry = DIRECTORY_HEADER_SIZE + DIRECTORY_ENTRY_SIZE;
+    expect(String.fromCharCode(...Array.from(result.rom.slice(entry, entry + 6)))).toBe('SECOND');
+    expect(result.rom[entry + 6]).toBe(0);
+
+    const base = (result.rom[entry + 8] << 8) | result.rom[entry + 9];
+    expect(base % 16).toBe(0);
+    expect(base).toBe(result.entries[1].base);
+    expect(Array.from(result.rom.slice(base, base + 3))).toEqual([0x10, 0x02, 0xFF]);
+    expect(result.rom[entry + 11]).toBe((0x10 + 0x02 + 0xFF) & 0xFF);
+  });
+
+  test('should store identical programs once', () => {
+    const program = [0x10, 0x48, 0x71, 0x01, 0xFF];
+    const result = new RomBundler().bundle([image('A', program), image('B', program)]);
+
+    expect(result.entries[0].base).toBe(result.entries[1].base);
+    expect(result.entries[1].sharedBytes).toBe(5);
+    expect(result.totalBytes - result.usedBytes).toBe(5);
+  });
+
+  test('should overlap a program whose code matches bytes already placed', () => {
+    // B starts with the routine A ends with
+    const routine = [0x71, 0x01, 0x72];
+    const result = new RomBundler({ align: 1 }).bundle([
+      image('A', [0x10, 0x05, 0x10, 0x06, ...routine]),
+      image('B', [...routine, 0xFF])
+    ]);
+
+    expect(result.entries[1].base).toBe(result.entries[0].base + 4);
+    expect(result.entries[1].sharedBytes).toBe(3);
+  });
+
+  test('should report images that do not fit', () => {
+    const full = new Array(256).fill(0);
+    const result = new RomBundler({ romSize: 512 }).bundle([
+      image('A', full.map(() => 1)),
+      image('B', full.map(() => 2))
+    ]);
+
+    expect(result.success).toBe(false);
+    expect(result.errors[0]).toContain('does not fit');
+  });
+});
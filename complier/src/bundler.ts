@@ -0,0 +1,232 @@
+/**
+ * Multi-Program ROM Bundler
+ *
+ * Packs several compiled program images into one ROM (28C256: 32 KB) that
+ * a boot loader picks from. The CPU sees 256 bytes at a time. The boot
+ * loader selects a program by mapping that window at the program's base
+ * address, which must be a multiple of `align`.
+ *
+ * ROM layout:
+ *
+ *   0x0000  Directory header: 'C' '8' <count>
+ *   0x0003  <count> entries of 12 bytes:
+ *             name[8] (ASCII, zero padded)
+ *             base (2 bytes, big-endian)
+ *             length (1 byte, 0 = 256)
+ *             checksum (1 byte, sum of image bytes mod 256)
+ *   ...     Program images, then 0xFF (erased EEPROM) fill
+ *
+ * Deduplication: each image goes at the lowest aligned base where every one
+ * of its bytes is either unused or already holds the same value. Identical
+ * programs share one copy. A program whose leading code (e.g. a shared I/O
+ * routine) matches code already placed at a compatible offset overlaps it
+ * instead of repeating it. Larger images are placed first; directory order
+ * follows the input order.
+ *
+ * @fileoverview ROM packing with directory table and overlap deduplication
+ */
+
+export interface RomImage {
+  /** Directory name (up to 8 ASCII characters) */
+  name: string;
+  binary: Uint8Array;
+}
+
+export interface BundleOptions {
+  /** ROM capacity in bytes */
+  romSize?: number;
+  /** Base address granularity supported by the boot loader */
+  align?: number;
+  /** Byte value of unprogrammed ROM */
+  fill?: number;
+}
+
+export interface BundleEntry {
+  name: string;
+  base: number;
+  length: number;
+  checksum: number;
+  /** Bytes that overlapped existing ROM contents */
+  sharedBytes: number;
+}
+
+export interface BundleResult {
+  success: boolean;
+  /** ROM contents up to the last used byte */
+  rom: Uint8Array;
+  entries: BundleEntry[];
+  /** Bytes the images and directory would take without deduplication */
+  totalBytes: number;
+  /** Bytes actually used in the ROM */
+  usedBytes: number;
+  errors: string[];
+}
+
+export const DIRECTORY_HEADER_SIZE = 3;
+export const DIRECTORY_ENTRY_SIZE = 12;
+const NAME_LENGTH = 8;
+const WINDOW_SIZE = 256;
+
+export class RomBundler {
+  private options: Required<BundleOptions>;
+
+  constructor(options: BundleOptions = {}) {
+    this.options = {
+      romSize: options.romSize || 32768,
+      align: options.align || 16,
+      fill: options.fill !== undefined ? options.fill : 0xFF
+    };
+  }
+
+  bundle(images: RomImage[]): BundleResult {
+    const result: BundleResult = {
+      success: false,
+      rom: new Uint8Array(0),
+      entries: [],
+      totalBytes: 0,
+      usedBytes: 0,
+      errors: []
+    };
+
+    const { romSize, align, fill } = this.options;
+    if (images.length === 0) {
+      result.errors.push('No images to bundle');
+      return result;
+    }
+    if (images.length > 255) {
+      result.errors.push(`Too many images: ${images.length} (directory holds at most 255)`);
+      return result;
+    }
+
+    for (const image of images) {
+      if (image.binary.length === 0 || image.binary.length > WINDOW_SIZE) {
+        result.errors.push(`Image '${image.name}' is ${image.binary.length} bytes; must be 1-${WINDOW_SIZE}`);
+      }
+      if (!/^[\x20-\x7E]{1,8}$/.test(image.name)) {
+        result.errors.push(`Image name '${image.name}' must be 1-${NAME_LENGTH} printable ASCII characters`);
+      }
+    }
+    if (result.errors.length > 0) {
+      return result;
+    }
+
+    const directorySize = DIRECTORY_HEADER_SIZE + images.length * DIRECTORY_ENTRY_SIZE;
+    const rom = new Uint8Array(romSize).fill(fill);
+    const used = new Uint8Array(romSize);
+    used.fill(1, 0, directorySize);
+
+    // Place larger images first so smaller ones can fill in around them
+    const order = images.map((_image, index) => index)
+      .sort((a, b) => images[b].binary.length - images[a].binary.length || a - b);
+    const bases: number[] = new Array(images.length);
+    const shared: number[] = new Array(images.length);
+
+    for (const index of order) {
+      const binary = images[index].binary;
+      const base = this.findBase(binary, rom, used, alignUp(directorySize, align));
+
+      if (base < 0) {
+        result.errors.push(`Image '${images[index].name}' does not fit in ${romSize} bytes of ROM`);
+        return result;
+      }
+
+      let overlap = 0;
+      for (let i = 0; i < binary.length; i++) {
+        if (used[base + i]) {
+          overlap++;
+        }
+        rom[base + i] = binary[i];
+        used[base + i] = 1;
+      }
+      bases[index] = base;
+      shared[index] = overlap;
+    }
+
+    // Directory table
+    rom[0] = 'C'.charCodeAt(0);
+    rom[1] = '8'.charCodeAt(0);
+    rom[2] = images.length;
+    images.forEach((image, index) => {
+      const offset = DIRECTORY_HEADER_SIZE + index * DIRECTORY_ENTRY_SIZE;
+      const checksum = image.binary.reduce((sum, byte) => (sum + byte) & 0xFF, 0);
+
+      for (let i = 0; i < NAME_LENGTH; i++) {
+        rom[offset + i] = i < image.name.length ? image.name.charCodeAt(i) : 0;
+      }
+      rom[offset + 8] = (bases[index] >> 8) & 0xFF;
+      rom[offset + 9] = bases[index] & 0xFF;
+      rom[offset + 10] = image.binary.length & 0xFF;
+      rom[offset + 11] = checksum;
+
+      result.entries.push({
+        name: image.name,
+        base: bases[index],
+        length: image.binary.length,
+        checksum,
+        sharedBytes: shared[index]
+      });
+    });
+
+    let end = romSize;
+    while (end > 0 && !used[end - 1]) {
+      end--;
+    }
+
+    result.rom = rom.slice(0, end);
+    result.totalBytes = directorySize + images.reduce((total, image) => total + image.binary.length, 0);
+    result.usedBytes = used.reduce((total, flag) => total + flag, 0);
+    result.success = true;
+    return result;
+  }
+
+  /**
+   * Lowest aligned base where `binary` agrees with everything already placed
+   */
+  private findBase(binary: Uint8Array, rom: Uint8Array, used: Uint8Array, start: number): number {
+    const { romSize, align } = this.options;
+
+    for (let base = start; base + binary.length <= romSize; base += align) {
+      let fits = true;
+      for (let i = 0; i < binary.length; i++) {
+        if (used[base + i] && rom[base + i] !== binary[i]) {
+          fits = false;
+          break;
+        }
+      }
+      if (fits) {
+        return base;
+      }
+    }
+    return -1;
+  }
+}
+
+export function formatBundleReport(result: BundleResult): string {
+  const lines: string[] = [];
+  lines.push('Name      Base    Length  Shared  Checksum');
+
+  for (const entry of result.entries) {
+    lines.push(
+      `${entry.name.padEnd(10)}` +
+      `0x${entry.base.toString(16).padStart(4, '0').toUpperCase()}  ` +
+      `${String(entry.length).padStart(6)}  ` +
+      `${String(entry.sharedBytes).padStart(6)}  ` +
+      `0x${entry.checksum.toString(16).padStart(2, '0').toUpperCase()}`
+    );
+  }
+
+  const saved = result.totalBytes - result.usedBytes;
+  const percent = result.totalBytes > 0 ? (saved / result.totalBytes) * 100 : 0;
+  lines.push('');
+  lines.push(`ROM used: ${result.usedBytes} of ${result.totalBytes} bytes (${saved} saved, ${percent.toFixed(1)}%)`);
+  return lines.join('\n');
+}
+
+function alignUp(value: number, align: number): number {
+  return Math.ceil(value / align) * align;
+}
+
+// Factory function for easier usage
+export function createRomBundler(options: BundleOptions = {}): RomBundler {
+  return new RomBundler(options);
+}
@@ -39,91 +39,311 @@
  */
 
 import { Command } from 'commander';
-import { CPU8BitCompiler } from './compiler';
+import { CPU8BitCompiler, generateIntelHex } from './compiler';
 import { HighLevelCompiler } from './languages/high-level-compiler';
+import { defaultSocketPath } from './client';
+import { loadSource } from './includes';
+import { BuildWatcher, FileCompiler } from './watcher';
+import { formatTimeReport } from './time-report';
+import { RomBundler, RomImage, formatBundleReport } from './bundler';
+import { readImage, writeDelta } from './rom-delta';
+import { OptimizationLevel } from './ir/pass-manager';
+import { BlockMap, BlockProfile, recordProfile } from './ir/profile';
+import { runBinary } from './emulator';
 import * as fs from 'fs';
 import * as path from 'path';
 
-const program = new Command();
-
-program
-  .name('cpu8bit')
-  .description('CPU 8-Bit Compiler - Compile assembly and high-level languages to binary')
-  .version('1.0.0');
-
-program
-  .command('compile')
-  .alias('c')
-  .description('Compile a source file to binary')
-  .argument('<input>', 'Input source file')
-  .option('-o, --output <dir>', 'Output directory', '.')
-  .option('-f, --format <format>', 'Output format (bin, hex, both)', 'bin')
-  .option('-l, --language <lang>', 'Source language (asm, c)', 'auto')
-  .option('-k, --keep-asm', 'Keep generated assembly file')
-  .option('-v, --verbose', 'Verbose output')
-  .action((input, options) => {
-    compileFile(input, options);
-  });
+export interface CompileOutcome {
+  exitCode: number;
+  outputFiles: string[];
+}
 
-program
-  .command('example')
-  .description('Generate example source files')
-  .option('-o, --output <dir>', 'Output directory', '.')
-  .option('-l, --language <lang>', 'Language for examples (asm, c, all)', 'all')
-  .action((options) => {
-    generateExamples(options.output, options.language);
-  });
+export interface CliHandlers {
+  /** Called with a non-zero code when a command fails */
+  exit: (code: number) => void;
+  /** Runs one `compile` command */
+  compile: (inputPath: string, options: any) => CompileOutcome;
+  /** Runs `compile --watch`, which does not return until interrupted */
+  watch: (inputs: string[], options: any) => void;
+}
+
+/**
+ * Builds the command tree. The daemon reuses this to run forwarded argv
+ * in-process, so actions report failures through `exit` instead of
+ * terminating the process themselves.
+ */
+export function createProgram(handlers: Partial<CliHandlers> = {}): Command {
+  const exit = handlers.exit || ((code: number) => process.exit(code));
+  const compile = handlers.compile || compileFile;
+  const watch = handlers.watch || watchFiles;
+  const program = new Command();
+
+  program
+    .name('cpu8bit')
+    .description('CPU 8-Bit Compiler - Compile assembly and high-level languages to binary')
+    .version('1.0.0');
+
+  program
+    .command('compile')
+    .alias('c')
+    .description('Compile a source file to binary')
+    .argument('<inputs...>', 'Input source files')
+    .option('-o, --output <dir>', 'Output directory', '.')
+    .option('-f, --format <format>', 'Output format (bin, hex, both)', 'bin')
+    .option('-l, --language <lang>', 'Source language (asm, c)', 'auto')
+    .option('-k, --keep-asm', 'Keep generated assembly file')
+    .option('-O, --optimize <level>', 'Optimization level for C sources (0, 1, 2)', '0')
+    .option('--dump-ir', 'Print the IR of C sources after optimization passes')
+    .option('-v, --verbose', 'Verbose output')
+    .option('-w, --watch', 'Rebuild outputs when their sources or includes change')
+    .option('--debounce <ms>', 'Delay before rebuilding after a change (watch mode)', '50')
+    .option('--time-report', 'Print per-phase time, heap and counts; write <name>.time.json')
+    .option('--stats', 'Alias for --time-report')
+    .option('--delta [previous]', 'Also emit only the changed ROM pages against the previous build (or the given .bin/.hex)')
+    .option('--page-size <bytes>', 'EEPROM page size for --delta', '64')
+    .option('--profile-generate', 'Keep a label on every block of C sources; write <name>.blocks.json for `run --profile`')
+    .option('--profile-use <file>', 'Optimize C sources with the block counts of a <name>.profile.json')
+    .action((inputs: string[], options) => {
+      if (options.watch) {
+        watch(inputs, options);
+        return;
+      }
+
+      let exitCode = 0;
+      for (const input of inputs) {
+        const outcome = compile(input, options);
+        if (outcome.exitCode !== 0 && exitCode === 0) {
+          exitCode = outcome.exitCode;
+        }
+      }
+      if (exitCode !== 0) {
+        exit(exitCode);
+      }
+    });
+
+  program
+    .command('example')
+    .description('Generate example source files')
+    .option('-o, --output <dir>', 'Output directory', '.')
+    .option('-l, --language <lang>', 'Language for examples (asm, c, all)', 'all')
+    .action((options) => {
+      generateExamples(options.output, options.language);
+    });
+
+  program
+    .command('bundle')
+    .description('Pack several programs into one ROM image with a directory table')
+    .argument('<inputs...>', 'Program sources or compiled .bin images')
+    .option('-o, --output <file>', 'ROM output file (.hex or .bin)', 'rom.hex')
+    .option('-l, --language <lang>', 'Source language (asm, c)', 'auto')
+    .option('-O, --optimize <level>', 'Optimization level for C sources (0, 1, 2)', '0')
+    .option('--size <bytes>', 'ROM capacity', '32768')
+    .option('--align <bytes>', 'Program base alignment supported by the boot loader', '16')
+    .option('--delta [previous]', 'Also emit only the changed ROM pages against the previous ROM (or the given .bin/.hex)')
+    .option('--page-size <bytes>', 'EEPROM page size for --delta', '64')
+    .action((inputs: string[], options) => {
+      const exitCode = bundleFiles(inputs, options);
+      if (exitCode !== 0) {
+        exit(exitCode);
+      }
+    });
+
+  program
+    .command('delta')
+    .description('Emit only the ROM pages that differ between two images')
+    .argument('<previous>', 'Image currently in the ROM (.bin or .hex)')
+    .argument('<next>', 'New image (.bin or .hex)')
+    .option('-o, --output <base>', 'Output base path (default: next image without extension)')
+    .option('--page-size <bytes>', 'EEPROM page size', '64')
+    .action((previousPath: string, nextPath: string, options) => {
+      try {
+        const parsed = path.parse(nextPath);
+        const basePath = options.output || path.join(parsed.dir, parsed.name);
+        const { delta, files } = writeDelta(readImage(previousPath), readImage(nextPath), basePath, {
+          pageSize: parseInt(options.pageSize, 10)
+        });
+        console.log(`${delta.pages.length} of ${delta.totalPages} page(s) changed`);
+        files.forEach((file) => console.log(`  ${file}`));
+      } catch (error) {
+        console.error(`Delta failed: ${error}`);
+        exit(2);
+      }
+    });
+
+  program
+    .command('run')
+    .description('Run a compiled image in the emulator')
+    .argument('<image>', 'Compiled program (.bin or .hex)')
+    .option('-i, --input <port=values>', 'Values read by IN on a port, comma separated (repeatable)', collectInputs, {})
+    .option('--max-steps <n>', 'Instructions executed before giving up', '1000000')
+    .option('--profile <blocks>', 'Add the block counts of this run to the .profile.json next to a .blocks.json')
+    .action((imagePath: string, options) => {
+      try {
+        const image = readImage(imagePath);
+        const result = runBinary(image, {
+          inputs: options.input,
+          maxSteps: parseInt(options.maxSteps, 10)
+        });
+        result.outputs.forEach(({ port, value }) => console.log(`OUT ${port}: ${value}`));
+        console.log(`${result.halted ? 'Halted' : 'Stopped'} after ${result.steps} instruction(s), ${result.cycles} cycle(s)`);
+
+        if (options.profile) {
+          const map: BlockMap = JSON.parse(fs.readFileSync(options.profile, 'utf-8'));
+          const profilePath = options.profile.replace(/(\.blocks)?\.json$/, '') + '.profile.json';
+          const previous: BlockProfile | undefined = fs.existsSync(profilePath)
+            ? JSON.parse(fs.readFileSync(profilePath, 'utf-8'))
+            : undefined;
+          const profile = recordProfile(map, image, result.executions, previous);
+          fs.writeFileSync(profilePath, JSON.stringify(profile, null, 2) + '\n');
+          console.log(`Profile of ${profile.runs} run(s) saved to: ${profilePath}`);
+        }
+        if (!result.halted) {
+          exit(1);
+        }
+      } catch (error) {
+        console.error(`Run failed: ${error}`);
+        exit(2);
+      }
+    });
+
+  program
+    .command('bench')
+    .description('Measure compiler throughput on a seeded synthetic corpus')
+    .option('-n, --iterations <n>', 'Measured passes per benchmark', '20')
+    .option('--warmup <n>', 'Unmeasured warmup passes', '5')
+    .option('--seed <n>', 'Corpus generator seed', '1')
+    .option('--scale <n>', 'Corpus size multiplier', '1')
+    .option('--filter <text>', 'Only run benchmarks whose name contains text')
+    .option('--save <file>', 'Write results as JSON')
+    .option('--baseline <file>', 'Compare against results saved with --save')
+    .option('--fail-on-regression', 'Exit with code 1 if any benchmark is significantly slower')
+    .action((options) => {
+      // Loaded lazily like the daemon; only benchmark runs need the harness
+      const bench = require('./bench/benchmark');
+      const scale = parseFloat(options.scale);
+      const report = bench.runBenchmarks({
+        iterations: parseInt(options.iterations, 10),
+        warmup: parseInt(options.warmup, 10),
+        filter: options.filter,
+        corpus: {
+          seed: parseInt(options.seed, 10),
+          assemblyPrograms: Math.max(1, Math.round(200 * scale)),
+          cPrograms: Math.max(1, Math.round(4 * scale))
+        }
+      });
+      console.log(bench.formatBenchmarkReport(report));
 
-async function compileFile(inputPath: string, options: any) {
+      if (options.save) {
+        fs.writeFileSync(options.save, JSON.stringify(report, null, 2) + '\n');
+        console.log(`Results saved to: ${options.save}`);
+      }
+
+      if (options.baseline) {
+        if (!fs.existsSync(options.baseline)) {
+          console.error(`Error: Baseline file '${options.baseline}' not found`);
+          exit(2);
+          return;
+        }
+        const baseline = JSON.parse(fs.readFileSync(options.baseline, 'utf-8'));
+        if (JSON.stringify(baseline.corpus) !== JSON.stringify(report.corpus)) {
+          console.error('Warning: baseline was recorded with a different corpus');
+        }
+        const comparisons = bench.compareReports(report, baseline);
+        console.log(bench.formatComparison(comparisons));
+
+        if (options.failOnRegression && comparisons.some((comparison: any) => comparison.verdict === 'slower')) {
+          exit(1);
+        }
+      }
+    });
+
+  program
+    .command('superopt')
+    .description('Search compiled C programs for sequences with shorter equivalents; print peephole rules')
+    .argument('<inputs...>', 'C sources to compile and harvest')
+    .option('-O, --optimize <level>', 'Optimization level to compile at (0, 1, 2)', '1')
+    .option('--max-length <n>', 'Longest replacement searched, in instructions', '3')
+    .option('--min-count <n>', 'Only search sequences seen at least this often', '1')
+    .action((inputs: string[], options) => {
+      // Loaded lazily like the benchmarks; an offline tool, not part of compiles
+      const { superoptimizePrograms } = require('./superopt');
+      try {
+        const found = superoptimizePrograms(inputs.map((input) => loadSource(input).source), {
+          optimizationLevel: parseInt(options.optimize, 10) as OptimizationLevel,
+          maxLength: parseInt(options.maxLength, 10),
+          minCount: parseInt(options.minCount, 10)
+        });
+        for (const { sequence, result } of found) {
+          const best = result.rules[0];
+          console.log(`# ${sequence.count}x, saves ${best.bytesSaved} byte(s) and ${best.cyclesSaved} cycle(s)`);
+          result.rules.forEach((rule: { rule: string }) => console.log(rule.rule));
+        }
+        console.log(`# ${found.length} rule target(s) found`);
+      } catch (error) {
+        console.error(`Superoptimizer failed: ${error}`);
+        exit(2);
+      }
+    });
+
+  program
+    .command('serve')
+    .description('Run a persistent compiler daemon on a local socket')
+    .option('-s, --socket <path>', 'Socket path', defaultSocketPath())
+    .option('-v, --verbose', 'Log each request')
+    .action((options) => {
+      // Loaded lazily so one-shot compiles don't pay for the server module
+      const { CompileDaemon } = require('./daemon');
+      new CompileDaemon({ socketPath: options.socket, verbose: options.verbose })
+        .listen()
+        .catch((error: Error) => {
+          console.error(`Failed to start daemon: ${error.message}`);
+          exit(2);
+        });
+    });
+
+  return program;
+}
+
+export function compileFile(inputPath: string, options: any): CompileOutcome {
   try {
     if (!fs.existsSync(inputPath)) {
       console.error(`Error: Input file '${inputPath}' not found`);
-      process.exit(1);
+      return { exitCode: 1, outputFiles: [] };
     }
 
-    const sourceCode = fs.readFileSync(inputPath, 'utf-8');
+    const sourceCode = loadSource(inputPath).source;
     const filename = path.parse(inputPath).name;
-    const extension = path.parse(inputPath).ext.toLowerCase();
-
-    // Determine language
-    let language = options.language;
-    if (language === 'auto') {
-      switch (extension) {
-        case '.s':
-        case '.asm':
-          language = 'asm';
-          break;
-        case '.c':
-        case '.h':
-          language = 'c';
-          break;
-        default:
-          language = 'asm'; // Default to assembly
-      }
-    }
-
-    let result: any;
+    const basePath = path.join(options.output, filename);
+    // Read before compiling; the build overwrites the previous image
+    // The default previous image is the one this output format writes
+    const extensions = options.format === 'hex' ? ['.hex'] : options.format === 'bin' ? ['.bin'] : ['.bin', '.hex'];
+    const previous = options.delta
+      ? readPreviousImage(options.delta, extensions.map((extension) => basePath + extension))
+      : null;
+    const compiler = createFileCompiler(inputPath, options);
+    const result = compiler.compile(sourceCode, filename);
 
-    if (language === 'asm') {
-      // Use original assembly compiler
-      const compiler = new CPU8BitCompiler({
-        outputFormat: options.format,
-        outputDir: options.output,
-        verbose: options.verbose
-      });
+    if (previous && result.success && result.binary) {
+      emitDelta(previous, result.binary, basePath, options, result.outputFiles);
+    }
 
-      result = compiler.compile(sourceCode, filename);
-    } else {
-      // Use high-level compiler
-      const compiler = new HighLevelCompiler({
-        language: language,
-        outputFormat: options.format,
-        outputDir: options.output,
-        verbose: options.verbose,
-        keepAssembly: options.keepAsm
-      });
+    const irDump = options.dumpIr && compiler.getIRDump ? compiler.getIRDump() : null;
+    if (irDump) {
+      console.log(`IR: ${inputPath}`);
+      console.log(irDump);
+    }
 
-      result = compiler.compile(sourceCode, filename);
+    const report = compiler.getTimeReport ? compiler.getTimeReport() : null;
+    if (report) {
+      console.log(formatTimeReport(report, inputPath));
+      const reportPath = path.join(options.output, filename + '.time.json');
+      fs.writeFileSync(reportPath, JSON.stringify({
+        file: inputPath,
+        timestamp: new Date().toISOString(),
+        success: result.success,
+        ...report
+      }, null, 2) + '\n');
+      result.outputFiles.push(reportPath);
     }
 
     if (result.success) {
@@ -135,13 +355,170 @@ async function compileFile(inputPath: string, options: any) {
     } else {
       console.error('Compilation failed:');
       result.errors.forEach((error: string) => console.error(`  ${error}`));
-      process.exit(1);
+      return { exitCode: 1, outputFiles: result.outputFiles };
     }
 
+    return { exitCode: 0, outputFiles: result.outputFiles };
   } catch (error) {
     console.error(`Compilation error: ${error}`);
-    process.exit(1);
+    return { exitCode: 1, outputFiles: [] };
+  }
+}
+
+export function watchFiles(inputs: string[], options: any): void {
+  new BuildWatcher(inputs, (input) => createFileCompiler(input, options), {
+    debounceMs: parseInt(options.debounce, 10),
+    extraDependencies: options.profileUse ? [options.profileUse] : []
+  }).start();
+}
+
+export function bundleFiles(inputs: string[], options: any): number {
+  const images: RomImage[] = [];
+
+  for (const input of inputs) {
+    if (!fs.existsSync(input)) {
+      console.error(`Error: Input file '${input}' not found`);
+      return 1;
+    }
+
+    const name = path.parse(input).name.slice(0, 8);
+    if (path.extname(input).toLowerCase() === '.bin') {
+      images.push({ name, binary: new Uint8Array(fs.readFileSync(input)) });
+      continue;
+    }
+
+    // Compile in memory; only the ROM is written
+    const compiler = createFileCompiler(input, { ...options, format: 'bin', output: '.' });
+    const result = compiler.compile(loadSource(input).source);
+    if (!result.success || !result.binary) {
+      console.error(`Compilation of ${input} failed:`);
+      result.errors.forEach((error: string) => console.error(`  ${error}`));
+      return 1;
+    }
+    images.push({ name, binary: result.binary });
+  }
+
+  const result = new RomBundler({
+    romSize: parseInt(options.size, 10),
+    align: parseInt(options.align, 10)
+  }).bundle(images);
+
+  if (!result.success) {
+    console.error('Bundling failed:');
+    result.errors.forEach((error) => console.error(`  ${error}`));
+    return 1;
+  }
+
+  const previous = options.delta ? readPreviousImage(options.delta, [options.output]) : null;
+
+  if (path.extname(options.output).toLowerCase() === '.bin') {
+    fs.writeFileSync(options.output, result.rom);
+  } else {
+    fs.writeFileSync(options.output, generateIntelHex(result.rom));
+  }
+
+  console.log(formatBundleReport(result));
+  console.log(`ROM written to: ${options.output}`);
+
+  if (previous) {
+    const parsed = path.parse(options.output);
+    const files: string[] = [];
+    emitDelta(previous, result.rom, path.join(parsed.dir, parsed.name), options, files);
+    files.forEach((file) => console.log(`  ${file}`));
+  }
+  return 0;
+}
+
+/**
+ * Image to diff against for --delta: the given file, else the first
+ * existing default, else an empty (fully erased) ROM
+ */
+function readPreviousImage(option: string | boolean, defaults: string[]): Uint8Array {
+  if (typeof option === 'string') {
+    return readImage(option);
+  }
+  const existing = defaults.find((file) => fs.existsSync(file));
+  return existing ? readImage(existing) : new Uint8Array(0);
+}
+
+function emitDelta(previous: Uint8Array, next: Uint8Array, basePath: string, options: any, outputFiles: string[]): void {
+  const { delta, files } = writeDelta(previous, next, basePath, { pageSize: parseInt(options.pageSize, 10) });
+  console.log(`Delta: ${delta.pages.length} of ${delta.totalPages} page(s) changed`);
+  outputFiles.push(...files);
+}
+
+/**
+ * Picks the compiler for an input from --language or its extension
+ */
+export function createFileCompiler(inputPath: string, options: any): FileCompiler {
+  const extension = path.parse(inputPath).ext.toLowerCase();
+
+  // Determine language
+  let language = options.language;
+  if (language === 'auto') {
+    switch (extension) {
+      case '.s':
+      case '.asm':
+        language = 'asm';
+        break;
+      case '.c':
+      case '.h':
+        language = 'c';
+        break;
+      default:
+        language = 'asm'; // Default to assembly
+    }
+  }
+
+  if (language === 'asm') {
+    // Use original assembly compiler
+    return new CPU8BitCompiler({
+      outputFormat: options.format,
+      outputDir: options.output,
+      verbose: options.verbose,
+      incremental: options.watch,
+      timeReport: wantsTimeReport(options)
+    });
+  }
+
+  // Use high-level compiler
+  return new HighLevelCompiler({
+    language: language,
+    outputFormat: options.format,
+    outputDir: options.output,
+    verbose: options.verbose,
+    keepAssembly: options.keepAsm,
+    timeReport: wantsTimeReport(options),
+    optimizationLevel: parseOptimizationLevel(options.optimize),
+    dumpIR: Boolean(options.dumpIr),
+    profileGenerate: Boolean(options.profileGenerate),
+    profile: options.profileUse ? JSON.parse(fs.readFileSync(options.profileUse, 'utf-8')) : null
+  });
+}
+
+/**
+ * Accumulates `-i port=v1,v2` options into emulator inputs
+ */
+function collectInputs(value: string, inputs: Record<number, number[]>): Record<number, number[]> {
+  const match = value.match(/^(\d+)=(.*)$/);
+  if (!match) {
+    throw new Error(`Invalid input: ${value} (expected port=v1,v2,...)`);
+  }
+  const port = Number(match[1]);
+  const values = match[2] === '' ? [] : match[2].split(',').map((text) => Number(text.trim()));
+  return { ...inputs, [port]: [...(inputs[port] || []), ...values] };
+}
+
+export function wantsTimeReport(options: any): boolean {
+  return Boolean(options.timeReport || options.stats);
+}
+
+function parseOptimizationLevel(value: string | undefined): OptimizationLevel {
+  const level = value === undefined ? 0 : Number(value);
+  if (level !== 0 && level !== 1 && level !== 2) {
+    throw new Error(`Invalid optimization level: ${value} (expected 0, 1 or 2)`);
   }
+  return level as OptimizationLevel;
 }
 
 function generateExamples(outputDir: string, language: string) {
@@ -293,4 +670,6 @@ void main() {
   }
 }
 
-program.parse();
\ No newline at end of file
+if (require.main === module) {
+  createProgram().parse();
+}
\ No newline at end of file
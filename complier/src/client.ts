@@ -0,0 +1,112 @@
+#!/usr/bin/env node
+
+/**
+ * Thin Client for the CPU 8-Bit Compiler Daemon
+ *
+ * Forwards its argv to a running `cpu8bit serve` daemon over a local Unix
+ * socket and streams the daemon's output back. Only Node built-ins are loaded
+ * on this path, so a warm compile costs one socket round trip instead of a
+ * full module graph load.
+ *
+ * Protocol (newline-delimited JSON):
+ *   client -> daemon: { "argv": [...], "cwd": "/abs/dir" }
+ *   daemon -> client: { "stdout": "..." } | { "stderr": "..." } ... { "exit": 0 }
+ *
+ * When no daemon is listening the client falls back to running the regular
+ * CLI in-process, so it is always safe to use in build scripts.
+ *
+ * Environment:
+ *   CPU8BIT_SOCKET  Override the socket path
+ *
+ * @fileoverview Daemon client with in-process fallback
+ */
+
+import * as net from 'net';
+import * as os from 'os';
+import * as path from 'path';
+
+export interface DaemonRequest {
+  argv: string[];
+  cwd: string;
+}
+
+export interface DaemonMessage {
+  stdout?: string;
+  stderr?: string;
+  exit?: number;
+}
+
+export function defaultSocketPath(): string {
+  if (process.env.CPU8BIT_SOCKET) {
+    return process.env.CPU8BIT_SOCKET;
+  }
+  const user = typeof process.getuid === 'function' ? process.getuid() : os.userInfo().username;
+  return path.join(os.tmpdir(), `cpu8bit-${user}.sock`);
+}
+
+/**
+ * Sends one request to the daemon and streams its output to the given sinks.
+ *
+ * Resolves with the daemon's exit code, or rejects if no daemon accepts the
+ * connection (ENOENT / ECONNREFUSED) so callers can fall back.
+ */
+export function runRemote(
+  request: DaemonRequest,
+  socketPath: string = defaultSocketPath(),
+  stdout: (text: string) => void = (text) => process.stdout.write(text),
+  stderr: (text: string) => void = (text) => process.stderr.write(text)
+): Promise<number> {
+  return new Promise((resolve, reject) => {
+    const socket = net.createConnection(socketPath);
+    let buffered = '';
+    let exitCode: number | null = null;
+
+    socket.setEncoding('utf-8');
+    socket.on('connect', () => {
+      socket.write(JSON.stringify(request) + '\n');
+    });
+    socket.on('data', (chunk) => {
+      buffered += chunk;
+      let newline: number;
+      while ((newline = buffered.indexOf('\n')) !== -1) {
+        const line = buffered.slice(0, newline);
+        buffered = buffered.slice(newline + 1);
+        if (!line) continue;
+
+        const message: DaemonMessage = JSON.parse(line);
+        if (message.stdout !== undefined) stdout(message.stdout);
+        if (message.stderr !== undefined) stderr(message.stderr);
+        if (message.exit !== undefined) exitCode = message.exit;
+      }
+    });
+    socket.on('error', reject);
+    socket.on('close', () => {
+      if (exitCode === null) {
+        reject(new Error('Daemon closed the connection without an exit status'));
+      } else {
+        resolve(exitCode);
+      }
+    });
+  });
+}
+
+async function main(): Promise<void> {
+  const argv = process.argv.slice(2);
+
+  try {
+    process.exitCode = await runRemote({ argv, cwd: process.cwd() });
+  } catch (error: any) {
+    if (error && (error.code === 'ENOENT' || error.code === 'ECONNREFUSED')) {
+      // No daemon: behave exactly like the regular CLI
+      const { createProgram } = require('./cli');
+      createProgram().parse(argv, { from: 'user' });
+      return;
+    }
+    console.error(`Daemon error: ${error}`);
+    process.exitCode = 4;
+  }
+}
+
+if (require.main === module) {
+  main();
+}
@@ -60,4 +60,17 @@ describe('CPU8BitCompiler', () => {
     expect(result.binary![5]).toBe(3);
     expect(result.binary![6]).toBe(0xFF); // HLT
   });
-});
\ No newline at end of file
+
+  test('should report per-phase timings and counts when enabled', () => {
+    const timed = new CPU8BitCompiler({ timeReport: true });
+    const result = timed.compile('START:\n  LDI 1\n  JMP START\n');
+
+    expect(result.success).toBe(true);
+    const report = timed.getTimeReport()!;
+    expect(report.sourceLines).toBe(3);
+    expect(report.phases.map((phase) => phase.name)).toEqual(['tokenize', 'parse', 'generate']);
+    expect(report.phases[1].counts).toEqual({ instructions: 2, labels: 1, directives: 0 });
+    expect(report.phases[2].counts.bytes).toBe(4);
+    expect(compiler.getTimeReport()).toBeNull();
+  });
+});
@@ -35,8 +35,11 @@
  */
 
 import { Tokenizer } from './tokenizer';
-import { Parser } from './parser';
+import { Parser, ParseResult } from './parser';
 import { generateBinary, CodeGenResult } from './code-generator';
+import { IncrementalParser, IncrementalStats } from './incremental';
+import { loadSource } from './includes';
+import { PhaseTimer, TimeReport, measure } from './time-report';
 import * as fs from 'fs';
 import * as path from 'path';
 
@@ -44,6 +47,10 @@ export interface CompilerOptions {
   outputFormat?: 'bin' | 'hex' | 'both';
   outputDir?: string;
   verbose?: boolean;
+  /** Reuse per-line tokens/parses across compile() calls (watch mode) */
+  incremental?: boolean;
+  /** Record per-phase time, heap and counts (--time-report) */
+  timeReport?: boolean;
 }
 
 export interface CompilerResult {
@@ -56,13 +63,35 @@ export interface CompilerResult {
 
 export class CPU8BitCompiler {
   private options: Required<CompilerOptions>;
+  private incrementalParser: IncrementalParser | null = null;
+  private lastTimeReport: TimeReport | null = null;
 
   constructor(options: CompilerOptions = {}) {
     this.options = {
       outputFormat: options.outputFormat || 'bin',
       outputDir: options.outputDir || '.',
-      verbose: options.verbose || false
+      verbose: options.verbose || false,
+      incremental: options.incremental || false,
+      timeReport: options.timeReport || false
     };
+
+    if (this.options.incremental) {
+      this.incrementalParser = new IncrementalParser();
+    }
+  }
+
+  /**
+   * Line reuse counters for the last compile(), when incremental
+   */
+  getIncrementalStats(): IncrementalStats | null {
+    return this.incrementalParser ? this.incrementalParser.getStats() : null;
+  }
+
+  /**
+   * Phase timings of the last compile(), when timeReport is enabled
+   */
+  getTimeReport(): TimeReport | null {
+    return this.lastTimeReport;
   }
 
   compile(sourceCode: string, filename?: string): CompilerResult {
@@ -73,21 +102,34 @@ export class CPU8BitCompiler {
       outputFiles: []
     };
 
+    const timer = this.options.timeReport ? new PhaseTimer(sourceCode) : null;
+    this.lastTimeReport = null;
     try {
-      // Step 1: Tokenize
-      if (this.options.verbose) {
-        console.log('Tokenizing source code...');
-      }
-      const tokenizer = new Tokenizer(sourceCode);
-      const tokens = tokenizer.tokenize();
+      // Steps 1-2: Tokenize and parse
+      const parseResult = this.parseSource(sourceCode, timer);
+      return this.assemble(parseResult, filename, timer);
 
-      // Step 2: Parse
-      if (this.options.verbose) {
-        console.log('Parsing tokens...');
-      }
-      const parser = new Parser(tokens);
-      const parseResult = parser.parse();
+    } catch (error) {
+      result.errors.push(`Compilation failed: ${error}`);
+      return result;
+    }
+  }
 
+  /**
+   * Runs code generation and output on an already parsed program.
+   * Front ends that build a ParseResult in memory (see assembly-stream.ts)
+   * enter here and skip tokenizing and parsing text, passing their own
+   * timer to extend its report.
+   */
+  assemble(parseResult: ParseResult, filename?: string, timer: PhaseTimer | null = null): CompilerResult {
+    const result: CompilerResult = {
+      success: false,
+      errors: [],
+      warnings: [],
+      outputFiles: []
+    };
+
+    try {
       if (parseResult.errors.length > 0) {
         result.errors = parseResult.errors;
         return result;
@@ -97,7 +139,10 @@ export class CPU8BitCompiler {
       if (this.options.verbose) {
         console.log('Generating machine code...');
       }
-      const codeGenResult = generateBinary(parseResult);
+      const codeGenResult = measure(timer, 'generate', () => generateBinary(parseResult), (generated) => ({
+        bytes: generated.binary.length,
+        labels: parseResult.labels.size
+      }));
 
       if (codeGenResult.errors.length > 0) {
         result.errors = codeGenResult.errors;
@@ -108,7 +153,9 @@ export class CPU8BitCompiler {
 
       // Step 4: Write output files
       if (filename) {
-        this.writeOutputFiles(filename, codeGenResult, result);
+        measure(timer, 'write', () => this.writeOutputFiles(filename, codeGenResult, result), () => ({
+          files: result.outputFiles.length
+        }));
       }
 
       result.success = true;
@@ -117,12 +164,14 @@ export class CPU8BitCompiler {
     } catch (error) {
       result.errors.push(`Compilation failed: ${error}`);
       return result;
+    } finally {
+      this.lastTimeReport = timer ? timer.getReport() : null;
     }
   }
 
   compileFile(inputPath: string): CompilerResult {
     try {
-      const sourceCode = fs.readFileSync(inputPath, 'utf-8');
+      const sourceCode = loadSource(inputPath).source;
       const filename = path.parse(inputPath).name;
       return this.compile(sourceCode, filename);
     } catch (error) {
@@ -135,6 +184,33 @@ export class CPU8BitCompiler {
     }
   }
 
+  private parseSource(sourceCode: string, timer: PhaseTimer | null): ParseResult {
+    const incrementalParser = this.incrementalParser;
+    if (incrementalParser) {
+      if (this.options.verbose) {
+        console.log('Parsing changed lines...');
+      }
+      return measure(timer, 'parse', () => incrementalParser.parse(sourceCode), (parsed) => ({
+        ...countParsed(parsed),
+        reused: incrementalParser.getStats().reused
+      }));
+    }
+
+    // Step 1: Tokenize
+    if (this.options.verbose) {
+      console.log('Tokenizing source code...');
+    }
+    const tokenizer = new Tokenizer(sourceCode);
+    const tokens = measure(timer, 'tokenize', () => tokenizer.tokenize(), (result) => ({ tokens: result.length }));
+
+    // Step 2: Parse
+    if (this.options.verbose) {
+      console.log('Parsing tokens...');
+    }
+    const parser = new Parser(tokens);
+    return measure(timer, 'parse', () => parser.parse(), countParsed);
+  }
+
   private writeOutputFiles(filename: string, codeGenResult: CodeGenResult, result: CompilerResult): void {
     const basePath = path.join(this.options.outputDir, filename);
 
@@ -151,7 +227,7 @@ export class CPU8BitCompiler {
     // Write hex file
     if (this.options.outputFormat === 'hex' || this.options.outputFormat === 'both') {
       const hexPath = basePath + '.hex';
-      const hexContent = this.generateIntelHex(codeGenResult.binary);
+      const hexContent = generateIntelHex(codeGenResult.binary);
       fs.writeFileSync(hexPath, hexContent);
       result.outputFiles.push(hexPath);
       if (this.options.verbose) {
@@ -169,35 +245,6 @@ export class CPU8BitCompiler {
     }
   }
 
-  private generateIntelHex(binary: Uint8Array): string {
-    const lines: string[] = [];
-    const bytesPerLine = 16;
-
-    for (let i = 0; i < binary.length; i += bytesPerLine) {
-      const chunk = binary.slice(i, i + bytesPerLine);
-      const address = i.toString(16).padStart(4, '0').toUpperCase();
-      const dataLength = chunk.length.toString(16).padStart(2, '0').toUpperCase();
-      
-      let dataHex = '';
-      let checksum = parseInt(dataLength, 16) + Math.floor(i / 256) + (i % 256);
-      
-      for (const byte of chunk) {
-        dataHex += byte.toString(16).padStart(2, '0').toUpperCase();
-        checksum += byte;
-      }
-      
-      checksum = (256 - (checksum % 256)) % 256;
-      const checksumHex = checksum.toString(16).padStart(2, '0').toUpperCase();
-      
-      lines.push(`:${dataLength}${address}00${dataHex}${checksumHex}`);
-    }
-
-    // End of file record
-    lines.push(':00000001FF');
-    
-    return lines.join('\n') + '\n';
-  }
-
   private generateMapFile(codeGenResult: CodeGenResult): string {
     const lines: string[] = [];
     lines.push('CPU 8-Bit Compiler - Memory Map');
@@ -215,4 +262,49 @@ export class CPU8BitCompiler {
 
     return lines.join('\n') + '\n';
   }
-}
\ No newline at end of file
+}
+
+function countParsed(parsed: ParseResult): Record<string, number> {
+  return {
+    instructions: parsed.instructions.length,
+    labels: parsed.labels.size,
+    directives: parsed.directives.length
+  };
+}
+
+/**
+ * Intel HEX text (16-byte data records plus EOF record) for a binary image
+ */
+export function generateIntelHex(binary: Uint8Array): string {
+  return [...intelHexRecords(binary, 0), ':00000001FF'].join('\n') + '\n';
+}
+
+/**
+ * Intel HEX data records for `binary` loaded at `baseAddress`
+ */
+export function intelHexRecords(binary: Uint8Array, baseAddress: number): string[] {
+  const lines: string[] = [];
+  const bytesPerLine = 16;
+
+  for (let i = 0; i < binary.length; i += bytesPerLine) {
+    const chunk = binary.slice(i, i + bytesPerLine);
+    const offset = baseAddress + i;
+    const address = offset.toString(16).padStart(4, '0').toUpperCase();
+    const dataLength = chunk.length.toString(16).padStart(2, '0').toUpperCase();
+    
+    let dataHex = '';
+    let checksum = parseInt(dataLength, 16) + Math.floor(offset / 256) + (offset % 256);
+    
+    for (const byte of chunk) {
+      dataHex += byte.toString(16).padStart(2, '0').toUpperCase();
+      checksum += byte;
+    }
+    
+    checksum = (256 - (checksum % 256)) % 256;
+    const checksumHex = checksum.toString(16).padStart(2, '0').toUpperCase();
+    
+    lines.push(`:${dataLength}${address}00${dataHex}${checksumHex}`);
+  }
+
+  return lines;
+}
@@ -0,0 +1,141 @@
+import { EventEmitter } from 'events';
+import * as fs from 'fs';
+import * as os from 'os';
+import * as path from 'path';
+import { CompileDaemon } from './daemon';
+
+describe('CompileDaemon', () => {
+  let workDir: string;
+  let daemon: CompileDaemon;
+
+  beforeEach(() => {
+    workDir = fs.mkdtempSync(path.join(os.tmpdir(), 'cpu8bit-daemon-'));
+    fs.writeFileSync(path.join(workDir, 'prog.s'), 'LDI 42\nHLT\n');
+    daemon = new CompileDaemon({ socketPath: path.join(workDir, 'test.sock') });
+  });
+
+  afterEach(() => fs.rmSync(workDir, { recursive: true, force: true }));
+
+  test('should run forwarded compile relative to the client cwd', () => {
+    const messages = daemon.execute({ argv: ['compile', 'prog.s'], cwd: workDir });
+
+    expect(messages[messages.length - 1]).toEqual({ exit: 0 });
+    expect(messages.some(m => m.stdout === 'Compilation successful!\n')).toBe(true);
+    expect(Array.from(fs.readFileSync(path.join(workDir, 'prog.bin')))).toEqual([0x13, 42, 0xFF]);
+  });
+
+  test('should hand each message to the sink as it is printed', () => {
+    const streamed: object[] = [];
+    const messages = daemon.execute({ argv: ['compile', 'prog.s'], cwd: workDir }, (message) => streamed.push(message));
+
+    expect(streamed).toEqual(messages.slice(0, -1));
+    expect(streamed.length).toBeGreaterThan(0);
+  });
+
+  test('should replay cached results for unchanged input', () => {
+    daemon.execute({ argv: ['compile', 'prog.s'], cwd: workDir });
+    fs.unlinkSync(path.join(workDir, 'prog.bin'));
+
+    const messages = daemon.execute({ argv: ['compile', 'prog.s'], cwd: workDir });
+
+    expect(messages[messages.length - 1]).toEqual({ exit: 0 });
+    expect(daemon.getCacheStats()).toEqual({ hits: 1, misses: 1, entries: 1 });
+    expect(fs.existsSync(path.join(workDir, 'prog.bin'))).toBe(true);
+  });
+
+  test('should recompile when the input changes', () => {
+    daemon.execute({ argv: ['compile', 'prog.s'], cwd: workDir });
+    fs.writeFileSync(path.join(workDir, 'prog.s'), 'LDI 7\nHLT\n');
+
+    daemon.execute({ argv: ['compile', 'prog.s'], cwd: workDir });
+
+    expect(daemon.getCacheStats().misses).toBe(2);
+    expect(fs.readFileSync(path.join(workDir, 'prog.bin'))[1]).toBe(7);
+  });
+
+  test('should recompile when an included file changes', () => {
+    fs.writeFileSync(path.join(workDir, 'value.s'), 'LDI 42\n');
+    fs.writeFileSync(path.join(workDir, 'prog.s'), '.INCLUDE "value.s"\nHLT\n');
+    daemon.execute({ argv: ['compile', 'prog.s'], cwd: workDir });
+    fs.writeFileSync(path.join(workDir, 'value.s'), 'LDI 7\n');
+
+    daemon.execute({ argv: ['compile', 'prog.s'], cwd: workDir });
+
+    expect(daemon.getCacheStats().misses).toBe(2);
+    expect(fs.readFileSync(path.join(workDir, 'prog.bin'))[1]).toBe(7);
+  });
+
+  test('should recompile when the --profile-use file changes', () => {
+    fs.writeFileSync(path.join(workDir, 'prog.c'), 'void main() { output(0, 1); }\n');
+    fs.writeFileSync(path.join(workDir, 'prog.profile.json'), '{ "runs": 0, "counts": {} }\n');
+    const argv = ['compile', 'prog.c', '-O', '1', '--profile-use', 'prog.profile.json'];
+    daemon.execute({ argv, cwd: workDir });
+    fs.writeFileSync(path.join(workDir, 'prog.profile.json'), '{ "runs": 1, "counts": { "main.bb0": 1 } }\n');
+
+    const messages = daemon.execute({ argv, cwd: workDir });
+
+    expect(messages[messages.length - 1]).toEqual({ exit: 0 });
+    expect(daemon.getCacheStats().misses).toBe(2);
+  });
+
+  test('should diff --delta builds against the latest previous image', () => {
+    const first = daemon.execute({ argv: ['compile', 'prog.s', '--delta'], cwd: workDir });
+    const second = daemon.execute({ argv: ['compile', 'prog.s', '--delta'], cwd: workDir });
+
+    expect(first.some(m => m.stdout === 'Delta: 1 of 1 page(s) changed\n')).toBe(true);
+    expect(second.some(m => m.stdout === 'Delta: 0 of 1 page(s) changed\n')).toBe(true);
+  });
+
+  test('should measure every --time-report build', () => {
+    daemon.execute({ argv: ['compile', 'prog.s', '--time-report'], cwd: workDir });
+    const messages = daemon.execute({ argv: ['compile', 'prog.s', '--time-report'], cwd: workDir });
+
+    expect(messages[messages.length - 1]).toEqual({ exit: 0 });
+    expect(daemon.getCacheStats()).toEqual({ hits: 0, misses: 2, entries: 0 });
+    expect(fs.existsSync(path.join(workDir, 'prog.time.json'))).toBe(true);
+  });
+
+  test('should report failures through the exit message', () => {
+    const messages = daemon.execute({ argv: ['compile', 'missing.s'], cwd: workDir });
+
+    expect(messages[messages.length - 1]).toEqual({ exit: 1 });
+    expect(messages.some(m => m.stderr !== undefined)).toBe(true);
+    expect(daemon.getCacheStats()).toEqual({ hits: 0, misses: 1, entries: 0 });
+  });
+
+  test('should refuse to start a daemon inside the daemon', () => {
+    const messages = daemon.execute({ argv: ['serve', '-s', path.join(workDir, 'nested.sock')], cwd: workDir });
+
+    expect(messages[messages.length - 1]).toEqual({ exit: 3 });
+    expect(messages[0].stderr).toMatch(/serve cannot be forwarded/);
+  });
+
+  test('should answer only the first request of a connection', () => {
+    const socket = Object.assign(new EventEmitter(), {
+      writes: [] as string[],
+      replies: [] as string[],
+      setEncoding: () => {},
+      write(text: string) { socket.writes.push(text); },
+      end(text: string) { socket.replies.push(text); },
+      destroy: () => {}
+    });
+    const request = JSON.stringify({ argv: ['compile', 'prog.s'], cwd: workDir });
+
+    daemon['handleConnection'](socket as any);
+    socket.emit('data', request + '\n' + request.slice(0, 10));
+    socket.emit('data', request.slice(10) + '\n');
+
+    expect(socket.replies).toEqual([JSON.stringify({ exit: 0 }) + '\n']);
+    // Output went out as it was printed, ahead of the exit message
+    expect(socket.writes).toContain(JSON.stringify({ stdout: 'Compilation successful!\n' }) + '\n');
+    expect(daemon.getCacheStats().misses + daemon.getCacheStats().hits).toBe(1);
+  });
+
+  test('should refuse watch mode instead of starting a watcher', () => {
+    const messages = daemon.execute({ argv: ['compile', 'prog.s', '-w'], cwd: workDir });
+
+    expect(messages[messages.length - 1]).toEqual({ exit: 3 });
+    expect(messages[0].stderr).toMatch(/--watch is not supported/);
+    expect(fs.existsSync(path.join(workDir, 'prog.bin'))).toBe(false);
+  });
+});
@@ -0,0 +1,334 @@
+/**
+ * Persistent Compiler Daemon
+ *
+ * Keeps the compiler loaded in a long-lived process listening on a local Unix
+ * socket. Each connection carries one forwarded argv (see client.ts); the
+ * daemon runs it through the same command tree as the CLI and streams console
+ * output back, so results are byte-for-byte what a one-shot run would print.
+ * Each message is written as it is printed; the exit message ends the reply.
+ *
+ * Caching:
+ * - Module loading and JIT warm-up are paid once per daemon, not per compile
+ * - `compile` results are cached per (input path, cwd, options); a request
+ *   whose input, includes and profile are unchanged replays the recorded
+ *   output files and messages without re-running the pipeline. `--delta`
+ *   builds are never cached, since they also depend on the previous image,
+ *   and neither are `--time-report` builds, which measure the run itself
+ *
+ * Requests are handled one at a time: compilation is synchronous and the
+ * process working directory is switched to the client's for each request.
+ * Commands that never return (`serve`, `compile --watch`) are refused
+ * rather than run.
+ *
+ * @fileoverview Unix socket compile server with result cache
+ */
+
+import * as fs from 'fs';
+import * as net from 'net';
+import * as path from 'path';
+import { createProgram, compileFile, wantsTimeReport, CompileOutcome } from './cli';
+import { DaemonRequest, DaemonMessage, defaultSocketPath } from './client';
+import { loadSource } from './includes';
+
+export interface DaemonOptions {
+  socketPath?: string;
+  verbose?: boolean;
+  /** Maximum number of cached compile results */
+  cacheSize?: number;
+}
+
+/** A dependency as it was when a cache entry was recorded */
+interface FileStamp {
+  path: string;
+  mtimeMs: number;
+  size: number;
+  contents: Buffer;
+}
+
+interface CacheEntry {
+  dependencies: FileStamp[];
+  messages: DaemonMessage[];
+  outcome: CompileOutcome;
+  files: Map<string, Buffer>;
+}
+
+export class CompileDaemon {
+  private options: Required<DaemonOptions>;
+  private cache: Map<string, CacheEntry> = new Map();
+  private server: net.Server | null = null;
+  private hits: number = 0;
+  private misses: number = 0;
+
+  constructor(options: DaemonOptions = {}) {
+    this.options = {
+      socketPath: options.socketPath || defaultSocketPath(),
+      verbose: options.verbose || false,
+      cacheSize: options.cacheSize || 256
+    };
+  }
+
+  async listen(): Promise<void> {
+    await this.removeStaleSocket();
+
+    this.server = net.createServer((socket) => this.handleConnection(socket));
+
+    const shutdown = () => {
+      this.close().then(() => process.exit(0));
+    };
+    process.once('SIGINT', shutdown);
+    process.once('SIGTERM', shutdown);
+
+    return new Promise((resolve, reject) => {
+      this.server!.once('error', reject);
+      this.server!.listen(this.options.socketPath, () => {
+        if (this.options.verbose) {
+          console.log(`cpu8bit daemon listening on ${this.options.socketPath}`);
+        }
+        resolve();
+      });
+    });
+  }
+
+  close(): Promise<void> {
+    return new Promise((resolve) => {
+      if (!this.server) {
+        resolve();
+        return;
+      }
+      this.server.close(() => resolve());
+      this.server = null;
+    });
+  }
+
+  getCacheStats(): { hits: number; misses: number; entries: number } {
+    return { hits: this.hits, misses: this.misses, entries: this.cache.size };
+  }
+
+  /**
+   * Runs one forwarded command line and returns everything it printed,
+   * terminated by an exit message. `sink` gets each message except the exit
+   * as soon as it is printed.
+   */
+  execute(request: DaemonRequest, sink: (message: DaemonMessage) => void = () => {}): DaemonMessage[] {
+    const messages: DaemonMessage[] = [];
+    const emit = (message: DaemonMessage) => {
+      messages.push(message);
+      sink(message);
+    };
+
+    const rejection = rejectRequest(request.argv);
+    if (rejection) {
+      emit({ stderr: `Error: ${rejection}\n` });
+      messages.push({ exit: 3 });
+      return messages;
+    }
+
+    const originalLog = console.log;
+    const originalError = console.error;
+    const originalCwd = process.cwd();
+    let exitCode = 0;
+
+    console.log = (...args: any[]) => {
+      emit({ stdout: args.join(' ') + '\n' });
+    };
+    console.error = (...args: any[]) => {
+      emit({ stderr: args.join(' ') + '\n' });
+    };
+
+    try {
+      process.chdir(request.cwd);
+
+      const program = createProgram({
+        exit: (code) => { exitCode = code; },
+        compile: (input, options) => this.compileCached(input, options, messages, emit),
+        watch: () => {
+          // A watch would never return; run it with the regular CLI instead
+          emit({ stderr: 'Error: --watch is not supported through the daemon\n' });
+          exitCode = 3;
+        }
+      });
+      program.exitOverride();
+      program.configureOutput({
+        writeOut: (text) => emit({ stdout: text }),
+        writeErr: (text) => emit({ stderr: text })
+      });
+      program.parse(request.argv, { from: 'user' });
+    } catch (error: any) {
+      // commander signals --help / --version / usage errors by throwing
+      exitCode = typeof error.exitCode === 'number' ? error.exitCode : 4;
+      if (error.code === undefined || !String(error.code).startsWith('commander.')) {
+        emit({ stderr: `Daemon error: ${error}\n` });
+      }
+    } finally {
+      console.log = originalLog;
+      console.error = originalError;
+      process.chdir(originalCwd);
+    }
+
+    messages.push({ exit: exitCode });
+    return messages;
+  }
+
+  private handleConnection(socket: net.Socket): void {
+    let buffered = '';
+    let handled = false;
+
+    socket.setEncoding('utf-8');
+    socket.on('data', (chunk) => {
+      // One request per connection; anything after it is ignored
+      if (handled) return;
+      buffered += chunk;
+      const newline = buffered.indexOf('\n');
+      if (newline === -1) return;
+      handled = true;
+
+      let request: DaemonRequest;
+      try {
+        request = JSON.parse(buffered.slice(0, newline));
+      } catch (error) {
+        socket.end(JSON.stringify({ stderr: `Malformed request: ${error}\n`, exit: 3 }) + '\n');
+        return;
+      }
+
+      const started = process.hrtime.bigint();
+      const messages = this.execute(request, (message) => {
+        if (!socket.destroyed) socket.write(JSON.stringify(message) + '\n');
+      });
+      socket.end(JSON.stringify(messages[messages.length - 1]) + '\n');
+
+      if (this.options.verbose) {
+        const elapsedMs = Number(process.hrtime.bigint() - started) / 1e6;
+        console.log(`${request.argv.join(' ')} (${elapsedMs.toFixed(2)} ms)`);
+      }
+    });
+    socket.on('error', () => socket.destroy());
+  }
+
+  private compileCached(inputPath: string, options: any, messages: DaemonMessage[], emit: (message: DaemonMessage) => void): CompileOutcome {
+    // The delta depends on the previous image, which by default is the output
+    // of the last build itself, and a time report measures this very run;
+    // replaying either would repeat stale data
+    if (options.delta || wantsTimeReport(options)) {
+      this.misses++;
+      return compileFile(inputPath, options);
+    }
+
+    const absolutePath = path.resolve(inputPath);
+    const key = JSON.stringify([absolutePath, process.cwd(), options]);
+
+    const cached = this.cache.get(key);
+    if (cached && cached.dependencies.every((stamp) => this.isFresh(stamp))) {
+      this.hits++;
+      // Refresh LRU position
+      this.cache.delete(key);
+      this.cache.set(key, cached);
+
+      for (const [file, contents] of cached.files) {
+        fs.mkdirSync(path.dirname(file), { recursive: true });
+        fs.writeFileSync(file, contents);
+      }
+      cached.messages.forEach(emit);
+      return cached.outcome;
+    }
+
+    // Stamped before compiling, so an edit made during the build is seen next time
+    let dependencies: FileStamp[];
+    try {
+      dependencies = this.dependenciesOf(absolutePath, options).map(stampFile);
+    } catch {
+      // Let the regular path produce the "not found" diagnostic
+      this.misses++;
+      return compileFile(inputPath, options);
+    }
+
+    this.misses++;
+    const firstMessage = messages.length;
+    const outcome = compileFile(inputPath, options);
+
+    const files = new Map<string, Buffer>();
+    for (const file of outcome.outputFiles) {
+      files.set(path.resolve(file), fs.readFileSync(file));
+    }
+
+    this.cache.delete(key);
+    this.cache.set(key, {
+      dependencies,
+      messages: messages.slice(firstMessage),
+      outcome,
+      files
+    });
+
+    while (this.cache.size > this.options.cacheSize) {
+      const oldest = this.cache.keys().next().value as string;
+      this.cache.delete(oldest);
+    }
+
+    return outcome;
+  }
+
+  /**
+   * Files whose contents decide the result of a compile: the input,
+   * everything it includes and the profile given to --profile-use
+   */
+  private dependenciesOf(absolutePath: string, options: any): string[] {
+    const dependencies = loadSource(absolutePath).dependencies;
+    if (options.profileUse) {
+      dependencies.push(path.resolve(options.profileUse));
+    }
+    return dependencies;
+  }
+
+  private isFresh(stamp: FileStamp): boolean {
+    let stat: fs.Stats;
+    try {
+      stat = fs.statSync(stamp.path);
+    } catch {
+      return false;
+    }
+    if (stamp.size !== stat.size) return false;
+    if (stamp.mtimeMs === stat.mtimeMs) return true;
+
+    // Touched but possibly unchanged (e.g. checkout, editor save)
+    if (!fs.readFileSync(stamp.path).equals(stamp.contents)) return false;
+    stamp.mtimeMs = stat.mtimeMs;
+    return true;
+  }
+
+  /**
+   * Removes a socket file left behind by a daemon that exited uncleanly.
+   * Refuses to take over a socket that still accepts connections.
+   */
+  private removeStaleSocket(): Promise<void> {
+    const socketPath = this.options.socketPath;
+    if (!fs.existsSync(socketPath)) return Promise.resolve();
+
+    return new Promise((resolve, reject) => {
+      const probe = net.createConnection(socketPath);
+      probe.on('connect', () => {
+        probe.destroy();
+        reject(new Error(`A daemon is already listening on ${socketPath}`));
+      });
+      probe.on('error', () => {
+        fs.unlinkSync(socketPath);
+        resolve();
+      });
+    });
+  }
+}
+
+/**
+ * Commands that never return would hold the daemon's single request loop
+ * forever; they have to run with the regular CLI.
+ */
+function rejectRequest(argv: string[]): string | null {
+  const command = argv.find((arg) => !arg.startsWith('-'));
+  if (command === 'serve') {
+    return 'serve cannot be forwarded to a running daemon';
+  }
+  return null;
+}
+
+function stampFile(file: string): FileStamp {
+  const stat = fs.statSync(file);
+  return { path: file, mtimeMs: stat.mtimeMs, size: stat.size, contents: fs.readFileSync(file) };
+}
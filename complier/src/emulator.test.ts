@@ -0,0 +1,80 @@
+import { CPU8BitCompiler } from './compiler';
+import { Emulator, runBinary } from './emulator';
+
+describe('Emulator', () => {
+  const assemble = (source: string): Uint8Array => {
+    const result = new CPU8BitCompiler().compile(source);
+    expect(result.errors).toHaveLength(0);
+    return result.binary!;
+  };
+
+  test('should set carry and zero as documented for the ISA', () => {
+    const binary = assemble(`
+      LDI 200
+      ADI 100
+      JNC WRONG
+      OUT 0
+      SUI 44
+      JNZ WRONG
+      JC WRONG
+      SUI 1
+      JNC WRONG
+      ORI 0
+      JC WRONG
+      OUT 1
+      HLT
+      WRONG:
+      LDI 99
+      OUT 2
+      HLT
+    `);
+
+    const result = runBinary(binary);
+
+    expect(result.halted).toBe(true);
+    expect(result.outputs).toEqual([{ port: 0, value: 44 }, { port: 1, value: 255 }]);
+  });
+
+  test('should address memory through B with LDX and STX', () => {
+    const binary = assemble(`
+      IN 0
+      MOV B, A
+      LDI 42
+      STX 0x80
+      LDI 0
+      LDA 0x83
+      OUT 0
+      LDX 0x80
+      OUT 1
+      HLT
+    `);
+
+    const result = runBinary(binary, { inputs: { 0: [3] } });
+
+    expect(result.outputs).toEqual([{ port: 0, value: 42 }, { port: 1, value: 42 }]);
+    expect(result.registers.B).toBe(3);
+    expect(result.memory[0x83]).toBe(42);
+  });
+
+  test('should track stack depth and stop after maxSteps', () => {
+    const binary = assemble(`
+      CALL SUB
+      LOOP:
+      JMP LOOP
+      SUB:
+      PUSH
+      POP
+      RET
+    `);
+
+    const result = new Emulator({ maxSteps: 50 }).run(binary);
+
+    expect(result.halted).toBe(false);
+    expect(result.steps).toBe(50);
+    // CALL 3, then JMP 2 per step
+    expect(result.cycles).toBe(3 + 49 * 2);
+    expect(result.maxStackDepth).toBe(2);
+    expect([result.executions[0], result.executions[2], result.executions[4]]).toEqual([1, 46, 1]);
+    expect(() => runBinary(assemble('RET'))).toThrow('Stack underflow at 0x0');
+  });
+});
@@ -0,0 +1,205 @@
+/**
+ * Instruction-Level Emulator for CPU 8-bit Binaries
+ *
+ * Runs assembled machine code as the CPU would, for tests and for
+ * measuring generated code. The model follows instruction-set.ts:
+ *
+ * - Program memory (the binary, loaded at 0) and data memory are separate
+ *   256-byte spaces; LDA/STA/LDX/STX and the ALU memory forms address data
+ *   memory
+ * - A and B are the 8-bit registers; MOV copies between them
+ * - Z and C are set as documented on INSTRUCTION_SET: ADD/ADI carry out,
+ *   SUB/SUI borrow, logical operations clear C, everything else keeps both
+ * - CALL/RET and PUSH/POP share one stack, growing down from SP = 0xFF
+ * - IN reads the next queued value of its port (0 once the queue is
+ *   empty); OUT appends to the output log
+ *
+ * `cycles` totals instructionCycles() over the executed instructions, the
+ * cost model the code generator uses when it picks between sequences.
+ * `executions` counts the instructions started at each program address,
+ * which with a block map gives block counts for profile-guided
+ * optimization (see src/ir/profile.ts).
+ *
+ * Execution stops at HLT or after `maxSteps` instructions. Unknown
+ * opcodes, stack overflow and underflow throw, naming the address.
+ *
+ * @fileoverview Reference interpreter for compiled programs
+ */
+
+import { INSTRUCTION_SET, instructionCycles } from './instruction-set';
+
+export interface EmulatorOptions {
+  /** Values read by IN, per port, in order */
+  inputs?: Record<number, number[]>;
+  /** Instructions executed before giving up */
+  maxSteps?: number;
+  /** Stack bytes available to CALL and PUSH */
+  stackSize?: number;
+}
+
+export interface EmulatorResult {
+  /** Whether the program reached HLT within maxSteps */
+  halted: boolean;
+  /** Instructions executed */
+  steps: number;
+  /** Their cost in cycles, per instructionCycles() */
+  cycles: number;
+  /** Values written by OUT, in order */
+  outputs: { port: number; value: number }[];
+  /** Data memory at the end of the run */
+  memory: Uint8Array;
+  registers: { A: number; B: number; PC: number; SP: number };
+  flags: { Z: boolean; C: boolean };
+  /** Deepest the stack got, in bytes */
+  maxStackDepth: number;
+  /** Instructions started at each program address */
+  executions: Uint32Array;
+}
+
+const BY_OPCODE: Map<number, { name: string; operands: number; cycles: number }> = new Map(
+  Object.values(INSTRUCTION_SET).map((instruction) =>
+    [instruction.opcode, { ...instruction, cycles: instructionCycles(instruction.name) }] as [number, { name: string; operands: number; cycles: number }]
+  )
+);
+
+const REGISTER_NAMES = ['A', 'B'];
+
+export class Emulator {
+  private options: Required<EmulatorOptions>;
+
+  constructor(options: EmulatorOptions = {}) {
+    this.options = {
+      inputs: options.inputs || {},
+      maxSteps: options.maxSteps || 100000,
+      stackSize: options.stackSize || 64
+    };
+  }
+
+  run(binary: Uint8Array): EmulatorResult {
+    const program = new Uint8Array(256);
+    program.set(binary.slice(0, 256));
+    const memory = new Uint8Array(256);
+    const stack = new Uint8Array(256);
+    const queues = new Map<number, number[]>();
+    Object.keys(this.options.inputs).forEach((port) => {
+      queues.set(Number(port), this.options.inputs[Number(port)].slice());
+    });
+
+    const registers = [0, 0];
+    let pc = 0;
+    let sp = 0xFF;
+    let z = false;
+    let c = false;
+    let steps = 0;
+    let cycles = 0;
+    let maxStackDepth = 0;
+    const executions = new Uint32Array(256);
+    const outputs: { port: number; value: number }[] = [];
+
+    const push = (value: number, at: number) => {
+      if (0xFF - sp >= this.options.stackSize) {
+        throw new Error(`Stack overflow at 0x${at.toString(16)}`);
+      }
+      stack[sp] = value & 0xFF;
+      sp--;
+      maxStackDepth = Math.max(maxStackDepth, 0xFF - sp);
+    };
+    const pop = (at: number) => {
+      if (sp === 0xFF) {
+        throw new Error(`Stack underflow at 0x${at.toString(16)}`);
+      }
+      sp++;
+      return stack[sp];
+    };
+    const arithmetic = (result: number, subtract: boolean) => {
+      c = subtract ? result < 0 : result > 0xFF;
+      registers[0] = result & 0xFF;
+      z = registers[0] === 0;
+    };
+    const logical = (result: number) => {
+      registers[0] = result & 0xFF;
+      z = registers[0] === 0;
+      c = false;
+    };
+    const register = (code: number, at: number) => {
+      if (code >= REGISTER_NAMES.length) {
+        throw new Error(`MOV with register ${code} at 0x${at.toString(16)}`);
+      }
+      return code;
+    };
+
+    let halted = false;
+    while (steps < this.options.maxSteps) {
+      const at = pc;
+      const instruction = BY_OPCODE.get(program[pc]);
+      if (!instruction) {
+        throw new Error(`Unknown opcode 0x${program[pc].toString(16)} at 0x${at.toString(16)}`);
+      }
+      const x = program[(pc + 1) & 0xFF];
+      const y = program[(pc + 2) & 0xFF];
+      pc = (pc + 1 + instruction.operands) & 0xFF;
+      steps++;
+      cycles += instruction.cycles;
+      executions[at]++;
+
+      const a = registers[0];
+      switch (instruction.name) {
+        case 'MOV': registers[register(x, at)] = registers[register(y, at)]; break;
+        case 'LDA': registers[0] = memory[x]; break;
+        case 'STA': memory[x] = a; break;
+        case 'LDI': registers[0] = x; break;
+        case 'LDX': registers[0] = memory[(x + registers[1]) & 0xFF]; break;
+        case 'STX': memory[(x + registers[1]) & 0xFF] = a; break;
+        case 'ADD': arithmetic(a + memory[x], false); break;
+        case 'ADI': arithmetic(a + x, false); break;
+        case 'SUB': arithmetic(a - memory[x], true); break;
+        case 'SUI': arithmetic(a - x, true); break;
+        case 'AND': logical(a & memory[x]); break;
+        case 'ANI': logical(a & x); break;
+        case 'OR': logical(a | memory[x]); break;
+        case 'ORI': logical(a | x); break;
+        case 'XOR': logical(a ^ memory[x]); break;
+        case 'XRI': logical(a ^ x); break;
+        case 'NOT': registers[0] = ~a & 0xFF; break;
+        case 'JMP': pc = x; break;
+        case 'JZ': if (z) pc = x; break;
+        case 'JNZ': if (!z) pc = x; break;
+        case 'JC': if (c) pc = x; break;
+        case 'JNC': if (!c) pc = x; break;
+        case 'CALL': push(pc, at); pc = x; break;
+        case 'RET': pc = pop(at); break;
+        case 'PUSH': push(a, at); break;
+        case 'POP': registers[0] = pop(at); break;
+        case 'IN': {
+          const queue = queues.get(x);
+          registers[0] = queue && queue.length > 0 ? queue.shift()! & 0xFF : 0;
+          break;
+        }
+        case 'OUT': outputs.push({ port: x, value: a }); break;
+        case 'NOP': break;
+        case 'HLT': halted = true; break;
+      }
+      if (halted) {
+        pc = at;
+        break;
+      }
+    }
+
+    return {
+      halted,
+      steps,
+      cycles,
+      outputs,
+      memory,
+      registers: { A: registers[0], B: registers[1], PC: pc, SP: sp },
+      flags: { Z: z, C: c },
+      maxStackDepth,
+      executions
+    };
+  }
+}
+
+// Factory function for easier usage
+export function runBinary(binary: Uint8Array, options: EmulatorOptions = {}): EmulatorResult {
+  return new Emulator(options).run(binary);
+}
@@ -0,0 +1,69 @@
+/**
+ * Source Loader with Include Expansion
+ *
+ * Reads a source file and textually expands include directives so the
+ * compilers see a single translation unit:
+ * - Assembly: `.INCLUDE "routines.s"`
+ * - C-like:   `#include "io.h"`
+ *
+ * Paths are resolved relative to the including file. The loader also reports
+ * the dependency closure of the input (the file itself plus everything it
+ * includes, transitively), which watch mode uses to decide what to rebuild.
+ *
+ * Line numbers in diagnostics refer to the expanded source.
+ *
+ * @fileoverview File loading with include expansion and dependency tracking
+ */
+
+import * as fs from 'fs';
+import * as path from 'path';
+
+export interface LoadedSource {
+  /** Source text with all includes expanded */
+  source: string;
+  /** Absolute paths of the input and every file it includes */
+  dependencies: string[];
+}
+
+const INCLUDE_PATTERN = /^\s*(?:\.include|#include)\s+["<]([^">]+)[">]/i;
+
+/**
+ * Loads `inputPath` with its includes expanded. `dependencies` collects
+ * every file the load read or tried to read; it is filled in even when the
+ * load throws, so a missing include can be watched until it appears.
+ */
+export function loadSource(inputPath: string, dependencies: string[] = []): LoadedSource {
+  const source = expand(path.resolve(inputPath), [], dependencies);
+  return { source, dependencies };
+}
+
+function expand(filePath: string, stack: string[], dependencies: string[]): string {
+  if (stack.includes(filePath)) {
+    const cycle = [...stack, filePath].map((file) => path.basename(file)).join(' -> ');
+    throw new Error(`Circular include: ${cycle}`);
+  }
+
+  if (!dependencies.includes(filePath)) {
+    dependencies.push(filePath);
+  }
+
+  const text = fs.readFileSync(filePath, 'utf-8');
+  if (!/include/i.test(text)) {
+    return text;
+  }
+
+  const lines = text.split('\n');
+  for (let i = 0; i < lines.length; i++) {
+    const match = INCLUDE_PATTERN.exec(lines[i]);
+    if (match) {
+      const included = path.resolve(path.dirname(filePath), match[1]);
+      if (!fs.existsSync(included)) {
+        if (!dependencies.includes(included)) dependencies.push(included);
+        throw new Error(`${path.basename(filePath)}:${i + 1}: Include file '${match[1]}' not found`);
+      }
+      lines[i] = expand(included, [...stack, filePath], dependencies);
+    }
+  }
+
+  return lines.join('\n');
+}
@@ -0,0 +1,152 @@
+/**
+ * Incremental Assembly Front End
+ *
+ * Assembly statements never span lines, so tokens and parse results can be
+ * memoized per line of source text. Between rebuilds only lines whose text
+ * changed are re-tokenized and re-parsed; everything else is reused from the
+ * previous build. A cheap layout pass then rebases each line's label
+ * addresses onto the running address, yielding a ParseResult identical to
+ * what `Parser.parse()` produces over the whole file.
+ *
+ * @fileoverview Line-level token/parse cache for rebuilds
+ */
+
+import { Tokenizer, TokenType } from './tokenizer';
+import { Parser, ParseResult, ParsedInstruction, ParsedDirective } from './parser';
+import { INSTRUCTION_SET } from './instruction-set';
+
+/**
+ * Label of a line; before the line's .ORG (or on a line without one) the
+ * address is relative to the line start, after it absolute
+ */
+interface LineLabel {
+  name: string;
+  address: number;
+  relative: boolean;
+}
+
+/**
+ * Parse of a single line with addresses relative to the line start
+ * (or absolute, after an .ORG on the line)
+ */
+interface LineEntry {
+  instructions: ParsedInstruction[];
+  directives: ParsedDirective[];
+  labels: LineLabel[];
+  errors: string[];
+  /** Value of the line's .ORG directive, if any */
+  origin?: number;
+  /** Bytes the line occupies after its origin */
+  size: number;
+}
+
+export interface IncrementalStats {
+  /** Lines reused from the previous build */
+  reused: number;
+  /** Lines tokenized and parsed from scratch */
+  parsed: number;
+}
+
+export class IncrementalParser {
+  private lineCache: Map<string, LineEntry> = new Map();
+  private stats: IncrementalStats = { reused: 0, parsed: 0 };
+
+  parse(sourceCode: string): ParseResult {
+    const result: ParseResult = {
+      instructions: [],
+      labels: new Map(),
+      directives: [],
+      errors: []
+    };
+
+    const lines = sourceCode.split('\n');
+    const nextCache: Map<string, LineEntry> = new Map();
+    let address = 0;
+    this.stats = { reused: 0, parsed: 0 };
+
+    for (let i = 0; i < lines.length; i++) {
+      const text = lines[i];
+      const line = i + 1;
+
+      let entry = nextCache.get(text) || this.lineCache.get(text);
+      if (entry) {
+        this.stats.reused++;
+      } else {
+        entry = this.parseLine(text);
+        this.stats.parsed++;
+      }
+      nextCache.set(text, entry);
+
+      for (const error of entry.errors) {
+        result.errors.push(error.replace(/^Line \d+:/, `Line ${line}:`));
+      }
+
+      for (const label of entry.labels) {
+        if (result.labels.has(label.name)) {
+          result.errors.push(`Line ${line}: Error: Label '${label.name}' already defined`);
+          continue;
+        }
+        result.labels.set(label.name, (label.relative ? address : 0) + label.address);
+      }
+
+      for (const instruction of entry.instructions) {
+        result.instructions.push({ ...instruction, line });
+      }
+      for (const directive of entry.directives) {
+        result.directives.push({ ...directive, line });
+      }
+
+      address = (entry.origin !== undefined ? entry.origin : address) + entry.size;
+    }
+
+    // Keep only lines present in this build so the cache tracks the file
+    this.lineCache = nextCache;
+    return result;
+  }
+
+  getStats(): IncrementalStats {
+    return { ...this.stats };
+  }
+
+  private parseLine(text: string): LineEntry {
+    const tokens = new Tokenizer(text).tokenize();
+    const parsed = new Parser(tokens).parse();
+
+    // Parser.parseLabel() gives a label the running address, so only labels
+    // after the .ORG are absolute
+    const beforeOrigin = new Set<string>();
+    for (const token of tokens) {
+      if (token.type === TokenType.DIRECTIVE && token.value === '.ORG') break;
+      if (token.type === TokenType.LABEL) beforeOrigin.add(token.value);
+    }
+
+    let origin: number | undefined;
+    let size = 0;
+    for (const directive of parsed.directives) {
+      switch (directive.directive) {
+        case '.ORG':
+          origin = directive.value as number;
+          size = 0;
+          break;
+        case '.DB':
+          size += 1;
+          break;
+        case '.DW':
+          size += 2;
+          break;
+      }
+    }
+    for (const instruction of parsed.instructions) {
+      size += 1 + INSTRUCTION_SET[instruction.instruction].operands;
+    }
+
+    return {
+      instructions: parsed.instructions,
+      directives: parsed.directives,
+      labels: Array.from(parsed.labels.entries()).map(([name, address]) => ({ name, address, relative: beforeOrigin.has(name) })),
+      errors: parsed.errors,
+      origin,
+      size
+    };
+  }
+}
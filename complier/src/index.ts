@@ -1,8 +1,14 @@
-export { CPU8BitCompiler } from './compiler';
+export { CPU8BitCompiler, generateIntelHex } from './compiler';
 export { Tokenizer, TokenType } from './tokenizer';
 export { Parser } from './parser';
 export { CodeGenerator, generateBinary } from './code-generator';
-export { INSTRUCTION_SET, REGISTERS } from './instruction-set';
+export { INSTRUCTION_SET, REGISTERS, instructionCycles, instructionBytes } from './instruction-set';
+export { buildParseResult, renderAssembly, stackDepth } from './assembly-stream';
+export { PhaseTimer, formatTimeReport } from './time-report';
+export { RomBundler, createRomBundler, formatBundleReport } from './bundler';
+export { diffImages, formatDeltaHex, formatPageScript, parseIntelHex } from './rom-delta';
+export { PeepholeOptimizer, optimizePeephole, parsePeepholeRules, DEFAULT_PEEPHOLE_RULES, SUPEROPTIMIZED_PEEPHOLE_RULES } from './peephole';
+export { Emulator, runBinary } from './emulator';
 
 // High-level language support
 export { HighLevelCompiler, createHighLevelCompiler } from './languages/high-level-compiler';
@@ -10,15 +16,52 @@ export { CTokenizer, CTokenType } from './languages/c-tokenizer';
 export { CParser } from './languages/c-parser';
 export { CToAssemblyGenerator } from './languages/c-generator';
 
+// Intermediate representation
+export { IRBuilder, buildModule } from './ir/builder';
+export { PassManager, createPassManager, inlinePass, unrollPass, INLINE_BUDGETS, UNROLL_BUDGETS } from './ir/pass-manager';
+export { Inliner, inlineModule, inlineCall } from './ir/inline';
+export { findLoops, rotateLoops, hoistInvariants, unrollLoops, countDownLoops } from './ir/loops';
+export { propagateConstants, foldBinary, foldUnary } from './ir/sccp';
+export { reduceStrength } from './ir/strength';
+export { planSwitch } from './ir/switch';
+export { RUNTIME_ROUTINES, linkRoutines } from './ir/runtime';
+export { eliminateDeadCode, removeDeadFunctions, removeDeadGlobals } from './ir/dce';
+export { verifyModule, verifyFunction } from './ir/verify';
+export { printModule, printFunction } from './ir/printer';
+export { IRLowering, lowerModule } from './ir/lower';
+export { overlayFrames, callGraph } from './ir/frames';
+export { ProfileCounts, recordProfile, imageHash, layoutBlocks, HOT_FRACTION } from './ir/profile';
+
 // Re-export types
 export type { CompilerOptions, CompilerResult } from './compiler';
 export type { Token } from './tokenizer';
 export type { ParseResult, ParsedInstruction, ParsedLabel, ParsedDirective } from './parser';
 export type { CodeGenResult } from './code-generator';
 export type { Instruction, RegisterName } from './instruction-set';
+export type { AssemblyItem } from './assembly-stream';
+export type { TimeReport, PhaseStats } from './time-report';
+export type { RomImage, BundleOptions, BundleEntry, BundleResult } from './bundler';
+export type { DeltaOptions, PageDelta, RomDelta } from './rom-delta';
+export type { PeepholeOptions, PeepholeRule, PeepholeStats, PeepholeGuard } from './peephole';
+export type { EmulatorOptions, EmulatorResult } from './emulator';
 
 // High-level types
 export type { HighLevelCompilerOptions, HighLevelCompileResult } from './languages/high-level-compiler';
 export type { CToken } from './languages/c-tokenizer';
 export type { CParseResult } from './languages/c-parser';
-export type * from './languages/ast';
\ No newline at end of file
+export type { CGeneratorOptions } from './languages/c-generator';
+export type * from './languages/ast';
+
+// IR types
+export type {
+  IRModule, IRFunction, IRVariable, IRType, BasicBlock, Value, Temp, Const,
+  Instruction as IRInstruction, Terminator, BinaryOp, UnaryOp
+} from './ir/ir';
+export type { IRPass, IRModulePass, PassStats, OptimizationLevel } from './ir/pass-manager';
+export type { InlineOptions } from './ir/inline';
+export type { Loop } from './ir/loops';
+export type { MemoryUsage, JumpTable, LoweringOptions } from './ir/lower';
+export type { SwitchPlan } from './ir/switch';
+export type { FramePlacement } from './ir/frames';
+export type { RuntimeRoutine } from './ir/runtime';
+export type { BlockMap, BlockProfile } from './ir/profile';
\ No newline at end of file
@@ -35,6 +35,17 @@ export interface Instruction {
  * - 0x50-0x5F: Stack operations
  * - 0x60-0x6F: I/O operations
  * - 0xFF: HALT
+ * 
+ * Flags (Z = zero, C = carry), relied on by the C code generator:
+ * - ADD/ADI/SUB/SUI set Z from the result; C is the carry out of an add or
+ *   the borrow of a subtract (set when A < operand, unsigned)
+ * - AND/ANI/OR/ORI/XOR/XRI set Z from the result and clear C
+ * - Everything else (NOT, loads, stores, jumps, stack, I/O) leaves both
+ *   flags unchanged, so testing a freshly loaded value needs `ORI 0`
+ *
+ * Indexed addressing: LDX/STX access the byte at `addr + B` (wrapping at
+ * 0xFF), so array elements are reached in constant time without patching
+ * the operand of an LDA/STA. B is set with `MOV B, A`.
  */
 export const INSTRUCTION_SET: Record<string, Instruction> = {
   // Data Movement
@@ -42,6 +53,8 @@ export const INSTRUCTION_SET: Record<string, Instruction> = {
   'LDA': { name: 'LDA', opcode: 0x11, operands: 1, description: 'Load accumulator from memory' },
   'STA': { name: 'STA', opcode: 0x12, operands: 1, description: 'Store accumulator to memory' },
   'LDI': { name: 'LDI', opcode: 0x13, operands: 1, description: 'Load immediate value to accumulator' },
+  'LDX': { name: 'LDX', opcode: 0x14, operands: 1, description: 'Load accumulator from memory at address + B' },
+  'STX': { name: 'STX', opcode: 0x15, operands: 1, description: 'Store accumulator to memory at address + B' },
   
   // Arithmetic Operations
   'ADD': { name: 'ADD', opcode: 0x20, operands: 1, description: 'Add memory to accumulator' },
@@ -88,9 +101,35 @@ export const INSTRUCTION_SET: Record<string, Instruction> = {
  */
 export const REGISTERS = {
   'A': 0x00,  // Accumulator
-  'B': 0x01,  // General purpose register
+  'B': 0x01,  // General purpose register, index of LDX/STX
   'PC': 0x02, // Program Counter (read-only in most contexts)
   'SP': 0x03, // Stack Pointer
 };
 
-export type RegisterName = keyof typeof REGISTERS;
\ No newline at end of file
+export type RegisterName = keyof typeof REGISTERS;
+
+/** Instructions that read or write data memory, or the stack */
+const MEMORY_ACCESS = new Set(['LDA', 'STA', 'LDX', 'STX', 'ADD', 'SUB', 'AND', 'OR', 'XOR', 'CALL', 'RET', 'PUSH', 'POP', 'IN', 'OUT']);
+
+/**
+ * Cycle cost model shared by the emulator and the code generator's
+ * choices between instruction sequences: one cycle per byte fetched
+ * (opcode and operands), plus one for an access to data memory, the stack
+ * or an I/O port. It ranks sequences; it is not measured hardware timing.
+ */
+export function instructionCycles(name: string): number {
+  const instruction = INSTRUCTION_SET[name];
+  if (!instruction) {
+    throw new Error(`Unknown instruction: ${name}`);
+  }
+  return 1 + instruction.operands + (MEMORY_ACCESS.has(name) ? 1 : 0);
+}
+
+/** Encoded size of an instruction in bytes */
+export function instructionBytes(name: string): number {
+  const instruction = INSTRUCTION_SET[name];
+  if (!instruction) {
+    throw new Error(`Unknown instruction: ${name}`);
+  }
+  return 1 + instruction.operands;
+}
\ No newline at end of file
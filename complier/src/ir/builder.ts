@@ -0,0 +1,748 @@
+/**
+ * AST to IR Builder
+ *
+ * Translates the C-like AST into the three-address IR. Every named
+ * variable (global, local or parameter) is a memory object accessed with
+ * load/store, which keeps this translation trivially correct; mem2reg
+ * turns scalar locals into SSA temporaries afterwards.
+ *
+ * Comparisons are unsigned in the IR; those with a signed operand compare
+ * both operands with their sign bits flipped (x ^ 0x80, or x ^ 0x8000 for
+ * 16 bits), which orders -128..127 as 0..255. Division, remainder and
+ * right shift have separate signed operations (sdiv, smod, sar), chosen
+ * here from the operand types: signed if either operand of `/` or `%` is
+ * signed, and if the shifted value of `>>` is.
+ *
+ * An operation is 16-bit if an operand is, or a literal operand does not
+ * fit a byte; the other operand is widened (sign-extended if int8) and
+ * the result is int16 if either operand is signed, else uint16. Stores,
+ * arguments and return values are converted to the declared type,
+ * truncating 16-bit values to their low byte. Multiply, divide, modulo
+ * and right shift are 8-bit only; `<<` of a 16-bit value by a constant
+ * becomes additions.
+ *
+ * Array elements are addressed by a constant offset when the index is a
+ * literal, and by an `index` operand (the index times the element size,
+ * in bytes) otherwise; neither is bounds-checked at run time.
+ *
+ * A `switch` dispatches as planSwitch() decides (compare chains, a jump
+ * table in a `switch` terminator, or a search tree of `lt` tests), on
+ * the value with its sign bit flipped if it is signed, like comparisons.
+ * Case bodies follow in source order, each falling through to the next;
+ * `break` jumps past the innermost switch or loop.
+ *
+ * Global declarations with literal initializers become initial values.
+ * Other top-level code (non-constant initializers, statements) is
+ * collected into a synthetic `__init` function that runs before `main`.
+ *
+ * Code after a `return` or `halt()` lands in an unreachable block that is
+ * dropped at the end of the function (a halting block ends in a `ret` that
+ * never runs).
+ *
+ * @fileoverview C-like AST lowering to three-address IR
+ */
+
+import {
+  Program, Statement, Expression, FunctionDeclaration, VariableDeclaration,
+  Assignment, BinaryExpression, UnaryExpression, CallExpression, Literal, SwitchStatement,
+  NodeType, DataType, BinaryOperator, UnaryOperator, BUILTIN_FUNCTIONS
+} from '../languages/ast';
+import {
+  IRModule, IRFunction, IRVariable, IRType, BasicBlock, Value, Instruction, Terminator,
+  BinaryOp, UnaryOp, constant, newTemp, newBlock, isWide, typeSize, typeMask
+} from './ir';
+import { removeUnreachableBlocks } from './cfg';
+import { SwitchPlan, planSwitch } from './switch';
+
+export const INIT_FUNCTION = '__init';
+
+const BINARY_OPS: Record<BinaryOperator, BinaryOp> = {
+  [BinaryOperator.ADD]: 'add',
+  [BinaryOperator.SUBTRACT]: 'sub',
+  [BinaryOperator.MULTIPLY]: 'mul',
+  [BinaryOperator.DIVIDE]: 'div',
+  [BinaryOperator.MODULO]: 'mod',
+  [BinaryOperator.SHIFT_LEFT]: 'shl',
+  [BinaryOperator.SHIFT_RIGHT]: 'shr',
+  [BinaryOperator.AND]: 'and',
+  [BinaryOperator.OR]: 'or',
+  [BinaryOperator.XOR]: 'xor',
+  [BinaryOperator.EQUAL]: 'eq',
+  [BinaryOperator.NOT_EQUAL]: 'ne',
+  [BinaryOperator.LESS_THAN]: 'lt',
+  [BinaryOperator.LESS_EQUAL]: 'le',
+  [BinaryOperator.GREATER_THAN]: 'gt',
+  [BinaryOperator.GREATER_EQUAL]: 'ge'
+};
+
+const SIGNED_OPS: Partial<Record<BinaryOp, BinaryOp>> = { div: 'sdiv', mod: 'smod', shr: 'sar' };
+
+const UNARY_OPS: Record<UnaryOperator, UnaryOp> = {
+  [UnaryOperator.NOT]: 'lnot',
+  [UnaryOperator.BITWISE_NOT]: 'not',
+  [UnaryOperator.NEGATIVE]: 'neg'
+};
+
+export function irType(type: DataType | undefined): IRType {
+  switch (type) {
+    case DataType.INT8:
+      return 'i8';
+    case DataType.UINT16:
+      return 'u16';
+    case DataType.INT16:
+      return 'i16';
+    case DataType.BOOL:
+      return 'bool';
+    default:
+      return 'u8';
+  }
+}
+
+function isSigned(type: IRType): boolean {
+  return type === 'i8' || type === 'i16';
+}
+
+export function isComparison(op: BinaryOp): boolean {
+  return op === 'eq' || op === 'ne' || op === 'lt' || op === 'le' || op === 'gt' || op === 'ge';
+}
+
+export class IRBuilder {
+  private module: IRModule = { globals: [], functions: [] };
+  private declarations: Map<string, FunctionDeclaration> = new Map();
+  private scopes: Map<string, IRVariable>[] = [];
+  private fn: IRFunction | null = null;
+  private block: BasicBlock | null = null;
+  /** Where `break` goes, innermost last */
+  private breakTargets: BasicBlock[] = [];
+
+  build(ast: Program): IRModule {
+    this.module = { globals: [], functions: [] };
+    this.declarations.clear();
+    this.scopes = [new Map()];
+
+    for (const stmt of ast.body) {
+      if (stmt.type === NodeType.FUNCTION_DECLARATION) {
+        if (this.declarations.has(stmt.name)) {
+          throw new Error(`Duplicate function: ${stmt.name}`);
+        }
+        this.declarations.set(stmt.name, stmt);
+      }
+    }
+
+    // Globals and top-level code, in source order
+    const topLevel: Statement[] = [];
+    for (const stmt of ast.body) {
+      if (stmt.type === NodeType.FUNCTION_DECLARATION) continue;
+      if (stmt.type === NodeType.VARIABLE_DECLARATION) {
+        const variable = this.declareGlobal(stmt);
+        if (stmt.initializer && variable.initial === undefined) {
+          topLevel.push({ type: NodeType.ASSIGNMENT, left: { type: NodeType.IDENTIFIER, name: stmt.name }, right: stmt.initializer });
+        }
+      } else {
+        topLevel.push(stmt);
+      }
+    }
+
+    if (topLevel.length > 0) {
+      this.buildFunction(INIT_FUNCTION, 'void', [], topLevel);
+    }
+    for (const decl of this.declarations.values()) {
+      this.buildFunction(decl.name, decl.returnType === DataType.VOID || !decl.returnType ? 'void' : irType(decl.returnType), decl.parameters, decl.body.body);
+    }
+
+    return this.module;
+  }
+
+  private declareGlobal(stmt: VariableDeclaration): IRVariable {
+    if (this.scopes[0].has(stmt.name)) {
+      throw new Error(`Duplicate variable: ${stmt.name}`);
+    }
+    const type = irType(stmt.dataType);
+    const variable: IRVariable = {
+      name: stmt.name,
+      type,
+      size: (stmt.isArray ? (stmt.arraySize || 1) : 1) * typeSize(type),
+      scope: 'global'
+    };
+    if (stmt.initializer && !stmt.isArray) {
+      const value = literalValue(stmt.initializer);
+      if (value !== null) {
+        variable.initial = value & typeMask(type);
+      }
+    }
+    this.scopes[0].set(stmt.name, variable);
+    this.module.globals.push(variable);
+    return variable;
+  }
+
+  private buildFunction(name: string, returnType: IRType | 'void', parameters: { name: string; type: DataType }[], body: Statement[]): void {
+    const fn: IRFunction = {
+      name,
+      returnType,
+      params: parameters.map((param) => ({ name: param.name, type: irType(param.type) })),
+      blocks: [],
+      locals: [],
+      nextTemp: 0,
+      nextBlock: 0
+    };
+    this.fn = fn;
+    this.block = newBlock(fn);
+    this.block.origin = `${name}.bb${this.block.id}`;
+    this.breakTargets = [];
+
+    this.scopes.push(new Map());
+    parameters.forEach((param, index) => {
+      this.declareLocal(param.name, irType(param.type), typeSize(irType(param.type)), index);
+    });
+    this.buildStatements(body);
+    this.scopes.pop();
+
+    if (!this.block.terminator) {
+      this.terminate({ op: 'ret', value: null });
+    }
+    removeUnreachableBlocks(fn);
+
+    this.module.functions.push(fn);
+    this.fn = null;
+    this.block = null;
+  }
+
+  private declareLocal(name: string, type: IRType, size: number, paramIndex?: number): IRVariable {
+    const scope = this.scopes[this.scopes.length - 1];
+    if (scope.has(name)) {
+      throw new Error(`Duplicate variable: ${name}`);
+    }
+
+    // Shadowed names get a suffix so dumps stay unambiguous
+    const taken = this.fn!.locals.filter((local) => local.name === name || local.name.startsWith(name + '.')).length;
+    const variable: IRVariable = {
+      name: taken === 0 ? name : `${name}.${taken}`,
+      type,
+      size,
+      scope: 'local',
+      paramIndex
+    };
+    scope.set(name, variable);
+    this.fn!.locals.push(variable);
+    return variable;
+  }
+
+  private lookup(name: string): IRVariable {
+    for (let i = this.scopes.length - 1; i >= 0; i--) {
+      const variable = this.scopes[i].get(name);
+      if (variable) return variable;
+    }
+    throw new Error(`Undefined variable: ${name}`);
+  }
+
+  private buildStatements(statements: Statement[]): void {
+    for (const stmt of statements) {
+      this.buildStatement(stmt);
+    }
+  }
+
+  private buildStatement(stmt: Statement): void {
+    switch (stmt.type) {
+      case NodeType.FUNCTION_DECLARATION:
+        throw new Error(`Nested function: ${stmt.name}`);
+      case NodeType.VARIABLE_DECLARATION:
+        this.buildVariableDeclaration(stmt);
+        break;
+      case NodeType.ASSIGNMENT:
+        this.buildAssignment(stmt);
+        break;
+      case NodeType.IF_STATEMENT: {
+        const thenBlock = this.createBlock();
+        const elseBlock = stmt.alternate ? this.createBlock() : null;
+        const endBlock = this.createBlock();
+
+        this.branch(this.buildExpression(stmt.condition), thenBlock, elseBlock || endBlock);
+        this.enter(thenBlock);
+        this.buildScoped(stmt.consequent);
+        this.jump(endBlock);
+
+        if (elseBlock) {
+          this.enter(elseBlock);
+          this.buildScoped(stmt.alternate!);
+          this.jump(endBlock);
+        }
+        this.enter(endBlock);
+        break;
+      }
+      case NodeType.WHILE_LOOP: {
+        const headerBlock = this.createBlock();
+        const bodyBlock = this.createBlock();
+        const endBlock = this.createBlock();
+
+        this.jump(headerBlock);
+        this.enter(headerBlock);
+        this.branch(this.buildExpression(stmt.condition), bodyBlock, endBlock);
+        this.enter(bodyBlock);
+        this.breakTargets.push(endBlock);
+        this.buildScoped(stmt.body);
+        this.breakTargets.pop();
+        this.jump(headerBlock);
+        this.enter(endBlock);
+        break;
+      }
+      case NodeType.FOR_LOOP: {
+        this.scopes.push(new Map());
+        if (stmt.init) {
+          this.buildStatement(stmt.init);
+        }
+
+        const headerBlock = this.createBlock();
+        const bodyBlock = this.createBlock();
+        const endBlock = this.createBlock();
+
+        this.jump(headerBlock);
+        this.enter(headerBlock);
+        if (stmt.condition) {
+          this.branch(this.buildExpression(stmt.condition), bodyBlock, endBlock);
+        } else {
+          this.jump(bodyBlock);
+        }
+        this.enter(bodyBlock);
+        this.breakTargets.push(endBlock);
+        this.buildScoped(stmt.body);
+        this.breakTargets.pop();
+        if (stmt.update) {
+          this.buildAssignment(stmt.update);
+        }
+        this.jump(headerBlock);
+        this.enter(endBlock);
+        this.scopes.pop();
+        break;
+      }
+      case NodeType.SWITCH_STATEMENT:
+        this.buildSwitch(stmt);
+        break;
+      case NodeType.BREAK_STATEMENT:
+        if (this.breakTargets.length === 0) {
+          throw new Error('break outside a loop or switch');
+        }
+        this.jump(this.breakTargets[this.breakTargets.length - 1]);
+        this.block = this.createBlock();
+        break;
+      case NodeType.RETURN_STATEMENT: {
+        const returnType = this.fn!.returnType;
+        if (returnType === 'void') {
+          if (stmt.value) this.buildExpression(stmt.value);
+          this.terminate({ op: 'ret', value: null });
+        } else {
+          this.terminate({ op: 'ret', value: stmt.value ? this.buildAs(stmt.value, returnType) : null });
+        }
+        break;
+      }
+      case NodeType.BLOCK_STATEMENT:
+        this.scopes.push(new Map());
+        this.buildStatements(stmt.body);
+        this.scopes.pop();
+        break;
+      case NodeType.EXPRESSION_STATEMENT:
+        this.buildExpression(stmt.expression);
+        break;
+    }
+  }
+
+  /**
+   * Statement in its own scope (if/loop bodies)
+   */
+  private buildScoped(stmt: Statement): void {
+    this.scopes.push(new Map());
+    this.buildStatement(stmt);
+    this.scopes.pop();
+  }
+
+  private buildSwitch(stmt: SwitchStatement): void {
+    const value = this.buildExpression(stmt.discriminant);
+    const wide = isWide(value.type);
+    const signed = isSigned(value.type);
+    const key = signed ? this.biasSign(value, wide) : value;
+
+    const bodies = stmt.cases.map(() => this.createBlock());
+    const endBlock = this.createBlock();
+    const targets = new Map<number, BasicBlock>();
+    let fallback = endBlock;
+    stmt.cases.forEach((clause, index) => {
+      if (!clause.test) {
+        fallback = bodies[index];
+        return;
+      }
+      const literal = literalValue(clause.test);
+      if (literal === null) {
+        throw new Error('case label must be a constant');
+      }
+      const caseKey = constant(literal, value.type).value ^ (signed ? (wide ? 0x8000 : 0x80) : 0);
+      if (targets.has(caseKey)) {
+        throw new Error(`Duplicate case ${literal}`);
+      }
+      targets.set(caseKey, bodies[index]);
+    });
+
+    const values = Array.from(targets.keys()).sort((a, b) => a - b);
+    if (values.length === 0) {
+      this.jump(fallback);
+    } else {
+      this.buildDispatch(key, planSwitch(values, !wide), targets, fallback);
+    }
+
+    this.breakTargets.push(endBlock);
+    this.scopes.push(new Map());
+    stmt.cases.forEach((clause, index) => {
+      this.enter(bodies[index]);
+      this.buildStatements(clause.body);
+      this.jump(bodies[index + 1] || endBlock);
+    });
+    this.scopes.pop();
+    this.breakTargets.pop();
+    this.enter(endBlock);
+  }
+
+  /**
+   * Jumps to the target of `key` (the unsigned switch value) as planned;
+   * every path ends the current block
+   */
+  private buildDispatch(key: Value, plan: SwitchPlan, targets: Map<number, BasicBlock>, fallback: BasicBlock): void {
+    const test = (operator: BinaryOp, value: number): Value => {
+      const dst = newTemp(this.fn!, 'bool');
+      this.emit({ op: 'binary', dst, operator, a: key, b: constant(value, key.type) });
+      return dst;
+    };
+
+    switch (plan.kind) {
+      case 'compare':
+        for (const value of plan.values) {
+          const next = this.createBlock();
+          this.branch(test('eq', value), targets.get(value)!, next);
+          this.enter(next);
+        }
+        this.jump(fallback);
+        break;
+      case 'split': {
+        const below = this.createBlock();
+        const above = this.createBlock();
+        this.branch(test('lt', plan.pivot), below, above);
+        this.enter(below);
+        this.buildDispatch(key, plan.below, targets, fallback);
+        this.enter(above);
+        this.buildDispatch(key, plan.above, targets, fallback);
+        break;
+      }
+      case 'table': {
+        let index = key;
+        if (plan.low !== 0) {
+          index = newTemp(this.fn!, 'u8');
+          this.emit({ op: 'binary', dst: index, operator: 'sub', a: key, b: constant(plan.low) });
+        }
+        const entries: BasicBlock[] = [];
+        for (let value = plan.low; value <= plan.high; value++) {
+          entries.push(targets.get(value) || fallback);
+        }
+        this.terminate({ op: 'switch', value: index, targets: entries, default: fallback });
+        break;
+      }
+    }
+  }
+
+  private buildVariableDeclaration(stmt: VariableDeclaration): void {
+    // The initializer cannot see the variable it initializes
+    const type = irType(stmt.dataType);
+    const value = stmt.initializer ? this.buildAs(stmt.initializer, type) : null;
+    const variable = this.declareLocal(stmt.name, type, (stmt.isArray ? (stmt.arraySize || 1) : 1) * typeSize(type));
+    if (value) {
+      this.emit({ op: 'store', variable, offset: 0, src: value });
+    }
+  }
+
+  private buildAssignment(stmt: Assignment): void {
+    const variable = this.lookup(stmt.left.name);
+    const element = stmt.arrayIndex ? this.buildElement(variable, stmt.arrayIndex) : { offset: 0 };
+    const value = this.buildAs(stmt.right, variable.type);
+    this.emit({ op: 'store', variable, ...element, src: value });
+  }
+
+  /**
+   * Byte position of `variable[index]`: a constant offset for a literal
+   * index (checked against the array bounds), else a scaled index
+   */
+  private buildElement(variable: IRVariable, indexExpr: Expression): { offset: number; index?: Value } {
+    const size = typeSize(variable.type);
+    const literal = literalValue(indexExpr);
+    if (literal !== null) {
+      const length = variable.size / size;
+      if (literal < 0 || literal >= length) {
+        throw new Error(`Array index ${literal} out of bounds: ${variable.name}[${length}]`);
+      }
+      return { offset: literal * size };
+    }
+
+    let index = this.convert(this.buildExpression(indexExpr), 'u8');
+    if (size > 1) {
+      const dst = newTemp(this.fn!, 'u8');
+      this.emit({ op: 'binary', dst, operator: 'add', a: index, b: index });
+      index = dst;
+    }
+    return { offset: 0, index };
+  }
+
+  private buildExpression(expr: Expression): Value {
+    switch (expr.type) {
+      case NodeType.LITERAL:
+        return constant(literalValue(expr)!, irType(expr.dataType));
+      case NodeType.IDENTIFIER: {
+        const variable = this.lookup(expr.name);
+        const dst = newTemp(this.fn!, variable.type, variable.name);
+        this.emit({ op: 'load', dst, variable, offset: 0 });
+        return dst;
+      }
+      case NodeType.BINARY_EXPRESSION:
+        return this.buildBinary(expr);
+      case NodeType.UNARY_EXPRESSION:
+        return this.buildUnary(expr);
+      case NodeType.CALL_EXPRESSION:
+        return this.buildCall(expr);
+      case NodeType.ARRAY_ACCESS: {
+        const variable = this.lookup(expr.array);
+        const element = this.buildElement(variable, expr.index);
+        const dst = newTemp(this.fn!, variable.type, variable.name);
+        this.emit({ op: 'load', dst, variable, ...element });
+        return dst;
+      }
+    }
+  }
+
+  private buildBinary(expr: BinaryExpression): Value {
+    let operator = BINARY_OPS[expr.operator];
+    const shift = operator === 'shl' || operator === 'shr';
+
+    // Literals take the operation's width; other operands are built in order
+    const leftLiteral = literalValue(expr.left);
+    const rightLiteral = literalValue(expr.right);
+    const left = leftLiteral === null ? this.buildExpression(expr.left) : constant(leftLiteral, literalType(expr.left, leftLiteral));
+    const right = rightLiteral === null ? this.buildExpression(expr.right) : constant(rightLiteral, literalType(expr.right, rightLiteral));
+    const signed = shift ? isSigned(left.type) : isSigned(left.type) || isSigned(right.type);
+    const wide = isWide(left.type) || (!shift && isWide(right.type));
+
+    let a = left;
+    let b = right;
+    let type: IRType = signed ? 'i8' : 'u8';
+    if (wide) {
+      type = signed ? 'i16' : 'u16';
+      a = leftLiteral === null ? this.convert(left, type) : constant(leftLiteral, type);
+      b = rightLiteral === null ? this.convert(right, type) : constant(rightLiteral, type);
+      if (operator === 'shl' && b.kind === 'const') {
+        return this.buildDoublings(a, b.value, type);
+      }
+      if (operator === 'mul' || operator === 'div' || operator === 'mod' || shift) {
+        throw new Error(`Operator ${expr.operator} is not supported on 16-bit values`);
+      }
+    } else if (isWide(right.type)) {
+      // Shift count of an 8-bit value
+      b = rightLiteral === null ? this.convert(right, 'u8') : constant(Math.min(rightLiteral, 0xFF), 'u8');
+    }
+
+    if (isComparison(operator)) {
+      type = 'bool';
+      if (signed && operator !== 'eq' && operator !== 'ne') {
+        // Flipping the sign bits orders signed values like unsigned ones
+        b = this.biasSign(b, wide);
+        a = this.biasSign(a, wide);
+      }
+    } else if (signed) {
+      operator = SIGNED_OPS[operator] || operator;
+    }
+
+    const dst = newTemp(this.fn!, type);
+    this.emit({ op: 'binary', dst, operator, a, b });
+    return dst;
+  }
+
+  /**
+   * 16-bit value << count as count additions of the value to itself
+   */
+  private buildDoublings(value: Value, count: number, type: IRType): Value {
+    if (count >= 16) {
+      return constant(0, type);
+    }
+    let result = value;
+    for (let i = 0; i < count; i++) {
+      const dst = newTemp(this.fn!, type);
+      this.emit({ op: 'binary', dst, operator: 'add', a: result, b: result });
+      result = dst;
+    }
+    return result;
+  }
+
+  private biasSign(value: Value, wide: boolean): Value {
+    const type: IRType = wide ? 'u16' : 'u8';
+    const bias = constant(wide ? 0x8000 : 0x80, type);
+    if (value.kind === 'const') {
+      return constant(value.value ^ bias.value, type);
+    }
+    const dst = newTemp(this.fn!, type);
+    this.emit({ op: 'binary', dst, operator: 'xor', a: value, b: bias });
+    return dst;
+  }
+
+  /**
+   * Expression converted to `type`; literals are taken at that width
+   */
+  private buildAs(expr: Expression, type: IRType): Value {
+    const literal = literalValue(expr);
+    return literal === null ? this.convert(this.buildExpression(expr), type) : constant(literal, type);
+  }
+
+  /**
+   * Value widened or truncated to the width of `type`
+   */
+  private convert(value: Value, type: IRType): Value {
+    if (isWide(value.type) === isWide(type)) {
+      return value;
+    }
+    const operator: UnaryOp = !isWide(type) ? 'trunc' : value.type === 'i8' ? 'sext' : 'zext';
+    if (value.kind === 'const') {
+      return constant(operator === 'sext' && value.value & 0x80 ? value.value | 0xFF00 : value.value, type);
+    }
+    const dst = newTemp(this.fn!, type);
+    this.emit({ op: 'unary', dst, operator, a: value });
+    return dst;
+  }
+
+  private buildUnary(expr: UnaryExpression): Value {
+    const a = this.buildExpression(expr.operand);
+    const operator = UNARY_OPS[expr.operator];
+    const dst = newTemp(this.fn!, operator === 'lnot' ? 'bool' : a.type === 'bool' ? 'u8' : a.type);
+    this.emit({ op: 'unary', dst, operator, a });
+    return dst;
+  }
+
+  private buildCall(expr: CallExpression): Value {
+    if (BUILTIN_FUNCTIONS[expr.callee]) {
+      return this.buildBuiltinCall(expr);
+    }
+
+    const decl = this.declarations.get(expr.callee);
+    if (!decl) {
+      throw new Error(`Undefined function: ${expr.callee}`);
+    }
+    if (expr.arguments.length !== decl.parameters.length) {
+      throw new Error(`${expr.callee}() expects ${decl.parameters.length} argument(s), got ${expr.arguments.length}`);
+    }
+
+    const args = expr.arguments.map((arg, index) => this.buildAs(arg, irType(decl.parameters[index].type)));
+    if (decl.returnType === DataType.VOID || !decl.returnType) {
+      this.emit({ op: 'call', dst: null, callee: expr.callee, args });
+      return constant(0);
+    }
+
+    const dst = newTemp(this.fn!, irType(decl.returnType));
+    this.emit({ op: 'call', dst, callee: expr.callee, args });
+    return dst;
+  }
+
+  private buildBuiltinCall(expr: CallExpression): Value {
+    const builtin = BUILTIN_FUNCTIONS[expr.callee];
+    if (expr.arguments.length !== builtin.parameters.length) {
+      throw new Error(`${expr.callee}() expects ${builtin.parameters.length} argument(s), got ${expr.arguments.length}`);
+    }
+
+    switch (expr.callee) {
+      case 'input': {
+        const dst = newTemp(this.fn!, 'u8');
+        this.emit({ op: 'in', dst, port: constantPort('input', expr.arguments[0]) });
+        return dst;
+      }
+      case 'output': {
+        const port = constantPort('output', expr.arguments[0]);
+        this.emit({ op: 'out', port, src: this.buildAs(expr.arguments[1], 'u8') });
+        break;
+      }
+      case 'delay':
+        this.emit({ op: 'delay', src: this.buildAs(expr.arguments[0], 'u8') });
+        break;
+      case 'halt':
+        this.emit({ op: 'halt' });
+        this.terminate({ op: 'ret', value: null });
+        break;
+    }
+    return constant(0);
+  }
+
+  /**
+   * New block, laid out when entered so the block order follows the source
+   */
+  private createBlock(): BasicBlock {
+    const id = this.fn!.nextBlock++;
+    return { id, instructions: [], terminator: null, origin: `${this.fn!.name}.bb${id}` };
+  }
+
+  private enter(block: BasicBlock): void {
+    this.fn!.blocks.push(block);
+    this.block = block;
+  }
+
+  private emit(instruction: Instruction): void {
+    this.block!.instructions.push(instruction);
+  }
+
+  private jump(target: BasicBlock): void {
+    if (!this.block!.terminator) {
+      this.terminate({ op: 'jmp', target });
+    }
+  }
+
+  private branch(cond: Value, thenBlock: BasicBlock, elseBlock: BasicBlock): void {
+    this.terminate({ op: 'br', cond, then: thenBlock, else: elseBlock });
+  }
+
+  /**
+   * Ends the current block; following code goes to a fresh (possibly
+   * unreachable) block
+   */
+  private terminate(terminator: Terminator): void {
+    if (!this.block!.terminator) {
+      this.block!.terminator = terminator;
+    }
+    if (terminator.op === 'ret') {
+      this.block = this.createBlock();
+    }
+  }
+}
+
+/**
+ * Numeric value of a literal (or negated literal), else null; constant()
+ * wraps it to the width it is used at
+ */
+function literalValue(expr: Expression): number | null {
+  if (expr.type === NodeType.UNARY_EXPRESSION && expr.operator === UnaryOperator.NEGATIVE) {
+    const inner = literalValue(expr.operand);
+    return inner === null ? null : -inner;
+  }
+  if (expr.type !== NodeType.LITERAL) return null;
+
+  const literal = expr as Literal;
+  if (typeof literal.value === 'number') return literal.value;
+  if (typeof literal.value === 'boolean') return literal.value ? 1 : 0;
+  return literal.value.length > 0 ? literal.value.charCodeAt(0) & 0xFF : 0;
+}
+
+/**
+ * Type a literal operand has on its own: 16-bit if it does not fit a byte
+ */
+function literalType(expr: Expression, value: number): IRType {
+  if (value > 0xFF || value < -0x80) return 'u16';
+  return expr.type === NodeType.LITERAL ? irType(expr.dataType) : 'u8';
+}
+
+function constantPort(builtin: string, expr: Expression): number {
+  if (expr.type !== NodeType.LITERAL || typeof expr.value !== 'number') {
+    throw new Error(`${builtin}() port must be a constant`);
+  }
+  return expr.value;
+}
+
+// Factory function for easier usage
+export function buildModule(ast: Program): IRModule {
+  return new IRBuilder().build(ast);
+}
@@ -0,0 +1,193 @@
+/**
+ * Control Flow Graph Utilities
+ *
+ * Successor/predecessor queries, block orderings and dominance for IR
+ * functions. Dominators use the iterative algorithm of Cooper, Harvey and
+ * Kennedy ("A Simple, Fast Dominance Algorithm"); dominance frontiers
+ * drive phi placement in mem2reg.
+ *
+ * @fileoverview CFG traversal and dominance analysis
+ */
+
+import { BasicBlock, IRFunction, Terminator } from './ir';
+
+export function successors(block: BasicBlock): BasicBlock[] {
+  const terminator = block.terminator;
+  if (!terminator) return [];
+  switch (terminator.op) {
+    case 'jmp':
+      return [terminator.target];
+    case 'br':
+      return terminator.then === terminator.else ? [terminator.then] : [terminator.then, terminator.else];
+    case 'switch':
+      return Array.from(new Set([...terminator.targets, terminator.default]));
+    case 'ret':
+      return [];
+  }
+}
+
+/**
+ * Points every edge of `terminator` that goes to `from` at `to`
+ */
+export function retarget(terminator: Terminator, from: BasicBlock, to: BasicBlock): void {
+  switch (terminator.op) {
+    case 'jmp':
+      if (terminator.target === from) terminator.target = to;
+      break;
+    case 'br':
+      if (terminator.then === from) terminator.then = to;
+      if (terminator.else === from) terminator.else = to;
+      break;
+    case 'switch':
+      terminator.targets = terminator.targets.map((target) => (target === from ? to : target));
+      if (terminator.default === from) terminator.default = to;
+      break;
+  }
+}
+
+export function predecessors(fn: IRFunction): Map<BasicBlock, BasicBlock[]> {
+  const preds = new Map<BasicBlock, BasicBlock[]>();
+  for (const block of fn.blocks) {
+    preds.set(block, []);
+  }
+  for (const block of fn.blocks) {
+    for (const successor of successors(block)) {
+      preds.get(successor)!.push(block);
+    }
+  }
+  return preds;
+}
+
+/**
+ * Blocks reachable from the entry, in reverse postorder
+ */
+export function reversePostorder(fn: IRFunction): BasicBlock[] {
+  const visited = new Set<BasicBlock>();
+  const order: BasicBlock[] = [];
+
+  // Iterative DFS; a block is emitted once all its successors are done
+  const stack: { block: BasicBlock; next: number }[] = [];
+  if (fn.blocks.length > 0) {
+    visited.add(fn.blocks[0]);
+    stack.push({ block: fn.blocks[0], next: 0 });
+  }
+  while (stack.length > 0) {
+    const frame = stack[stack.length - 1];
+    const succs = successors(frame.block);
+    if (frame.next < succs.length) {
+      const successor = succs[frame.next++];
+      if (!visited.has(successor)) {
+        visited.add(successor);
+        stack.push({ block: successor, next: 0 });
+      }
+    } else {
+      order.push(frame.block);
+      stack.pop();
+    }
+  }
+  return order.reverse();
+}
+
+/**
+ * Drops blocks unreachable from the entry and phi inputs from them.
+ * Returns true if anything was removed.
+ */
+export function removeUnreachableBlocks(fn: IRFunction): boolean {
+  const reachable = new Set(reversePostorder(fn));
+  if (reachable.size === fn.blocks.length) return false;
+
+  fn.blocks = fn.blocks.filter((block) => reachable.has(block));
+  for (const block of fn.blocks) {
+    for (const instruction of block.instructions) {
+      if (instruction.op === 'phi') {
+        instruction.incoming = instruction.incoming.filter((incoming) => reachable.has(incoming.block));
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * Immediate dominator of every reachable block (the entry maps to itself)
+ */
+export function immediateDominators(fn: IRFunction): Map<BasicBlock, BasicBlock> {
+  const order = reversePostorder(fn);
+  const index = new Map(order.map((block, i) => [block, i] as [BasicBlock, number]));
+  const preds = predecessors(fn);
+  const idom = new Map<BasicBlock, BasicBlock>();
+
+  if (order.length === 0) return idom;
+  idom.set(order[0], order[0]);
+
+  const intersect = (a: BasicBlock, b: BasicBlock): BasicBlock => {
+    while (a !== b) {
+      while (index.get(a)! > index.get(b)!) a = idom.get(a)!;
+      while (index.get(b)! > index.get(a)!) b = idom.get(b)!;
+    }
+    return a;
+  };
+
+  let changed = true;
+  while (changed) {
+    changed = false;
+    for (const block of order.slice(1)) {
+      let dominator: BasicBlock | null = null;
+      for (const pred of preds.get(block)!) {
+        if (!idom.has(pred)) continue;
+        dominator = dominator ? intersect(pred, dominator) : pred;
+      }
+      if (dominator && idom.get(block) !== dominator) {
+        idom.set(block, dominator);
+        changed = true;
+      }
+    }
+  }
+  return idom;
+}
+
+export function dominates(idom: Map<BasicBlock, BasicBlock>, a: BasicBlock, b: BasicBlock): boolean {
+  let current = b;
+  for (;;) {
+    if (current === a) return true;
+    const parent = idom.get(current);
+    if (!parent || parent === current) return false;
+    current = parent;
+  }
+}
+
+/**
+ * Children of each block in the dominator tree
+ */
+export function dominatorTree(idom: Map<BasicBlock, BasicBlock>): Map<BasicBlock, BasicBlock[]> {
+  const children = new Map<BasicBlock, BasicBlock[]>();
+  for (const block of idom.keys()) {
+    children.set(block, []);
+  }
+  for (const [block, parent] of idom) {
+    if (block !== parent) {
+      children.get(parent)!.push(block);
+    }
+  }
+  return children;
+}
+
+export function dominanceFrontiers(fn: IRFunction, idom: Map<BasicBlock, BasicBlock>): Map<BasicBlock, Set<BasicBlock>> {
+  const frontiers = new Map<BasicBlock, Set<BasicBlock>>();
+  for (const block of idom.keys()) {
+    frontiers.set(block, new Set());
+  }
+
+  const preds = predecessors(fn);
+  for (const block of idom.keys()) {
+    const blockPreds = preds.get(block)!.filter((pred) => idom.has(pred));
+    if (blockPreds.length < 2) continue;
+    for (const pred of blockPreds) {
+      let runner = pred;
+      while (runner !== idom.get(block)) {
+        frontiers.get(runner)!.add(block);
+        runner = idom.get(runner)!;
+      }
+    }
+  }
+  return frontiers;
+}
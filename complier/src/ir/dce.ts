@@ -0,0 +1,194 @@
+/**
+ * Dead Code, Store and Function Elimination
+ *
+ * RAM and ROM are both tiny, so only code and data the program can reach
+ * should be emitted.
+ *
+ * Function pass (`dce`):
+ * - A store is dead when the function never loads its local, or when the
+ *   same byte is stored again later in the block with no load of the
+ *   variable or call in between
+ * - Instructions without side effects whose result is never used are
+ *   removed; liveness is marked from side effects and terminators, so
+ *   dead phi cycles go too
+ * - Locals that are neither loaded nor stored any more give up their
+ *   frame bytes (parameters keep their slots)
+ *
+ * Module passes:
+ * - `dead-functions`: functions the call graph cannot reach from `main`
+ *   or the global initializer function are removed. Without a `main`
+ *   (a library compiled on its own) everything is kept
+ * - `dead-globals`: globals no function loads lose their stores and
+ *   their RAM
+ *
+ * @fileoverview Removal of unreachable functions, unused values and dead stores
+ */
+
+import { IRModule, IRFunction, IRVariable, Instruction, Terminator, definedTemp, usedValues, hasSideEffects } from './ir';
+import { INIT_FUNCTION } from './builder';
+
+/**
+ * Runs dead store and dead instruction elimination on one function;
+ * returns true if it changed anything
+ */
+export function eliminateDeadCode(fn: IRFunction): boolean {
+  let changed = removeDeadStores(fn);
+  changed = removeDeadInstructions(fn) || changed;
+  changed = removeUnusedLocals(fn) || changed;
+  return changed;
+}
+
+function removeDeadStores(fn: IRFunction): boolean {
+  const loaded = new Set<IRVariable>();
+  for (const block of fn.blocks) {
+    for (const ins of block.instructions) {
+      if (ins.op === 'load') loaded.add(ins.variable);
+    }
+  }
+
+  let changed = false;
+  for (const block of fn.blocks) {
+    // Walking backwards: bytes stored again before anything can read them
+    const overwritten = new Map<IRVariable, Set<number>>();
+    const dead = new Set<Instruction>();
+
+    for (let i = block.instructions.length - 1; i >= 0; i--) {
+      const ins = block.instructions[i];
+      if (ins.op === 'call') {
+        overwritten.clear();
+      } else if (ins.op === 'load') {
+        overwritten.delete(ins.variable);
+      } else if (ins.op === 'store') {
+        const offsets = overwritten.get(ins.variable) || new Set<number>();
+        const unread = ins.variable.scope === 'local' && !loaded.has(ins.variable);
+        if (unread || (!ins.index && offsets.has(ins.offset))) {
+          dead.add(ins);
+        }
+        // An indexed store may write any byte; it hides none of the earlier ones
+        if (!ins.index) offsets.add(ins.offset);
+        overwritten.set(ins.variable, offsets);
+      }
+    }
+
+    if (dead.size > 0) {
+      block.instructions = block.instructions.filter((ins) => !dead.has(ins));
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+function removeDeadInstructions(fn: IRFunction): boolean {
+  const definitions = new Map<number, Instruction>();
+  for (const block of fn.blocks) {
+    for (const ins of block.instructions) {
+      const dst = definedTemp(ins);
+      if (dst) definitions.set(dst.id, ins);
+    }
+  }
+
+  const live = new Set<Instruction>();
+  const work: Instruction[] = [];
+  const markUses = (ins: Instruction | Terminator) => {
+    for (const value of usedValues(ins)) {
+      const def = value.kind === 'temp' ? definitions.get(value.id) : undefined;
+      if (def && !live.has(def)) {
+        live.add(def);
+        work.push(def);
+      }
+    }
+  };
+
+  for (const block of fn.blocks) {
+    for (const ins of block.instructions) {
+      if (hasSideEffects(ins)) {
+        live.add(ins);
+        work.push(ins);
+      }
+    }
+    markUses(block.terminator!);
+  }
+  while (work.length > 0) {
+    markUses(work.pop()!);
+  }
+
+  let changed = false;
+  for (const block of fn.blocks) {
+    const kept = block.instructions.filter((ins) => live.has(ins));
+    if (kept.length !== block.instructions.length) {
+      block.instructions = kept;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+function removeUnusedLocals(fn: IRFunction): boolean {
+  const used = new Set<IRVariable>();
+  for (const block of fn.blocks) {
+    for (const ins of block.instructions) {
+      if (ins.op === 'load' || ins.op === 'store') used.add(ins.variable);
+    }
+  }
+
+  const kept = fn.locals.filter((local) => local.paramIndex !== undefined || used.has(local));
+  if (kept.length === fn.locals.length) return false;
+  fn.locals = kept;
+  return true;
+}
+
+/**
+ * Removes functions unreachable from main; returns how many were removed
+ */
+export function removeDeadFunctions(module: IRModule): number {
+  const byName = new Map(module.functions.map((fn) => [fn.name, fn] as [string, IRFunction]));
+  if (!byName.has('main')) return 0;
+
+  const reachable = new Set<string>();
+  const work = ['main', INIT_FUNCTION].filter((name) => byName.has(name));
+  while (work.length > 0) {
+    const name = work.pop()!;
+    if (reachable.has(name)) continue;
+    reachable.add(name);
+    for (const block of byName.get(name)!.blocks) {
+      for (const ins of block.instructions) {
+        if (ins.op === 'call') work.push(ins.callee);
+      }
+    }
+  }
+
+  const before = module.functions.length;
+  module.functions = module.functions.filter((fn) => reachable.has(fn.name));
+  return before - module.functions.length;
+}
+
+/**
+ * Drops globals that are never loaded, with their stores; returns how
+ * many functions lost stores
+ */
+export function removeDeadGlobals(module: IRModule): number {
+  const loaded = new Set<IRVariable>();
+  for (const fn of module.functions) {
+    for (const block of fn.blocks) {
+      for (const ins of block.instructions) {
+        if (ins.op === 'load') loaded.add(ins.variable);
+      }
+    }
+  }
+
+  const dead = new Set(module.globals.filter((global) => !loaded.has(global)));
+  if (dead.size === 0) return 0;
+  module.globals = module.globals.filter((global) => !dead.has(global));
+
+  let changed = 0;
+  for (const fn of module.functions) {
+    let removed = false;
+    for (const block of fn.blocks) {
+      const kept = block.instructions.filter((ins) => ins.op !== 'store' || !dead.has(ins.variable));
+      removed = removed || kept.length !== block.instructions.length;
+      block.instructions = kept;
+    }
+    if (removed) changed++;
+  }
+  return changed;
+}
@@ -0,0 +1,140 @@
+/**
+ * Compiled Stack
+ *
+ * Function frames are static, but two functions can only need their
+ * frames at the same time when one is active while the other runs, i.e.
+ * when one (transitively) calls the other. The call graph therefore lets
+ * frames overlay each other like a stack laid out at compile time:
+ *
+ * - Functions nothing calls (`main`, the global initializer, library
+ *   entry points) start at the bottom
+ * - Every other function starts above the highest frame of any caller
+ * - Functions on a call graph cycle are stacked on top of one another as
+ *   a unit, so they do not overwrite each other's frames
+ *
+ * A function still has one frame for all its activations. A recursive
+ * call that returns to its caller would find the caller's frame
+ * overwritten, so the lowering only accepts calls within a cycle that it
+ * turns into tail-call jumps (see recursiveComponents()).
+ *
+ * The RAM the frames need is then that of the deepest call chain rather
+ * than the sum over all functions.
+ *
+ * @fileoverview Frame placement by call graph overlay
+ */
+
+import { IRModule } from './ir';
+
+export interface FramePlacement {
+  /** First byte of every function's frame */
+  bases: Map<string, number>;
+  /** One past the highest frame byte */
+  end: number;
+}
+
+/**
+ * Functions each function calls directly
+ */
+export function callGraph(module: IRModule): Map<string, Set<string>> {
+  const graph = new Map<string, Set<string>>();
+  for (const fn of module.functions) {
+    const callees = new Set<string>();
+    for (const block of fn.blocks) {
+      for (const ins of block.instructions) {
+        if (ins.op === 'call') callees.add(ins.callee);
+      }
+    }
+    graph.set(fn.name, callees);
+  }
+  return graph;
+}
+
+/**
+ * Strongly connected components of the call graph, callers before
+ * callees (Tarjan's algorithm emits them callees first)
+ */
+function components(graph: Map<string, Set<string>>): string[][] {
+  const index = new Map<string, number>();
+  const lowLink = new Map<string, number>();
+  const stack: string[] = [];
+  const onStack = new Set<string>();
+  const result: string[][] = [];
+
+  const connect = (name: string) => {
+    index.set(name, index.size);
+    lowLink.set(name, index.get(name)!);
+    stack.push(name);
+    onStack.add(name);
+
+    for (const callee of graph.get(name)!) {
+      if (!graph.has(callee)) continue;
+      if (!index.has(callee)) {
+        connect(callee);
+        lowLink.set(name, Math.min(lowLink.get(name)!, lowLink.get(callee)!));
+      } else if (onStack.has(callee)) {
+        lowLink.set(name, Math.min(lowLink.get(name)!, index.get(callee)!));
+      }
+    }
+
+    if (lowLink.get(name) === index.get(name)) {
+      const component: string[] = [];
+      let member: string;
+      do {
+        member = stack.pop()!;
+        onStack.delete(member);
+        component.push(member);
+      } while (member !== name);
+      result.push(component);
+    }
+  };
+
+  for (const name of graph.keys()) {
+    if (!index.has(name)) connect(name);
+  }
+  return result.reverse();
+}
+
+/**
+ * Functions on a call graph cycle, each mapped to the members of its cycle
+ * (itself included): a call from one member to another can reach an
+ * activation whose frame is still in use
+ */
+export function recursiveComponents(module: IRModule): Map<string, Set<string>> {
+  const graph = callGraph(module);
+  const result = new Map<string, Set<string>>();
+  for (const component of components(graph)) {
+    if (component.length === 1 && !graph.get(component[0])!.has(component[0])) continue;
+    const members = new Set(component);
+    for (const name of component) result.set(name, members);
+  }
+  return result;
+}
+
+/**
+ * Places frames of the given sizes from `base` upwards so that no two
+ * functions that can be active together share a byte
+ */
+export function overlayFrames(module: IRModule, sizes: Map<string, number>, base: number): FramePlacement {
+  const graph = callGraph(module);
+  const bases = new Map<string, number>();
+  // Lowest byte each function may use, raised by every caller placed
+  const floor = new Map<string, number>();
+  let end = base;
+
+  for (const component of components(graph)) {
+    let address = Math.max(base, ...component.map((name) => floor.get(name) || base));
+    for (const name of component) {
+      bases.set(name, address);
+      address += sizes.get(name) || 0;
+    }
+    end = Math.max(end, address);
+
+    const members = new Set(component);
+    for (const name of component) {
+      for (const callee of graph.get(name)!) {
+        if (!members.has(callee)) floor.set(callee, Math.max(floor.get(callee) || base, address));
+      }
+    }
+  }
+  return { bases, end };
+}
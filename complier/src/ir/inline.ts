@@ -0,0 +1,308 @@
+/**
+ * Function Inlining
+ *
+ * A call is expensive on this CPU: the caller stores every argument into
+ * the callee's static frame, CALL and RET go through the stack, and the
+ * callee's frame occupies RAM for the whole program. The inliner replaces
+ * a call with a copy of the callee's body when:
+ *
+ * - the callee has a single call site; the copy takes the place of the
+ *   original, which dead-functions then removes along with its frame, or
+ * - the callee is a leaf (it makes no calls) whose body costs no more
+ *   than the call it replaces (one store per argument, CALL, RET) plus
+ *   the size budget of the optimization level. Returns and accesses to
+ *   scalar locals are free, since they turn into jumps and SSA values
+ *
+ * Recursive functions, `main` and the initializer function are never
+ * inlined. With a profile (--profile-use), a call in a hot block gets
+ * `hotSizeBudget` instead, and one in a block that never ran none.
+ *
+ * The callee's locals, parameters included, become fresh locals of the
+ * caller, so arguments are plain stores that mem2reg later promotes like
+ * any other local. Each `ret` becomes a jump to the code after the call,
+ * and the returned values meet in a phi (or a copy, if there is a single
+ * return).
+ *
+ * @fileoverview Call-site inlining with a size cost model
+ */
+
+import {
+  IRModule, IRFunction, IRVariable, BasicBlock, Instruction, Terminator, Value, Temp,
+  PhiIncoming, constant, typeSize, newTemp, instructionCount, mapUsedValues, definedTemp
+} from './ir';
+import { successors } from './cfg';
+import { INIT_FUNCTION } from './builder';
+import { ProfileCounts } from './profile';
+
+export interface InlineOptions {
+  /** IR instructions a leaf may cost beyond the call it replaces */
+  sizeBudget?: number;
+  /** Upper bound on a caller's size after inlining, in IR instructions */
+  maxCallerSize?: number;
+  /** Execution counts deciding the budget per call site */
+  profile?: ProfileCounts | null;
+  /** Budget of call sites the profile finds hot */
+  hotSizeBudget?: number;
+}
+
+export class Inliner {
+  private options: Required<InlineOptions>;
+  private functions: Map<string, IRFunction> = new Map();
+  private recursive: Set<string> = new Set();
+
+  constructor(options: InlineOptions = {}) {
+    this.options = {
+      sizeBudget: options.sizeBudget || 0,
+      maxCallerSize: options.maxCallerSize || 400,
+      profile: options.profile || null,
+      hotSizeBudget: options.hotSizeBudget || 0
+    };
+  }
+
+  /**
+   * Inlines qualifying calls everywhere; returns how many functions
+   * changed
+   */
+  run(module: IRModule): number {
+    this.functions = new Map(module.functions.map((fn) => [fn.name, fn] as [string, IRFunction]));
+    this.recursive = findRecursive(module);
+
+    let changed = 0;
+    for (const caller of module.functions) {
+      let inlinedAny = false;
+      let site = this.findSite(module, caller);
+      while (site) {
+        inlineCall(caller, site.block, site.index, this.functions.get(site.callee)!);
+        inlinedAny = true;
+        site = this.findSite(module, caller);
+      }
+      if (inlinedAny) changed++;
+    }
+    return changed;
+  }
+
+  /**
+   * Whether a call to `callee` (in `site`, if known) should be replaced by
+   * its body
+   */
+  shouldInline(callee: IRFunction, callSites: number, site: BasicBlock | null = null): boolean {
+    if (callee.name === 'main' || callee.name === INIT_FUNCTION || this.recursive.has(callee.name)) {
+      return false;
+    }
+    if (callSites === 1) return true;
+
+    const { sizeBudget, profile, hotSizeBudget } = this.options;
+    const budget = profile && site ? profile.budget(site, sizeBudget, hotSizeBudget) : sizeBudget;
+    const leaf = callee.blocks.every((block) => block.instructions.every((ins) => ins.op !== 'call'));
+    return leaf && bodyCost(callee) <= callee.params.length + 2 + budget;
+  }
+
+  private findSite(module: IRModule, caller: IRFunction): { block: BasicBlock; index: number; callee: string } | null {
+    if (instructionCount(caller) > this.options.maxCallerSize) return null;
+    const sites = countCallSites(module);
+
+    for (const block of caller.blocks) {
+      for (let index = 0; index < block.instructions.length; index++) {
+        const ins = block.instructions[index];
+        if (ins.op !== 'call' || ins.callee === caller.name) continue;
+        const callee = this.functions.get(ins.callee);
+        if (callee && this.shouldInline(callee, sites.get(ins.callee) || 0, block)) {
+          return { block, index, callee: ins.callee };
+        }
+      }
+    }
+    return null;
+  }
+}
+
+/**
+ * IR instructions the callee's body leaves once inlined and promoted
+ */
+function bodyCost(fn: IRFunction): number {
+  let cost = 0;
+  for (const block of fn.blocks) {
+    for (const ins of block.instructions) {
+      const scalarLocal = (ins.op === 'load' || ins.op === 'store') && ins.variable.scope === 'local' && ins.variable.size === typeSize(ins.variable.type);
+      if (!scalarLocal) cost++;
+    }
+    if (block.terminator && block.terminator.op !== 'ret') cost++;
+  }
+  return cost;
+}
+
+function countCallSites(module: IRModule): Map<string, number> {
+  const sites = new Map<string, number>();
+  for (const fn of module.functions) {
+    for (const block of fn.blocks) {
+      for (const ins of block.instructions) {
+        if (ins.op === 'call') sites.set(ins.callee, (sites.get(ins.callee) || 0) + 1);
+      }
+    }
+  }
+  return sites;
+}
+
+/**
+ * Functions that can reach themselves through calls
+ */
+function findRecursive(module: IRModule): Set<string> {
+  const callees = new Map<string, Set<string>>();
+  for (const fn of module.functions) {
+    const called = new Set<string>();
+    for (const block of fn.blocks) {
+      for (const ins of block.instructions) {
+        if (ins.op === 'call') called.add(ins.callee);
+      }
+    }
+    callees.set(fn.name, called);
+  }
+
+  const recursive = new Set<string>();
+  for (const fn of module.functions) {
+    const seen = new Set<string>();
+    const work = Array.from(callees.get(fn.name)!);
+    while (work.length > 0) {
+      const name = work.pop()!;
+      if (name === fn.name) {
+        recursive.add(fn.name);
+        break;
+      }
+      if (seen.has(name)) continue;
+      seen.add(name);
+      work.push(...(callees.get(name) || []));
+    }
+  }
+  return recursive;
+}
+
+/**
+ * Replaces the call at `block.instructions[index]` with a copy of
+ * `callee`'s body
+ */
+export function inlineCall(caller: IRFunction, block: BasicBlock, index: number, callee: IRFunction): void {
+  const call = block.instructions[index];
+  if (call.op !== 'call') {
+    throw new Error(`${caller.name}: bb${block.id} has no call at ${index}`);
+  }
+
+  // Split the block after the call; phis of its successors now come from the tail
+  const tail: BasicBlock = { id: caller.nextBlock++, instructions: block.instructions.slice(index + 1), terminator: block.terminator };
+  block.instructions = block.instructions.slice(0, index);
+  for (const successor of successors(tail)) {
+    for (const ins of successor.instructions) {
+      if (ins.op === 'phi') {
+        ins.incoming.forEach((incoming) => {
+          if (incoming.block === block) incoming.block = tail;
+        });
+      }
+    }
+  }
+
+  // Fresh locals, temporaries and blocks for the copy
+  const variables = new Map<IRVariable, IRVariable>();
+  for (const local of callee.locals) {
+    const copy: IRVariable = { name: `${callee.name}.${local.name}`, type: local.type, size: local.size, scope: 'local' };
+    variables.set(local, copy);
+    caller.locals.push(copy);
+  }
+  const temps = new Map<number, Temp>();
+  const temp = (original: Temp): Temp => {
+    if (!temps.has(original.id)) temps.set(original.id, newTemp(caller, original.type, original.name));
+    return temps.get(original.id)!;
+  };
+  const blocks = new Map<BasicBlock, BasicBlock>();
+  for (const original of callee.blocks) {
+    blocks.set(original, { id: caller.nextBlock++, instructions: [], terminator: null, origin: original.origin });
+  }
+
+  const mapValue = (value: Value): Value => value.kind === 'temp' ? temp(value) : value;
+  const variable = (original: IRVariable) => variables.get(original) || original;
+  const returns: PhiIncoming[] = [];
+
+  // Arguments go to the parameters' new home
+  for (const local of callee.locals) {
+    if (local.paramIndex !== undefined) {
+      block.instructions.push({ op: 'store', variable: variables.get(local)!, offset: 0, src: call.args[local.paramIndex] });
+    }
+  }
+
+  for (const original of callee.blocks) {
+    const copy = blocks.get(original)!;
+    for (const ins of original.instructions) {
+      copy.instructions.push(cloneInstruction(ins, call.args, mapValue, temp, variable, blocks));
+    }
+
+    const terminator = original.terminator!;
+    if (terminator.op === 'ret') {
+      returns.push({ block: copy, value: terminator.value ? mapValue(terminator.value) : constant(0) });
+      copy.terminator = { op: 'jmp', target: tail };
+    } else {
+      let cloned: Terminator;
+      if (terminator.op === 'jmp') {
+        cloned = { op: 'jmp', target: blocks.get(terminator.target)! };
+      } else if (terminator.op === 'br') {
+        cloned = { op: 'br', cond: terminator.cond, then: blocks.get(terminator.then)!, else: blocks.get(terminator.else)! };
+      } else {
+        const targets = terminator.targets.map((target) => blocks.get(target)!);
+        cloned = { op: 'switch', value: terminator.value, targets, default: blocks.get(terminator.default)! };
+      }
+      mapUsedValues(cloned, mapValue);
+      copy.terminator = cloned;
+    }
+  }
+
+  if (call.dst) {
+    const result: Instruction = returns.length === 1
+      ? { op: 'copy', dst: call.dst, src: returns[0].value }
+      : { op: 'phi', dst: call.dst, incoming: returns };
+    if (result.op === 'copy') {
+      returns[0].block.instructions.push(result);
+    } else {
+      tail.instructions.unshift(result);
+    }
+  }
+
+  block.terminator = { op: 'jmp', target: blocks.get(callee.blocks[0])! };
+  const position = caller.blocks.indexOf(block) + 1;
+  caller.blocks.splice(position, 0, ...callee.blocks.map((original) => blocks.get(original)!), tail);
+}
+
+function cloneInstruction(
+  ins: Instruction,
+  args: Value[],
+  mapValue: (value: Value) => Value,
+  temp: (original: Temp) => Temp,
+  variable: (original: IRVariable) => IRVariable,
+  blocks: Map<BasicBlock, BasicBlock>
+): Instruction {
+  let copy: Instruction;
+  switch (ins.op) {
+    case 'param':
+      // Callee already in SSA form: the argument is the value
+      return { op: 'copy', dst: temp(ins.dst), src: args[ins.index] };
+    case 'load':
+    case 'store':
+      copy = { ...ins, variable: variable(ins.variable) };
+      break;
+    case 'phi':
+      copy = { ...ins, incoming: ins.incoming.map((incoming) => ({ block: blocks.get(incoming.block)!, value: incoming.value })) };
+      break;
+    case 'call':
+      copy = { ...ins, args: ins.args.slice() };
+      break;
+    default:
+      copy = { ...ins };
+  }
+
+  mapUsedValues(copy, mapValue);
+  const dst = definedTemp(copy);
+  if (dst) {
+    (copy as { dst: Temp }).dst = temp(dst);
+  }
+  return copy;
+}
+
+// Factory function for easier usage
+export function inlineModule(module: IRModule, options: InlineOptions = {}): number {
+  return new Inliner(options).run(module);
+}
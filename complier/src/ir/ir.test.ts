@@ -0,0 +1,460 @@
+import { CTokenizer } from '../languages/c-tokenizer';
+import { CParser } from '../languages/c-parser';
+import { buildModule } from './builder';
+import { PassManager, MEM2REG, TAIL_RECURSION, createPassManager } from './pass-manager';
+import { printFunction } from './printer';
+import { verifyFunction } from './verify';
+import { destructSSA } from './ssa';
+import { successors } from './cfg';
+import { foldBinary } from './sccp';
+import { IRLowering, allocateTemps } from './lower';
+import { overlayFrames } from './frames';
+import { BasicBlock, IRModule, Instruction, Temp, definedTemp, isTemp, usedValues } from './ir';
+import { planSwitch } from './switch';
+
+function build(source: string): IRModule {
+  const parsed = new CParser(new CTokenizer(source).tokenize()).parse();
+  if (parsed.errors.length > 0) {
+    throw new Error(parsed.errors.join('\n'));
+  }
+  return buildModule(parsed.ast);
+}
+
+describe('IR', () => {
+  const loop = `
+    void main() {
+      uint8 i;
+      uint8 sum = 0;
+      for (i = 0; i < 10; i = i + 1) {
+        sum = sum + i;
+      }
+      output(0, sum);
+    }
+  `;
+
+  test('should build loads and stores for locals at O0', () => {
+    const module = build(loop);
+    const main = module.functions[0];
+
+    expect(verifyFunction(main)).toEqual([]);
+    expect(main.locals.map((local) => local.name)).toEqual(['i', 'sum']);
+    expect(printFunction(main)).toContain('store sum, %');
+    expect(printFunction(main)).not.toContain('phi');
+  });
+
+  test('should promote locals to SSA with phis at the loop header', () => {
+    const module = build(loop);
+    const stats = new PassManager().add(MEM2REG).run(module);
+    const main = module.functions[0];
+    const text = printFunction(main);
+
+    expect(stats.map((pass) => [pass.name, pass.changed])).toEqual([['mem2reg', 1]]);
+    expect(main.locals).toEqual([]);
+    expect(text).not.toContain('load');
+    expect((text.match(/= phi/g) || []).length).toBe(2);
+    expect(text).toMatch(/phi \[0, bb0\]/);
+  });
+
+  test('should report uses that are not dominated by their definition', () => {
+    const module = build('uint8 f(uint8 a) { uint8 b; if (a) { b = a + 1; } return b; }');
+    createPassManager(1).run(module);
+    const fn = module.functions[0];
+
+    // Move the definition of the phi input into the other branch
+    const [, thenBlock] = fn.blocks;
+    const add = thenBlock.instructions.shift()!;
+    fn.blocks[fn.blocks.length - 1].instructions.push(add);
+
+    expect(verifyFunction(fn).join('\n')).toMatch(/before its definition|defined more than once/);
+  });
+
+  test('should sequentialize swapping phi copies through a temporary', () => {
+    const module = build(`
+      void main() {
+        uint8 x = 1;
+        uint8 y = 2;
+        while (input(0)) {
+          uint8 t = x;
+          x = y;
+          y = t;
+        }
+        output(0, x);
+      }
+    `);
+    new PassManager().add(MEM2REG).run(module);
+    const main = module.functions[0];
+    destructSSA(main);
+
+    const copies = main.blocks.flatMap((block) => block.instructions).filter((ins) => ins.op === 'copy');
+    expect(main.blocks.some((block) => block.instructions.some((ins) => ins.op === 'phi'))).toBe(false);
+    // Two copies per incoming edge of the header, plus one to break the cycle
+    expect(copies.length).toBe(5);
+  });
+
+  test('should never give temporaries that are live together the same slot', () => {
+    // b is defined first, so the saved copy prefers b's slot 0 while b is rewritten
+    const module = build(`
+      void main() {
+        uint8 a;
+        uint8 b = input(1);
+        a = input(0);
+        uint8 n = input(2);
+        while (n != 0) { uint8 t = a; a = b; b = t; n = n - 1; }
+        output(0, a);
+        output(1, b);
+      }
+    `);
+    createPassManager(1).run(module);
+    const main = module.functions[0];
+    destructSSA(main);
+    const { poolColors } = allocateTemps(main);
+
+    // Walks a block backwards from the temporaries live at its end
+    const walk = (block: BasicBlock, live: Set<number>, visit: (dst: Temp, ins: Instruction) => void) => {
+      for (const value of usedValues(block.terminator!)) if (isTemp(value)) live.add(value.id);
+      for (let i = block.instructions.length - 1; i >= 0; i--) {
+        const ins = block.instructions[i];
+        const dst = definedTemp(ins);
+        if (dst) {
+          visit(dst, ins);
+          live.delete(dst.id);
+        }
+        for (const value of usedValues(ins)) if (isTemp(value)) live.add(value.id);
+      }
+      return live;
+    };
+
+    const liveOut = new Map<BasicBlock, Set<number>>();
+    for (const block of main.blocks) liveOut.set(block, new Set());
+    let changed = true;
+    while (changed) {
+      changed = false;
+      for (const block of main.blocks) {
+        const out = liveOut.get(block)!;
+        for (const succ of successors(block)) {
+          for (const id of walk(succ, new Set(liveOut.get(succ)!), () => {})) {
+            if (out.has(id)) continue;
+            out.add(id);
+            changed = true;
+          }
+        }
+      }
+    }
+
+    const clashes: string[] = [];
+    for (const block of main.blocks) {
+      const live = new Set(liveOut.get(block)!);
+      walk(block, live, (dst, ins) => {
+        const source = ins.op === 'copy' && isTemp(ins.src) ? ins.src.id : -1;
+        for (const id of live) {
+          if (id === dst.id || id === source || !poolColors.has(id)) continue;
+          if (poolColors.get(id) === poolColors.get(dst.id)) clashes.push(`%${dst.id} and %${id}`);
+        }
+      });
+    }
+    expect(clashes).toEqual([]);
+  });
+
+  test('should fold constants through phis and remove decided branches', () => {
+    const module = build(`
+      void main() {
+        uint8 a = 1;
+        uint8 b;
+        if (a) {
+          b = 5;
+        } else {
+          b = input(0);
+        }
+        int8 c = 127;
+        output(0, b + 1);
+        output(1, c + 1);
+      }
+    `);
+    const stats = createPassManager(1).run(module);
+    const text = printFunction(module.functions[0]);
+
+    expect(text).toContain('out 0, 6');
+    expect(text).toContain('out 1, 128');
+    expect(text).not.toMatch(/\bbr\b|\bin\b|phi/);
+    expect(stats.find((pass) => pass.name === 'sccp')!.removed).toBeGreaterThan(0);
+  });
+
+  test('should wrap folded arithmetic at 8 bits', () => {
+    expect(foldBinary('add', 200, 100)).toBe(44);
+    expect(foldBinary('sub', 3, 5)).toBe(254);
+    expect(foldBinary('lt', 254, 3)).toBe(0);
+    expect(foldBinary('mul', 20, 13)).toBe(4);
+    expect(foldBinary('shl', 3, 7)).toBe(128);
+  });
+
+  test('should fold division and shifts like the runtime routines', () => {
+    expect(foldBinary('div', 200, 7)).toBe(28);
+    expect(foldBinary('mod', 200, 7)).toBe(4);
+    expect(foldBinary('div', 9, 0)).toBe(255);
+    expect(foldBinary('mod', 9, 0)).toBe(9);
+    // -7 / 2 = -3 remainder -1
+    expect(foldBinary('sdiv', 249, 2)).toBe(253);
+    expect(foldBinary('smod', 249, 2)).toBe(255);
+    expect(foldBinary('shr', 0x90, 4)).toBe(0x09);
+    expect(foldBinary('sar', 0x90, 4)).toBe(0xF9);
+    expect(foldBinary('sar', 0x90, 9)).toBe(0xFF);
+  });
+
+  test('should widen 8-bit operands of 16-bit operations', () => {
+    const module = build(`
+      void main() {
+        int8 s = input(0);
+        uint8 u = input(1);
+        int16 w = s + 1000;
+        if (w < u) {
+          output(0, w);
+        }
+      }
+    `);
+    const text = printFunction(module.functions[0]);
+
+    expect(text).toMatch(/%\d+:i16 = sext %\d+/);
+    expect(text).toMatch(/%\d+:i16 = add %\d+, 1000/);
+    expect(text).toMatch(/%\d+:i16 = zext %\d+/);
+    expect(text).toMatch(/xor %\d+, 32768/);
+    expect(text).toMatch(/%\d+:u8 = trunc %\d+/);
+    expect(foldBinary('add', 0xFFFF, 1, 0xFFFF)).toBe(0);
+    expect(foldBinary('sub', 0x100, 1, 0xFFFF)).toBe(0xFF);
+  });
+
+  test('should index arrays by a scaled byte offset and fold constant indices', () => {
+    const module = build(`
+      uint16 w[4];
+      void main() {
+        uint8 i = input(0);
+        uint8 j = 2;
+        w[i] = 7;
+        output(0, w[j + 1]);
+      }
+    `);
+    const text = printFunction(module.functions[0]);
+
+    expect(text).toMatch(/(%\d+):u8 = add (%\d+), \2\s+store w\[\1\], 7/);
+    createPassManager(1).run(module);
+    const optimized = printFunction(module.functions[0]);
+    expect(optimized).toMatch(/load w\+6 /);
+    expect(optimized).toMatch(/store w\[%\d+\], 7/);
+  });
+
+  test('should reduce multiplication, division and shifts by constants', () => {
+    const module = build(`
+      void main() {
+        uint8 a = input(0);
+        int8 s = input(1);
+        output(0, a * 10);
+        output(1, a % 16);
+        output(2, a / 4);
+        output(3, a >> 7);
+        output(4, a * 255);
+        output(5, s >> 7);
+        output(6, a / 3);
+        output(7, s / 4);
+      }
+    `);
+    createPassManager(1).run(module);
+    const text = printFunction(module.functions[0]);
+
+    expect(text).not.toMatch(/\b(mul|mod|sar)\b/);
+    // 2a, 4a, 5a, 10a
+    expect(text.match(/= add (%\d+), \1\b/g)!.length).toBe(3);
+    expect(text).toMatch(/and %\d+, 15/);
+    expect(text).toMatch(/shr %\d+, 2/);
+    expect(text.match(/ge %\d+, 128/g)!.length).toBe(2);
+    // Only divisions without a cheaper form are left to the runtime
+    expect(text).toMatch(/= div %\d+, 3/);
+    expect(text).toMatch(/sdiv %\d+, 4/);
+  });
+
+  test('should drop unreachable functions, unread globals and dead stores', () => {
+    const module = build(`
+      uint8 unused = 4;
+      uint8 used = 9;
+      uint8 helper(uint8 a) { return a + used; }
+      uint8 never(uint8 a) { return helper(a); }
+      void main() {
+        uint8 buf[2];
+        uint8 t = input(0);
+        buf[0] = t;
+        unused = t;
+        uint8 dead = t ^ 3;
+        output(0, helper(t));
+        halt();
+        output(1, 99);
+      }
+    `);
+    const stats = createPassManager(1).run(module);
+    const main = module.functions.find((fn) => fn.name === 'main')!;
+    const text = printFunction(main);
+
+    // helper is inlined into main, leaving both helper and never unreachable
+    expect(module.functions.map((fn) => fn.name)).toEqual(['main']);
+    expect(module.globals.map((global) => global.name)).toEqual(['used']);
+    expect(main.locals).toEqual([]);
+    expect(text).not.toMatch(/store|xor|out 1|call/);
+    expect(stats.find((pass) => pass.name === 'dead-functions')!.changed).toBe(2);
+  });
+
+  test('should inline small leaves and single call sites but not recursion', () => {
+    const source = `
+      uint8 add(uint8 a, uint8 b) { return a + b; }
+      uint8 clamp(uint8 x) {
+        if (x > 100) { return 100; }
+        x = x + 1;
+        x = x ^ 5;
+        x = x + 7;
+        return x;
+      }
+      uint8 count(uint8 n) {
+        if (n == 0) { return 0; }
+        return count(n - 1);
+      }
+      void main() {
+        uint8 t = input(0);
+        output(0, add(t, 1));
+        output(1, add(t, 2));
+        output(2, clamp(t));
+        output(3, clamp(add(t, t)));
+        output(4, count(t));
+      }
+    `;
+    const o1 = build(source);
+    createPassManager(1).run(o1);
+    expect(o1.functions.map((fn) => fn.name)).toEqual(['clamp', 'count', 'main']);
+    expect(printFunction(o1.functions[2])).not.toContain('call add');
+
+    // O2 trades size for speed: clamp is small enough too
+    const o2 = build(source);
+    createPassManager(2).run(o2);
+    expect(o2.functions.map((fn) => fn.name)).toEqual(['count', 'main']);
+    const main = printFunction(o2.functions[1]);
+    expect(main).toMatch(/= phi/);
+    expect(main.match(/call/g)!.length).toBe(1);
+  });
+
+  test('should overlay frames of functions that are never active together', () => {
+    const module = build(`
+      uint8 g;
+      uint8 mix(uint8 a, uint8 b) { uint8 t = a ^ b; return t + a; }
+      uint8 twice(uint8 a) { uint8 u = a + 1; return u + mix(u, a); }
+      uint8 sum(uint8 a, uint8 b, uint8 c) { return a + b + c; }
+      void main() { g = twice(input(0)); output(0, sum(g, 1, 2)); halt(); }
+    `);
+    const sizes = new Map([['mix', 3], ['twice', 3], ['sum', 3], ['main', 1]]);
+    const placement = overlayFrames(module, sizes, 0x81);
+
+    expect(placement.bases.get('main')).toBe(0x81);
+    expect(placement.bases.get('twice')).toBe(0x82);
+    expect(placement.bases.get('sum')).toBe(0x82);
+    expect(placement.bases.get('mix')).toBe(0x85);
+    expect(placement.end).toBe(0x88);
+
+    const lowering = new IRLowering();
+    lowering.lower(module);
+    const usage = lowering.getMemoryUsage();
+    expect(usage.globals).toBe(1);
+    expect(usage.variables).toBeLessThan(usage.globals + usage.unsharedFrames);
+    expect(usage.total).toBe(usage.variables + usage.temporaries);
+  });
+
+  test('should stack the frames of mutually recursive functions', () => {
+    const module = build(`
+      uint8 even(uint8 n) { if (n == 0) { return 1; } return odd(n - 1); }
+      uint8 odd(uint8 n) { if (n == 0) { return 0; } return even(n - 1); }
+      void main() { output(0, even(input(0))); }
+    `);
+    const placement = overlayFrames(module, new Map([['even', 2], ['odd', 2], ['main', 0]]), 0x80);
+    const bases = [placement.bases.get('even')!, placement.bases.get('odd')!].sort();
+
+    expect(bases[1] - bases[0]).toBe(2);
+    expect(placement.end).toBe(0x84);
+  });
+
+  test('should turn self tail calls into a loop over the parameters', () => {
+    const module = build(`
+      uint8 gcd(uint8 a, uint8 b) { if (b == 0) { return a; } if (a < b) { return gcd(b, a); } return gcd(a - b, b); }
+      void main() { output(0, gcd(input(0), 12)); }
+    `);
+    const stats = new PassManager().add(MEM2REG).add(TAIL_RECURSION).run(module);
+    const gcd = module.functions[0];
+    const text = printFunction(gcd);
+
+    expect(stats.map((pass) => [pass.name, pass.changed])).toEqual([['mem2reg', 1], ['tail-recursion', 1]]);
+    expect(verifyFunction(gcd)).toEqual([]);
+    expect(text).not.toContain('call');
+    // One phi per parameter: the caller's value and both tail calls
+    expect(text.match(/= phi \[[^\n]*\], \[[^\n]*\], \[/g)!.length).toBe(2);
+    expect(text).toMatch(/param 1 +; b\s+jmp bb0/);
+  });
+
+  test('should plan dense switches as tables and sparse ones as search trees', () => {
+    expect(planSwitch([1, 2])).toEqual({ kind: 'compare', values: [1, 2] });
+    expect(planSwitch([0, 1, 2, 3, 4, 5, 6])).toEqual({ kind: 'table', low: 0, high: 6 });
+    expect(planSwitch([0, 1, 2, 3, 4, 5, 6], false).kind).not.toBe('table');
+
+    const sparse = planSwitch([3, 40, 77, 120, 160, 200, 250]);
+    expect(sparse.kind).toBe('split');
+    if (sparse.kind === 'split') expect(sparse.pivot).toBe(120);
+  });
+
+  test('should print and fold switch terminators', () => {
+    const module = build(`
+      void main() {
+        uint8 k = 2;
+        switch (k) { case 0: output(0, 10); break; case 1: output(0, 11); break; case 2: output(0, 12); case 3: output(0, 13); break; case 4: output(0, 14); }
+      }
+    `);
+    const main = module.functions[0];
+
+    expect(printFunction(main)).toMatch(/switch %\d+, \[bb\d+, bb\d+, bb\d+, bb\d+, bb\d+\], bb\d+/);
+    expect(verifyFunction(main)).toEqual([]);
+
+    createPassManager(1).run(module);
+    const text = printFunction(main);
+    expect(text).not.toContain('switch');
+    expect(text).toMatch(/out 0, 12[\s\S]*out 0, 13/);
+    expect(text).not.toMatch(/out 0, 1[014]/);
+  });
+
+  test('should rotate loops, hoist invariants, unroll and count down', () => {
+    const source = `
+      uint8 g = 3;
+      void main() {
+        uint8 n = input(0);
+        uint8 i;
+        uint8 acc = 0;
+        for (i = 0; i < 40; i = i + 1) {
+          acc = acc + (n ^ g);
+        }
+        output(0, acc);
+        uint8 k = 0;
+        while (k < 3) { output(1, k); k = k + 1; }
+        for (i = 0; i < 40; i = i + 1) { acc = acc + (n ^ i); }
+        output(2, acc);
+      }
+    `;
+    const o1 = build(source);
+    const stats = createPassManager(1).run(o1);
+    const main = o1.functions[0];
+    const text = printFunction(main);
+
+    expect(stats.map((pass) => pass.name)).toEqual([
+      'inline', 'loop-rotate', 'mem2reg', 'tail-recursion', 'sccp', 'strength', 'licm', 'loop-unroll', 'sccp', 'countdown',
+      'dead-functions', 'dead-globals', 'dce'
+    ]);
+    // n ^ g is computed once, before the first loop
+    expect(text.indexOf('xor')).toBeLessThan(text.indexOf('phi'));
+    expect(text).toMatch(/out 1, 0[\s\S]*out 1, 1[\s\S]*out 1, 2/);
+    expect(text).toMatch(/phi \[40, bb\d+\][\s\S]*= sub %\d+, 1\s+br %\d+/);
+    expect(text.match(/br /g)!.length).toBe(2);
+
+    // O2 repeats the last loop's body five times per iteration
+    const o2 = build(source);
+    createPassManager(2).run(o2);
+    expect(printFunction(o2.functions[0]).match(/xor/g)!.length).toBe(6);
+  });
+});
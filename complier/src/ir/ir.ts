@@ -0,0 +1,292 @@
+/**
+ * Three-Address Intermediate Representation
+ *
+ * Middle-end form of C-like programs between the AST and CPU instructions.
+ *
+ * Structure:
+ * - A module holds global variables and functions
+ * - A function is a list of basic blocks; the first one is the entry
+ * - A block is a list of instructions ending in exactly one terminator
+ *   (jmp, br, switch, ret), which defines the control flow graph
+ * - `switch` is a jump table: it goes to `targets[value]`, or to
+ *   `default` when the u8 value is not below the number of targets
+ *
+ * Values are typed temporaries (`%n`) or constants. Every temporary has
+ * exactly one defining instruction (SSA). Named variables start out in
+ * memory (load/store); the mem2reg pass promotes scalar locals to
+ * temporaries and inserts phi instructions at join points. A load or
+ * store with an `index` (a u8 byte count, already scaled by the element
+ * size) accesses the byte `offset + index` of its variable.
+ *
+ * Arithmetic wraps modulo 2^8, or 2^16 for the wide types u16 and i16;
+ * both operands of a binary operation have the same width. zext, sext
+ * and trunc convert between widths. Comparisons produce `bool` (0 or 1).
+ * Division, remainder and right shift come in unsigned (div, mod, shr)
+ * and signed (sdiv, smod, sar) forms; division truncates toward zero.
+ *
+ * @fileoverview IR types and construction helpers
+ */
+
+export type IRType = 'u8' | 'i8' | 'bool' | 'u16' | 'i16';
+
+export interface Temp {
+  kind: 'temp';
+  id: number;
+  type: IRType;
+  /** Source variable the value came from, for dumps and comments */
+  name?: string;
+}
+
+export interface Const {
+  kind: 'const';
+  value: number;
+  type: IRType;
+}
+
+export type Value = Temp | Const;
+
+export type BinaryOp =
+  | 'add' | 'sub' | 'mul' | 'div' | 'mod' | 'shl' | 'shr' | 'sdiv' | 'smod' | 'sar'
+  | 'and' | 'or' | 'xor' | 'eq' | 'ne' | 'lt' | 'le' | 'gt' | 'ge';
+export type UnaryOp = 'not' | 'neg' | 'lnot' | 'zext' | 'sext' | 'trunc';
+
+export interface IRVariable {
+  name: string;
+  type: IRType;
+  /** Size in bytes; arrays hold size / typeSize(type) elements */
+  size: number;
+  scope: 'global' | 'local';
+  /** Constant initial value of globals, applied at startup */
+  initial?: number;
+  /** Parameter position; the caller stores the argument here */
+  paramIndex?: number;
+}
+
+export type Instruction =
+  | { op: 'binary'; dst: Temp; operator: BinaryOp; a: Value; b: Value }
+  | { op: 'unary'; dst: Temp; operator: UnaryOp; a: Value }
+  | { op: 'copy'; dst: Temp; src: Value }
+  | { op: 'phi'; dst: Temp; incoming: PhiIncoming[] }
+  | { op: 'param'; dst: Temp; index: number }
+  | { op: 'load'; dst: Temp; variable: IRVariable; offset: number; index?: Value }
+  | { op: 'store'; variable: IRVariable; offset: number; src: Value; index?: Value }
+  | { op: 'call'; dst: Temp | null; callee: string; args: Value[] }
+  | { op: 'in'; dst: Temp; port: number }
+  | { op: 'out'; port: number; src: Value }
+  | { op: 'delay'; src: Value }
+  | { op: 'halt' };
+
+export interface PhiIncoming {
+  block: BasicBlock;
+  value: Value;
+}
+
+export type Terminator =
+  | { op: 'jmp'; target: BasicBlock }
+  | { op: 'br'; cond: Value; then: BasicBlock; else: BasicBlock }
+  | { op: 'switch'; value: Value; targets: BasicBlock[]; default: BasicBlock }
+  | { op: 'ret'; value: Value | null };
+
+export interface BasicBlock {
+  id: number;
+  instructions: Instruction[];
+  terminator: Terminator | null;
+  /**
+   * Builder block this one is or was copied from, `<function>.bb<n>`: the
+   * key of its execution count in a profile (see profile.ts)
+   */
+  origin?: string;
+}
+
+export interface IRFunction {
+  name: string;
+  returnType: IRType | 'void';
+  params: { name: string; type: IRType }[];
+  blocks: BasicBlock[];
+  locals: IRVariable[];
+  nextTemp: number;
+  nextBlock: number;
+}
+
+export interface IRModule {
+  globals: IRVariable[];
+  functions: IRFunction[];
+}
+
+export function isTemp(value: Value): value is Temp {
+  return value.kind === 'temp';
+}
+
+export function isWide(type: IRType): boolean {
+  return type === 'u16' || type === 'i16';
+}
+
+/** Bytes a value of the type takes, stored low byte first */
+export function typeSize(type: IRType): number {
+  return isWide(type) ? 2 : 1;
+}
+
+/** All bits of a value of the type */
+export function typeMask(type: IRType): number {
+  return isWide(type) ? 0xFFFF : 0xFF;
+}
+
+export function constant(value: number, type: IRType = 'u8'): Const {
+  return { kind: 'const', value: value & typeMask(type), type };
+}
+
+export function newTemp(fn: IRFunction, type: IRType, name?: string): Temp {
+  return { kind: 'temp', id: fn.nextTemp++, type, name };
+}
+
+export function newBlock(fn: IRFunction): BasicBlock {
+  const block: BasicBlock = { id: fn.nextBlock++, instructions: [], terminator: null };
+  fn.blocks.push(block);
+  return block;
+}
+
+/**
+ * Instructions in a function, counting each terminator as one
+ */
+export function instructionCount(fn: IRFunction): number {
+  return fn.blocks.reduce((total, block) => total + block.instructions.length + (block.terminator ? 1 : 0), 0);
+}
+
+/**
+ * Block a switch goes to for `value`
+ */
+export function switchTarget(terminator: Extract<Terminator, { op: 'switch' }>, value: number): BasicBlock {
+  return value < terminator.targets.length ? terminator.targets[value] : terminator.default;
+}
+
+/**
+ * Temporary defined by an instruction, if any
+ */
+export function definedTemp(instruction: Instruction): Temp | null {
+  switch (instruction.op) {
+    case 'binary':
+    case 'unary':
+    case 'copy':
+    case 'phi':
+    case 'param':
+    case 'load':
+    case 'in':
+      return instruction.dst;
+    case 'call':
+      return instruction.dst;
+    default:
+      return null;
+  }
+}
+
+/**
+ * Copy of an instruction that mapUsedValues() can rewrite without
+ * touching the original
+ */
+export function copyInstruction(instruction: Instruction): Instruction {
+  switch (instruction.op) {
+    case 'phi':
+      return { ...instruction, incoming: instruction.incoming.map((incoming) => ({ ...incoming })) };
+    case 'call':
+      return { ...instruction, args: instruction.args.slice() };
+    default:
+      return { ...instruction };
+  }
+}
+
+/**
+ * Values read by an instruction (phi operands included)
+ */
+export function usedValues(instruction: Instruction | Terminator): Value[] {
+  switch (instruction.op) {
+    case 'binary':
+      return [instruction.a, instruction.b];
+    case 'unary':
+      return [instruction.a];
+    case 'copy':
+    case 'out':
+    case 'delay':
+      return [instruction.src];
+    case 'load':
+      return instruction.index ? [instruction.index] : [];
+    case 'store':
+      return instruction.index ? [instruction.src, instruction.index] : [instruction.src];
+    case 'phi':
+      return instruction.incoming.map((incoming) => incoming.value);
+    case 'call':
+      return instruction.args;
+    case 'br':
+      return [instruction.cond];
+    case 'switch':
+      return [instruction.value];
+    case 'ret':
+      return instruction.value ? [instruction.value] : [];
+    default:
+      return [];
+  }
+}
+
+/**
+ * Rewrites every value read by an instruction through `map`
+ */
+export function mapUsedValues(instruction: Instruction | Terminator, map: (value: Value) => Value): void {
+  switch (instruction.op) {
+    case 'binary':
+      instruction.a = map(instruction.a);
+      instruction.b = map(instruction.b);
+      break;
+    case 'unary':
+      instruction.a = map(instruction.a);
+      break;
+    case 'copy':
+    case 'store':
+    case 'out':
+    case 'delay':
+      instruction.src = map(instruction.src);
+      if (instruction.op === 'store' && instruction.index) {
+        instruction.index = map(instruction.index);
+      }
+      break;
+    case 'load':
+      if (instruction.index) {
+        instruction.index = map(instruction.index);
+      }
+      break;
+    case 'phi':
+      for (const incoming of instruction.incoming) {
+        incoming.value = map(incoming.value);
+      }
+      break;
+    case 'call':
+      instruction.args = instruction.args.map(map);
+      break;
+    case 'br':
+      instruction.cond = map(instruction.cond);
+      break;
+    case 'switch':
+      instruction.value = map(instruction.value);
+      break;
+    case 'ret':
+      if (instruction.value) {
+        instruction.value = map(instruction.value);
+      }
+      break;
+  }
+}
+
+/**
+ * Instructions with effects beyond defining their result
+ */
+export function hasSideEffects(instruction: Instruction): boolean {
+  switch (instruction.op) {
+    case 'store':
+    case 'call':
+    case 'in':
+    case 'out':
+    case 'delay':
+    case 'halt':
+      return true;
+    default:
+      return false;
+  }
+}
@@ -0,0 +1,505 @@
+/**
+ * Loop Optimizations
+ *
+ * The builder emits every loop top-tested: the header evaluates the
+ * condition and branches into the body or out, and the body jumps back to
+ * the header, so each iteration pays a JMP and a conditional jump plus the
+ * whole test. Passes, in pipeline order:
+ *
+ * - `loop-rotate` (before mem2reg): the latch gets its own copy of the
+ *   header's test and branches straight back into the body, so an
+ *   iteration ends in one conditional jump; the original header is left
+ *   to guard the first entry
+ * - `licm`: operations whose operands are all defined outside the loop
+ *   move to a preheader, together with loads of variables the loop
+ *   neither stores nor can change through a call
+ * - `loop-unroll`: single-block loops with a trip count known at compile
+ *   time are unrolled completely, folding the counter into constants,
+ *   when the copies fit the size budget of the optimization level; with a
+ *   larger budget, the body is repeated a number of times dividing the
+ *   trip count instead
+ * - `countdown`: a counter that only counts iterations is replaced by
+ *   one running down to zero, so the latch is `SUI 1 ; JNZ`
+ *
+ * Loops are natural loops with a single back edge.
+ *
+ * @fileoverview Loop rotation, invariant code motion, unrolling and countdown
+ */
+
+import {
+  IRFunction, IRVariable, BasicBlock, Instruction, Value, Temp, constant, typeMask, newTemp,
+  definedTemp, usedValues, mapUsedValues, copyInstruction
+} from './ir';
+import { predecessors, reversePostorder, immediateDominators, dominates, retarget } from './cfg';
+import { foldBinary, foldUnary } from './sccp';
+import { isComparison } from './builder';
+import { ProfileCounts } from './profile';
+
+/** Largest header (in IR instructions) copied into the latch */
+const MAX_ROTATED_HEADER = 6;
+
+/** Longest trip count the unroller and countdown conversion evaluate */
+const MAX_TRIP_COUNT = 255;
+
+type Phi = Extract<Instruction, { op: 'phi' }>;
+
+export interface Loop {
+  header: BasicBlock;
+  /** Source of the back edge */
+  latch: BasicBlock;
+  blocks: Set<BasicBlock>;
+  /** The header's only predecessor outside the loop, if it has one */
+  entry: BasicBlock | null;
+}
+
+/**
+ * Natural loops with a single back edge, innermost first
+ */
+export function findLoops(fn: IRFunction): Loop[] {
+  const idom = immediateDominators(fn);
+  const preds = predecessors(fn);
+  const loops: Loop[] = [];
+
+  for (const header of fn.blocks) {
+    if (!idom.has(header)) continue;
+    const latches = preds.get(header)!.filter((pred) => idom.has(pred) && dominates(idom, header, pred));
+    if (latches.length !== 1) continue;
+
+    const blocks = new Set<BasicBlock>([header]);
+    const work = [latches[0]];
+    while (work.length > 0) {
+      const block = work.pop()!;
+      if (blocks.has(block)) continue;
+      blocks.add(block);
+      work.push(...preds.get(block)!);
+    }
+
+    const outside = preds.get(header)!.filter((pred) => !blocks.has(pred));
+    loops.push({ header, latch: latches[0], blocks, entry: outside.length === 1 ? outside[0] : null });
+  }
+  return loops.sort((a, b) => a.blocks.size - b.blocks.size);
+}
+
+// ---------------------------------------------------------------------
+// Rotation
+// ---------------------------------------------------------------------
+
+/**
+ * Turns top-tested loops into bottom-tested ones; returns true if any
+ * loop was rotated. Runs on memory-form IR, where a header holds nothing
+ * but its test.
+ */
+export function rotateLoops(fn: IRFunction): boolean {
+  let changed = false;
+  for (const loop of findLoops(fn)) {
+    const { header, latch } = loop;
+    const test = header.terminator!;
+    if (test.op !== 'br' || latch === header || latch.terminator!.op !== 'jmp') continue;
+    if (loop.blocks.has(test.then) === loop.blocks.has(test.else)) continue;
+    if (header.instructions.length > MAX_ROTATED_HEADER || header.instructions.some((ins) => ins.op === 'phi')) continue;
+    if (usedOutside(fn, header)) continue;
+
+    const values = new Map<number, Value>();
+    for (const ins of header.instructions) {
+      latch.instructions.push(cloneFresh(fn, ins, values));
+    }
+    latch.terminator = { op: 'br', cond: lookup(values, test.cond), then: test.then, else: test.else };
+    changed = true;
+  }
+  return changed;
+}
+
+/**
+ * Whether a temporary defined in `block` is read anywhere else
+ */
+function usedOutside(fn: IRFunction, block: BasicBlock): boolean {
+  const defined = new Set(block.instructions.map((ins) => definedTemp(ins)).filter((dst) => dst).map((dst) => dst!.id));
+  return fn.blocks.some((other) => other !== block && [...other.instructions, other.terminator!].some((ins) =>
+    usedValues(ins).some((value) => value.kind === 'temp' && defined.has(value.id))
+  ));
+}
+
+// ---------------------------------------------------------------------
+// Loop-invariant code motion
+// ---------------------------------------------------------------------
+
+/**
+ * Hoists loop-invariant operations into preheaders, inner loops first;
+ * returns true if anything moved
+ */
+export function hoistInvariants(fn: IRFunction): boolean {
+  let changed = false;
+  const done = new Set<BasicBlock>();
+  for (;;) {
+    // Preheaders change the CFG, so loops are found again each time
+    const loop = findLoops(fn).find((candidate) => !done.has(candidate.header));
+    if (!loop) break;
+    done.add(loop.header);
+    changed = hoistFromLoop(fn, loop) || changed;
+  }
+  return changed;
+}
+
+function hoistFromLoop(fn: IRFunction, loop: Loop): boolean {
+  if (!loop.entry) return false;
+  const order = reversePostorder(fn).filter((block) => loop.blocks.has(block));
+  const instructions = order.flatMap((block) => block.instructions);
+  const stored = new Set<IRVariable>();
+  instructions.forEach((ins) => {
+    if (ins.op === 'store') stored.add(ins.variable);
+  });
+  const calls = instructions.some((ins) => ins.op === 'call');
+
+  const definedInLoop = new Map<number, Instruction>();
+  for (const ins of instructions) {
+    const dst = definedTemp(ins);
+    if (dst) definedInLoop.set(dst.id, ins);
+  }
+
+  const invariant = new Set<Instruction>();
+  const isInvariant = (value: Value) =>
+    value.kind === 'const' || !definedInLoop.has(value.id) || invariant.has(definedInLoop.get(value.id)!);
+  let grew = true;
+  while (grew) {
+    grew = false;
+    for (const ins of instructions) {
+      if (invariant.has(ins)) continue;
+      const pure = ins.op === 'binary' || ins.op === 'unary' || ins.op === 'copy';
+      const readOnly = ins.op === 'load' && !calls && !stored.has(ins.variable) && usedValues(ins).every(isInvariant);
+      if ((pure && usedValues(ins).every(isInvariant)) || readOnly) {
+        invariant.add(ins);
+        grew = true;
+      }
+    }
+  }
+
+  // Loads and copies alone gain nothing: only computations move, with
+  // whatever they read from inside the loop
+  const hoisted = new Set<Instruction>();
+  const hoist = (ins: Instruction) => {
+    if (hoisted.has(ins)) return;
+    hoisted.add(ins);
+    for (const value of usedValues(ins)) {
+      if (value.kind === 'temp' && definedInLoop.has(value.id)) hoist(definedInLoop.get(value.id)!);
+    }
+  };
+  for (const ins of invariant) {
+    const computes = ins.op === 'binary' || ins.op === 'unary';
+    if (computes && usedValues(ins).some((value) => value.kind === 'temp')) hoist(ins);
+  }
+  if (hoisted.size === 0) return false;
+
+  const preheader = ensurePreheader(fn, loop);
+  for (const block of order) {
+    preheader.instructions.push(...block.instructions.filter((ins) => hoisted.has(ins)));
+    block.instructions = block.instructions.filter((ins) => !hoisted.has(ins));
+  }
+  return true;
+}
+
+/**
+ * A block that only jumps to the loop header, laid out before it
+ */
+function ensurePreheader(fn: IRFunction, loop: Loop): BasicBlock {
+  const entry = loop.entry!;
+  const terminator = entry.terminator!;
+  if (terminator.op === 'jmp') return entry;
+
+  const preheader: BasicBlock = { id: fn.nextBlock++, instructions: [], terminator: { op: 'jmp', target: loop.header } };
+  retarget(terminator, loop.header, preheader);
+  for (const ins of loop.header.instructions) {
+    if (ins.op === 'phi') {
+      ins.incoming.forEach((incoming) => {
+        if (incoming.block === entry) incoming.block = preheader;
+      });
+    }
+  }
+  fn.blocks.splice(fn.blocks.indexOf(loop.header), 0, preheader);
+  loop.entry = preheader;
+  return preheader;
+}
+
+// ---------------------------------------------------------------------
+// Unrolling
+// ---------------------------------------------------------------------
+
+/**
+ * Unrolls single-block loops with a known trip count. A complete unroll
+ * is kept if it is at most `sizeBudget` IR instructions larger than the
+ * loop; otherwise a positive budget allows a partial one. With a
+ * `profile`, hot loops get `hotSizeBudget` and loops that never ran none.
+ * Returns true if any loop was unrolled.
+ */
+export function unrollLoops(fn: IRFunction, sizeBudget: number, profile: ProfileCounts | null = null, hotSizeBudget: number = 0): boolean {
+  let changed = false;
+  for (const loop of findLoops(fn)) {
+    const block = loop.header;
+    const terminator = block.terminator!;
+    if (loop.latch !== block || !loop.entry || terminator.op !== 'br') continue;
+    const budget = profile ? profile.budget(block, sizeBudget, hotSizeBudget) : sizeBudget;
+
+    const trips = tripCount(block, loop.entry);
+    if (trips === null) continue;
+    const phis = block.instructions.filter((ins) => ins.op === 'phi') as Phi[];
+    const loopSize = block.instructions.length - phis.length + 1;
+
+    const initial = new Map<number, Value>(phis.map((phi) => [phi.dst.id, incomingFrom(phi, loop.entry!)] as [number, Value]));
+    const full = unrollBody(fn, block, terminator.cond, trips, initial);
+    if (full.instructions.length <= loopSize + budget) {
+      block.instructions = full.instructions;
+      block.terminator = { op: 'jmp', target: terminator.then === block ? terminator.else : terminator.then };
+      replaceOutside(fn, block, full.exitValues);
+      changed = true;
+      continue;
+    }
+
+    let factor = 0;
+    for (let candidate = 2; candidate < trips && candidate * loopSize <= loopSize + budget; candidate++) {
+      if (trips % candidate === 0) factor = candidate;
+    }
+    if (factor === 0) continue;
+
+    // Only the last copy's test can end the loop
+    const identity = new Map<number, Value>(phis.map((phi) => [phi.dst.id, phi.dst] as [number, Value]));
+    const partial = unrollBody(fn, block, terminator.cond, factor, identity);
+    for (const phi of phis) {
+      phi.incoming.find((incoming) => incoming.block === block)!.value = partial.backValues.get(phi.dst.id)!;
+    }
+    block.instructions = [...phis, ...partial.instructions];
+    terminator.cond = partial.cond;
+    replaceOutside(fn, block, partial.exitValues);
+    changed = true;
+  }
+  return changed;
+}
+
+/**
+ * How many times a single-block loop runs when entered from `entry`, if
+ * its test can be evaluated from constants alone
+ */
+function tripCount(block: BasicBlock, entry: BasicBlock): number | null {
+  const terminator = block.terminator!;
+  if (terminator.op !== 'br') return null;
+  const phis = block.instructions.filter((ins) => ins.op === 'phi') as Phi[];
+  let known = new Map<number, number>();
+  for (const phi of phis) {
+    const value = incomingFrom(phi, entry);
+    if (value.kind === 'const') known.set(phi.dst.id, value.value);
+  }
+
+  for (let trips = 1; trips <= MAX_TRIP_COUNT; trips++) {
+    const valueOf = (value: Value) => value.kind === 'const' ? value.value : known.get(value.id);
+    for (const ins of block.instructions) {
+      if (ins.op === 'phi') continue;
+      const dst = definedTemp(ins);
+      if (!dst) continue;
+      const folded = fold(ins, (value) => {
+        const number = valueOf(value);
+        return number === undefined ? value : constant(number, value.type);
+      });
+      if (folded && folded.kind === 'const') {
+        known.set(dst.id, folded.value);
+      } else {
+        known.delete(dst.id);
+      }
+    }
+
+    const cond = valueOf(terminator.cond);
+    if (cond === undefined) return null;
+    if ((cond !== 0) !== (terminator.then === block)) return trips;
+
+    const next = new Map<number, number>();
+    for (const phi of phis) {
+      const value = valueOf(incomingFrom(phi, block));
+      if (value !== undefined) next.set(phi.dst.id, value);
+    }
+    known = next;
+  }
+  return null;
+}
+
+interface UnrolledBody {
+  instructions: Instruction[];
+  /** Loop temporaries as seen after the last copy (phis: on entry to it) */
+  exitValues: Map<number, Value>;
+  /** Values flowing back into the phis after the last copy */
+  backValues: Map<number, Value>;
+  cond: Value;
+}
+
+/**
+ * `copies` copies of a single-block loop body, the first seeing the phis
+ * as `initial`; operations on constants are folded as they are copied
+ */
+function unrollBody(fn: IRFunction, block: BasicBlock, cond: Value, copies: number, initial: Map<number, Value>): UnrolledBody {
+  const phis = block.instructions.filter((ins) => ins.op === 'phi') as Phi[];
+  const body = block.instructions.filter((ins) => ins.op !== 'phi');
+  const instructions: Instruction[] = [];
+  let values = new Map(initial);
+
+  for (let copy = 0; copy < copies; copy++) {
+    if (copy > 0) {
+      const previous = values;
+      values = new Map(phis.map((phi) => [phi.dst.id, lookup(previous, incomingFrom(phi, block))] as [number, Value]));
+    }
+    for (const ins of body) {
+      const dst = definedTemp(ins);
+      const folded = dst ? fold(ins, (value) => lookup(values, value)) : null;
+      if (dst && folded) {
+        values.set(dst.id, folded);
+      } else {
+        instructions.push(cloneFresh(fn, ins, values));
+      }
+    }
+  }
+
+  return {
+    instructions,
+    exitValues: values,
+    backValues: new Map(phis.map((phi) => [phi.dst.id, lookup(values, incomingFrom(phi, block))] as [number, Value])),
+    cond: lookup(values, cond)
+  };
+}
+
+/**
+ * Value of an operation whose operands are constants (or of a copy),
+ * else null
+ */
+function fold(ins: Instruction, map: (value: Value) => Value): Value | null {
+  switch (ins.op) {
+    case 'copy':
+      return map(ins.src);
+    case 'binary': {
+      const a = map(ins.a);
+      const b = map(ins.b);
+      return a.kind === 'const' && b.kind === 'const' ? constant(foldBinary(ins.operator, a.value, b.value, typeMask(a.type)), ins.dst.type) : null;
+    }
+    case 'unary': {
+      const a = map(ins.a);
+      return a.kind === 'const' ? constant(foldUnary(ins.operator, a.value, typeMask(ins.dst.type)), ins.dst.type) : null;
+    }
+    default:
+      return null;
+  }
+}
+
+/**
+ * Rewrites uses of `block`'s temporaries in all other blocks
+ */
+function replaceOutside(fn: IRFunction, block: BasicBlock, values: Map<number, Value>): void {
+  for (const other of fn.blocks) {
+    if (other === block) continue;
+    for (const ins of other.instructions) {
+      mapUsedValues(ins, (value) => lookup(values, value));
+    }
+    mapUsedValues(other.terminator!, (value) => lookup(values, value));
+  }
+}
+
+// ---------------------------------------------------------------------
+// Countdown
+// ---------------------------------------------------------------------
+
+/**
+ * Replaces counters that only decide when a loop ends by a count of the
+ * remaining iterations, tested for zero straight after the decrement;
+ * returns true if any loop changed
+ */
+export function countDownLoops(fn: IRFunction): boolean {
+  let changed = false;
+  const uses = new Map<number, number>();
+  for (const block of fn.blocks) {
+    for (const ins of [...block.instructions, block.terminator!]) {
+      for (const value of usedValues(ins)) {
+        if (value.kind === 'temp') uses.set(value.id, (uses.get(value.id) || 0) + 1);
+      }
+    }
+  }
+  const useCount = (temp: Temp) => uses.get(temp.id) || 0;
+
+  for (const loop of findLoops(fn)) {
+    const { header, latch, entry } = loop;
+    const exit = latch.terminator!;
+    if (!entry || exit.op !== 'br' || exit.then !== header || exit.cond.kind !== 'temp' || useCount(exit.cond) !== 1) continue;
+
+    // latch: next = counter +/- step ; test = next <op> limit ; br test, header, exit
+    const cond = exit.cond;
+    const test = latch.instructions.find((ins) => definesTemp(ins, cond));
+    if (!test || test.op !== 'binary' || !isComparison(test.operator)) continue;
+    const nextFirst = test.a.kind === 'temp';
+    const next = nextFirst ? test.a : test.b;
+    const limit = nextFirst ? test.b : test.a;
+    if (next.kind !== 'temp' || limit.kind !== 'const' || useCount(next) !== 2) continue;
+
+    const step = findDefinition(loop, next);
+    if (!step || step.op !== 'binary' || (step.operator !== 'add' && step.operator !== 'sub')) continue;
+    const counterValue = step.a;
+    const stepValue = step.b;
+    if (counterValue.kind !== 'temp' || stepValue.kind !== 'const') continue;
+    const counter = header.instructions.find((ins) => ins.op === 'phi' && ins.dst.id === counterValue.id) as Phi | undefined;
+    if (!counter || counter.incoming.length !== 2 || useCount(counter.dst) !== 1) continue;
+    const start = incomingFrom(counter, entry);
+    const back = incomingFrom(counter, latch);
+    if (start.kind !== 'const' || back.kind !== 'temp' || back.id !== next.id) continue;
+
+    let value = start.value;
+    let trips = 0;
+    let running = true;
+    const mask = typeMask(counter.dst.type);
+    while (running && trips <= MAX_TRIP_COUNT) {
+      value = foldBinary(step.operator, value, stepValue.value, mask);
+      trips++;
+      running = foldBinary(test.operator, nextFirst ? value : limit.value, nextFirst ? limit.value : value, mask) !== 0;
+    }
+    if (running) continue;
+
+    counter.incoming.find((incoming) => incoming.block === entry)!.value = constant(trips, counter.dst.type);
+    step.operator = 'sub';
+    step.b = constant(1, stepValue.type);
+    latch.instructions = latch.instructions.filter((ins) => ins !== test);
+    exit.cond = next;
+    changed = true;
+  }
+  return changed;
+}
+
+function findDefinition(loop: Loop, temp: Temp): Instruction | null {
+  for (const block of loop.blocks) {
+    const ins = block.instructions.find((candidate) => definesTemp(candidate, temp));
+    if (ins) return ins;
+  }
+  return null;
+}
+
+// ---------------------------------------------------------------------
+// Helpers
+// ---------------------------------------------------------------------
+
+function definesTemp(ins: Instruction, temp: Temp): boolean {
+  const dst = definedTemp(ins);
+  return dst !== null && dst.id === temp.id;
+}
+
+function incomingFrom(phi: Phi, block: BasicBlock): Value {
+  return phi.incoming.find((incoming) => incoming.block === block)!.value;
+}
+
+function lookup(values: Map<number, Value>, value: Value): Value {
+  return value.kind === 'temp' && values.has(value.id) ? values.get(value.id)! : value;
+}
+
+/**
+ * Copy of `ins` reading through `values`, with a fresh destination that
+ * is recorded there
+ */
+function cloneFresh(fn: IRFunction, ins: Instruction, values: Map<number, Value>): Instruction {
+  const copy = copyInstruction(ins);
+  mapUsedValues(copy, (value) => lookup(values, value));
+  const dst = definedTemp(ins);
+  if (dst) {
+    const fresh = newTemp(fn, dst.type, dst.name);
+    (copy as { dst: Temp }).dst = fresh;
+    values.set(dst.id, fresh);
+  }
+  return copy;
+}
@@ -0,0 +1,1651 @@
+/**
+ * IR Lowering to CPU-8Bit Instructions
+ *
+ * Turns an IR module into the structured assembly stream consumed by the
+ * assembler back end.
+ *
+ * Storage:
+ * - Globals live from 0x80 upwards
+ * - Each function has a static frame: parameter slots (written by the
+ *   caller before CALL), the return slot of a 16-bit result, temporaries
+ *   that are live across a call, then memory locals. Frames of functions
+ *   that are never active together share bytes (see frames.ts)
+ * - All other temporaries share one scratch pool. A call never happens
+ *   while a scratch value is live, so callers and callees can reuse the
+ *   same bytes
+ *
+ * Temporaries get slots by liveness-based graph coloring; a copy prefers
+ * the slot of its source, which coalesces most phi copies away. Colors
+ * are byte offsets: a 16-bit value takes two, starting at an even one
+ * (16-bit parameters are aligned the same way), so two 16-bit values
+ * either share both bytes or none and can be processed a byte at a time.
+ *
+ * Code shape: an operation loads one operand into A and applies the other
+ * as an immediate (ADI, SUI, ANI, ORI, XRI) when it is a constant, or
+ * straight from memory otherwise. Before slots are assigned, operands are
+ * planned per block:
+ * - A temporary defined right before its only use, which takes it in A,
+ *   never leaves the accumulator (commutative operations swap operands to
+ *   make this happen), so left-deep expressions need no memory at all
+ * - A load of a memory variable whose only use follows in the same block,
+ *   with no store to the variable or call in between, is not emitted; the
+ *   use reads the variable's address directly
+ * Emission also tracks which memory bytes and constant A holds, dropping
+ * LDA/LDI that would reload the same value.
+ *
+ * A load or store with an index moves the index to B (`MOV B, A`) and
+ * uses LDX/STX on the variable's address, so an array element costs the
+ * same whatever the index.
+ *
+ * B also holds temporaries between uses (see allocateRegister()): a value
+ * in B is defined with `MOV B, A`, read with `MOV A, B`, and indexes
+ * LDX/STX with nothing at all. MOV costs what LDA/STA cost in cycles and a
+ * byte more, and the ALU cannot take B as an operand, so B only pays off
+ * for indexes: typically a loop counter, together with the copies that
+ * carry it around the loop. A value goes to B only if nothing else writes
+ * B while it is live (another index or a call; the runtime routines leave
+ * it alone), and only where the cycles saved, weighted by loop nesting (or
+ * by the block counts of a profile), outweigh the bytes; everything else
+ * stays in memory.
+ *
+ * Comparisons rely on the flag convention documented in instruction-set.ts
+ * (SUB/SUI set C on borrow, loads and stores keep flags) and are rewritten
+ * so a constant is always the subtrahend: `5 < a` becomes `a > 5`, and
+ * `a > 5` becomes `a >= 6`. A comparison (or `!x`) computed last in its
+ * block and read only by the block's branch is fused with it: SUB/SUI
+ * sets the flags and JZ/JNZ/JC/JNC jumps on them, with no 0/1 value in
+ * between. Signed (int8) comparisons reach this point already biased to
+ * unsigned ones by the builder.
+ *
+ * 16-bit values are stored low byte first, like `.DW`, and never stay in
+ * A. Addition and subtraction carry between the bytes with JNC over an
+ * ADI/SUI 1 on the high byte; comparisons subtract the high bytes and,
+ * only if they are equal (JNZ past it), the low bytes, which leaves Z
+ * and C as a 16-bit subtraction would. A 16-bit result is returned in
+ * the callee's return slot rather than A.
+ *
+ * A block that ends in a call and returns its result unchanged (or a
+ * void call and `return;`) stores the arguments and jumps to the callee,
+ * whose RET then returns to the caller's caller: one return address
+ * fewer on the stack per call, and mutually recursive tail calls run in
+ * constant stack. 16-bit results are returned through the callee's own
+ * return slot, so they still go through CALL. A jump to a block that only
+ * returns is replaced by the return when A already holds its value.
+ *
+ * A `switch` checks its value against the number of targets (SUI, JNC to
+ * the default), adds it twice to the address of the function's jump table
+ * and jumps there with `PUSH ; RET`. The table, emitted after the
+ * function's blocks, is one labelled `JMP` per target; the labels keep the
+ * peephole optimizer from treating entries as unreachable.
+ *
+ * Multiply, divide and shift operations store their operands in the
+ * parameter bytes of a runtime routine and CALL it (see runtime.ts); the
+ * routines the module needs are emitted after its functions, and their
+ * scratch bytes sit between the globals and the frames.
+ *
+ * Labels: `MAIN` is the reset entry, functions are `FUNC_<NAME>` and their
+ * blocks `FUNC_<NAME>_B<n>`. With `labelBlocks`, every block with an
+ * origin gets its label, for the block map of a profiling build.
+ *
+ * @fileoverview Out-of-SSA slot assignment and instruction selection
+ */
+
+import {
+  IRModule, IRFunction, IRVariable, BasicBlock, Instruction, Terminator, Value, Temp, BinaryOp,
+  constant, definedTemp, usedValues, isWide, typeSize, typeMask, switchTarget
+} from './ir';
+import { successors } from './cfg';
+import { destructSSA } from './ssa';
+import { INIT_FUNCTION, isComparison } from './builder';
+import { overlayFrames, recursiveComponents } from './frames';
+import { findLoops } from './loops';
+import { ProfileCounts } from './profile';
+import { RuntimeRoutine, RUNTIME_SCRATCH, linkRoutines, runtimeScratchSize, assembleRoutine } from './runtime';
+import { AssemblyItem, InstructionItem, stackDepth } from '../assembly-stream';
+import { instructionBytes, instructionCycles } from '../instruction-set';
+
+const RAM_START = 0x80;
+const RAM_END = 0x100;
+
+const ALU_MNEMONICS: Record<string, { memory: string; immediate: string }> = {
+  add: { memory: 'ADD', immediate: 'ADI' },
+  sub: { memory: 'SUB', immediate: 'SUI' },
+  and: { memory: 'AND', immediate: 'ANI' },
+  or: { memory: 'OR', immediate: 'ORI' },
+  xor: { memory: 'XOR', immediate: 'XRI' }
+};
+
+const COMMUTATIVE = new Set<BinaryOp>(['add', 'and', 'or', 'xor']);
+
+/** Operations computed by a runtime routine; some read its remainder byte */
+const RUNTIME_OPERATIONS: Partial<Record<BinaryOp, { routine: string; remainder?: boolean }>> = {
+  mul: { routine: 'RT_MUL8' },
+  div: { routine: 'RT_DIV8' },
+  mod: { routine: 'RT_DIV8', remainder: true },
+  sdiv: { routine: 'RT_SDIV8' },
+  smod: { routine: 'RT_SDIV8', remainder: true },
+  shl: { routine: 'RT_SHL8' },
+  shr: { routine: 'RT_SHR8' },
+  sar: { routine: 'RT_SAR8' }
+};
+
+const LOAD = { memory: 'LDA', immediate: 'LDI' };
+
+const INVERTED_JUMPS: Record<string, string> = { JZ: 'JNZ', JNZ: 'JZ', JC: 'JNC', JNC: 'JC' };
+
+/** Instructions after which A and the flags are as before */
+const PRESERVES_A = new Set(['STA', 'OUT', 'JMP', 'JZ', 'JNZ', 'JC', 'JNC', 'RET', 'HLT', 'NOP', 'PUSH']);
+
+/** Where a temporary lives */
+type Location = { kind: 'frame'; address: number } | { kind: 'pool'; slot: number } | { kind: 'register' };
+
+/** Key of B in the accumulator tracking: A and B hold the same value */
+const REGISTER_KEY = 'rB';
+
+/** Weight of a block per enclosing loop when choosing values for B */
+const LOOP_WEIGHT = 8;
+
+/**
+ * A comparison with the operand for A first, the jump taken when it
+ * holds, or its value when known from the constant alone
+ */
+type Comparison = { x: Value; y: Value; jump: string } | { result: number };
+
+/** How temporaries reach their use; see the file header */
+export interface OperandPlan {
+  /** Temporaries that stay in A between definition and use */
+  accumulator: Set<number>;
+  /** Temporaries replaced by the memory variable they were loaded from */
+  folded: Map<number, { variable: IRVariable; offset: number }>;
+  /** Conditions that only exist as flags for their block's branch */
+  flags: Set<number>;
+}
+
+interface FunctionLayout {
+  fn: IRFunction;
+  label: string;
+  /** Start of the frame; parameters are at paramOffsets() from it */
+  paramBase: number;
+  /** Parameter offsets from paramBase */
+  paramOffsets: number[];
+  /** Where a 16-bit result is returned, else -1 */
+  returnSlot: number;
+  locals: Map<IRVariable, number>;
+  temps: Map<number, Location>;
+  operands: OperandPlan;
+  /** Pool colors used by the function's temporaries */
+  poolColors: number;
+  frameSize: number;
+}
+
+export interface MemoryUsage {
+  /** Globals, runtime scratch and frames, as overlaid by the compiled stack */
+  variables: number;
+  /** Scratch bytes of the linked runtime routines */
+  runtime: number;
+  /** Shared scratch pool above the frames */
+  temporaries: number;
+  globals: number;
+  /** Frame bytes if every function had its own */
+  unsharedFrames: number;
+  /** Worst case over all call chains: variables + temporaries */
+  total: number;
+  /** Worst-case stack bytes (return addresses), or null if unbounded */
+  stack: number | null;
+}
+
+export interface JumpTable {
+  /** Address added to twice the switch value: the first entry */
+  label: string;
+  /** Label of each entry, a JMP to `target` */
+  entries: { label: string; target: string }[];
+}
+
+export interface TempAllocation {
+  frameColors: Map<number, number>;
+  poolColors: Map<number, number>;
+}
+
+export interface LoweringOptions {
+  /** Block counts (--profile-use) for choosing values to keep in B */
+  profile?: ProfileCounts | null;
+  /** Label every block with an origin (--profile-generate) */
+  labelBlocks?: boolean;
+}
+
+export function functionLabel(name: string): string {
+  return `FUNC_${name.toUpperCase()}`;
+}
+
+export class IRLowering {
+  private options: Required<LoweringOptions>;
+  private output: AssemblyItem[] = [];
+  private globals: Map<IRVariable, number> = new Map();
+  private layouts: Map<string, FunctionLayout> = new Map();
+  private poolFixups: { item: InstructionItem; slot: number }[] = [];
+  private jumpTables: JumpTable[] = [];
+  /** Memory bytes (see locationKey) and constant known to equal A */
+  private accumulator: { locations: Set<string>; constant: number | null } = { locations: new Set(), constant: null };
+  private poolSize: number = 0;
+  private variableBytes: number = 0;
+  private globalBytes: number = 0;
+  private unsharedFrameBytes: number = 0;
+  private runtime: RuntimeRoutine[] = [];
+  private runtimeBase: number = 0;
+  /** Members of the call graph cycle of each recursive function */
+  private recursive: Map<string, Set<string>> = new Map();
+  private labelCounter: number = 0;
+  /** Jump taken when the pending flags condition holds, or its known value */
+  private flagsJump: string | number = 'JNZ';
+  private blockLabels: { label: string; origin: string }[] = [];
+
+  constructor(options: LoweringOptions = {}) {
+    this.options = {
+      profile: options.profile || null,
+      labelBlocks: options.labelBlocks || false
+    };
+  }
+
+  /**
+   * Lowers the module. Phis are eliminated in place, so the module is
+   * consumed.
+   */
+  lower(module: IRModule): AssemblyItem[] {
+    this.output = [];
+    this.globals.clear();
+    this.layouts.clear();
+    this.poolFixups = [];
+    this.jumpTables = [];
+    this.blockLabels = [];
+    this.poolSize = 0;
+    this.labelCounter = 0;
+
+    let address = RAM_START;
+    for (const global of module.globals) {
+      this.globals.set(global, address);
+      address += global.size;
+    }
+
+    this.globalBytes = address - RAM_START;
+
+    // Runtime scratch sits between the globals and the frames
+    this.runtime = linkRoutines(runtimeOperations(module));
+    this.runtimeBase = address;
+    address += runtimeScratchSize(this.runtime);
+
+    // Frames are laid out from offset 0, then overlaid by the call graph
+    const layouts = module.functions.map((fn) => {
+      destructSSA(fn);
+      return this.layoutFunction(fn);
+    });
+    const sizes = new Map(layouts.map((layout) => [layout.fn.name, layout.frameSize] as [string, number]));
+    const placement = overlayFrames(module, sizes, address);
+    this.recursive = recursiveComponents(module);
+    for (const layout of layouts) {
+      relocateFrame(layout, placement.bases.get(layout.fn.name)!);
+      this.layouts.set(layout.fn.name, layout);
+    }
+    this.unsharedFrameBytes = layouts.reduce((total, layout) => total + layout.frameSize, 0);
+    this.variableBytes = placement.end - RAM_START;
+
+    this.emitStartup(module);
+    for (const fn of module.functions) {
+      this.emitFunction(this.layouts.get(fn.name)!);
+    }
+    for (const routine of this.runtime) {
+      this.output.push(...assembleRoutine(routine, this.runtimeBase));
+    }
+
+    this.placePool(placement.end);
+    return this.output;
+  }
+
+  /**
+   * Worst-case RAM footprint of the last lowered module
+   */
+  getMemoryUsage(): MemoryUsage {
+    return {
+      variables: this.variableBytes,
+      runtime: runtimeScratchSize(this.runtime),
+      temporaries: this.poolSize,
+      globals: this.globalBytes,
+      unsharedFrames: this.unsharedFrameBytes,
+      total: this.variableBytes + this.poolSize,
+      stack: stackDepth(this.output, 'MAIN', new Map(this.jumpTables.map((table) =>
+        [table.label, table.entries.map((entry) => entry.target)] as [string, string[]]
+      )))
+    };
+  }
+
+  /**
+   * Jump tables of the last lowered module; their entry labels must be kept
+   */
+  getJumpTables(): JumpTable[] {
+    return this.jumpTables;
+  }
+
+  /**
+   * Label of every block with an origin in the last lowered module, with
+   * `labelBlocks`; the labels must be kept
+   */
+  getBlockLabels(): { label: string; origin: string }[] {
+    return this.blockLabels;
+  }
+
+  private placePool(base: number): void {
+    const end = base + this.poolSize;
+    if (end > RAM_END) {
+      throw new Error(`Out of RAM: variables and temporaries need 0x80-0x${(end - 1).toString(16).toUpperCase()}`);
+    }
+    for (const fixup of this.poolFixups) {
+      fixup.item.operands[0] = base + fixup.slot;
+    }
+  }
+
+  // ---------------------------------------------------------------------
+  // Slot assignment
+  // ---------------------------------------------------------------------
+
+  /**
+   * Assigns frame offsets from 0; relocateFrame() moves the frame to its
+   * place in the compiled stack
+   */
+  private layoutFunction(fn: IRFunction): FunctionLayout {
+    const params = paramOffsets(fn);
+    let offset = params.size;
+    let returnSlot = -1;
+    if (fn.returnType !== 'void' && isWide(fn.returnType)) {
+      returnSlot = offset + (offset & 1);
+      offset = returnSlot + 2;
+    }
+
+    // Bytes of memory parameters and the return slot are off limits
+    const reserved = new Set<number>();
+    const reserve = (start: number, size: number) => {
+      for (let byte = start; byte < start + size; byte++) reserved.add(byte);
+    };
+    for (const local of fn.locals) {
+      if (local.paramIndex !== undefined) reserve(params.offsets[local.paramIndex], local.size);
+    }
+    if (returnSlot >= 0) reserve(returnSlot, 2);
+
+    let operands = planOperands(fn);
+    const profile = this.options.profile;
+    const registers = allocateRegister(fn, operands, profile ? profile.blockCounts(fn) : loopWeights(fn));
+    if (registers.size > 0) {
+      // Stores indexed by B can take their value in A instead
+      operands = planOperands(fn, registers);
+    }
+    const allocation = allocateTemps(fn, reserved, new Set([...operands.accumulator, ...operands.folded.keys(), ...operands.flags, ...registers]));
+    const sizes = new Map<number, number>();
+    for (const block of fn.blocks) {
+      for (const ins of block.instructions) {
+        const dst = definedTemp(ins);
+        if (dst) sizes.set(dst.id, typeSize(dst.type));
+      }
+    }
+
+    const temps = new Map<number, Location>();
+    for (const [id, color] of allocation.frameColors) {
+      temps.set(id, { kind: 'frame', address: color });
+      offset = Math.max(offset, color + sizes.get(id)!);
+    }
+    let poolColors = 0;
+    for (const [id, color] of allocation.poolColors) {
+      temps.set(id, { kind: 'pool', slot: color });
+      poolColors = Math.max(poolColors, color + sizes.get(id)!);
+    }
+    for (const id of registers) {
+      temps.set(id, { kind: 'register' });
+    }
+
+    const locals = new Map<IRVariable, number>();
+    for (const local of fn.locals) {
+      if (local.paramIndex !== undefined) {
+        locals.set(local, params.offsets[local.paramIndex]);
+      } else {
+        locals.set(local, offset);
+        offset += local.size;
+      }
+    }
+
+    return {
+      fn,
+      label: functionLabel(fn.name),
+      paramBase: 0,
+      paramOffsets: params.offsets,
+      returnSlot,
+      locals,
+      temps,
+      operands,
+      poolColors,
+      frameSize: offset
+    };
+  }
+
+  // ---------------------------------------------------------------------
+  // Instruction selection
+  // ---------------------------------------------------------------------
+
+  private emitStartup(module: IRModule): void {
+    this.emitComment('Generated C-like code for CPU 8-Bit', false);
+    this.emitComment('Compiled from high-level language', false);
+    this.emitBlank();
+    this.output.push({ kind: 'directive', directive: '.ORG', value: 0x00 });
+    this.emitBlank();
+
+    this.emitLabel('MAIN');
+    for (const global of module.globals) {
+      if (global.initial === undefined) continue;
+      for (let byte = 0; byte < typeSize(global.type); byte++) {
+        this.emitInstruction('LDI', [(global.initial >> (8 * byte)) & 0xFF]);
+        this.emitInstruction('STA', [this.globals.get(global)! + byte], `Initialize ${global.name}`);
+      }
+    }
+    if (this.layouts.has(INIT_FUNCTION)) {
+      this.emitInstruction('CALL', [functionLabel(INIT_FUNCTION)]);
+    }
+    if (this.layouts.has('main')) {
+      this.emitInstruction('CALL', [functionLabel('main')]);
+    }
+    this.emitInstruction('HLT');
+    this.emitBlank();
+  }
+
+  private emitFunction(layout: FunctionLayout): void {
+    const fn = layout.fn;
+
+    this.emitComment(`Function: ${fn.name}`, false);
+    this.emitLabel(layout.label);
+
+    // Blocks reached other than by falling through need a label
+    const targeted = new Set<BasicBlock>();
+    fn.blocks.forEach((block, index) => {
+      for (const successor of successors(block)) {
+        if (successor !== fn.blocks[index + 1] || block.terminator!.op !== 'jmp') {
+          targeted.add(successor);
+        }
+      }
+    });
+
+    const tables = this.jumpTables.length;
+    fn.blocks.forEach((block, index) => {
+      const profiled = this.options.labelBlocks && block.origin !== undefined;
+      if (index > 0 && (targeted.has(block) || profiled)) {
+        this.emitLabel(this.blockLabel(layout, block));
+      }
+      if (profiled) {
+        this.blockLabels.push({ label: this.blockLabel(layout, block), origin: block.origin! });
+      }
+      const tail = this.tailCall(layout, block);
+      for (const ins of block.instructions) {
+        if (ins !== tail) this.emitIRInstruction(layout, ins);
+      }
+      if (tail) {
+        this.emitInstruction('JMP', [this.emitArguments(layout, tail).label], 'Tail call');
+      } else {
+        this.emitTerminator(layout, block.terminator!, fn.blocks[index + 1] || null);
+      }
+    });
+    for (const table of this.jumpTables.slice(tables)) {
+      for (const entry of table.entries) {
+        this.emitLabel(entry.label);
+        this.emitInstruction('JMP', [entry.target]);
+      }
+    }
+
+    this.poolSize = Math.max(this.poolSize, layout.poolColors);
+    this.emitBlank();
+  }
+
+  private emitIRInstruction(layout: FunctionLayout, ins: Instruction): void {
+    const wide = definedTemp(ins) !== null && isWide(definedTemp(ins)!.type);
+    switch (ins.op) {
+      case 'binary':
+        if (isWide(ins.a.type) && ins.operator in ALU_MNEMONICS) {
+          this.emitWideBinary(layout, ins);
+        } else {
+          this.emitBinary(layout, ins);
+        }
+        break;
+      case 'unary':
+        if (wide || isWide(ins.a.type)) {
+          this.emitWideUnary(layout, ins);
+          break;
+        }
+        this.loadA(layout, ins.a);
+        if (ins.operator === 'lnot' && layout.operands.flags.has(ins.dst.id)) {
+          this.emitInstruction('ORI', [0], 'Test condition');
+          this.flagsJump = 'JZ';
+          break;
+        }
+        if (ins.operator === 'lnot') {
+          this.emitInstruction('ORI', [0]);
+          this.emitBoolean(layout, 'JZ');
+        } else {
+          this.emitInstruction('NOT');
+          if (ins.operator === 'neg') {
+            this.emitInstruction('ADI', [1], 'Two\'s complement');
+          }
+        }
+        this.storeA(layout, ins.dst);
+        break;
+      case 'copy': {
+        const source = ins.src.kind === 'temp' ? layout.temps.get(ins.src.id) : undefined;
+        const target = layout.temps.get(ins.dst.id);
+        if (source && target && sameLocation(source, target)) {
+          break;
+        }
+        for (let byte = 0; byte < typeSize(ins.dst.type); byte++) {
+          this.loadByte(layout, ins.src, byte);
+          this.storeByte(layout, ins.dst, byte);
+        }
+        break;
+      }
+      case 'param':
+        // Already in its parameter slot
+        break;
+      case 'load':
+        if (layout.operands.folded.has(ins.dst.id)) {
+          // Read by its use
+          break;
+        }
+        if (ins.index) {
+          this.loadIndex(layout, ins.index);
+        }
+        for (let byte = 0; byte < typeSize(ins.dst.type); byte++) {
+          this.emitInstruction(ins.index ? 'LDX' : 'LDA', [this.variableAddress(layout, ins.variable) + ins.offset + byte], `Load ${ins.variable.name}`);
+          this.storeByte(layout, ins.dst, byte);
+        }
+        break;
+      case 'store':
+        if (ins.index) {
+          this.loadIndex(layout, ins.index);
+        }
+        for (let byte = 0; byte < typeSize(ins.variable.type); byte++) {
+          this.loadByte(layout, ins.src, byte);
+          this.emitInstruction(ins.index ? 'STX' : 'STA', [this.variableAddress(layout, ins.variable) + ins.offset + byte], `Store ${ins.variable.name}`);
+        }
+        break;
+      case 'call': {
+        // Tail calls are jumps (see emitFunction()); any other call back into
+        // the cycle would return to a frame the callee has overwritten
+        const cycle = this.recursive.get(layout.fn.name);
+        if (cycle && cycle.has(ins.callee)) {
+          throw new Error(`${layout.fn.name}: recursive call to ${ins.callee} is not in tail position; frames are static, so only tail recursion is supported`);
+        }
+        const callee = this.emitArguments(layout, ins);
+        this.emitInstruction('CALL', [callee.label]);
+        if (ins.dst && wide) {
+          for (let byte = 0; byte < 2; byte++) {
+            this.emitInstruction('LDA', [callee.returnSlot + byte], `Result of ${callee.fn.name}`);
+            this.storeByte(layout, ins.dst, byte);
+          }
+        } else if (ins.dst) {
+          this.storeA(layout, ins.dst);
+        }
+        break;
+      }
+      case 'in':
+        this.emitInstruction('IN', [ins.port]);
+        this.storeA(layout, ins.dst);
+        break;
+      case 'out':
+        this.loadA(layout, ins.src);
+        this.emitInstruction('OUT', [ins.port]);
+        break;
+      case 'delay': {
+        const loop = this.newLabel(layout);
+        const done = this.newLabel(layout);
+        this.loadA(layout, ins.src);
+        this.emitInstruction('ORI', [0]);
+        this.emitInstruction('JZ', [done]);
+        this.emitLabel(loop);
+        this.emitInstruction('SUI', [1], 'Delay loop');
+        this.emitInstruction('JNZ', [loop]);
+        this.emitLabel(done);
+        break;
+      }
+      case 'halt':
+        this.emitInstruction('HLT');
+        break;
+      case 'phi':
+        throw new Error(`Phi %${ins.dst.id} reached lowering`);
+    }
+  }
+
+  /**
+   * Stores the arguments of a call in the callee's parameter slots;
+   * returns the callee's layout
+   */
+  private emitArguments(layout: FunctionLayout, ins: Extract<Instruction, { op: 'call' }>): FunctionLayout {
+    const callee = this.layouts.get(ins.callee)!;
+    ins.args.forEach((arg, index) => {
+      for (let byte = 0; byte < typeSize(callee.fn.params[index].type); byte++) {
+        this.loadByte(layout, arg, byte);
+        this.emitInstruction('STA', [callee.paramBase + callee.paramOffsets[index] + byte], `Argument ${callee.fn.params[index].name}`);
+      }
+    });
+    return callee;
+  }
+
+  /**
+   * The call ending `block` if the block returns what it returns: the
+   * callee's RET can then return for the caller
+   */
+  private tailCall(layout: FunctionLayout, block: BasicBlock): Extract<Instruction, { op: 'call' }> | null {
+    const call = block.instructions[block.instructions.length - 1];
+    const terminator = block.terminator!;
+    if (!call || call.op !== 'call' || terminator.op !== 'ret') {
+      return null;
+    }
+    if (!terminator.value) {
+      return call;
+    }
+    // Only results in A pass through; 16-bit ones sit in each function's return slot
+    const result = terminator.value;
+    const callee = this.layouts.get(call.callee)!;
+    const passes = call.dst !== null && result.kind === 'temp' && result.id === call.dst.id;
+    return passes && layout.returnSlot < 0 && callee.returnSlot < 0 ? call : null;
+  }
+
+  private emitBinary(layout: FunctionLayout, ins: Extract<Instruction, { op: 'binary' }>): void {
+    if (ins.operator in ALU_MNEMONICS) {
+      let a = ins.a;
+      let b = ins.b;
+      // Commutative: whatever is already in A (or B) goes first, constants last
+      if (COMMUTATIVE.has(ins.operator) && (this.inAccumulator(layout, b) || this.inRegister(layout, b) || (a.kind === 'const' && b.kind === 'temp'))) {
+        [a, b] = [b, a];
+      }
+      this.loadA(layout, a);
+      this.applyOperand(layout, ALU_MNEMONICS[ins.operator], b);
+    } else if (ins.operator in RUNTIME_OPERATIONS) {
+      const operation = RUNTIME_OPERATIONS[ins.operator]!;
+      this.loadA(layout, ins.a);
+      this.emitInstruction('STA', [this.runtimeBase + RUNTIME_SCRATCH.X]);
+      this.loadA(layout, ins.b);
+      this.emitInstruction('STA', [this.runtimeBase + RUNTIME_SCRATCH.Y]);
+      this.emitInstruction('CALL', [operation.routine], ins.operator);
+      if (operation.remainder) {
+        this.emitInstruction('LDA', [this.runtimeBase + RUNTIME_SCRATCH.R], 'Remainder');
+      }
+    } else {
+      const comparison = normalizeComparison(ins.operator, ins.a, ins.b);
+      if (layout.operands.flags.has(ins.dst.id)) {
+        // The branch jumps on the flags of x - y
+        if ('result' in comparison) {
+          this.flagsJump = comparison.result;
+        } else {
+          this.emitCompare(layout, comparison.x, comparison.y, `Compare (${ins.operator})`);
+          this.flagsJump = comparison.jump;
+        }
+        return;
+      }
+      if ('result' in comparison) {
+        this.emitInstruction('LDI', [comparison.result], `Compare (${ins.operator}) is constant`);
+      } else {
+        // x - y sets Z when equal and C when x < y (unsigned)
+        this.emitCompare(layout, comparison.x, comparison.y, `Compare (${ins.operator})`);
+        this.emitBoolean(layout, comparison.jump);
+      }
+    }
+    this.storeA(layout, ins.dst);
+  }
+
+  /**
+   * Sets Z and C like x - y; 16-bit values only subtract the low bytes
+   * when the high bytes are equal
+   */
+  private emitCompare(layout: FunctionLayout, x: Value, y: Value, comment: string): void {
+    if (!isWide(x.type)) {
+      this.loadA(layout, x);
+      this.applyOperand(layout, ALU_MNEMONICS.sub, y, comment);
+      return;
+    }
+    const done = this.newLabel(layout);
+    this.loadByte(layout, x, 1);
+    this.applyByte(layout, ALU_MNEMONICS.sub, y, 1, comment);
+    this.emitInstruction('JNZ', [done]);
+    this.loadByte(layout, x, 0);
+    this.applyByte(layout, ALU_MNEMONICS.sub, y, 0);
+    this.emitLabel(done);
+  }
+
+  /**
+   * 16-bit add, sub, and, or, xor a byte at a time, low byte first; the
+   * high byte of add/sub takes the carry of the low one
+   */
+  private emitWideBinary(layout: FunctionLayout, ins: Extract<Instruction, { op: 'binary' }>): void {
+    let a = ins.a;
+    let b = ins.b;
+    if (COMMUTATIVE.has(ins.operator) && a.kind === 'const' && b.kind === 'temp') {
+      [a, b] = [b, a];
+    }
+    const mnemonics = ALU_MNEMONICS[ins.operator];
+    // Adding or subtracting a multiple of 256 never carries
+    const carries = (ins.operator === 'add' || ins.operator === 'sub') && !(b.kind === 'const' && (b.value & 0xFF) === 0);
+    for (let byte = 0; byte < 2; byte++) {
+      this.loadByte(layout, a, byte);
+      if (carries && byte === 1) {
+        const done = this.newLabel(layout);
+        this.emitInstruction('JNC', [done]);
+        this.emitInstruction(mnemonics.immediate, [1], ins.operator === 'add' ? 'Carry' : 'Borrow');
+        this.emitLabel(done);
+      }
+      // The low byte of add/sub always runs, for its carry
+      const identity = b.kind === 'const' && ((b.value >> (8 * byte)) & 0xFF) === (ins.operator === 'and' ? 0xFF : 0);
+      if (!identity || (carries && byte === 0)) {
+        this.applyByte(layout, mnemonics, b, byte);
+      }
+      this.storeByte(layout, ins.dst, byte);
+    }
+  }
+
+  /**
+   * Unary operations with a 16-bit operand or result
+   */
+  private emitWideUnary(layout: FunctionLayout, ins: Extract<Instruction, { op: 'unary' }>): void {
+    switch (ins.operator) {
+      case 'zext':
+      case 'sext':
+        this.loadA(layout, ins.a);
+        this.storeByte(layout, ins.dst, 0);
+        if (ins.operator === 'zext') {
+          this.emitInstruction('LDI', [0]);
+        } else {
+          const done = this.newLabel(layout);
+          this.emitInstruction('ANI', [0x80], 'Sign');
+          this.emitInstruction('JZ', [done]);
+          this.emitInstruction('LDI', [0xFF]);
+          this.emitLabel(done);
+        }
+        this.storeByte(layout, ins.dst, 1);
+        break;
+      case 'trunc':
+        this.loadByte(layout, ins.a, 0);
+        this.storeA(layout, ins.dst);
+        break;
+      case 'lnot':
+        this.loadByte(layout, ins.a, 0);
+        this.applyByte(layout, ALU_MNEMONICS.or, ins.a, 1);
+        if (layout.operands.flags.has(ins.dst.id)) {
+          this.flagsJump = 'JZ';
+          break;
+        }
+        this.emitBoolean(layout, 'JZ');
+        this.storeA(layout, ins.dst);
+        break;
+      case 'not':
+        for (let byte = 0; byte < 2; byte++) {
+          this.loadByte(layout, ins.a, byte);
+          this.emitInstruction('NOT');
+          this.storeByte(layout, ins.dst, byte);
+        }
+        break;
+      case 'neg':
+        // 0 - x, borrowing into the high byte
+        for (let byte = 0; byte < 2; byte++) {
+          this.emitInstruction('LDI', [0]);
+          if (byte === 1) {
+            const done = this.newLabel(layout);
+            this.emitInstruction('JNC', [done]);
+            this.emitInstruction('SUI', [1], 'Borrow');
+            this.emitLabel(done);
+          }
+          this.applyByte(layout, ALU_MNEMONICS.sub, ins.a, byte);
+          this.storeByte(layout, ins.dst, byte);
+        }
+        break;
+    }
+  }
+
+  /**
+   * A = 1 if `jump` is taken on the current flags, else 0
+   */
+  private emitBoolean(layout: FunctionLayout, jump: string): void {
+    const done = this.newLabel(layout);
+    this.emitInstruction('LDI', [1]);
+    this.emitInstruction(jump, [done]);
+    this.emitInstruction('LDI', [0]);
+    this.emitLabel(done);
+  }
+
+  private emitTerminator(layout: FunctionLayout, terminator: Terminator, next: BasicBlock | null): void {
+    switch (terminator.op) {
+      case 'jmp': {
+        const target = terminator.target;
+        if (target === next) {
+          break;
+        }
+        // A jump to a bare return is the return itself when A already holds its value
+        const returns = target.instructions.length === 0 && target.terminator!.op === 'ret' ? target.terminator! : null;
+        if (returns && returns.op === 'ret' && (!returns.value || this.holdsInA(layout, returns.value))) {
+          this.emitTerminator(layout, returns, next);
+        } else {
+          this.emitInstruction('JMP', [this.blockLabel(layout, target)]);
+        }
+        break;
+      }
+      case 'br': {
+        let jump: string | number = 'JNZ';
+        if (terminator.cond.kind === 'temp' && layout.operands.flags.has(terminator.cond.id)) {
+          jump = this.flagsJump;
+        } else if (isWide(terminator.cond.type)) {
+          this.loadByte(layout, terminator.cond, 0);
+          this.applyByte(layout, ALU_MNEMONICS.or, terminator.cond, 1, 'Test condition');
+        } else {
+          this.loadA(layout, terminator.cond);
+          this.emitInstruction('ORI', [0], 'Test condition');
+        }
+
+        if (typeof jump === 'number') {
+          const target = jump !== 0 ? terminator.then : terminator.else;
+          if (target !== next) {
+            this.emitInstruction('JMP', [this.blockLabel(layout, target)]);
+          }
+        } else if (terminator.then === next) {
+          this.emitInstruction(INVERTED_JUMPS[jump], [this.blockLabel(layout, terminator.else)]);
+        } else {
+          this.emitInstruction(jump, [this.blockLabel(layout, terminator.then)]);
+          if (terminator.else !== next) {
+            this.emitInstruction('JMP', [this.blockLabel(layout, terminator.else)]);
+          }
+        }
+        break;
+      }
+      case 'switch': {
+        const value = terminator.value;
+        if (value.kind === 'const') {
+          const target = switchTarget(terminator, value.value);
+          if (target !== next) {
+            this.emitInstruction('JMP', [this.blockLabel(layout, target)]);
+          }
+          break;
+        }
+        const label = `${layout.label}_T${this.labelCounter++}`;
+        this.loadA(layout, value);
+        this.emitInstruction('SUI', [terminator.targets.length], 'Switch range');
+        this.emitInstruction('JNC', [this.blockLabel(layout, terminator.default)]);
+        this.loadA(layout, value);
+        this.applyOperand(layout, ALU_MNEMONICS.add, value);
+        this.emitInstruction('ADI', [label], 'Jump table');
+        this.emitInstruction('PUSH');
+        this.emitInstruction('RET');
+        this.jumpTables.push({
+          label,
+          entries: terminator.targets.map((target, index) => ({
+            label: index === 0 ? label : `${label}_${index}`,
+            target: this.blockLabel(layout, target)
+          }))
+        });
+        break;
+      }
+      case 'ret':
+        if (terminator.value && layout.returnSlot >= 0) {
+          for (let byte = 0; byte < 2; byte++) {
+            this.loadByte(layout, terminator.value, byte);
+            this.emitInstruction('STA', [layout.returnSlot + byte], 'Result');
+          }
+        } else if (terminator.value) {
+          this.loadA(layout, terminator.value);
+        }
+        this.emitInstruction('RET');
+        break;
+    }
+  }
+
+  /**
+   * Applies `value` to A: as an immediate if it is a constant, else from memory
+   */
+  private applyOperand(layout: FunctionLayout, mnemonics: { memory: string; immediate: string }, value: Value, comment?: string): void {
+    if (value.kind === 'const') {
+      this.emitInstruction(mnemonics.immediate, [value.value], comment);
+      return;
+    }
+    if (layout.operands.accumulator.has(value.id)) {
+      throw new Error(`${layout.fn.name}: %${value.id} is in A, not memory`);
+    }
+    const folded = layout.operands.folded.get(value.id);
+    if (folded) {
+      this.emitInstruction(mnemonics.memory, [this.variableAddress(layout, folded.variable) + folded.offset], comment || folded.variable.name);
+    } else {
+      this.emitOperand(mnemonics.memory, this.location(layout, value), comment || value.name);
+    }
+  }
+
+  /**
+   * Applies byte `byte` (0 = low) of a 16-bit value to A, like applyOperand()
+   */
+  private applyByte(layout: FunctionLayout, mnemonics: { memory: string; immediate: string }, value: Value, byte: number, comment?: string): void {
+    if (value.kind === 'const') {
+      this.emitInstruction(mnemonics.immediate, [(value.value >> (8 * byte)) & 0xFF], comment);
+      return;
+    }
+    const folded = layout.operands.folded.get(value.id);
+    if (folded) {
+      this.emitInstruction(mnemonics.memory, [this.variableAddress(layout, folded.variable) + folded.offset + byte], comment || folded.variable.name);
+    } else {
+      this.emitOperand(mnemonics.memory, byteLocation(this.location(layout, value), byte), comment || value.name);
+    }
+  }
+
+  /**
+   * A = byte `byte` of a value; 8-bit values only have byte 0
+   */
+  private loadByte(layout: FunctionLayout, value: Value, byte: number): void {
+    if (isWide(value.type)) {
+      this.applyByte(layout, LOAD, value, byte);
+    } else {
+      this.loadA(layout, value);
+    }
+  }
+
+  private storeByte(layout: FunctionLayout, temp: Temp, byte: number): void {
+    if (isWide(temp.type)) {
+      this.emitOperand('STA', byteLocation(this.location(layout, temp), byte), temp.name);
+    } else {
+      this.storeA(layout, temp);
+    }
+  }
+
+  /**
+   * Whether A is known to hold an 8-bit value already, so loading it
+   * emits nothing
+   */
+  private holdsInA(layout: FunctionLayout, value: Value): boolean {
+    if (isWide(value.type) || layout.returnSlot >= 0) {
+      return false;
+    }
+    if (value.kind === 'const') {
+      return this.accumulator.constant === value.value;
+    }
+    const location = layout.temps.get(value.id);
+    return location !== undefined && this.accumulator.locations.has(locationKey(location));
+  }
+
+  private inAccumulator(layout: FunctionLayout, value: Value): boolean {
+    return value.kind === 'temp' && layout.operands.accumulator.has(value.id);
+  }
+
+  private inRegister(layout: FunctionLayout, value: Value): boolean {
+    if (value.kind !== 'temp') {
+      return false;
+    }
+    const location = layout.temps.get(value.id);
+    return location !== undefined && location.kind === 'register';
+  }
+
+  private loadA(layout: FunctionLayout, value: Value): void {
+    if (value.kind === 'const') {
+      this.emitInstruction('LDI', [value.value]);
+      return;
+    }
+    if (layout.operands.accumulator.has(value.id)) {
+      return;
+    }
+    const folded = layout.operands.folded.get(value.id);
+    if (folded) {
+      this.emitInstruction('LDA', [this.variableAddress(layout, folded.variable) + folded.offset], `Load ${folded.variable.name}`);
+    } else {
+      this.emitOperand('LDA', this.location(layout, value), value.name);
+    }
+  }
+
+  /**
+   * B = the byte index of an LDX/STX
+   */
+  private loadIndex(layout: FunctionLayout, index: Value): void {
+    if (this.inRegister(layout, index)) {
+      return;
+    }
+    this.loadA(layout, index);
+    this.emitInstruction('MOV', ['B', 'A'], 'Index');
+  }
+
+  private storeA(layout: FunctionLayout, temp: Temp): void {
+    if (!layout.operands.accumulator.has(temp.id)) {
+      this.emitOperand('STA', this.location(layout, temp), temp.name);
+    }
+  }
+
+  private location(layout: FunctionLayout, temp: Temp): Location {
+    const location = layout.temps.get(temp.id);
+    if (!location) {
+      throw new Error(`${layout.fn.name}: no slot for %${temp.id}`);
+    }
+    return location;
+  }
+
+  private variableAddress(layout: FunctionLayout, variable: IRVariable): number {
+    const address = variable.scope === 'global' ? this.globals.get(variable) : layout.locals.get(variable);
+    if (address === undefined) {
+      throw new Error(`${layout.fn.name}: no storage for ${variable.name}`);
+    }
+    return address;
+  }
+
+  private blockLabel(layout: FunctionLayout, block: BasicBlock): string {
+    return block === layout.fn.blocks[0] ? layout.label : `${layout.label}_B${block.id}`;
+  }
+
+  private newLabel(layout: FunctionLayout): string {
+    return `${layout.label}_L${this.labelCounter++}`;
+  }
+
+  private emitOperand(instruction: string, location: Location, comment?: string): void {
+    if (location.kind === 'frame') {
+      this.emitInstruction(instruction, [location.address], comment);
+      return;
+    }
+    if (location.kind === 'register') {
+      if (instruction !== 'LDA' && instruction !== 'STA') {
+        throw new Error(`${instruction} cannot take B as its operand`);
+      }
+      this.emitInstruction('MOV', instruction === 'LDA' ? ['A', 'B'] : ['B', 'A'], comment);
+      return;
+    }
+    const key = locationKey(location);
+    if (instruction === 'LDA' && this.accumulator.locations.has(key)) {
+      return;
+    }
+    const item: InstructionItem = { kind: 'instruction', instruction, operands: [location.slot], comment };
+    this.output.push(item);
+    this.poolFixups.push({ item, slot: location.slot });
+    this.track(instruction, key);
+  }
+
+  private emitInstruction(instruction: string, operands: (string | number)[] = [], comment?: string): void {
+    const operand = operands[0];
+    const key = typeof operand === 'number' ? locationKey({ kind: 'frame', address: operand }) : undefined;
+    if (instruction === 'LDA' && key !== undefined && this.accumulator.locations.has(key)) {
+      return;
+    }
+    if (instruction === 'LDI' && this.accumulator.constant === operand) {
+      return;
+    }
+    if (instruction === 'MOV' && this.accumulator.locations.has(REGISTER_KEY)) {
+      return;
+    }
+    this.output.push({ kind: 'instruction', instruction, operands, comment });
+    this.track(instruction, instruction === 'LDI' || instruction === 'MOV' ? operand : key);
+  }
+
+  /**
+   * Updates what A is known to hold after `instruction`
+   */
+  private track(instruction: string, operand: string | number | undefined): void {
+    const accumulator = this.accumulator;
+    if (instruction === 'STA' && typeof operand === 'string') {
+      accumulator.locations.add(operand);
+    } else if (instruction === 'STX') {
+      // Any byte may have changed, A has not
+      accumulator.locations.clear();
+    } else if (instruction === 'MOV' && operand === 'B') {
+      // Only B changed, to A
+      accumulator.locations.add(REGISTER_KEY);
+    } else if (!PRESERVES_A.has(instruction)) {
+      accumulator.locations.clear();
+      accumulator.constant = null;
+      if (instruction === 'LDA' && typeof operand === 'string') {
+        accumulator.locations.add(operand);
+      } else if (instruction === 'MOV') {
+        accumulator.locations.add(REGISTER_KEY);
+      } else if (instruction === 'LDI' && typeof operand === 'number') {
+        accumulator.constant = operand;
+      }
+    }
+  }
+
+  private emitLabel(name: string): void {
+    this.output.push({ kind: 'label', name });
+    this.accumulator.locations.clear();
+    this.accumulator.constant = null;
+  }
+
+  private emitComment(text: string, indent: boolean = true): void {
+    this.output.push({ kind: 'comment', text, indent });
+  }
+
+  private emitBlank(): void {
+    this.output.push({ kind: 'blank' });
+  }
+}
+
+function relocateFrame(layout: FunctionLayout, base: number): void {
+  layout.paramBase += base;
+  if (layout.returnSlot >= 0) layout.returnSlot += base;
+  for (const [local, address] of layout.locals) {
+    layout.locals.set(local, address + base);
+  }
+  for (const location of layout.temps.values()) {
+    if (location.kind === 'frame') location.address += base;
+  }
+}
+
+/** B only holds 8-bit values, so only memory locations have a byte 1 */
+function byteLocation(location: Location, byte: number): Location {
+  switch (location.kind) {
+    case 'frame': return { kind: 'frame', address: location.address + byte };
+    case 'pool': return { kind: 'pool', slot: location.slot + byte };
+    case 'register': return location;
+  }
+}
+
+function sameLocation(a: Location, b: Location): boolean {
+  return locationKey(a) === locationKey(b);
+}
+
+/** Pool slots are placed above every frame, so the two never alias */
+function locationKey(location: Location): string {
+  switch (location.kind) {
+    case 'frame': return `m${location.address}`;
+    case 'pool': return `p${location.slot}`;
+    case 'register': return REGISTER_KEY;
+  }
+}
+
+const MIRRORED: Partial<Record<BinaryOp, BinaryOp>> = { lt: 'gt', gt: 'lt', le: 'ge', ge: 'le' };
+
+/**
+ * Orders a comparison for `x - y` with the constant, if any, as y.
+ * gt/le against a constant use the next constant instead (a > c is
+ * a >= c + 1); against 255 their result is known.
+ */
+function normalizeComparison(operator: BinaryOp, a: Value, b: Value): Comparison {
+  if (a.kind === 'const' && b.kind === 'temp') {
+    [a, b] = [b, a];
+    operator = MIRRORED[operator] || operator;
+  }
+  if (operator === 'gt' || operator === 'le') {
+    if (b.kind === 'temp') {
+      return { x: b, y: a, jump: operator === 'gt' ? 'JC' : 'JNC' };
+    }
+    if (b.value === typeMask(b.type)) {
+      return { result: operator === 'gt' ? 0 : 1 };
+    }
+    return { x: a, y: constant(b.value + 1, b.type), jump: operator === 'gt' ? 'JNC' : 'JC' };
+  }
+  const jumps: Partial<Record<BinaryOp, string>> = { eq: 'JZ', ne: 'JNZ', lt: 'JC', ge: 'JNC' };
+  return { x: a, y: b, jump: jumps[operator]! };
+}
+
+/**
+ * Runtime routines the module's operations call
+ */
+function runtimeOperations(module: IRModule): Set<string> {
+  const routines = new Set<string>();
+  for (const fn of module.functions) {
+    for (const block of fn.blocks) {
+      for (const ins of block.instructions) {
+        if (ins.op === 'binary' && ins.operator in RUNTIME_OPERATIONS) {
+          routines.add(RUNTIME_OPERATIONS[ins.operator]!.routine);
+        }
+      }
+    }
+  }
+  return routines;
+}
+
+/**
+ * Operands of `ins` that it can take from A: the one it loads first, or
+ * either one of a commutative operation. `registers` are the temporaries
+ * in B.
+ */
+function accumulatorOperands(ins: Instruction | Terminator, registers: Set<number>): Value[] {
+  switch (ins.op) {
+    case 'binary':
+      if (COMMUTATIVE.has(ins.operator)) return [ins.a, ins.b];
+      if (ins.operator === 'sub' || ins.operator in RUNTIME_OPERATIONS) return [ins.a];
+      {
+        const comparison = normalizeComparison(ins.operator, ins.a, ins.b);
+        return 'result' in comparison ? [] : [comparison.x];
+      }
+    case 'unary':
+      return [ins.a];
+    case 'load':
+      return ins.index ? [ins.index] : [];
+    case 'store':
+      // The index goes to B first, unless it is there already
+      return ins.index && !(ins.index.kind === 'temp' && registers.has(ins.index.id)) ? [ins.index] : [ins.src];
+    case 'copy':
+    case 'out':
+    case 'delay':
+      return [ins.src];
+    case 'call':
+      return ins.args.slice(0, 1);
+    case 'br':
+      return [ins.cond];
+    case 'ret':
+      return ins.value ? [ins.value] : [];
+    default:
+      return [];
+  }
+}
+
+/**
+ * Finds temporaries that need no slot; see the file header. `registers`
+ * are temporaries already given B, which are left out.
+ */
+export function planOperands(fn: IRFunction, registers: Set<number> = new Set()): OperandPlan {
+  const uses = new Map<number, number>();
+  for (const block of fn.blocks) {
+    for (const ins of [...block.instructions, block.terminator!]) {
+      for (const value of usedValues(ins)) {
+        if (value.kind === 'temp') uses.set(value.id, (uses.get(value.id) || 0) + 1);
+      }
+    }
+  }
+
+  const plan: OperandPlan = { accumulator: new Set(), folded: new Map(), flags: new Set() };
+  const singleUse = (ins: Instruction) => {
+    const dst = definedTemp(ins);
+    return dst && ins.op !== 'param' && uses.get(dst.id) === 1 && !registers.has(dst.id) ? dst : null;
+  };
+  const isFolded = (ins: Instruction) => {
+    const dst = definedTemp(ins);
+    return dst !== null && plan.folded.has(dst.id);
+  };
+  const reads = (user: Instruction | Terminator, temp: Temp) =>
+    usedValues(user).findIndex((value) => value.kind === 'temp' && value.id === temp.id);
+
+  for (const block of fn.blocks) {
+    const sequence: (Instruction | Terminator)[] = [...block.instructions, block.terminator!];
+
+    block.instructions.forEach((ins, index) => {
+      const dst = singleUse(ins);
+      if (!dst || ins.op !== 'load' || ins.index) return;
+      for (let i = index + 1; i < sequence.length; i++) {
+        const user = sequence[i];
+        const operand = reads(user, dst);
+        // Arguments after the first are read once earlier ones are in the callee's slots
+        if (operand >= 0 && (user.op !== 'call' || operand === 0)) {
+          plan.folded.set(dst.id, { variable: ins.variable, offset: ins.offset });
+          return;
+        }
+        if (user.op === 'call' || (user.op === 'store' && user.variable === ins.variable)) return;
+      }
+    });
+
+    // A condition computed last, for the branch alone, stays in the flags
+    const terminator = block.terminator!;
+    if (terminator.op === 'br' && terminator.cond.kind === 'temp') {
+      const cond = terminator.cond;
+      const index = block.instructions.findIndex((ins) => {
+        const dst = definedTemp(ins);
+        return dst !== null && dst.id === cond.id;
+      });
+      const ins = block.instructions[index];
+      const setsFlags = ins && ((ins.op === 'binary' && isComparison(ins.operator)) || (ins.op === 'unary' && ins.operator === 'lnot'));
+      if (setsFlags && singleUse(ins) && block.instructions.slice(index + 1).every(isFolded)) {
+        plan.flags.add(cond.id);
+      }
+    }
+
+    // Folded loads emit nothing, so they do not separate a value from its use
+    block.instructions.forEach((ins, index) => {
+      const dst = singleUse(ins);
+      if (!dst || isWide(dst.type) || plan.folded.has(dst.id) || plan.flags.has(dst.id)) return;
+      let next = index + 1;
+      while (next < block.instructions.length && isFolded(block.instructions[next])) {
+        next++;
+      }
+      if (accumulatorOperands(sequence[next], registers).some((value) => value.kind === 'temp' && value.id === dst.id)) {
+        plan.accumulator.add(dst.id);
+      }
+    });
+  }
+  return plan;
+}
+
+/**
+ * Frame offset of each parameter, 16-bit ones at even offsets, and the
+ * bytes they take up
+ */
+export function paramOffsets(fn: IRFunction): { offsets: number[]; size: number } {
+  const offsets: number[] = [];
+  let size = 0;
+  for (const param of fn.params) {
+    if (isWide(param.type)) size += size & 1;
+    offsets.push(size);
+    size += typeSize(param.type);
+  }
+  return { offsets, size };
+}
+
+/**
+ * Colors temporaries of an out-of-SSA function. Values live across a call
+ * (and parameters) get frame colors, everything else pool colors; two
+ * temporaries of the same class that are live at the same time never
+ * share a byte. Colors are byte offsets; 16-bit values get even ones.
+ */
+export function allocateTemps(fn: IRFunction, reservedFrameColors: Set<number> = new Set(), unallocated: Set<number> = new Set()): TempAllocation {
+  const interference = new Map<number, Set<number>>();
+  const acrossCall = new Set<number>();
+  const preference = new Map<number, number>();
+  const order: Temp[] = [];
+  const seen = new Set<number>();
+
+  const node = (id: number) => {
+    if (!interference.has(id)) interference.set(id, new Set());
+    return interference.get(id)!;
+  };
+  const addEdge = (a: number, b: number) => {
+    if (a === b) return;
+    node(a).add(b);
+    node(b).add(a);
+  };
+
+  for (const block of fn.blocks) {
+    for (const ins of block.instructions) {
+      const dst = definedTemp(ins);
+      if (dst && !seen.has(dst.id)) {
+        seen.add(dst.id);
+        order.push(dst);
+        node(dst.id);
+      }
+      if (ins.op === 'copy' && ins.src.kind === 'temp' && dst) {
+        preference.set(dst.id, ins.src.id);
+      }
+    }
+  }
+
+  const liveOut = liveness(fn);
+  for (const block of fn.blocks) {
+    const live = new Set(liveOut.get(block)!);
+    for (const value of usedValues(block.terminator!)) {
+      if (value.kind === 'temp') live.add(value.id);
+    }
+
+    for (let i = block.instructions.length - 1; i >= 0; i--) {
+      const ins = block.instructions[i];
+      const dst = definedTemp(ins);
+
+      if (ins.op === 'call') {
+        for (const id of live) {
+          if (!dst || id !== dst.id) acrossCall.add(id);
+        }
+      }
+      if (dst) {
+        const copySource = ins.op === 'copy' && ins.src.kind === 'temp' ? ins.src.id : -1;
+        for (const id of live) {
+          if (id !== copySource) addEdge(dst.id, id);
+        }
+        live.delete(dst.id);
+      }
+      for (const value of usedValues(ins)) {
+        if (value.kind === 'temp') live.add(value.id);
+      }
+    }
+
+    // Parameters are all in place on entry
+    if (block === fn.blocks[0]) {
+      const params = block.instructions.filter((ins) => ins.op === 'param').map((ins) => definedTemp(ins)!.id);
+      for (const a of params) {
+        for (const b of params) addEdge(a, b);
+        for (const id of live) addEdge(a, id);
+      }
+    }
+  }
+
+  const frameColors = new Map<number, number>();
+  const poolColors = new Map<number, number>();
+  const sizes = new Map(order.map((temp) => [temp.id, typeSize(temp.type)] as [number, number]));
+
+  const offsets = paramOffsets(fn).offsets;
+  for (const block of fn.blocks) {
+    for (const ins of block.instructions) {
+      if (ins.op === 'param') frameColors.set(ins.dst.id, offsets[ins.index]);
+    }
+  }
+
+  for (const temp of order) {
+    if (frameColors.has(temp.id) || unallocated.has(temp.id)) continue;
+    const inFrame = acrossCall.has(temp.id);
+    const colors = inFrame ? frameColors : poolColors;
+
+    const taken = new Set<number>(inFrame ? reservedFrameColors : []);
+    for (const neighbor of interference.get(temp.id)!) {
+      const color = colors.get(neighbor);
+      if (color === undefined) continue;
+      for (let byte = 0; byte < sizes.get(neighbor)!; byte++) taken.add(color + byte);
+    }
+
+    const size = sizes.get(temp.id)!;
+    const fits = (color: number) => color % size === 0 && !taken.has(color) && !taken.has(color + size - 1);
+    const preferred = preference.has(temp.id) ? colors.get(preference.get(temp.id)!) : undefined;
+    let color = preferred !== undefined && fits(preferred) ? preferred : 0;
+    while (!fits(color)) color += size;
+    colors.set(temp.id, color);
+  }
+
+  return { frameColors, poolColors };
+}
+
+/** What an access to a value costs in memory and in B; see allocateRegister() */
+const REGISTER_ACCESS = {
+  /** `LDA i ; MOV B, A` before an LDX/STX becomes nothing */
+  index: { memory: ['LDA', 'MOV'], register: [] as string[] },
+  read: { memory: ['LDA'], register: ['MOV'] },
+  write: { memory: ['STA'], register: ['MOV'] }
+};
+
+type RegisterAccess = keyof typeof REGISTER_ACCESS;
+
+/**
+ * Chooses the temporaries of an out-of-SSA function that live in B; see
+ * the file header. Temporaries joined by a copy that do not interfere are
+ * one candidate, so a loop counter moves to B together with the copies
+ * carrying it around the loop. A candidate qualifies if its members are
+ * 8-bit, every use reads them as an index or through A, and nothing
+ * writes B while one is live. Qualifying candidates are taken by benefit,
+ * as long as it is positive and they do not interfere with ones already
+ * taken: the cycles each access saves, times the weight of its block
+ * (LOOP_WEIGHT per enclosing loop unless `weights` are given), plus the
+ * bytes it saves.
+ */
+export function allocateRegister(fn: IRFunction, plan: OperandPlan, weights: Map<BasicBlock, number> = loopWeights(fn)): Set<number> {
+  const excluded = new Set<number>([...plan.accumulator, ...plan.folded.keys(), ...plan.flags]);
+  const interference = new Map<number, Set<number>>();
+  const gains = new Map<number, number>();
+  const copies: { dst: number; src: number; weight: number }[] = [];
+
+  const node = (id: number) => {
+    if (!interference.has(id)) interference.set(id, new Set());
+    return interference.get(id)!;
+  };
+  const gain = (id: number, access: RegisterAccess, weight: number) => {
+    const { memory, register } = REGISTER_ACCESS[access];
+    const cycles = (names: string[]) => names.reduce((total, name) => total + instructionCycles(name), 0);
+    const bytes = (names: string[]) => names.reduce((total, name) => total + instructionBytes(name), 0);
+    gains.set(id, (gains.get(id) || 0) + weight * (cycles(memory) - cycles(register)) + bytes(memory) - bytes(register));
+  };
+
+  const liveOut = liveness(fn);
+  for (const block of fn.blocks) {
+    const weight = weights.has(block) ? weights.get(block)! : 1;
+    const live = new Set(liveOut.get(block)!);
+    const read = (ins: Instruction | Terminator) => {
+      const ids = new Set<number>();
+      for (const value of usedValues(ins)) {
+        if (value.kind === 'temp') ids.add(value.id);
+      }
+      for (const id of ids) {
+        live.add(id);
+        if (ins.op === 'copy') continue;
+        const access = registerRead(ins, id, plan);
+        if (access) {
+          gain(id, access, weight);
+        } else {
+          excluded.add(id);
+        }
+      }
+    };
+    read(block.terminator!);
+
+    for (let i = block.instructions.length - 1; i >= 0; i--) {
+      const ins = block.instructions[i];
+      const dst = definedTemp(ins);
+      const index = (ins.op === 'load' || ins.op === 'store') && ins.index ? ins.index : null;
+
+      // Indexes other than the value itself and callees write B; the runtime
+      // routines only use A and their scratch bytes
+      if (index || ins.op === 'call') {
+        for (const id of live) {
+          const isIndex = index !== null && index.kind === 'temp' && index.id === id;
+          if (!isIndex && (!dst || id !== dst.id)) excluded.add(id);
+        }
+      }
+      if (dst) {
+        node(dst.id);
+        if (ins.op === 'param' || isWide(dst.type)) excluded.add(dst.id);
+        const copySource = ins.op === 'copy' && ins.src.kind === 'temp' ? ins.src.id : -1;
+        for (const id of live) {
+          if (id !== copySource && id !== dst.id) {
+            node(dst.id).add(id);
+            node(id).add(dst.id);
+          }
+        }
+        live.delete(dst.id);
+        if (copySource >= 0) {
+          copies.push({ dst: dst.id, src: copySource, weight });
+        } else {
+          gain(dst.id, 'write', weight);
+        }
+      }
+      read(ins);
+    }
+  }
+
+  // Candidates: copy-related temporaries that can share B
+  const group = new Map<number, number[]>();
+  for (const id of interference.keys()) {
+    if (!excluded.has(id)) group.set(id, [id]);
+  }
+  const interferes = (a: number[], b: number[]) => a.some((x) => b.some((y) => interference.get(x)!.has(y)));
+  for (const copy of copies.slice().sort((a, b) => b.weight - a.weight)) {
+    const dst = group.get(copy.dst);
+    const src = group.get(copy.src);
+    if (!dst || !src || dst === src || interferes(dst, src)) continue;
+    dst.push(...src);
+    for (const id of src) group.set(id, dst);
+  }
+  // A copy within a candidate emits nothing in B, as it does between coalesced slots
+  for (const copy of copies) {
+    if (group.get(copy.dst) === group.get(copy.src) && group.has(copy.dst)) continue;
+    gain(copy.src, 'read', copy.weight);
+    gain(copy.dst, 'write', copy.weight);
+  }
+
+  const benefit = (members: number[]) => members.reduce((total, id) => total + (gains.get(id) || 0), 0);
+  const candidates = [...new Set(group.values())].sort((a, b) => benefit(b) - benefit(a));
+  const chosen: number[] = [];
+  for (const members of candidates) {
+    if (benefit(members) > 0 && !interferes(members, chosen)) chosen.push(...members);
+  }
+  return new Set(chosen);
+}
+
+/**
+ * How `ins` reads temporary `id` if it is in B: as its index, through A,
+ * or not at all (null), when the value has to be a memory operand or is
+ * read after the index overwrote B
+ */
+function registerRead(ins: Instruction | Terminator, id: number, plan: OperandPlan): RegisterAccess | null {
+  const is = (value: Value) => value.kind === 'temp' && value.id === id;
+  switch (ins.op) {
+    case 'load':
+    case 'store':
+      if (ins.index) return is(ins.index) ? 'index' : null;
+      return 'read';
+    case 'binary': {
+      if (ins.operator in RUNTIME_OPERATIONS) return 'read';
+      if (ins.operator in ALU_MNEMONICS) {
+        if (is(ins.a) && is(ins.b)) return null;
+        if (ins.operator === 'sub') return is(ins.a) ? 'read' : null;
+        // Loaded first, unless the other operand is in A already
+        const other = is(ins.a) ? ins.b : ins.a;
+        return other.kind === 'temp' && plan.accumulator.has(other.id) ? null : 'read';
+      }
+      const comparison = normalizeComparison(ins.operator, ins.a, ins.b);
+      return 'result' in comparison || (is(comparison.x) && !is(comparison.y)) ? 'read' : null;
+    }
+    case 'switch':
+      // Added to itself from memory
+      return null;
+    default:
+      return 'read';
+  }
+}
+
+/**
+ * LOOP_WEIGHT to the power of the number of loops around each block
+ */
+export function loopWeights(fn: IRFunction): Map<BasicBlock, number> {
+  const weights = new Map<BasicBlock, number>();
+  for (const loop of findLoops(fn)) {
+    for (const block of loop.blocks) {
+      weights.set(block, (weights.get(block) || 1) * LOOP_WEIGHT);
+    }
+  }
+  return weights;
+}
+
+/**
+ * Temporaries live at the end of each block
+ */
+function liveness(fn: IRFunction): Map<BasicBlock, Set<number>> {
+  const use = new Map<BasicBlock, Set<number>>();
+  const def = new Map<BasicBlock, Set<number>>();
+
+  for (const block of fn.blocks) {
+    const blockUse = new Set<number>();
+    const blockDef = new Set<number>();
+    const read = (value: Value) => {
+      if (value.kind === 'temp' && !blockDef.has(value.id)) blockUse.add(value.id);
+    };
+    for (const ins of block.instructions) {
+      usedValues(ins).forEach(read);
+      const dst = definedTemp(ins);
+      if (dst) blockDef.add(dst.id);
+    }
+    usedValues(block.terminator!).forEach(read);
+    use.set(block, blockUse);
+    def.set(block, blockDef);
+  }
+
+  const liveIn = new Map<BasicBlock, Set<number>>();
+  const liveOut = new Map<BasicBlock, Set<number>>();
+  for (const block of fn.blocks) {
+    liveIn.set(block, new Set(use.get(block)));
+    liveOut.set(block, new Set());
+  }
+
+  let changed = true;
+  while (changed) {
+    changed = false;
+    for (const block of fn.blocks.slice().reverse()) {
+      const out = liveOut.get(block)!;
+      for (const successor of successors(block)) {
+        for (const id of liveIn.get(successor)!) {
+          if (!out.has(id)) {
+            out.add(id);
+            changed = true;
+          }
+        }
+      }
+      const inSet = liveIn.get(block)!;
+      for (const id of out) {
+        if (!def.get(block)!.has(id) && !inSet.has(id)) {
+          inSet.add(id);
+          changed = true;
+        }
+      }
+    }
+  }
+  return liveOut;
+}
+
+// Factory function for easier usage
+export function lowerModule(module: IRModule, options: LoweringOptions = {}): AssemblyItem[] {
+  return new IRLowering(options).lower(module);
+}
@@ -0,0 +1,190 @@
+/**
+ * IR Pass Manager
+ *
+ * Runs passes over a module in a fixed order. A function pass runs on each
+ * function and reports whether it changed it; a module pass (call graph,
+ * globals) runs once and reports how many functions it changed or
+ * removed. The manager records per-pass wall time, change counts and how
+ * many IR instructions the pass removed, optionally verifies the IR after
+ * every pass (so a broken pass is named in the error), and can hand each
+ * pass to the phase timer of --time-report.
+ *
+ * The default pipelines are keyed by optimization level:
+ *
+ * - O0: none; locals stay in memory, as written
+ * - O1: inline (single-call-site functions, and leaves no bigger than
+ *   the call), loop-rotate, mem2reg (SSA construction), tail-recursion
+ *   (self tail calls as loops), sccp (constant propagation and branch
+ *   folding), strength (multiply, divide and shift by constants as ALU
+ *   operations), licm, loop-unroll (only where that does not grow the
+ *   loop), sccp again on the unrolled code, countdown, dead-functions,
+ *   dead-globals, dce (dead values and stores)
+ * - O2: O1, inlining leaves up to INLINE_BUDGETS[2] IR instructions
+ *   larger than their call to save CALL/RET time, and unrolling within
+ *   UNROLL_BUDGETS[2]
+ *
+ * With a profile (--profile-use, see profile.ts), inline and loop-unroll
+ * spend the O2 budgets on hot code from level 1 and nothing on code that
+ * never ran, and block-layout runs last to make hot paths fall through.
+ *
+ * @fileoverview Ordered IR transformations with verification and stats
+ */
+
+import { IRModule, IRFunction, instructionCount } from './ir';
+import { verifyModule } from './verify';
+import { promoteLocals } from './ssa';
+import { propagateConstants } from './sccp';
+import { eliminateDeadCode, removeDeadFunctions, removeDeadGlobals } from './dce';
+import { inlineModule } from './inline';
+import { rotateLoops, hoistInvariants, unrollLoops, countDownLoops } from './loops';
+import { reduceStrength } from './strength';
+import { eliminateTailRecursion } from './tail';
+import { ProfileCounts, layoutBlocks } from './profile';
+import { PhaseTimer, measure } from '../time-report';
+
+export type OptimizationLevel = 0 | 1 | 2;
+
+export interface IRPass {
+  name: string;
+  /** Transforms one function; returns true if it changed anything */
+  run(fn: IRFunction, module: IRModule): boolean;
+}
+
+export interface IRModulePass {
+  name: string;
+  /** Transforms the whole module; returns the number of functions changed or removed */
+  runModule(module: IRModule): number;
+}
+
+export interface PassStats {
+  name: string;
+  wallMs: number;
+  /** Functions the pass changed (or, for module passes, removed) */
+  changed: number;
+  /** IR instructions (terminators included) removed, net of any added */
+  removed: number;
+}
+
+export interface PassManagerOptions {
+  /** Verify the module after every pass */
+  verify?: boolean;
+  timer?: PhaseTimer | null;
+}
+
+export class PassManager {
+  private passes: (IRPass | IRModulePass)[] = [];
+  private options: Required<PassManagerOptions>;
+  private stats: PassStats[] = [];
+
+  constructor(options: PassManagerOptions = {}) {
+    this.options = {
+      verify: options.verify !== undefined ? options.verify : true,
+      timer: options.timer || null
+    };
+  }
+
+  add(pass: IRPass | IRModulePass): this {
+    this.passes.push(pass);
+    return this;
+  }
+
+  getPasses(): string[] {
+    return this.passes.map((pass) => pass.name);
+  }
+
+  run(module: IRModule): PassStats[] {
+    this.stats = [];
+    if (this.options.verify) {
+      this.check(module, 'ir-build');
+    }
+
+    for (const pass of this.passes) {
+      const started = process.hrtime.bigint();
+      const run = () => {
+        const before = countInstructions(module);
+        const changed = 'runModule' in pass
+          ? pass.runModule(module)
+          : module.functions.filter((fn) => pass.run(fn, module)).length;
+        return { changed, removed: before - countInstructions(module) };
+      };
+      const counts = measure(this.options.timer, `ir:${pass.name}`, run, (result) => ({ ...result }));
+
+      this.stats.push({ name: pass.name, wallMs: Number(process.hrtime.bigint() - started) / 1e6, ...counts });
+      if (this.options.verify) {
+        this.check(module, pass.name);
+      }
+    }
+    return this.stats;
+  }
+
+  getStats(): PassStats[] {
+    return this.stats.slice();
+  }
+
+  private check(module: IRModule, after: string): void {
+    const errors = verifyModule(module);
+    if (errors.length > 0) {
+      throw new Error(`Invalid IR after ${after}: ${errors.join('; ')}`);
+    }
+  }
+}
+
+function countInstructions(module: IRModule): number {
+  return module.functions.reduce((total, fn) => total + instructionCount(fn), 0);
+}
+
+export const MEM2REG: IRPass = { name: 'mem2reg', run: promoteLocals };
+export const SCCP: IRPass = { name: 'sccp', run: propagateConstants };
+export const DCE: IRPass = { name: 'dce', run: eliminateDeadCode };
+export const DEAD_FUNCTIONS: IRModulePass = { name: 'dead-functions', runModule: removeDeadFunctions };
+export const DEAD_GLOBALS: IRModulePass = { name: 'dead-globals', runModule: removeDeadGlobals };
+export const LOOP_ROTATE: IRPass = { name: 'loop-rotate', run: rotateLoops };
+export const LICM: IRPass = { name: 'licm', run: hoistInvariants };
+export const COUNTDOWN: IRPass = { name: 'countdown', run: countDownLoops };
+export const STRENGTH: IRPass = { name: 'strength', run: reduceStrength };
+export const TAIL_RECURSION: IRPass = { name: 'tail-recursion', run: eliminateTailRecursion };
+
+/** IR instructions a leaf may cost beyond the call it replaces, per level */
+export const INLINE_BUDGETS: Record<OptimizationLevel, number> = { 0: 0, 1: 0, 2: 8 };
+
+/** IR instructions an unrolled loop may grow by, per level */
+export const UNROLL_BUDGETS: Record<OptimizationLevel, number> = { 0: 0, 1: 0, 2: 24 };
+
+export function unrollPass(sizeBudget: number, profile: ProfileCounts | null = null): IRPass {
+  return { name: 'loop-unroll', run: (fn) => unrollLoops(fn, sizeBudget, profile, UNROLL_BUDGETS[2]) };
+}
+
+export function inlinePass(sizeBudget: number, profile: ProfileCounts | null = null): IRModulePass {
+  return { name: 'inline', runModule: (module) => inlineModule(module, { sizeBudget, profile, hotSizeBudget: INLINE_BUDGETS[2] }) };
+}
+
+export function layoutPass(profile: ProfileCounts): IRPass {
+  return { name: 'block-layout', run: (fn) => layoutBlocks(fn, profile) };
+}
+
+/**
+ * The pipeline of an optimization level; `profile` makes it
+ * profile-guided (see the file header)
+ */
+export function createPassManager(level: OptimizationLevel, options: PassManagerOptions = {}, profile: ProfileCounts | null = null): PassManager {
+  const manager = new PassManager(options);
+  if (level >= 1) {
+    manager.add(inlinePass(INLINE_BUDGETS[level], profile));
+    manager.add(LOOP_ROTATE);
+    manager.add(MEM2REG);
+    manager.add(TAIL_RECURSION);
+    manager.add(SCCP);
+    manager.add(STRENGTH);
+    manager.add(LICM);
+    manager.add(unrollPass(UNROLL_BUDGETS[level], profile));
+    manager.add(SCCP);
+    manager.add(COUNTDOWN);
+    manager.add(DEAD_FUNCTIONS);
+    manager.add(DEAD_GLOBALS);
+    manager.add(DCE);
+  }
+  if (profile) {
+    manager.add(layoutPass(profile));
+  }
+  return manager;
+}
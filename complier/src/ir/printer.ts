@@ -0,0 +1,114 @@
+/**
+ * IR Printer
+ *
+ * Text form of the IR for --dump-ir and tests:
+ *
+ *     global counter: u8 = 0
+ *
+ *     function u8 add(u8 a, u8 b) {
+ *     bb0:
+ *       %0:u8 = param 0            ; a
+ *       %1:u8 = param 1            ; b
+ *       %2:u8 = add %0, %1
+ *       ret %2
+ *     }
+ *
+ * @fileoverview Human-readable IR dumps
+ */
+
+import { IRModule, IRFunction, IRVariable, Instruction, Terminator, Value, BasicBlock, typeSize } from './ir';
+
+export function formatValue(value: Value): string {
+  return value.kind === 'temp' ? `%${value.id}` : String(value.value);
+}
+
+function formatVariable(variable: IRVariable): string {
+  return variable.size > typeSize(variable.type) ? `${variable.name}: ${variable.type}[${variable.size / typeSize(variable.type)}]` : `${variable.name}: ${variable.type}`;
+}
+
+function label(block: BasicBlock): string {
+  return `bb${block.id}`;
+}
+
+export function formatInstruction(ins: Instruction | Terminator): string {
+  const def = (dst: { id: number; type: string }) => `%${dst.id}:${dst.type} = `;
+  const at = (variable: IRVariable, offset: number, index?: Value) =>
+    (offset > 0 ? `${variable.name}+${offset}` : variable.name) + (index ? `[${formatValue(index)}]` : '');
+
+  switch (ins.op) {
+    case 'binary':
+      return `${def(ins.dst)}${ins.operator} ${formatValue(ins.a)}, ${formatValue(ins.b)}`;
+    case 'unary':
+      return `${def(ins.dst)}${ins.operator} ${formatValue(ins.a)}`;
+    case 'copy':
+      return `${def(ins.dst)}copy ${formatValue(ins.src)}`;
+    case 'phi':
+      return `${def(ins.dst)}phi ${ins.incoming.map((incoming) => `[${formatValue(incoming.value)}, ${label(incoming.block)}]`).join(', ')}`;
+    case 'param':
+      return `${def(ins.dst)}param ${ins.index}`;
+    case 'load':
+      return `${def(ins.dst)}load ${at(ins.variable, ins.offset, ins.index)}`;
+    case 'store':
+      return `store ${at(ins.variable, ins.offset, ins.index)}, ${formatValue(ins.src)}`;
+    case 'call': {
+      const call = `call ${ins.callee}(${ins.args.map(formatValue).join(', ')})`;
+      return ins.dst ? `${def(ins.dst)}${call}` : call;
+    }
+    case 'in':
+      return `${def(ins.dst)}in ${ins.port}`;
+    case 'out':
+      return `out ${ins.port}, ${formatValue(ins.src)}`;
+    case 'delay':
+      return `delay ${formatValue(ins.src)}`;
+    case 'halt':
+      return 'halt';
+    case 'jmp':
+      return `jmp ${label(ins.target)}`;
+    case 'br':
+      return `br ${formatValue(ins.cond)}, ${label(ins.then)}, ${label(ins.else)}`;
+    case 'switch':
+      return `switch ${formatValue(ins.value)}, [${ins.targets.map(label).join(', ')}], ${label(ins.default)}`;
+    case 'ret':
+      return ins.value ? `ret ${formatValue(ins.value)}` : 'ret';
+  }
+}
+
+export function printFunction(fn: IRFunction): string {
+  const lines: string[] = [];
+  const params = fn.params.map((param) => `${param.type} ${param.name}`).join(', ');
+  lines.push(`function ${fn.returnType} ${fn.name}(${params}) {`);
+
+  const memory = fn.locals.map(formatVariable);
+  if (memory.length > 0) {
+    lines.push(`  ; memory: ${memory.join(', ')}`);
+  }
+
+  for (const block of fn.blocks) {
+    lines.push(`${label(block)}:`);
+    for (const ins of block.instructions) {
+      const text = formatInstruction(ins);
+      const dst = 'dst' in ins && ins.dst ? ins.dst : null;
+      lines.push(dst && dst.name ? `  ${text.padEnd(28)} ; ${dst.name}` : `  ${text}`);
+    }
+    if (block.terminator) {
+      lines.push(`  ${formatInstruction(block.terminator)}`);
+    }
+  }
+
+  lines.push('}');
+  return lines.join('\n');
+}
+
+export function printModule(module: IRModule): string {
+  const sections: string[] = [];
+
+  if (module.globals.length > 0) {
+    sections.push(module.globals.map((global) =>
+      `global ${formatVariable(global)}${global.initial !== undefined ? ` = ${global.initial}` : ''}`
+    ).join('\n'));
+  }
+  for (const fn of module.functions) {
+    sections.push(printFunction(fn));
+  }
+  return sections.join('\n\n') + '\n';
+}
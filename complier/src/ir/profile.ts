@@ -0,0 +1,183 @@
+/**
+ * Block Execution Profiles
+ *
+ * Profile-guided optimization takes three steps:
+ *
+ * 1. `compile --profile-generate` labels the first instruction of every
+ *    block and writes a block map (`<name>.blocks.json`) with its program
+ *    address. The code is otherwise the normal build, so nothing is
+ *    instrumented and the program runs at full speed
+ * 2. `run --profile <name>.blocks.json` runs the image in the emulator on
+ *    the given input-port vectors and adds how often each block started to
+ *    `<name>.profile.json`; runs with different inputs accumulate. The map
+ *    records a hash of its image, and a map from another build is refused
+ * 3. `compile --profile-use <name>.profile.json` feeds the counts back:
+ *    - inline: calls in hot blocks may grow the caller by the -O2 budget,
+ *      calls in blocks that never ran only inline when that does not
+ *      grow it
+ *    - loop-unroll: the same for loops, by the count of their body
+ *    - block-layout: blocks are chained so that the hotter successor of
+ *      every branch falls through
+ *    - the lowering weighs accesses by block counts rather than loop
+ *      nesting when it keeps values in B
+ *
+ * Counts are keyed by the builder block each block came from
+ * (BasicBlock.origin, `<function>.bb<n>`), which depends only on the
+ * source: a profile recorded at one optimization level applies at any
+ * other, as long as the source is unchanged. Copies made by inlining
+ * share the origin of the callee's block, so its count is their total.
+ * Blocks the passes create (split edges, preheaders) have no origin and
+ * take the count of a neighbour. A block that emits no code starts where
+ * the next one does and reports that count.
+ *
+ * @fileoverview Block maps, execution counts and profile-guided block layout
+ */
+
+import { IRFunction, BasicBlock } from './ir';
+import { successors, predecessors } from './cfg';
+
+/** Program address of each labelled block of a compiled image */
+export interface BlockMap {
+  /** imageHash() of the image the addresses belong to */
+  image: string;
+  blocks: { origin: string; address: number }[];
+}
+
+/** Executions per block origin, accumulated over emulator runs */
+export interface BlockProfile {
+  runs: number;
+  counts: Record<string, number>;
+}
+
+/** A block is hot when it ran at least this share of the hottest block's count */
+export const HOT_FRACTION = 1 / 8;
+
+/**
+ * Size and FNV-1a hash of an image, so a block map can be matched to the
+ * build that wrote it
+ */
+export function imageHash(binary: ArrayLike<number>): string {
+  let hash = 0x811C9DC5;
+  for (let i = 0; i < binary.length; i++) {
+    hash = Math.imul(hash ^ binary[i], 0x01000193) >>> 0;
+  }
+  return `${binary.length}:${hash.toString(16).padStart(8, '0')}`;
+}
+
+/**
+ * Adds the block counts of one run of `image` to `into`: `executions`
+ * holds how often an instruction started at each program address (see
+ * EmulatorResult.executions). Throws if `map` was written for another
+ * image, whose addresses would credit the wrong blocks.
+ */
+export function recordProfile(
+  map: BlockMap,
+  image: ArrayLike<number>,
+  executions: ArrayLike<number>,
+  into: BlockProfile = { runs: 0, counts: {} }
+): BlockProfile {
+  if (map.image !== imageHash(image)) {
+    throw new Error('Block map does not belong to this image; rebuild it with --profile-generate');
+  }
+
+  const counts = { ...into.counts };
+  for (const { origin, address } of map.blocks) {
+    counts[origin] = (counts[origin] || 0) + (executions[address] || 0);
+  }
+  return { runs: into.runs + 1, counts };
+}
+
+/**
+ * Lookups into a profile for the passes that use one
+ */
+export class ProfileCounts {
+  private counts: Record<string, number>;
+  private hottest: number;
+
+  constructor(profile: BlockProfile) {
+    this.counts = profile.counts;
+    this.hottest = Object.keys(profile.counts).reduce((max, origin) => Math.max(max, profile.counts[origin]), 0);
+  }
+
+  /**
+   * Recorded count of a block, or null if the profile has none
+   */
+  count(block: BasicBlock): number | null {
+    const count = block.origin !== undefined ? this.counts[block.origin] : undefined;
+    return count !== undefined ? count : null;
+  }
+
+  isHot(block: BasicBlock): boolean {
+    const count = this.count(block);
+    return count !== null && count > 0 && count >= this.hottest * HOT_FRACTION;
+  }
+
+  /**
+   * Size budget for code in `block`: `hot` if the block is hot, 0 if it
+   * never ran, else `normal`
+   */
+  budget(block: BasicBlock, normal: number, hot: number): number {
+    if (this.isHot(block)) return Math.max(normal, hot);
+    return this.count(block) === 0 ? 0 : normal;
+  }
+
+  /**
+   * Counts of every block of `fn`; blocks without one take the largest
+   * count among their neighbours that have one, else 0
+   */
+  blockCounts(fn: IRFunction): Map<BasicBlock, number> {
+    const counts = new Map<BasicBlock, number>();
+    for (const block of fn.blocks) {
+      const count = this.count(block);
+      if (count !== null) counts.set(block, count);
+    }
+
+    const preds = predecessors(fn);
+    let changed = true;
+    while (changed) {
+      changed = false;
+      for (const block of fn.blocks) {
+        if (counts.has(block)) continue;
+        const known = [...preds.get(block)!, ...successors(block)].filter((neighbour) => counts.has(neighbour));
+        if (known.length > 0) {
+          counts.set(block, Math.max(...known.map((neighbour) => counts.get(neighbour)!)));
+          changed = true;
+        }
+      }
+    }
+    for (const block of fn.blocks) {
+      if (!counts.has(block)) counts.set(block, 0);
+    }
+    return counts;
+  }
+}
+
+/**
+ * Reorders the blocks of `fn` into chains: each block is followed by its
+ * hottest successor not placed yet. A chain that cannot continue goes on
+ * with the hottest block a placed block branches to, so code after a loop
+ * still follows its exit. The entry stays first; ties keep the existing
+ * order. Returns true if the order changed.
+ */
+export function layoutBlocks(fn: IRFunction, profile: ProfileCounts): boolean {
+  const counts = profile.blockCounts(fn);
+  const position = new Map(fn.blocks.map((block, index) => [block, index] as [BasicBlock, number]));
+  const hotter = (a: BasicBlock, b: BasicBlock) => counts.get(b)! - counts.get(a)! || position.get(a)! - position.get(b)!;
+
+  const placed = new Set<BasicBlock>();
+  const reached = new Set<BasicBlock>();
+  const order: BasicBlock[] = [];
+  let next: BasicBlock | undefined = fn.blocks[0];
+  while (next) {
+    order.push(next);
+    placed.add(next);
+    successors(next).forEach((block) => reached.add(block));
+    next = successors(next).filter((block) => !placed.has(block)).sort(hotter)[0]
+      || [...reached].filter((block) => !placed.has(block)).sort(hotter)[0]
+      || fn.blocks.filter((block) => !placed.has(block)).sort(hotter)[0];
+  }
+
+  const changed = order.some((block, index) => block !== fn.blocks[index]);
+  fn.blocks = order;
+  return changed;
+}
@@ -0,0 +1,306 @@
+/**
+ * Runtime Library
+ *
+ * The CPU has no multiply, divide or shift instructions, so these
+ * operations call hand-written routines. Only the routines a program uses
+ * (and the ones they build on) are linked, after the program's functions.
+ *
+ * Calling convention, like compiled functions: the caller stores the
+ * operands in the routine's parameter bytes X and Y, CALLs it, and gets
+ * the result in A. The routines use a few more scratch bytes of their own
+ * (see RUNTIME_SCRATCH); none of them are touched by compiled code, so a
+ * routine can run while any temporary is live.
+ *
+ * - RT_MUL8: X * Y, low byte. Shift-and-add over the multiplier's bits
+ *   from the lowest, stopping at its highest set bit
+ * - RT_DIV8: X / Y unsigned, remainder left in R. Restoring division, one
+ *   quotient bit per iteration; x / 0 is 255 and x % 0 is x
+ * - RT_SDIV8: X / Y int8, truncating toward zero, remainder in R with the
+ *   sign of X. Divides the magnitudes with RT_DIV8, then fixes the signs
+ * - RT_SHL8: X << Y, one ADD per bit until X is 0
+ * - RT_SHR8: X >> Y unsigned. With no right shift in the ISA, the 8 - Y
+ *   bits that stay are shifted out of the top of X into the result
+ * - RT_SAR8: X >> Y int8; a negative X is shifted as ~(~X >> Y)
+ *
+ * @fileoverview Multiply, divide and shift routines linked on demand
+ */
+
+import { AssemblyItem } from '../assembly-stream';
+
+/** Scratch byte offsets from the start of the runtime area */
+export const RUNTIME_SCRATCH: Record<string, number> = {
+  /** First operand; the dividend, then the quotient, of RT_DIV8 */
+  X: 0,
+  /** Second operand */
+  Y: 1,
+  /** Result being built; the remainder of RT_DIV8 and RT_SDIV8 */
+  R: 2,
+  /** Loop counter or bit mask */
+  N: 3,
+  /** Signs of RT_SDIV8's results */
+  S: 4
+};
+
+export interface RuntimeRoutine {
+  label: string;
+  /** Routines it calls or jumps into */
+  uses: string[];
+  /** Scratch bytes from the start of the area it touches, its callees' included */
+  scratch: number;
+  /** Assembly; `$X` etc. are scratch bytes */
+  source: string;
+}
+
+export const RUNTIME_ROUTINES: Record<string, RuntimeRoutine> = {
+  RT_MUL8: {
+    label: 'RT_MUL8',
+    uses: [],
+    scratch: 4,
+    source: `
+      LDI 0
+      STA $R
+      LDI 1
+      STA $N          ; mask of the multiplier bit at hand
+    RT_MUL8_LOOP:
+      LDA $Y
+      AND $N
+      JZ RT_MUL8_SHIFT
+      LDA $Y
+      XOR $N
+      STA $Y          ; bit done
+      LDA $R
+      ADD $X
+      STA $R
+    RT_MUL8_SHIFT:
+      LDA $Y
+      ORI 0
+      JZ RT_MUL8_DONE ; no multiplier bits left
+      LDA $X
+      ADD $X
+      STA $X
+      LDA $N
+      ADD $N
+      STA $N
+      JMP RT_MUL8_LOOP
+    RT_MUL8_DONE:
+      LDA $R
+      RET
+    `
+  },
+  RT_DIV8: {
+    label: 'RT_DIV8',
+    uses: [],
+    scratch: 4,
+    source: `
+      LDI 0
+      STA $R
+      LDI 8
+      STA $N
+    RT_DIV8_LOOP:
+      LDA $R
+      ADD $R
+      STA $R          ; remainder <<= 1
+      LDA $X
+      JC RT_DIV8_WIDE
+      ADD $X
+      STA $X          ; next dividend bit into C
+      LDA $R
+      JNC RT_DIV8_TEST
+      ORI 1
+      STA $R
+    RT_DIV8_TEST:
+      SUB $Y
+      JC RT_DIV8_NEXT ; remainder < divisor: quotient bit 0
+    RT_DIV8_FITS:
+      STA $R
+      LDA $X
+      ORI 1
+      STA $X          ; quotient bit 1
+    RT_DIV8_NEXT:
+      LDA $N
+      SUI 1
+      STA $N
+      JNZ RT_DIV8_LOOP
+      LDA $X
+      RET
+    RT_DIV8_WIDE:     ; 9-bit remainder, certainly >= divisor
+      ADD $X
+      STA $X
+      LDA $R
+      JNC RT_DIV8_SUB
+      ORI 1
+    RT_DIV8_SUB:
+      SUB $Y
+      JMP RT_DIV8_FITS
+    `
+  },
+  RT_SDIV8: {
+    label: 'RT_SDIV8',
+    uses: ['RT_DIV8'],
+    scratch: 5,
+    source: `
+      LDA $X
+      XOR $Y
+      ANI 0x80
+      STA $S          ; bit 7: quotient negative
+      LDA $Y
+      ANI 0x80
+      JZ RT_SDIV8_X
+      LDA $Y
+      NOT
+      ADI 1
+      STA $Y
+    RT_SDIV8_X:
+      LDA $X
+      ANI 0x80
+      JZ RT_SDIV8_DIVIDE
+      LDA $S
+      ORI 1
+      STA $S          ; bit 0: remainder negative
+      LDA $X
+      NOT
+      ADI 1
+      STA $X
+    RT_SDIV8_DIVIDE:
+      CALL RT_DIV8
+      LDA $S
+      ANI 1
+      JZ RT_SDIV8_QUOTIENT
+      LDA $R
+      NOT
+      ADI 1
+      STA $R
+    RT_SDIV8_QUOTIENT:
+      LDA $S
+      ANI 0x80
+      LDA $X
+      JZ RT_SDIV8_DONE
+      NOT
+      ADI 1
+    RT_SDIV8_DONE:
+      RET
+    `
+  },
+  RT_SHL8: {
+    label: 'RT_SHL8',
+    uses: [],
+    scratch: 2,
+    source: `
+      LDA $Y
+      ORI 0
+      JZ RT_SHL8_DONE
+    RT_SHL8_LOOP:
+      LDA $X
+      ADD $X
+      STA $X
+      JZ RT_SHL8_DONE ; every bit shifted out
+      LDA $Y
+      SUI 1
+      STA $Y
+      JNZ RT_SHL8_LOOP
+    RT_SHL8_DONE:
+      LDA $X
+      RET
+    `
+  },
+  RT_SHR8: {
+    label: 'RT_SHR8',
+    uses: [],
+    scratch: 4,
+    source: `
+      LDI 0
+      STA $R
+      LDI 8
+      SUB $Y
+      JC RT_SHR8_DONE ; shifted out entirely
+      JZ RT_SHR8_DONE
+      STA $N          ; bits that stay
+    RT_SHR8_LOOP:
+      LDA $R
+      ADD $R
+      STA $R
+      LDA $X
+      ADD $X
+      STA $X          ; top bit into C
+      JNC RT_SHR8_NEXT
+      LDA $R
+      ORI 1
+      STA $R
+    RT_SHR8_NEXT:
+      LDA $N
+      SUI 1
+      STA $N
+      JNZ RT_SHR8_LOOP
+    RT_SHR8_DONE:
+      LDA $R
+      RET
+    `
+  },
+  RT_SAR8: {
+    label: 'RT_SAR8',
+    uses: ['RT_SHR8'],
+    scratch: 4,
+    source: `
+      LDA $X
+      ANI 0x80
+      JZ RT_SHR8
+      LDA $X
+      NOT
+      STA $X
+      CALL RT_SHR8
+      NOT
+      RET
+    `
+  }
+};
+
+/**
+ * The given routines plus everything they use, in library order
+ */
+export function linkRoutines(names: Iterable<string>): RuntimeRoutine[] {
+  const linked = new Set<string>();
+  const add = (name: string) => {
+    if (linked.has(name)) return;
+    linked.add(name);
+    RUNTIME_ROUTINES[name].uses.forEach(add);
+  };
+  for (const name of names) add(name);
+  return Object.keys(RUNTIME_ROUTINES).filter((name) => linked.has(name)).map((name) => RUNTIME_ROUTINES[name]);
+}
+
+/**
+ * Scratch bytes the given routines need
+ */
+export function runtimeScratchSize(routines: RuntimeRoutine[]): number {
+  return routines.reduce((size, routine) => Math.max(size, routine.scratch), 0);
+}
+
+/**
+ * Assembly items of a routine whose scratch area starts at `base`
+ */
+export function assembleRoutine(routine: RuntimeRoutine, base: number): AssemblyItem[] {
+  const items: AssemblyItem[] = [{ kind: 'comment', text: `Runtime: ${routine.label}`, indent: false }, { kind: 'label', name: routine.label }];
+  for (const raw of routine.source.split('\n')) {
+    const separator = raw.indexOf(';');
+    const line = (separator >= 0 ? raw.slice(0, separator) : raw).trim();
+    const comment = separator >= 0 ? raw.slice(separator + 1).trim() : undefined;
+    if (line === '') continue;
+
+    if (line.endsWith(':')) {
+      items.push({ kind: 'label', name: line.slice(0, -1) });
+      continue;
+    }
+    const [instruction, operand] = line.split(/\s+/);
+    const operands: (string | number)[] = [];
+    if (operand !== undefined) {
+      if (operand.startsWith('$')) {
+        operands.push(base + RUNTIME_SCRATCH[operand.slice(1)]);
+      } else {
+        operands.push(/^(0x[0-9a-f]+|\d+)$/i.test(operand) ? Number(operand) : operand);
+      }
+    }
+    items.push({ kind: 'instruction', instruction, operands, comment });
+  }
+  items.push({ kind: 'blank' });
+  return items;
+}
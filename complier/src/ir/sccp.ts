@@ -0,0 +1,339 @@
+/**
+ * Sparse Conditional Constant Propagation
+ *
+ * Wegman-Zadeck SCCP over SSA form. Every temporary starts unknown and
+ * only moves down the lattice (unknown → constant → varying); blocks are
+ * evaluated only once an edge into them is found executable, so a branch
+ * on a constant condition never contributes values from its dead side.
+ * Afterwards the function is rewritten:
+ *
+ * - Uses of constant temporaries become constants and their definitions
+ *   are deleted
+ * - Branches and switches on constants become jumps; blocks no longer
+ *   reachable are removed along with their phi inputs
+ * - Loads and stores at a constant index use a fixed offset instead
+ * - Operations with an identity operand (x + 0, x - 0, x | 0, x ^ 0,
+ *   x & ~0, x * 1, x / 1, x << 0, x >> 0) are replaced by the other
+ *   operand
+ *
+ * Arithmetic wraps at the operands' width (8 or 16 bits), which is the
+ * same for signed and unsigned types; comparisons are unsigned like the
+ * code the lowering emits for them (the builder biases signed operands
+ * first).
+ *
+ * @fileoverview Constant folding and propagation with branch elimination
+ */
+
+import {
+  IRFunction, BasicBlock, Instruction, Terminator, Value, BinaryOp, UnaryOp,
+  constant, typeMask, definedTemp, usedValues, hasSideEffects, switchTarget
+} from './ir';
+import { successors, removeUnreachableBlocks } from './cfg';
+import { replaceUses, removeTrivialPhis } from './ssa';
+
+/** Lattice value of a temporary that can take more than one value */
+const VARYING = -1;
+
+/** Signed value of a byte (mask 0xFF) or 16-bit word (0xFFFF) */
+function signed(value: number, mask: number): number {
+  const sign = (mask + 1) >> 1;
+  return value & sign ? value - mask - 1 : value;
+}
+
+/**
+ * Folds like the runtime routines compute, division by zero included
+ * (see runtime.ts). `mask` is the operands' typeMask().
+ */
+export function foldBinary(operator: BinaryOp, a: number, b: number, mask: number = 0xFF): number {
+  const bits = mask === 0xFF ? 8 : 16;
+  switch (operator) {
+    case 'add': return (a + b) & mask;
+    case 'sub': return (a - b) & mask;
+    case 'mul': return Math.imul(a, b) & mask;
+    case 'div': return b === 0 ? mask : Math.floor(a / b);
+    case 'mod': return b === 0 ? a : a % b;
+    case 'sdiv': return b === 0 ? (signed(a, mask) < 0 ? 1 : mask) : Math.trunc(signed(a, mask) / signed(b, mask)) & mask;
+    case 'smod': return b === 0 ? a : (signed(a, mask) % signed(b, mask)) & mask;
+    case 'shl': return b >= bits ? 0 : (a << b) & mask;
+    case 'shr': return b >= bits ? 0 : a >> b;
+    case 'sar': return (signed(a, mask) >> Math.min(b, bits - 1)) & mask;
+    case 'and': return a & b;
+    case 'or': return a | b;
+    case 'xor': return a ^ b;
+    case 'eq': return a === b ? 1 : 0;
+    case 'ne': return a !== b ? 1 : 0;
+    case 'lt': return a < b ? 1 : 0;
+    case 'le': return a <= b ? 1 : 0;
+    case 'gt': return a > b ? 1 : 0;
+    case 'ge': return a >= b ? 1 : 0;
+  }
+}
+
+/**
+ * `mask` is the result's typeMask(); zext, sext and trunc widen from or
+ * narrow to a byte
+ */
+export function foldUnary(operator: UnaryOp, a: number, mask: number = 0xFF): number {
+  switch (operator) {
+    case 'not': return ~a & mask;
+    case 'neg': return -a & mask;
+    case 'lnot': return a === 0 ? 1 : 0;
+    case 'zext': return a;
+    case 'sext': return a & 0x80 ? a | 0xFF00 : a;
+    case 'trunc': return a & 0xFF;
+  }
+}
+
+/**
+ * Result of a binary operation known from one operand alone, e.g. x & 0
+ * or x < 0
+ */
+function absorbing(operator: BinaryOp, a: Value, b: Value, valueOf: (value: Value) => number | undefined): number | undefined {
+  const mask = typeMask(a.type);
+  const bits = mask === 0xFF ? 8 : 16;
+  if (a.kind === 'temp' && b.kind === 'temp' && a.id === b.id) {
+    switch (operator) {
+      case 'sub': case 'xor': case 'ne': case 'lt': case 'gt': return 0;
+      case 'eq': case 'le': case 'ge': return 1;
+    }
+  }
+  const left = valueOf(a);
+  const right = valueOf(b);
+  switch (operator) {
+    case 'and': case 'mul': return left === 0 || right === 0 ? 0 : undefined;
+    case 'mod': case 'smod': case 'sar':
+      return left === 0 ? 0 : undefined;
+    case 'shl': case 'shr':
+      return left === 0 || (right !== undefined && right !== VARYING && right >= bits) ? 0 : undefined;
+    case 'or': return left === mask || right === mask ? mask : undefined;
+    case 'lt': return right === 0 || left === mask ? 0 : undefined;
+    case 'ge': return right === 0 || left === mask ? 1 : undefined;
+    case 'gt': return left === 0 || right === mask ? 0 : undefined;
+    case 'le': return left === 0 || right === mask ? 1 : undefined;
+    default: return undefined;
+  }
+}
+
+/**
+ * Runs SCCP on one function; returns true if it changed anything
+ */
+export function propagateConstants(fn: IRFunction): boolean {
+  // Missing: not yet known; 0-255: constant; VARYING
+  const values = new Map<number, number>();
+  const executable = new Set<BasicBlock>();
+  const edges = new Set<string>();
+  const users = new Map<number, { ins: Instruction | Terminator; block: BasicBlock }[]>();
+  const flowWork: [BasicBlock, BasicBlock][] = [];
+  const ssaWork: { ins: Instruction | Terminator; block: BasicBlock }[] = [];
+
+  for (const block of fn.blocks) {
+    for (const ins of [...block.instructions, block.terminator!]) {
+      for (const value of usedValues(ins)) {
+        if (value.kind !== 'temp') continue;
+        if (!users.has(value.id)) users.set(value.id, []);
+        users.get(value.id)!.push({ ins, block });
+      }
+    }
+  }
+
+  const valueOf = (value: Value): number | undefined => value.kind === 'const' ? value.value : values.get(value.id);
+  const edgeKey = (from: BasicBlock, to: BasicBlock) => `${from.id}>${to.id}`;
+
+  const evaluate = (ins: Instruction, block: BasicBlock): number | undefined => {
+    switch (ins.op) {
+      case 'binary': {
+        const known = absorbing(ins.operator, ins.a, ins.b, valueOf);
+        if (known !== undefined) return known;
+        const a = valueOf(ins.a);
+        const b = valueOf(ins.b);
+        if (a === VARYING || b === VARYING) return VARYING;
+        return a === undefined || b === undefined ? undefined : foldBinary(ins.operator, a, b, typeMask(ins.a.type));
+      }
+      case 'unary': {
+        const a = valueOf(ins.a);
+        return a === undefined || a === VARYING ? a : foldUnary(ins.operator, a, typeMask(ins.dst.type));
+      }
+      case 'copy':
+        return valueOf(ins.src);
+      case 'phi': {
+        let merged: number | undefined;
+        for (const incoming of ins.incoming) {
+          if (!edges.has(edgeKey(incoming.block, block))) continue;
+          const value = valueOf(incoming.value);
+          if (value === undefined) continue;
+          if (merged !== undefined && merged !== value) return VARYING;
+          merged = value;
+        }
+        return merged;
+      }
+      default:
+        return VARYING;
+    }
+  };
+
+  const visit = (ins: Instruction | Terminator, block: BasicBlock) => {
+    if (ins.op === 'jmp') {
+      flowWork.push([block, ins.target]);
+      return;
+    }
+    if (ins.op === 'br') {
+      const cond = valueOf(ins.cond);
+      if (cond === VARYING || cond === 0) flowWork.push([block, ins.else]);
+      if (cond === VARYING || (cond !== undefined && cond !== 0)) flowWork.push([block, ins.then]);
+      return;
+    }
+    if (ins.op === 'switch') {
+      const value = valueOf(ins.value);
+      if (value === VARYING) {
+        for (const target of [...ins.targets, ins.default]) flowWork.push([block, target]);
+      } else if (value !== undefined) {
+        flowWork.push([block, switchTarget(ins, value)]);
+      }
+      return;
+    }
+    if (ins.op === 'ret') return;
+
+    const dst = definedTemp(ins);
+    if (!dst) return;
+    const current = values.get(dst.id);
+    let next = evaluate(ins, block);
+    if (next === undefined || current === VARYING || next === current) return;
+    if (current !== undefined) next = VARYING;
+
+    values.set(dst.id, next);
+    for (const user of users.get(dst.id) || []) {
+      ssaWork.push(user);
+    }
+  };
+
+  const entry = fn.blocks[0];
+  executable.add(entry);
+  entry.instructions.forEach((ins) => visit(ins, entry));
+  visit(entry.terminator!, entry);
+
+  while (flowWork.length > 0 || ssaWork.length > 0) {
+    while (flowWork.length > 0) {
+      const [from, to] = flowWork.pop()!;
+      const key = edgeKey(from, to);
+      if (edges.has(key)) continue;
+      edges.add(key);
+
+      if (executable.has(to)) {
+        to.instructions.filter((ins) => ins.op === 'phi').forEach((ins) => visit(ins, to));
+      } else {
+        executable.add(to);
+        to.instructions.forEach((ins) => visit(ins, to));
+        visit(to.terminator!, to);
+      }
+    }
+    const item = ssaWork.pop();
+    if (item && executable.has(item.block)) {
+      visit(item.ins, item.block);
+    }
+  }
+
+  return rewrite(fn, values, executable);
+}
+
+function rewrite(fn: IRFunction, values: Map<number, number>, executable: Set<BasicBlock>): boolean {
+  let changed = false;
+
+  // Branches and switches decided by a constant
+  for (const block of fn.blocks) {
+    const terminator = block.terminator!;
+    if (!executable.has(block) || (terminator.op !== 'br' && terminator.op !== 'switch')) continue;
+    const value = terminator.op === 'br' ? terminator.cond : terminator.value;
+    const known = value.kind === 'const' ? value.value : values.get(value.id);
+    if (known === undefined || known === VARYING) continue;
+
+    let taken: BasicBlock;
+    if (terminator.op === 'br') {
+      taken = known !== 0 ? terminator.then : terminator.else;
+    } else {
+      taken = switchTarget(terminator, known);
+    }
+    for (const dropped of successors(block)) {
+      if (dropped === taken) continue;
+      for (const ins of dropped.instructions) {
+        if (ins.op === 'phi') ins.incoming = ins.incoming.filter((incoming) => incoming.block !== block);
+      }
+    }
+    block.terminator = { op: 'jmp', target: taken };
+    changed = true;
+  }
+  changed = removeUnreachableBlocks(fn) || changed;
+
+  // Constant temporaries
+  const replacements = new Map<number, Value>();
+  for (const block of fn.blocks) {
+    block.instructions = block.instructions.filter((ins) => {
+      const dst = definedTemp(ins);
+      const value = dst ? values.get(dst.id) : undefined;
+      if (!dst || value === undefined || value === VARYING || hasSideEffects(ins)) return true;
+      replacements.set(dst.id, constant(value, dst.type));
+      return false;
+    });
+  }
+  replaceUses(fn, replacements);
+  changed = replacements.size > 0 || changed;
+
+  changed = foldIndices(fn) || changed;
+  changed = removeIdentities(fn) || changed;
+  changed = removeTrivialPhis(fn) || changed;
+  return changed;
+}
+
+/**
+ * A constant index of a load or store becomes part of its offset
+ */
+function foldIndices(fn: IRFunction): boolean {
+  let changed = false;
+  for (const block of fn.blocks) {
+    for (const ins of block.instructions) {
+      if ((ins.op === 'load' || ins.op === 'store') && ins.index && ins.index.kind === 'const') {
+        ins.offset += ins.index.value;
+        delete ins.index;
+        changed = true;
+      }
+    }
+  }
+  return changed;
+}
+
+/**
+ * x + 0, x - 0, x | 0, x ^ 0, x & ~0, x * 1, x / 1, x << 0 and x >> 0
+ * are x
+ */
+function removeIdentities(fn: IRFunction): boolean {
+  const replacements = new Map<number, Value>();
+  const isConst = (value: Value, n: number) => value.kind === 'const' && value.value === n;
+
+  for (const block of fn.blocks) {
+    block.instructions = block.instructions.filter((ins) => {
+      if (ins.op !== 'binary') return true;
+      let same: Value | null = null;
+      switch (ins.operator) {
+        case 'add': case 'or': case 'xor':
+          same = isConst(ins.b, 0) ? ins.a : isConst(ins.a, 0) ? ins.b : null;
+          break;
+        case 'sub': case 'shl': case 'shr': case 'sar':
+          same = isConst(ins.b, 0) ? ins.a : null;
+          break;
+        case 'mul':
+          same = isConst(ins.b, 1) ? ins.a : isConst(ins.a, 1) ? ins.b : null;
+          break;
+        case 'div': case 'sdiv':
+          same = isConst(ins.b, 1) ? ins.a : null;
+          break;
+        case 'and':
+          same = isConst(ins.b, typeMask(ins.a.type)) ? ins.a : isConst(ins.a, typeMask(ins.a.type)) ? ins.b : null;
+          break;
+      }
+      if (!same) return true;
+      replacements.set(ins.dst.id, same);
+      return false;
+    });
+  }
+  replaceUses(fn, replacements);
+  return replacements.size > 0;
+}
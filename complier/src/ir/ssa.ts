@@ -0,0 +1,333 @@
+/**
+ * SSA Construction and Destruction
+ *
+ * mem2reg promotes scalar locals and parameters from memory to SSA
+ * temporaries:
+ *
+ * 1. Phi placement on the iterated dominance frontier of each variable's
+ *    stores (Cytron et al.), pruned to blocks where the variable is live
+ *    on entry
+ * 2. Renaming by a walk over the dominator tree; every load is replaced by
+ *    the reaching definition and every store disappears
+ * 3. Removal of trivial phis (all inputs equal, or the phi itself)
+ *
+ * A parameter's entry definition is a `param` instruction; any other local
+ * read before it is written reads 0. Arrays, and anything accessed with
+ * a variable index, stay in memory.
+ *
+ * Before lowering, destructSSA replaces phis with copies at the end of
+ * each predecessor. Critical edges into phi blocks are split first, and
+ * the copies of one edge are sequentialized as a parallel copy (swaps go
+ * through a fresh temporary), which avoids the lost-copy and swap
+ * problems.
+ *
+ * @fileoverview Promotion of locals to SSA form and phi elimination
+ */
+
+import {
+  IRFunction, IRVariable, BasicBlock, Instruction, Value, Temp,
+  constant, typeSize, newTemp, mapUsedValues, definedTemp
+} from './ir';
+import { immediateDominators, dominanceFrontiers, dominatorTree, successors, predecessors, removeUnreachableBlocks, retarget } from './cfg';
+
+/**
+ * Runs mem2reg on one function; returns true if anything was promoted
+ */
+export function promoteLocals(fn: IRFunction): boolean {
+  removeUnreachableBlocks(fn);
+  const promotable = new Set(fn.locals.filter((local) => local.size === typeSize(local.type)));
+  for (const block of fn.blocks) {
+    for (const ins of block.instructions) {
+      if ((ins.op === 'load' || ins.op === 'store') && ins.index) promotable.delete(ins.variable);
+    }
+  }
+  if (promotable.size === 0) return false;
+
+  const idom = immediateDominators(fn);
+  const frontiers = dominanceFrontiers(fn, idom);
+  const liveIn = liveOnEntry(fn, promotable);
+
+  // 1. Phi placement
+  const phiVariables = new Map<Instruction, IRVariable>();
+  for (const variable of promotable) {
+    const defBlocks = fn.blocks.filter((block) =>
+      block.instructions.some((ins) => ins.op === 'store' && ins.variable === variable)
+    );
+    const hasPhi = new Set<BasicBlock>();
+    const worklist = defBlocks.slice();
+
+    while (worklist.length > 0) {
+      const block = worklist.pop()!;
+      for (const frontier of frontiers.get(block) || []) {
+        if (hasPhi.has(frontier) || !liveIn.get(frontier)!.has(variable)) continue;
+        hasPhi.add(frontier);
+
+        const phi: Instruction = { op: 'phi', dst: newTemp(fn, variable.type, variable.name), incoming: [] };
+        frontier.instructions.unshift(phi);
+        phiVariables.set(phi, variable);
+        worklist.push(frontier);
+      }
+    }
+  }
+
+  // Entry definitions: parameters arrive in their slot (locals list them
+  // first, in order), others read as 0
+  const entry = fn.blocks[0];
+  const stacks = new Map<IRVariable, Value[]>();
+  const entryDefs: Instruction[] = [];
+  for (const variable of promotable) {
+    if (variable.paramIndex !== undefined) {
+      const dst = newTemp(fn, variable.type, variable.name);
+      entryDefs.push({ op: 'param', dst, index: variable.paramIndex });
+      stacks.set(variable, [dst]);
+    } else {
+      stacks.set(variable, [constant(0, variable.type)]);
+    }
+  }
+  entry.instructions.unshift(...entryDefs);
+
+  // 2. Renaming over the dominator tree
+  const replacements = new Map<number, Value>();
+  const children = dominatorTree(idom);
+
+  const rename = (block: BasicBlock): void => {
+    const pushed: IRVariable[] = [];
+    const kept: Instruction[] = [];
+
+    for (const ins of block.instructions) {
+      if (ins.op === 'phi' && phiVariables.has(ins)) {
+        const variable = phiVariables.get(ins)!;
+        stacks.get(variable)!.push(ins.dst);
+        pushed.push(variable);
+        kept.push(ins);
+      } else if (ins.op === 'load' && promotable.has(ins.variable)) {
+        const stack = stacks.get(ins.variable)!;
+        replacements.set(ins.dst.id, stack[stack.length - 1]);
+      } else if (ins.op === 'store' && promotable.has(ins.variable)) {
+        stacks.get(ins.variable)!.push(resolve(replacements, ins.src));
+        pushed.push(ins.variable);
+      } else {
+        kept.push(ins);
+      }
+    }
+    block.instructions = kept;
+
+    for (const successor of successors(block)) {
+      for (const ins of successor.instructions) {
+        if (ins.op !== 'phi' || !phiVariables.has(ins)) continue;
+        const stack = stacks.get(phiVariables.get(ins)!)!;
+        ins.incoming.push({ block, value: stack[stack.length - 1] });
+      }
+    }
+
+    for (const child of children.get(block) || []) {
+      rename(child);
+    }
+    for (const variable of pushed) {
+      stacks.get(variable)!.pop();
+    }
+  };
+  rename(entry);
+
+  replaceUses(fn, replacements);
+  removeTrivialPhis(fn);
+  fn.locals = fn.locals.filter((local) => !promotable.has(local));
+  return true;
+}
+
+/**
+ * Variables whose value on entry to each block may be read (upward-exposed
+ * loads), used to avoid placing dead phis
+ */
+function liveOnEntry(fn: IRFunction, variables: Set<IRVariable>): Map<BasicBlock, Set<IRVariable>> {
+  const uses = new Map<BasicBlock, Set<IRVariable>>();
+  const defs = new Map<BasicBlock, Set<IRVariable>>();
+  for (const block of fn.blocks) {
+    const use = new Set<IRVariable>();
+    const def = new Set<IRVariable>();
+    for (const ins of block.instructions) {
+      if (ins.op === 'load' && variables.has(ins.variable) && !def.has(ins.variable)) use.add(ins.variable);
+      if (ins.op === 'store' && variables.has(ins.variable)) def.add(ins.variable);
+    }
+    uses.set(block, use);
+    defs.set(block, def);
+  }
+
+  const liveIn = new Map<BasicBlock, Set<IRVariable>>();
+  for (const block of fn.blocks) liveIn.set(block, new Set(uses.get(block)));
+
+  let changed = true;
+  while (changed) {
+    changed = false;
+    for (const block of fn.blocks.slice().reverse()) {
+      const live = liveIn.get(block)!;
+      for (const successor of successors(block)) {
+        for (const variable of liveIn.get(successor)!) {
+          if (!defs.get(block)!.has(variable) && !live.has(variable)) {
+            live.add(variable);
+            changed = true;
+          }
+        }
+      }
+    }
+  }
+  return liveIn;
+}
+
+function resolve(replacements: Map<number, Value>, value: Value): Value {
+  while (value.kind === 'temp' && replacements.has(value.id)) {
+    value = replacements.get(value.id)!;
+  }
+  return value;
+}
+
+/**
+ * Rewrites all uses through a temp-id → value substitution
+ */
+export function replaceUses(fn: IRFunction, replacements: Map<number, Value>): void {
+  if (replacements.size === 0) return;
+  const map = (value: Value) => resolve(replacements, value);
+  for (const block of fn.blocks) {
+    for (const ins of block.instructions) {
+      mapUsedValues(ins, map);
+    }
+    if (block.terminator) {
+      mapUsedValues(block.terminator, map);
+    }
+  }
+}
+
+/**
+ * Removes phis whose inputs are all the same value (ignoring self
+ * references) until none are left; returns true if any were removed
+ */
+export function removeTrivialPhis(fn: IRFunction): boolean {
+  let removedAny = false;
+  let changed = true;
+
+  while (changed) {
+    changed = false;
+    const replacements = new Map<number, Value>();
+
+    for (const block of fn.blocks) {
+      block.instructions = block.instructions.filter((ins) => {
+        if (ins.op !== 'phi') return true;
+        const unique = uniqueIncoming(ins.dst, ins.incoming.map((incoming) => incoming.value));
+        if (unique === undefined) return true;
+
+        replacements.set(ins.dst.id, unique);
+        changed = true;
+        return false;
+      });
+    }
+
+    replaceUses(fn, replacements);
+    removedAny = removedAny || changed;
+  }
+  return removedAny;
+}
+
+/**
+ * The single value a phi merges, or undefined if it merges several
+ */
+function uniqueIncoming(dst: Temp, values: Value[]): Value | undefined {
+  let unique: Value | null = null;
+  for (const value of values) {
+    if (value.kind === 'temp' && value.id === dst.id) continue;
+    if (unique && !sameValue(unique, value)) return undefined;
+    unique = value;
+  }
+  return unique || constant(0, dst.type);
+}
+
+export function sameValue(a: Value, b: Value): boolean {
+  return a.kind === 'temp' ? b.kind === 'temp' && a.id === b.id : b.kind === 'const' && a.value === b.value;
+}
+
+/**
+ * Temporaries defined in the function, by id
+ */
+export function definitions(fn: IRFunction): Map<number, { block: BasicBlock; instruction: Instruction }> {
+  const defs = new Map<number, { block: BasicBlock; instruction: Instruction }>();
+  for (const block of fn.blocks) {
+    for (const instruction of block.instructions) {
+      const dst = definedTemp(instruction);
+      if (dst) defs.set(dst.id, { block, instruction });
+    }
+  }
+  return defs;
+}
+
+/**
+ * Replaces phis by copies in the predecessors. The function is no longer
+ * in SSA form afterwards (phi results have one definition per edge).
+ */
+export function destructSSA(fn: IRFunction): void {
+  const preds = predecessors(fn);
+
+  for (const block of fn.blocks.slice()) {
+    const phis = block.instructions.filter((ins) => ins.op === 'phi');
+    if (phis.length === 0) continue;
+
+    for (const pred of preds.get(block)!) {
+      let source = pred;
+      if (successors(pred).length > 1) {
+        source = splitEdge(fn, pred, block);
+      }
+
+      const copies: { dst: Temp; src: Value }[] = [];
+      for (const phi of phis) {
+        if (phi.op !== 'phi') continue;
+        const incoming = phi.incoming.find((candidate) => candidate.block === pred)!;
+        incoming.block = source;
+        copies.push({ dst: phi.dst, src: incoming.value });
+      }
+      source.instructions.push(...sequentializeCopies(fn, copies));
+    }
+
+    block.instructions = block.instructions.filter((ins) => ins.op !== 'phi');
+  }
+}
+
+/**
+ * Inserts an empty block on the edge from → to, laid out after `from`
+ */
+function splitEdge(fn: IRFunction, from: BasicBlock, to: BasicBlock): BasicBlock {
+  const block: BasicBlock = { id: fn.nextBlock++, instructions: [], terminator: { op: 'jmp', target: to } };
+  fn.blocks.splice(fn.blocks.indexOf(from) + 1, 0, block);
+
+  retarget(from.terminator!, to, block);
+  return block;
+}
+
+/**
+ * Orders copies that semantically happen at once so no source is
+ * overwritten before it is read
+ */
+function sequentializeCopies(fn: IRFunction, copies: { dst: Temp; src: Value }[]): Instruction[] {
+  const sequence: Instruction[] = [];
+  let pending = copies.filter((copy) => copy.src.kind !== 'temp' || copy.src.id !== copy.dst.id);
+
+  while (pending.length > 0) {
+    const ready = pending.find((copy) =>
+      !pending.some((other) => other.src.kind === 'temp' && other.src.id === copy.dst.id)
+    );
+
+    if (ready) {
+      sequence.push({ op: 'copy', dst: ready.dst, src: ready.src });
+      pending = pending.filter((copy) => copy !== ready);
+      continue;
+    }
+
+    // Every destination is still read: save one, redirect its readers
+    const saved = pending[0].dst;
+    const temp = newTemp(fn, saved.type, saved.name);
+    sequence.push({ op: 'copy', dst: temp, src: saved });
+    for (const copy of pending) {
+      if (copy.src.kind === 'temp' && copy.src.id === saved.id) {
+        copy.src = temp;
+      }
+    }
+  }
+  return sequence;
+}
@@ -0,0 +1,140 @@
+/**
+ * Strength Reduction
+ *
+ * Multiplication, division and shifts call runtime routines that take
+ * dozens of loop iterations (see runtime.ts). With a constant operand
+ * most of them have a cheaper equivalent in plain ALU operations:
+ *
+ * - x * c: doublings and additions of x, walking the bits of c from the
+ *   top (x * 10: 2x, 4x, 5x, 10x), or the same for -c followed by a
+ *   negation when that is shorter; kept as a call beyond
+ *   MAX_MULTIPLY_CHAIN operations
+ * - x << k: k doublings
+ * - x / 2^k: x >> k; x % 2^k: x & (2^k - 1)
+ * - x / c for c >= 128 (the quotient is 0 or 1), x >> 7: x >= c, x >= 128
+ * - int8 x >> 7: -(x >= 128), i.e. 0 or -1
+ *
+ * Constant shifts by 8 or more, and operations with identity or
+ * absorbing operands, are left to sccp.
+ *
+ * @fileoverview Constant multiply/divide/shift to ALU operations
+ */
+
+import { IRFunction, Instruction, Value, Temp, BinaryOp, constant, newTemp, isWide } from './ir';
+
+/** Most IR operations a constant multiplication is replaced by */
+export const MAX_MULTIPLY_CHAIN = 8;
+
+type Binary = Extract<Instruction, { op: 'binary' }>;
+
+/**
+ * Rewrites operations with a constant operand; returns true if anything
+ * changed
+ */
+export function reduceStrength(fn: IRFunction): boolean {
+  let changed = false;
+  for (const block of fn.blocks) {
+    const instructions: Instruction[] = [];
+    for (const ins of block.instructions) {
+      const replacement = ins.op === 'binary' ? reduce(fn, ins) : null;
+      if (replacement) {
+        instructions.push(...replacement);
+        changed = true;
+      } else {
+        instructions.push(ins);
+      }
+    }
+    block.instructions = instructions;
+  }
+  return changed;
+}
+
+/**
+ * Instructions computing `ins.dst` without a runtime call, or null
+ */
+function reduce(fn: IRFunction, ins: Binary): Instruction[] | null {
+  let a = ins.a;
+  let b = ins.b;
+  if (ins.operator === 'mul' && a.kind === 'const') {
+    [a, b] = [b, a];
+  }
+  if (a.kind !== 'temp' || b.kind !== 'const' || isWide(a.type)) return null;
+
+  const c = b.value;
+  const shift = Math.log2(c);
+  const power = Number.isInteger(shift);
+
+  switch (ins.operator) {
+    case 'mul':
+      return c > 1 ? multiply(fn, ins.dst, a, c) : null;
+    case 'shl':
+      return c > 0 && c < 8 ? horner(fn, ins.dst, a, 1 << c) : null;
+    case 'div':
+      if (c >= 0x80) return [binary(ins.dst, 'ge', a, b)];
+      return power && c > 1 ? [binary(ins.dst, 'shr', a, constant(shift))] : null;
+    case 'mod':
+      return power && c > 1 ? [binary(ins.dst, 'and', a, constant(c - 1))] : null;
+    case 'shr':
+      return c === 7 ? [binary(ins.dst, 'ge', a, constant(0x80))] : null;
+    case 'sar':
+      if (c === 7) {
+        const negative = newTemp(fn, 'bool');
+        return [binary(negative, 'ge', a, constant(0x80)), { op: 'unary', dst: ins.dst, operator: 'neg', a: negative }];
+      }
+      return null;
+    default:
+      return null;
+  }
+}
+
+/**
+ * x * c as doublings and additions, or null if longer than
+ * MAX_MULTIPLY_CHAIN
+ */
+function multiply(fn: IRFunction, dst: Temp, x: Temp, c: number): Instruction[] | null {
+  const direct = chainLength(c);
+  const negated = chainLength(0x100 - c) + 1;
+  if (Math.min(direct, negated) > MAX_MULTIPLY_CHAIN) return null;
+  if (direct <= negated) return horner(fn, dst, x, c);
+
+  if (c === 0xFF) {
+    return [{ op: 'unary', dst, operator: 'neg', a: x }];
+  }
+  const product = newTemp(fn, dst.type);
+  return [...horner(fn, product, x, 0x100 - c), { op: 'unary', dst, operator: 'neg', a: product }];
+}
+
+/**
+ * Operations horner() emits for c > 1: a doubling per bit below the top
+ * one and an addition per further set bit
+ */
+function chainLength(c: number): number {
+  const bits = c.toString(2);
+  return bits.length - 1 + bits.slice(1).split('').filter((bit) => bit === '1').length;
+}
+
+/**
+ * x * c for c > 1, walking the bits of c below the top one: double, then
+ * add x if the bit is set. The last operation defines `dst`.
+ */
+function horner(fn: IRFunction, dst: Temp, x: Temp, c: number): Instruction[] {
+  // null doubles the running value, x adds x to it
+  const addends: (Temp | null)[] = [];
+  for (const bit of c.toString(2).slice(1)) {
+    addends.push(null);
+    if (bit === '1') addends.push(x);
+  }
+
+  const chain: Instruction[] = [];
+  let value: Value = x;
+  addends.forEach((addend, index) => {
+    const result = index === addends.length - 1 ? dst : newTemp(fn, dst.type);
+    chain.push(binary(result, 'add', value, addend || value));
+    value = result;
+  });
+  return chain;
+}
+
+function binary(dst: Temp, operator: BinaryOp, a: Value, b: Value): Instruction {
+  return { op: 'binary', dst, operator, a, b };
+}
@@ -0,0 +1,94 @@
+/**
+ * Switch Dispatch Planning
+ *
+ * Chooses how a `switch` finds its case from the sorted case values,
+ * recursively, by the cheapest of:
+ *
+ * - compare: a chain of equality tests, then the default
+ * - table: a jump table over the range low..high (holes go to the
+ *   default), dispatched in constant time: the index is range-checked,
+ *   doubled and added to the table address, and `PUSH ; RET` jumps to
+ *   the table's `JMP` for it
+ * - split: a `value < pivot` test between two halves, each planned the
+ *   same way, which makes sparse values a balanced search tree
+ *
+ * Cost is program bytes plus worst-case dispatch cycles, counted over the
+ * instruction sequences the lowering emits for each shape (a test is
+ * `LDA value ; SUI c ; JZ/JC case`) with instructionBytes() and
+ * instructionCycles(). Bytes and cycles weigh the same because both are
+ * scarce: the whole program shares 256 bytes of ROM. Tables need an 8-bit
+ * value.
+ *
+ * @fileoverview Jump table or compare tree selection for switch
+ */
+
+import { instructionBytes, instructionCycles } from '../instruction-set';
+
+export type SwitchPlan =
+  | { kind: 'compare'; values: number[] }
+  | { kind: 'table'; low: number; high: number }
+  | { kind: 'split'; pivot: number; below: SwitchPlan; above: SwitchPlan };
+
+interface Cost {
+  bytes: number;
+  cycles: number;
+}
+
+const TEST = ['LDA', 'SUI', 'JZ'];
+const DISPATCH = ['LDA', 'SUI', 'JNC', 'LDA', 'ADD', 'ADI', 'PUSH', 'RET', 'JMP'];
+/** Subtracting the low end of the range into the index */
+const REBASE = ['SUI', 'STA'];
+
+function sequence(instructions: string[], times: number = 1): Cost {
+  return {
+    bytes: times * instructions.reduce((total, name) => total + instructionBytes(name), 0),
+    cycles: times * instructions.reduce((total, name) => total + instructionCycles(name), 0)
+  };
+}
+
+function total(cost: Cost): number {
+  return cost.bytes + cost.cycles;
+}
+
+/**
+ * Cheapest dispatch for distinct case `values` in ascending order
+ */
+export function planSwitch(values: number[], allowTable: boolean = true): SwitchPlan {
+  return plan(values, allowTable).plan;
+}
+
+function plan(values: number[], allowTable: boolean): { plan: SwitchPlan; cost: Cost } {
+  const tests = sequence(TEST, values.length);
+  const jump = sequence(['JMP']);
+  let best: { plan: SwitchPlan; cost: Cost } = {
+    plan: { kind: 'compare', values },
+    cost: { bytes: tests.bytes + jump.bytes, cycles: tests.cycles + jump.cycles }
+  };
+  const consider = (candidate: { plan: SwitchPlan; cost: Cost }) => {
+    if (total(candidate.cost) < total(best.cost)) best = candidate;
+  };
+
+  const low = values[0];
+  const high = values[values.length - 1];
+  if (allowTable && values.length > 1 && high - low < 0xFF) {
+    const dispatch = sequence(low === 0 ? DISPATCH : [...DISPATCH, ...REBASE]);
+    // The JMP counted in DISPATCH is the one entry taken; the rest only take space
+    const entries = (high - low) * instructionBytes('JMP');
+    consider({ plan: { kind: 'table', low, high }, cost: { bytes: dispatch.bytes + entries, cycles: dispatch.cycles } });
+  }
+
+  if (values.length > 3) {
+    const middle = values.length >> 1;
+    const below = plan(values.slice(0, middle), allowTable);
+    const above = plan(values.slice(middle), allowTable);
+    const test = sequence(TEST);
+    consider({
+      plan: { kind: 'split', pivot: values[middle], below: below.plan, above: above.plan },
+      cost: {
+        bytes: test.bytes + below.cost.bytes + above.cost.bytes,
+        cycles: test.cycles + Math.max(below.cost.cycles, above.cost.cycles)
+      }
+    });
+  }
+  return best;
+}
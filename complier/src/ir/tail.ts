@@ -0,0 +1,78 @@
+/**
+ * Tail Recursion Elimination
+ *
+ * A function that calls itself and returns the result right away
+ * (`return f(x);`, or a void call followed by `return`) needs no new
+ * activation: it can start over with the arguments as its parameters.
+ * Frames are static, so a real recursive call would also overwrite the
+ * caller's parameters and locals; as a loop it is correct and pushes no
+ * return address.
+ *
+ * Runs on SSA form. The entry block's `param` instructions move to a new
+ * entry block, and the old entry becomes a loop header with a phi per
+ * parameter that merges the value passed by the caller with the
+ * arguments of each tail call. The call and its `ret` become a jump to
+ * the header.
+ *
+ * Tail calls of other functions are left to the lowering, which emits a
+ * JMP in place of CALL and RET.
+ *
+ * @fileoverview Self tail calls turned into loops
+ */
+
+import { IRFunction, BasicBlock, Instruction, Value, newTemp } from './ir';
+import { predecessors } from './cfg';
+import { replaceUses } from './ssa';
+
+type Call = Extract<Instruction, { op: 'call' }>;
+type Param = Extract<Instruction, { op: 'param' }>;
+type Phi = Extract<Instruction, { op: 'phi' }>;
+
+/**
+ * The call ending `block` if it is a self tail call
+ */
+function selfTailCall(fn: IRFunction, block: BasicBlock): Call | null {
+  const call = block.instructions[block.instructions.length - 1];
+  const terminator = block.terminator;
+  if (!call || call.op !== 'call' || call.callee !== fn.name || !terminator || terminator.op !== 'ret') {
+    return null;
+  }
+  if (!terminator.value) return call;
+  const result = terminator.value;
+  return call.dst && result.kind === 'temp' && result.id === call.dst.id ? call : null;
+}
+
+/**
+ * Runs on one function in SSA form; returns true if it changed anything
+ */
+export function eliminateTailRecursion(fn: IRFunction): boolean {
+  const tails = fn.blocks.filter((block) => selfTailCall(fn, block) !== null);
+  const header = fn.blocks[0];
+  if (tails.length === 0 || (predecessors(fn).get(header) || []).length > 0) {
+    return false;
+  }
+
+  const entry: BasicBlock = { id: fn.nextBlock++, instructions: [], terminator: { op: 'jmp', target: header } };
+  const params = header.instructions.filter((ins): ins is Param => ins.op === 'param');
+  entry.instructions = params;
+  header.instructions = header.instructions.filter((ins) => ins.op !== 'param');
+  fn.blocks.unshift(entry);
+
+  // Uses of each parameter now read the phi; the phi reads the parameter
+  const replacements = new Map<number, Value>();
+  const phis = params.map((param): Phi => {
+    const dst = newTemp(fn, param.dst.type, param.dst.name);
+    replacements.set(param.dst.id, dst);
+    return { op: 'phi', dst, incoming: [{ block: entry, value: param.dst }] };
+  });
+  replaceUses(fn, replacements);
+
+  for (const block of tails) {
+    const call = selfTailCall(fn, block)!;
+    params.forEach((param, i) => phis[i].incoming.push({ block, value: call.args[param.index] }));
+    block.instructions.pop();
+    block.terminator = { op: 'jmp', target: header };
+  }
+  header.instructions.unshift(...phis);
+  return true;
+}
@@ -0,0 +1,113 @@
+/**
+ * IR Verifier
+ *
+ * Structural checks run between passes so a broken transformation is
+ * reported at the pass that caused it, not as wrong machine code:
+ *
+ * - Every block ends in a terminator whose targets belong to the function
+ * - Phis come first in their block and have one input per predecessor
+ * - Every temporary is defined exactly once (SSA)
+ * - Every use is dominated by its definition (phi inputs: at the end of
+ *   the incoming block)
+ *
+ * @fileoverview Structural and SSA validity checks for IR functions
+ */
+
+import { IRModule, IRFunction, BasicBlock, Value, definedTemp, usedValues } from './ir';
+import { successors, predecessors, immediateDominators, dominates } from './cfg';
+
+export function verifyFunction(fn: IRFunction): string[] {
+  const errors: string[] = [];
+  const where = (block: BasicBlock) => `${fn.name}: bb${block.id}`;
+  const inFunction = new Set(fn.blocks);
+
+  if (fn.blocks.length === 0) {
+    return [`${fn.name}: no blocks`];
+  }
+
+  // Definitions
+  const defs = new Map<number, { block: BasicBlock; index: number }>();
+  for (const block of fn.blocks) {
+    block.instructions.forEach((ins, index) => {
+      const dst = definedTemp(ins);
+      if (!dst) return;
+      if (defs.has(dst.id)) {
+        errors.push(`${where(block)}: %${dst.id} defined more than once`);
+      }
+      defs.set(dst.id, { block, index });
+    });
+  }
+
+  const preds = predecessors(fn);
+  const idom = immediateDominators(fn);
+
+  const checkUse = (value: Value, block: BasicBlock, index: number, context: string) => {
+    if (value.kind !== 'temp') return;
+    const def = defs.get(value.id);
+    if (!def) {
+      errors.push(`${where(block)}: ${context} uses undefined %${value.id}`);
+      return;
+    }
+    const dominated = def.block === block ? def.index < index : dominates(idom, def.block, block);
+    if (!dominated && idom.has(block)) {
+      errors.push(`${where(block)}: ${context} uses %${value.id} before its definition`);
+    }
+  };
+
+  for (const block of fn.blocks) {
+    if (!block.terminator) {
+      errors.push(`${where(block)}: missing terminator`);
+    } else {
+      for (const target of successors(block)) {
+        if (!inFunction.has(target)) {
+          errors.push(`${where(block)}: branch to bb${target.id} outside the function`);
+        }
+      }
+      for (const value of usedValues(block.terminator)) {
+        checkUse(value, block, block.instructions.length, block.terminator.op);
+      }
+    }
+
+    let pastPhis = false;
+    block.instructions.forEach((ins, index) => {
+      if (ins.op !== 'phi') {
+        pastPhis = true;
+        for (const value of usedValues(ins)) {
+          checkUse(value, block, index, ins.op);
+        }
+        return;
+      }
+
+      if (pastPhis) {
+        errors.push(`${where(block)}: phi %${ins.dst.id} after non-phi instructions`);
+      }
+      const blockPreds = preds.get(block) || [];
+      const incomingBlocks = ins.incoming.map((incoming) => incoming.block);
+      if (incomingBlocks.length !== blockPreds.length || !blockPreds.every((pred) => incomingBlocks.includes(pred))) {
+        errors.push(`${where(block)}: phi %${ins.dst.id} inputs do not match predecessors`);
+      }
+      for (const incoming of ins.incoming) {
+        checkUse(incoming.value, incoming.block, incoming.block.instructions.length, 'phi');
+      }
+    });
+  }
+
+  return errors;
+}
+
+export function verifyModule(module: IRModule): string[] {
+  const errors: string[] = [];
+  const names = new Set(module.functions.map((fn) => fn.name));
+
+  for (const fn of module.functions) {
+    errors.push(...verifyFunction(fn));
+    for (const block of fn.blocks) {
+      for (const ins of block.instructions) {
+        if (ins.op === 'call' && !names.has(ins.callee)) {
+          errors.push(`${fn.name}: call to unknown function ${ins.callee}`);
+        }
+      }
+    }
+  }
+  return errors;
+}
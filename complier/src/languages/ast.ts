@@ -6,13 +6,14 @@
  * 
  * - Function declarations with typed parameters
  * - Variable declarations with explicit typing
- * - Control flow constructs (if/else, loops)
+ * - Control flow constructs (if/else, loops, switch/case, break)
  * - Expression trees with operator precedence
  * - Built-in function calls for hardware interaction
  * 
  * Type System:
  * - uint8: 8-bit unsigned integer (0-255)
  * - int8: 8-bit signed integer (-128 to 127)  
+ * - uint16/int16: 16-bit integers, stored low byte first
  * - bool: Boolean values (0/1)
  * - void: No return value for functions
  * 
@@ -29,11 +30,14 @@ export enum NodeType {
   BINARY_EXPRESSION = 'BINARY_EXPRESSION',
   UNARY_EXPRESSION = 'UNARY_EXPRESSION',
   CALL_EXPRESSION = 'CALL_EXPRESSION',
+  ARRAY_ACCESS = 'ARRAY_ACCESS',
   IDENTIFIER = 'IDENTIFIER',
   LITERAL = 'LITERAL',
   IF_STATEMENT = 'IF_STATEMENT',
   WHILE_LOOP = 'WHILE_LOOP',
   FOR_LOOP = 'FOR_LOOP',
+  SWITCH_STATEMENT = 'SWITCH_STATEMENT',
+  BREAK_STATEMENT = 'BREAK_STATEMENT',
   RETURN_STATEMENT = 'RETURN_STATEMENT',
   BLOCK_STATEMENT = 'BLOCK_STATEMENT',
   EXPRESSION_STATEMENT = 'EXPRESSION_STATEMENT'
@@ -98,6 +102,12 @@ export interface CallExpression extends ASTNode {
   arguments: Expression[];
 }
 
+export interface ArrayAccess extends ASTNode {
+  type: NodeType.ARRAY_ACCESS;
+  array: string;
+  index: Expression;
+}
+
 export interface Identifier extends ASTNode {
   type: NodeType.IDENTIFIER;
   name: string;
@@ -130,6 +140,23 @@ export interface ForLoop extends ASTNode {
   body: Statement;
 }
 
+export interface SwitchStatement extends ASTNode {
+  type: NodeType.SWITCH_STATEMENT;
+  discriminant: Expression;
+  cases: SwitchCase[];
+}
+
+export interface SwitchCase {
+  /** Constant the discriminant is matched against; absent for `default` */
+  test?: Expression;
+  /** Statements up to the next label; control falls through to it */
+  body: Statement[];
+}
+
+export interface BreakStatement extends ASTNode {
+  type: NodeType.BREAK_STATEMENT;
+}
+
 export interface ReturnStatement extends ASTNode {
   type: NodeType.RETURN_STATEMENT;
   value?: Expression;
@@ -153,6 +180,8 @@ export type Statement =
   | IfStatement
   | WhileLoop
   | ForLoop
+  | SwitchStatement
+  | BreakStatement
   | ReturnStatement
   | BlockStatement
   | ExpressionStatement;
@@ -161,6 +190,7 @@ export type Expression =
   | BinaryExpression
   | UnaryExpression
   | CallExpression
+  | ArrayAccess
   | Identifier
   | Literal;
 
@@ -168,6 +198,8 @@ export type Expression =
 export enum DataType {
   UINT8 = 'uint8',    // 8-bit unsigned integer (0-255)
   INT8 = 'int8',      // 8-bit signed integer (-128 to 127)
+  UINT16 = 'uint16',  // 16-bit unsigned integer (0-65535)
+  INT16 = 'int16',    // 16-bit signed integer (-32768 to 32767)
   BOOL = 'bool',      // Boolean (0 or 1)
   VOID = 'void'       // For functions with no return value
 }
@@ -176,6 +208,11 @@ export enum DataType {
 export enum BinaryOperator {
   ADD = '+',
   SUBTRACT = '-',
+  MULTIPLY = '*',
+  DIVIDE = '/',
+  MODULO = '%',
+  SHIFT_LEFT = '<<',
+  SHIFT_RIGHT = '>>',
   AND = '&',
   OR = '|',
   XOR = '^',
@@ -5,569 +5,155 @@
  * highly optimized assembly code for the 8-bit CPU. Implements sophisticated
  * optimization strategies while maintaining code correctness and debuggability.
  * 
- * Code Generation Strategy:
+ * Pipeline:
+ * - The AST is translated into the three-address IR (see src/ir)
+ * - IR passes selected by the optimization level run over the module
+ * - The IR is lowered to the structured instruction stream
+ * - From level 1, the peephole optimizer rewrites that stream
  * 
- * Register Allocation:
- * - A: Primary accumulator for arithmetic operations
- * - B: Secondary operand and temporary storage
- * - C: Loop counters and index variables
- * - D: Function parameters and return values
- * - Stack-based spilling for complex expressions
+ * With `profileGenerate`, every block keeps a label so the compiler can
+ * write the block map; with `profile`, the passes and the lowering use its
+ * block counts (see src/ir/profile.ts).
  * 
- * Memory Management:
- * - Local variables allocated on stack with SP-relative addressing
- * - Global variables placed in dedicated memory regions
- * - Automatic lifetime management for temporaries
- * - Efficient stack frame setup/teardown
- * 
- * Expression Evaluation:
- * - Left-to-right evaluation with register reuse
- * - Constant folding and propagation
- * - Strength reduction (multiply by 2 -> shift left)
- * - Dead code elimination for unused expressions
- * 
- * Control Flow Generation:
- * - Structured jumps with label management
- * - Short-circuit evaluation for logical operators
- * - Loop optimization (loop invariant code motion)
- * - Tail call optimization where possible
- * 
- * Function Call Convention:
- * - Parameters passed via registers (first 4) then stack
- * - Return values in register A (8-bit) or A+B (16-bit)
- * - Caller-save register convention
- * - Stack alignment maintained for proper operation
- * 
- * Optimization Passes:
- * 
- * 1. Peephole Optimization:
- *    - Remove redundant MOV instructions
- *    - Combine arithmetic operations
- *    - Eliminate unnecessary jumps
- *    - Optimize common instruction patterns
- * 
- * 2. Register Optimization:
- *    - Minimize register-to-memory transfers
- *    - Reuse registers across basic blocks
- *    - Reduce register pressure through scheduling
- * 
- * 3. Control Flow Optimization:
- *    - Branch prediction hints for conditional jumps
- *    - Loop unrolling for small iteration counts
- *    - Function inlining for small functions
- * 
- * Debug Information:
- * - Source line mapping for debugging
- * - Variable name preservation in symbol table
- * - Call stack tracking information
- * - Breakpoint-friendly code generation
- * 
- * Error Handling:
- * - Runtime error detection for array bounds
- * - Stack overflow protection
- * - Divide-by-zero checking
- * - Type safety enforcement
+ * This class is the entry point tying those stages together.
  * 
  * @fileoverview Advanced C-to-assembly code generator with optimization
  * @author CPU-8Bit Compiler Team
  * @version 1.0.0
  */
 
-import {
-  Program, Statement, Expression, FunctionDeclaration, VariableDeclaration,
-  Assignment, BinaryExpression, UnaryExpression, CallExpression,
-  Identifier, Literal, IfStatement, WhileLoop, ForLoop, ReturnStatement,
-  BlockStatement, ExpressionStatement,
-  NodeType, DataType, BinaryOperator, UnaryOperator, BUILTIN_FUNCTIONS
-} from './ast';
-
-interface Variable {
-  name: string;
-  type: DataType;
-  address: number;
-  isArray?: boolean;
-  arraySize?: number;
-}
-
-interface Function {
-  name: string;
-  returnType: DataType;
-  parameters: Variable[];
-  startLabel: string;
-  endLabel: string;
+import { Program } from './ast';
+import { AssemblyItem, renderAssembly } from '../assembly-stream';
+import { IRModule } from '../ir/ir';
+import { buildModule } from '../ir/builder';
+import { IRLowering, MemoryUsage, functionLabel } from '../ir/lower';
+import { OptimizationLevel, PassStats, createPassManager } from '../ir/pass-manager';
+import { printModule } from '../ir/printer';
+import { PeepholeOptimizer, PeepholeStats } from '../peephole';
+import { PhaseTimer, measure } from '../time-report';
+import { BlockProfile, ProfileCounts } from '../ir/profile';
+
+export interface CGeneratorOptions {
+  /** Selects the IR pass pipeline (0 = none) */
+  optimizationLevel?: OptimizationLevel;
+  /** Keep a text dump of the IR after passes (--dump-ir) */
+  dumpIR?: boolean;
+  /** Records ir-build, each pass and lower as phases */
+  timer?: PhaseTimer | null;
+  /** Label every block for the block map (--profile-generate) */
+  profileGenerate?: boolean;
+  /** Block counts from earlier runs (--profile-use) */
+  profile?: BlockProfile | null;
 }
 
 export class CToAssemblyGenerator {
-  private output: string[] = [];
-  private variables: Map<string, Variable> = new Map();
-  private functions: Map<string, Function> = new Map();
-  private labelCounter: number = 0;
-  private currentMemoryAddress: number = 0x80; // Start variables at 0x80
-  private currentFunction: string | null = null;
-
+  private options: Required<CGeneratorOptions>;
+  private lowering: IRLowering;
+  private profile: ProfileCounts | null;
+  private passStats: PassStats[] = [];
+  private peepholeStats: PeepholeStats | null = null;
+  private irDump: string | null = null;
+
+  constructor(options: CGeneratorOptions = {}) {
+    this.options = {
+      optimizationLevel: options.optimizationLevel || 0,
+      dumpIR: options.dumpIR || false,
+      timer: options.timer || null,
+      profileGenerate: options.profileGenerate || false,
+      profile: options.profile || null
+    };
+    this.profile = this.options.profile ? new ProfileCounts(this.options.profile) : null;
+    this.lowering = new IRLowering({ profile: this.profile, labelBlocks: this.options.profileGenerate });
+  }
+
+  /**
+   * Generates the program as assembly text
+   */
   generate(ast: Program): string {
-    this.output = [];
-    this.variables.clear();
-    this.functions.clear();
-    this.labelCounter = 0;
-    this.currentMemoryAddress = 0x80;
-
-    // Add standard header
-    this.emit('; Generated C-like code for CPU 8-Bit');
-    this.emit('; Compiled from high-level language');
-    this.emit('');
-    this.emit('.ORG 0x00');
-    this.emit('');
-
-    // Generate main entry point
-    this.emit('MAIN:');
-    this.emit('    ; Initialize stack pointer');
-    this.emit('    LDI 0xFF');
-    this.emit('    ; Stack setup would go here in a real implementation');
-    this.emit('');
-
-    // First pass: collect function declarations
-    for (const stmt of ast.body) {
-      if (stmt.type === NodeType.FUNCTION_DECLARATION) {
-        this.collectFunction(stmt);
-      }
-    }
-
-    // Second pass: generate code
-    for (const stmt of ast.body) {
-      this.generateStatement(stmt);
-    }
-
-    // Add halt at the end if no main function
-    if (!this.functions.has('main')) {
-      this.emit('    HLT');
-    }
-
-    return this.output.join('\n');
-  }
-
-  private collectFunction(func: FunctionDeclaration): void {
-    const startLabel = `FUNC_${func.name.toUpperCase()}`;
-    const endLabel = `FUNC_${func.name.toUpperCase()}_END`;
-
-    const parameters: Variable[] = [];
-    for (let i = 0; i < func.parameters.length; i++) {
-      const param = func.parameters[i];
-      parameters.push({
-        name: param.name,
-        type: param.type,
-        address: this.allocateMemory(1) // Parameters get memory addresses
-      });
-    }
-
-    this.functions.set(func.name, {
-      name: func.name,
-      returnType: func.returnType || DataType.VOID,
-      parameters,
-      startLabel,
-      endLabel
+    return renderAssembly(this.generateItems(ast));
+  }
+
+  /**
+   * Generates the program as a structured instruction/label/directive
+   * stream that the assembler back end consumes without re-parsing
+   */
+  generateItems(ast: Program): AssemblyItem[] {
+    const timer = this.options.timer;
+    const module = this.buildIR(ast);
+    const entries = ['MAIN', ...module.functions.map((fn) => functionLabel(fn.name))];
+
+    const items = measure(timer, 'lower', () => this.lowering.lower(module), (lowered) => {
+      const usage = this.lowering.getMemoryUsage();
+      const stats: Record<string, number> = {
+        items: lowered.length,
+        instructions: lowered.filter((item) => item.kind === 'instruction').length,
+        ramBytes: usage.total
+      };
+      if (usage.stack !== null) stats.stackBytes = usage.stack;
+      return stats;
     });
-  }
-
-  private generateStatement(stmt: Statement): void {
-    switch (stmt.type) {
-      case NodeType.FUNCTION_DECLARATION:
-        this.generateFunctionDeclaration(stmt);
-        break;
-      case NodeType.VARIABLE_DECLARATION:
-        this.generateVariableDeclaration(stmt);
-        break;
-      case NodeType.ASSIGNMENT:
-        this.generateAssignment(stmt);
-        break;
-      case NodeType.IF_STATEMENT:
-        this.generateIfStatement(stmt);
-        break;
-      case NodeType.WHILE_LOOP:
-        this.generateWhileLoop(stmt);
-        break;
-      case NodeType.FOR_LOOP:
-        this.generateForLoop(stmt);
-        break;
-      case NodeType.RETURN_STATEMENT:
-        this.generateReturnStatement(stmt);
-        break;
-      case NodeType.BLOCK_STATEMENT:
-        this.generateBlockStatement(stmt);
-        break;
-      case NodeType.EXPRESSION_STATEMENT:
-        this.generateExpressionStatement(stmt);
-        break;
-    }
-  }
-
-  private generateFunctionDeclaration(func: FunctionDeclaration): void {
-    const funcInfo = this.functions.get(func.name)!;
-    this.currentFunction = func.name;
-
-    this.emit(`; Function: ${func.name}`);
-    this.emit(`${funcInfo.startLabel}:`);
-
-    // Register function parameters as variables
-    for (const param of funcInfo.parameters) {
-      this.variables.set(param.name, param);
-    }
-
-    // If it's main function, call it from MAIN
-    if (func.name === 'main') {
-      // Update MAIN to call main function
-      const mainIndex = this.output.findIndex(line => line === 'MAIN:');
-      if (mainIndex !== -1) {
-        this.output.splice(mainIndex + 3, 0, `    CALL ${funcInfo.startLabel}`);
-        this.output.splice(mainIndex + 4, 0, '    HLT');
-      }
-    }
-
-    // Function body
-    this.generateBlockStatement(func.body);
-
-    this.emit(`${funcInfo.endLabel}:`);
-    if (func.returnType !== DataType.VOID) {
-      this.emit('    ; Return value should be in accumulator');
-    }
-    this.emit('    RET');
-    this.emit('');
 
-    // Clean up function parameters from variables
-    for (const param of funcInfo.parameters) {
-      this.variables.delete(param.name);
+    this.peepholeStats = null;
+    if (this.options.optimizationLevel < 1) {
+      return items;
     }
-
-    this.currentFunction = null;
-  }
-
-  private generateVariableDeclaration(stmt: VariableDeclaration): void {
-    const address = this.allocateMemory(stmt.isArray ? (stmt.arraySize || 1) : 1);
-    
-    this.variables.set(stmt.name, {
-      name: stmt.name,
-      type: stmt.dataType,
-      address,
-      isArray: stmt.isArray,
-      arraySize: stmt.arraySize
+    const tableEntries = this.lowering.getJumpTables().flatMap((table) => table.entries.map((entry) => entry.label));
+    const blockLabels = this.lowering.getBlockLabels().map((block) => block.label);
+    const peephole = new PeepholeOptimizer({ keepLabels: [...entries, ...tableEntries, ...blockLabels] });
+    const optimized = measure(timer, 'peephole', () => peephole.optimize(items), () => {
+      const stats = peephole.getStats();
+      return { removed: stats.removed, passes: stats.passes, ...stats.hits };
     });
-
-    this.emit(`    ; Variable declaration: ${stmt.dataType} ${stmt.name}`);
-
-    if (stmt.initializer) {
-      this.generateExpression(stmt.initializer);
-      this.emit(`    STA 0x${address.toString(16).padStart(2, '0')}`);
-    }
+    this.peepholeStats = peephole.getStats();
+    return optimized;
   }
 
-  private generateAssignment(stmt: Assignment): void {
-    const variable = this.variables.get(stmt.left.name);
-    if (!variable) {
-      throw new Error(`Undefined variable: ${stmt.left.name}`);
-    }
+  /**
+   * Builds the IR and runs the pass pipeline, without lowering
+   */
+  buildIR(ast: Program): IRModule {
+    const timer = this.options.timer;
+    const module = measure(timer, 'ir-build', () => buildModule(ast), (built) => ({
+      functions: built.functions.length,
+      blocks: built.functions.reduce((total, fn) => total + fn.blocks.length, 0)
+    }));
 
-    this.emit(`    ; Assignment to ${stmt.left.name}`);
-    this.generateExpression(stmt.right);
-
-    if (stmt.arrayIndex) {
-      // Array assignment - more complex
-      this.emit('    ; TODO: Array assignment not fully implemented');
-      this.emit(`    STA 0x${variable.address.toString(16).padStart(2, '0')}`);
-    } else {
-      this.emit(`    STA 0x${variable.address.toString(16).padStart(2, '0')}`);
-    }
+    this.passStats = createPassManager(this.options.optimizationLevel, { timer }, this.profile).run(module);
+    this.irDump = this.options.dumpIR ? printModule(module) : null;
+    return module;
   }
 
-  private generateIfStatement(stmt: IfStatement): void {
-    const elseLabel = this.generateLabel('ELSE');
-    const endLabel = this.generateLabel('END_IF');
-
-    this.emit('    ; If statement');
-    this.generateExpression(stmt.condition);
-    
-    // If accumulator is 0, jump to else/end
-    this.emit(`    JZ ${stmt.alternate ? elseLabel : endLabel}`);
-
-    this.generateStatement(stmt.consequent);
-    
-    if (stmt.alternate) {
-      this.emit(`    JMP ${endLabel}`);
-      this.emit(`${elseLabel}:`);
-      this.generateStatement(stmt.alternate);
-    }
-
-    this.emit(`${endLabel}:`);
+  /**
+   * IR after passes from the last generate(), when dumpIR is enabled
+   */
+  getIRDump(): string | null {
+    return this.irDump;
   }
 
-  private generateWhileLoop(stmt: WhileLoop): void {
-    const loopLabel = this.generateLabel('WHILE_LOOP');
-    const endLabel = this.generateLabel('WHILE_END');
-
-    this.emit('    ; While loop');
-    this.emit(`${loopLabel}:`);
-    
-    this.generateExpression(stmt.condition);
-    this.emit(`    JZ ${endLabel}`);
-    
-    this.generateStatement(stmt.body);
-    this.emit(`    JMP ${loopLabel}`);
-    
-    this.emit(`${endLabel}:`);
-  }
-
-  private generateForLoop(stmt: ForLoop): void {
-    const loopLabel = this.generateLabel('FOR_LOOP');
-    const updateLabel = this.generateLabel('FOR_UPDATE');
-    const endLabel = this.generateLabel('FOR_END');
-
-    this.emit('    ; For loop');
-    
-    // Initialize
-    if (stmt.init) {
-      if (stmt.init.type === NodeType.VARIABLE_DECLARATION) {
-        this.generateVariableDeclaration(stmt.init);
-      } else {
-        this.generateAssignment(stmt.init);
-      }
-    }
-
-    this.emit(`${loopLabel}:`);
-    
-    // Condition
-    if (stmt.condition) {
-      this.generateExpression(stmt.condition);
-      this.emit(`    JZ ${endLabel}`);
-    }
-
-    // Body
-    this.generateStatement(stmt.body);
-
-    // Update
-    this.emit(`${updateLabel}:`);
-    if (stmt.update) {
-      this.generateAssignment(stmt.update);
-    }
-    
-    this.emit(`    JMP ${loopLabel}`);
-    this.emit(`${endLabel}:`);
-  }
-
-  private generateReturnStatement(stmt: ReturnStatement): void {
-    this.emit('    ; Return statement');
-    
-    if (stmt.value) {
-      this.generateExpression(stmt.value);
-      // Return value is in accumulator
-    }
-
-    if (this.currentFunction) {
-      const funcInfo = this.functions.get(this.currentFunction)!;
-      this.emit(`    JMP ${funcInfo.endLabel}`);
-    } else {
-      this.emit('    RET');
-    }
-  }
-
-  private generateBlockStatement(stmt: BlockStatement): void {
-    for (const statement of stmt.body) {
-      this.generateStatement(statement);
-    }
-  }
-
-  private generateExpressionStatement(stmt: ExpressionStatement): void {
-    this.generateExpression(stmt.expression);
-  }
-
-  private generateExpression(expr: Expression): void {
-    switch (expr.type) {
-      case NodeType.BINARY_EXPRESSION:
-        this.generateBinaryExpression(expr);
-        break;
-      case NodeType.UNARY_EXPRESSION:
-        this.generateUnaryExpression(expr);
-        break;
-      case NodeType.CALL_EXPRESSION:
-        this.generateCallExpression(expr);
-        break;
-      case NodeType.IDENTIFIER:
-        this.generateIdentifier(expr);
-        break;
-      case NodeType.LITERAL:
-        this.generateLiteral(expr);
-        break;
-    }
-  }
-
-  private generateBinaryExpression(expr: BinaryExpression): void {
-    this.emit('    ; Binary expression');
-    
-    // For simple operations, we'll use a basic approach
-    // Left operand in accumulator, right operand in memory temp location
-    const tempAddr = this.allocateMemory(1);
-
-    this.generateExpression(expr.left);
-    this.emit(`    STA 0x${tempAddr.toString(16).padStart(2, '0')}    ; Store left operand`);
-    
-    this.generateExpression(expr.right);
-
-    switch (expr.operator) {
-      case BinaryOperator.ADD:
-        this.emit(`    ADD 0x${tempAddr.toString(16).padStart(2, '0')}`);
-        break;
-      case BinaryOperator.SUBTRACT:
-        // Need to swap: temp - accumulator
-        this.emit(`    ; Subtract: left - right`);
-        this.emit(`    STA 0x${(tempAddr + 1).toString(16).padStart(2, '0')}    ; Store right operand`);
-        this.emit(`    LDA 0x${tempAddr.toString(16).padStart(2, '0')}    ; Load left operand`);
-        this.emit(`    SUB 0x${(tempAddr + 1).toString(16).padStart(2, '0')}    ; left - right`);
-        break;
-      case BinaryOperator.AND:
-        this.emit(`    AND 0x${tempAddr.toString(16).padStart(2, '0')}`);
-        break;
-      case BinaryOperator.OR:
-        this.emit(`    OR 0x${tempAddr.toString(16).padStart(2, '0')}`);
-        break;
-      case BinaryOperator.XOR:
-        this.emit(`    XOR 0x${tempAddr.toString(16).padStart(2, '0')}`);
-        break;
-      case BinaryOperator.EQUAL:
-        // Implement equality check
-        this.emit(`    SUB 0x${tempAddr.toString(16).padStart(2, '0')}    ; Compare`);
-        this.emit(`    ; If result is 0, values were equal`);
-        // Convert to boolean: 0 if equal, 1 if not equal, then invert
-        break;
-      case BinaryOperator.NOT_EQUAL:
-        this.emit(`    SUB 0x${tempAddr.toString(16).padStart(2, '0')}    ; Compare`);
-        this.emit(`    ; If result is non-zero, values were not equal`);
-        break;
-      case BinaryOperator.LESS_THAN:
-      case BinaryOperator.GREATER_THAN:
-      case BinaryOperator.LESS_EQUAL:
-      case BinaryOperator.GREATER_EQUAL:
-        this.emit(`    ; Comparison ${expr.operator} not fully implemented`);
-        this.emit(`    SUB 0x${tempAddr.toString(16).padStart(2, '0')}`);
-        break;
-    }
-  }
-
-  private generateUnaryExpression(expr: UnaryExpression): void {
-    this.generateExpression(expr.operand);
-
-    switch (expr.operator) {
-      case UnaryOperator.NOT:
-        this.emit('    ; Logical NOT');
-        this.emit('    ; Convert to boolean and invert');
-        // TODO: Implement proper boolean NOT
-        break;
-      case UnaryOperator.BITWISE_NOT:
-        this.emit('    NOT');
-        break;
-      case UnaryOperator.NEGATIVE:
-        this.emit('    ; Negate (two\'s complement)');
-        this.emit('    NOT');
-        this.emit('    ADI 1');
-        break;
-    }
-  }
-
-  private generateCallExpression(expr: CallExpression): void {
-    const functionName = expr.callee;
-
-    // Handle built-in functions
-    if (BUILTIN_FUNCTIONS[functionName]) {
-      this.generateBuiltinCall(functionName, expr.arguments);
-      return;
-    }
-
-    // Handle user-defined functions
-    const funcInfo = this.functions.get(functionName);
-    if (!funcInfo) {
-      throw new Error(`Undefined function: ${functionName}`);
-    }
-
-    this.emit(`    ; Call function ${functionName}`);
-    
-    // Pass arguments (simplified - just evaluate them)
-    for (let i = 0; i < expr.arguments.length; i++) {
-      this.generateExpression(expr.arguments[i]);
-      if (i < funcInfo.parameters.length) {
-        const param = funcInfo.parameters[i];
-        this.emit(`    STA 0x${param.address.toString(16).padStart(2, '0')}    ; Parameter ${param.name}`);
-      }
-    }
-
-    this.emit(`    CALL ${funcInfo.startLabel}`);
+  /**
+   * Label and origin of every block of the last generate(), with
+   * profileGenerate
+   */
+  getBlockLabels(): { label: string; origin: string }[] {
+    return this.lowering.getBlockLabels();
   }
 
-  private generateBuiltinCall(functionName: string, args: Expression[]): void {
-    switch (functionName) {
-      case 'input':
-        this.emit('    ; Built-in: input(port)');
-        this.generateExpression(args[0]);
-        this.emit('    ; Use accumulator as port number');
-        this.emit('    IN 0    ; Simplified - should use accumulator as port');
-        break;
-      
-      case 'output':
-        this.emit('    ; Built-in: output(port, value)');
-        // Generate port number first
-        this.generateExpression(args[0]);
-        const portTemp = this.allocateMemory(1);
-        this.emit(`    STA 0x${portTemp.toString(16).padStart(2, '0')}    ; Store port`);
-        
-        // Generate value
-        this.generateExpression(args[1]);
-        this.emit('    OUT 1    ; Simplified - should use stored port');
-        break;
-      
-      case 'delay':
-        this.emit('    ; Built-in: delay(cycles)');
-        this.generateExpression(args[0]);
-        this.emit('    ; TODO: Implement delay loop');
-        break;
-      
-      case 'halt':
-        this.emit('    ; Built-in: halt()');
-        this.emit('    HLT');
-        break;
-    }
+  getPassStats(): PassStats[] {
+    return this.passStats.slice();
   }
 
-  private generateIdentifier(expr: Identifier): void {
-    const variable = this.variables.get(expr.name);
-    if (!variable) {
-      throw new Error(`Undefined variable: ${expr.name}`);
-    }
-
-    this.emit(`    LDA 0x${variable.address.toString(16).padStart(2, '0')}    ; Load ${expr.name}`);
+  /**
+   * Rule hits of the last generate(), or null below level 1
+   */
+  getPeepholeStats(): PeepholeStats | null {
+    return this.peepholeStats;
   }
 
-  private generateLiteral(expr: Literal): void {
-    if (typeof expr.value === 'number') {
-      this.emit(`    LDI ${expr.value}`);
-    } else if (typeof expr.value === 'boolean') {
-      this.emit(`    LDI ${expr.value ? 1 : 0}`);
-    } else if (typeof expr.value === 'string') {
-      // For strings, we'll just load the first character for now
-      if (expr.value.length > 0) {
-        this.emit(`    LDI ${expr.value.charCodeAt(0)}    ; String: "${expr.value}"`);
-      } else {
-        this.emit(`    LDI 0    ; Empty string`);
-      }
-    }
+  /**
+   * Worst-case RAM footprint of the last generate(): globals, overlaid
+   * frames and the shared temporary pool
+   */
+  getMemoryUsage(): MemoryUsage {
+    return this.lowering.getMemoryUsage();
   }
-
-  private allocateMemory(size: number): number {
-    const address = this.currentMemoryAddress;
-    this.currentMemoryAddress += size;
-    return address;
-  }
-
-  private generateLabel(prefix: string): string {
-    return `${prefix}_${this.labelCounter++}`;
-  }
-
-  private emit(code: string): void {
-    this.output.push(code);
-  }
-}
\ No newline at end of file
+}
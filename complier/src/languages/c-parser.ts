@@ -13,19 +13,23 @@
  * variable_declaration := type identifier ('=' expression)? ';'
  * 
  * Type System:
- * type := 'uint8' | 'int8' | 'bool' | 'void'
+ * type := 'uint8' | 'int8' | 'uint16' | 'int16' | 'bool' | 'void'
  * parameter_list := parameter (',' parameter)*
  * parameter := type identifier
  * 
  * Statements:
  * statement := block_statement | if_statement | while_statement | for_statement
- *           | return_statement | expression_statement | variable_declaration
+ *           | switch_statement | break_statement | return_statement
+ *           | expression_statement | variable_declaration
  * 
  * block_statement := '{' statement* '}'
  * if_statement := 'if' '(' expression ')' statement ('else' statement)?
  * while_statement := 'while' '(' expression ')' statement
  * for_statement := 'for' '(' (variable_declaration | expression)? ';'
  *                      expression? ';' expression? ')' statement
+ * switch_statement := 'switch' '(' expression ')' '{' case_clause* '}'
+ * case_clause := ('case' expression | 'default') ':' statement*
+ * break_statement := 'break' ';'
  * return_statement := 'return' expression? ';'
  * expression_statement := expression ';'
  * 
@@ -35,12 +39,14 @@
  * logical_or_expression := logical_and_expression ('||' logical_and_expression)*
  * logical_and_expression := equality_expression ('&&' equality_expression)*
  * equality_expression := relational_expression (('==' | '!=') relational_expression)*
- * relational_expression := additive_expression (('<' | '<=' | '>' | '>=') additive_expression)*
+ * relational_expression := shift_expression (('<' | '<=' | '>' | '>=') shift_expression)*
+ * shift_expression := additive_expression (('<<' | '>>') additive_expression)*
  * additive_expression := multiplicative_expression (('+' | '-') multiplicative_expression)*
  * multiplicative_expression := unary_expression (('*' | '/' | '%') unary_expression)*
  * unary_expression := ('!' | '-' | '+' | '++' | '--') unary_expression | postfix_expression
  * postfix_expression := primary_expression ('++' | '--')*
  * primary_expression := identifier | literal | '(' expression ')' | call_expression
+ *                     | identifier '[' expression ']'
  * call_expression := identifier '(' argument_list? ')'
  * 
  * Parser Features:
@@ -79,7 +85,7 @@ import { CToken, CTokenType } from './c-tokenizer';
 import {
   Program, Statement, Expression, FunctionDeclaration, VariableDeclaration,
   Assignment, BinaryExpression, UnaryExpression, CallExpression,
-  Identifier, Literal, IfStatement, WhileLoop, ForLoop, ReturnStatement,
+  Identifier, Literal, IfStatement, WhileLoop, ForLoop, SwitchStatement, SwitchCase, ReturnStatement,
   BlockStatement, ExpressionStatement, Parameter,
   NodeType, DataType, BinaryOperator, UnaryOperator, BUILTIN_FUNCTIONS
 } from './ast';
@@ -153,6 +159,16 @@ export class CParser {
       return this.parseForLoop();
     }
 
+    if (this.check(CTokenType.SWITCH)) {
+      return this.parseSwitchStatement();
+    }
+
+    if (this.check(CTokenType.BREAK)) {
+      this.advance();
+      this.consume(CTokenType.SEMICOLON, "Expected ';' after 'break'");
+      return { type: NodeType.BREAK_STATEMENT, line: this.previous().line };
+    }
+
     if (this.check(CTokenType.RETURN)) {
       return this.parseReturnStatement();
     }
@@ -386,6 +402,51 @@ export class CParser {
     };
   }
 
+  private parseSwitchStatement(): SwitchStatement {
+    this.consume(CTokenType.SWITCH, "Expected 'switch'");
+    this.consume(CTokenType.LEFT_PAREN, "Expected '(' after 'switch'");
+    const discriminant = this.parseExpression();
+    this.consume(CTokenType.RIGHT_PAREN, "Expected ')' after switch value");
+    this.skipNewlines();
+    this.consume(CTokenType.LEFT_BRACE, "Expected '{' after switch");
+
+    const cases: SwitchCase[] = [];
+    this.skipNewlines();
+    while (!this.check(CTokenType.RIGHT_BRACE) && !this.isAtEnd()) {
+      let test: Expression | undefined;
+      if (this.match(CTokenType.CASE)) {
+        test = this.parseExpression();
+      } else if (this.match(CTokenType.DEFAULT)) {
+        if (cases.some((clause) => !clause.test)) {
+          throw new Error("Duplicate 'default' in switch");
+        }
+      } else {
+        throw new Error(`Expected 'case' or 'default', got ${this.current().value}`);
+      }
+      this.consume(CTokenType.COLON, "Expected ':' after case label");
+
+      const body: Statement[] = [];
+      this.skipNewlines();
+      while (!this.check(CTokenType.CASE) && !this.check(CTokenType.DEFAULT) && !this.check(CTokenType.RIGHT_BRACE) && !this.isAtEnd()) {
+        const stmt = this.parseStatement();
+        if (stmt) {
+          body.push(stmt);
+        }
+        this.skipNewlines();
+      }
+      cases.push({ test, body });
+    }
+
+    this.consume(CTokenType.RIGHT_BRACE, "Expected '}' after switch cases");
+
+    return {
+      type: NodeType.SWITCH_STATEMENT,
+      discriminant,
+      cases,
+      line: this.previous().line
+    };
+  }
+
   private parseReturnStatement(): ReturnStatement {
     this.consume(CTokenType.RETURN, "Expected 'return'");
     
@@ -503,9 +564,27 @@ export class CParser {
   }
 
   private parseXor(): Expression {
-    let expr = this.parseAddition();
+    let expr = this.parseShift();
 
     while (this.match(CTokenType.BITWISE_XOR)) {
+      const operator = this.previous().value as BinaryOperator;
+      const right = this.parseShift();
+      expr = {
+        type: NodeType.BINARY_EXPRESSION,
+        left: expr,
+        operator,
+        right,
+        line: this.previous().line
+      };
+    }
+
+    return expr;
+  }
+
+  private parseShift(): Expression {
+    let expr = this.parseAddition();
+
+    while (this.match(CTokenType.SHIFT_LEFT, CTokenType.SHIFT_RIGHT)) {
       const operator = this.previous().value as BinaryOperator;
       const right = this.parseAddition();
       expr = {
@@ -521,9 +600,27 @@ export class CParser {
   }
 
   private parseAddition(): Expression {
-    let expr = this.parseUnary();
+    let expr = this.parseMultiplication();
 
     while (this.match(CTokenType.PLUS, CTokenType.MINUS)) {
+      const operator = this.previous().value as BinaryOperator;
+      const right = this.parseMultiplication();
+      expr = {
+        type: NodeType.BINARY_EXPRESSION,
+        left: expr,
+        operator,
+        right,
+        line: this.previous().line
+      };
+    }
+
+    return expr;
+  }
+
+  private parseMultiplication(): Expression {
+    let expr = this.parseUnary();
+
+    while (this.match(CTokenType.STAR, CTokenType.SLASH, CTokenType.PERCENT)) {
       const operator = this.previous().value as BinaryOperator;
       const right = this.parseUnary();
       expr = {
@@ -622,7 +719,7 @@ export class CParser {
       return {
         type: NodeType.LITERAL,
         value,
-        dataType: DataType.UINT8,
+        dataType: value > 0xFF ? DataType.UINT16 : DataType.UINT8,
         line: this.previous().line
       };
     }
@@ -637,6 +734,17 @@ export class CParser {
     }
 
     if (this.match(CTokenType.IDENTIFIER)) {
+      const array = this.previous();
+      if (this.match(CTokenType.LEFT_BRACKET)) {
+        const index = this.parseExpression();
+        this.consume(CTokenType.RIGHT_BRACKET, "Expected ']' after array index");
+        return {
+          type: NodeType.ARRAY_ACCESS,
+          array: array.value,
+          index,
+          line: array.line
+        };
+      }
       return {
         type: NodeType.IDENTIFIER,
         name: this.previous().value,
@@ -658,6 +766,8 @@ export class CParser {
   private parseDataType(): DataType {
     if (this.match(CTokenType.UINT8)) return DataType.UINT8;
     if (this.match(CTokenType.INT8)) return DataType.INT8;
+    if (this.match(CTokenType.UINT16)) return DataType.UINT16;
+    if (this.match(CTokenType.INT16)) return DataType.INT16;
     if (this.match(CTokenType.BOOL)) return DataType.BOOL;
     if (this.match(CTokenType.VOID)) return DataType.VOID;
     
@@ -666,6 +776,7 @@ export class CParser {
 
   private isDataType(): boolean {
     return this.check(CTokenType.UINT8) || this.check(CTokenType.INT8) || 
+           this.check(CTokenType.UINT16) || this.check(CTokenType.INT16) ||
            this.check(CTokenType.BOOL) || this.check(CTokenType.VOID);
   }
 
@@ -695,9 +806,13 @@ export class CParser {
         case CTokenType.IF:
         case CTokenType.WHILE:
         case CTokenType.FOR:
+        case CTokenType.SWITCH:
+        case CTokenType.BREAK:
         case CTokenType.RETURN:
         case CTokenType.UINT8:
         case CTokenType.INT8:
+        case CTokenType.UINT16:
+        case CTokenType.INT16:
         case CTokenType.BOOL:
         case CTokenType.VOID:
           return;
@@ -10,6 +10,8 @@
  * Data Types:
  * - uint8: 8-bit unsigned integer (0-255)
  * - int8: 8-bit signed integer (-128 to 127)
+ * - uint16: 16-bit unsigned integer (0-65535)
+ * - int16: 16-bit signed integer (-32768 to 32767)
  * - bool: Boolean type (true/false)
  * - void: No-value type for functions
  * 
@@ -61,6 +63,8 @@ export enum CTokenType {
   // Keywords
   UINT8 = 'uint8',
   INT8 = 'int8',
+  UINT16 = 'uint16',
+  INT16 = 'int16',
   BOOL = 'bool',
   VOID = 'void',
   IF = 'if',
@@ -68,6 +72,10 @@ export enum CTokenType {
   WHILE = 'while',
   FOR = 'for',
   RETURN = 'return',
+  SWITCH = 'switch',
+  CASE = 'case',
+  DEFAULT = 'default',
+  BREAK = 'break',
   TRUE = 'true',
   FALSE = 'false',
   
@@ -79,6 +87,11 @@ export enum CTokenType {
   // Operators
   PLUS = '+',
   MINUS = '-',
+  STAR = '*',
+  SLASH = '/',
+  PERCENT = '%',
+  SHIFT_LEFT = '<<',
+  SHIFT_RIGHT = '>>',
   BITWISE_AND = '&',
   BITWISE_OR = '|',
   BITWISE_XOR = '^',
@@ -94,6 +107,7 @@ export enum CTokenType {
   
   // Delimiters
   SEMICOLON = ';',
+  COLON = ':',
   COMMA = ',',
   LEFT_PAREN = '(',
   RIGHT_PAREN = ')',
@@ -122,8 +136,9 @@ export class CTokenizer {
   private column: number = 1;
 
   private keywords = new Set([
-    'uint8', 'int8', 'bool', 'void',
+    'uint8', 'int8', 'uint16', 'int16', 'bool', 'void',
     'if', 'else', 'while', 'for', 'return',
+    'switch', 'case', 'default', 'break',
     'true', 'false'
   ]);
 
@@ -201,6 +216,20 @@ export class CTokenizer {
       return token;
     }
     
+    if (char === '<' && this.peek() === '<') {
+      const token = this.createToken(CTokenType.SHIFT_LEFT, '<<');
+      this.advance();
+      this.advance();
+      return token;
+    }
+    
+    if (char === '>' && this.peek() === '>') {
+      const token = this.createToken(CTokenType.SHIFT_RIGHT, '>>');
+      this.advance();
+      this.advance();
+      return token;
+    }
+    
     if (char === '<' && this.peek() === '=') {
       const token = this.createToken(CTokenType.LESS_EQUAL, '<=');
       this.advance();
@@ -219,6 +248,9 @@ export class CTokenizer {
     const singleCharTokens: Record<string, CTokenType> = {
       '+': CTokenType.PLUS,
       '-': CTokenType.MINUS,
+      '*': CTokenType.STAR,
+      '/': CTokenType.SLASH,
+      '%': CTokenType.PERCENT,
       '&': CTokenType.BITWISE_AND,
       '|': CTokenType.BITWISE_OR,
       '^': CTokenType.BITWISE_XOR,
@@ -228,6 +260,7 @@ export class CTokenizer {
       '>': CTokenType.GREATER_THAN,
       '=': CTokenType.ASSIGN,
       ';': CTokenType.SEMICOLON,
+      ':': CTokenType.COLON,
       ',': CTokenType.COMMA,
       '(': CTokenType.LEFT_PAREN,
       ')': CTokenType.RIGHT_PAREN,
@@ -1,4 +1,7 @@
 import { HighLevelCompiler } from './high-level-compiler';
+import { CPU8BitCompiler } from '../compiler';
+import { runBinary } from '../emulator';
+import { recordProfile } from '../ir/profile';
 
 describe('HighLevelCompiler', () => {
   test('should compile simple C program', () => {
@@ -15,6 +18,8 @@ describe('HighLevelCompiler', () => {
     expect(result.assembly).toBeDefined();
     expect(result.assembly).toContain('FUNC_MAIN');
     expect(result.assembly).toContain('HLT');
+    // Startup goes straight to main, even at -O0
+    expect(result.assembly).toMatch(/MAIN:\s+CALL FUNC_MAIN/);
   });
 
   test('should compile C program with variables', () => {
@@ -69,4 +74,453 @@ describe('HighLevelCompiler', () => {
     expect(result.success).toBe(false);
     expect(result.errors.length).toBeGreaterThan(0);
   });
-});
\ No newline at end of file
+
+  test('should assemble the same binary as its rendered assembly', () => {
+    const source = `
+      uint8 add(uint8 a, uint8 b) {
+        return a + b;
+      }
+
+      void main() {
+        uint8 i;
+        for (i = 0; i < 11; i = i + 1) {
+          output(0, add(i, 0xFF));
+        }
+        halt();
+      }
+    `;
+
+    const result = new HighLevelCompiler({ language: 'c' }).compile(source);
+    const reassembled = new CPU8BitCompiler().compile(result.assembly!);
+
+    expect(result.success).toBe(true);
+    expect(reassembled.success).toBe(true);
+    expect(Array.from(result.binary!)).toEqual(Array.from(reassembled.binary!));
+  });
+
+  test('should time front end and assembler phases together', () => {
+    const compiler = new HighLevelCompiler({ language: 'c', timeReport: true });
+    const result = compiler.compile('void main() { halt(); }');
+
+    expect(result.success).toBe(true);
+    const phases = compiler.getTimeReport()!.phases;
+    expect(phases.map((phase) => phase.name)).toEqual(['c-tokenize', 'c-parse', 'ir-build', 'lower', 'stream', 'generate']);
+    expect(phases[1].counts.astNodes).toBeGreaterThan(0);
+  });
+
+  test('should reuse temporaries across statements', () => {
+    const statements = Array.from({ length: 40 }, (_value, i) => `x = x + ${i} - (y ^ ${i});`).join('\n');
+    const source = `
+      void main() {
+        uint8 x = 0;
+        uint8 y = 1;
+        ${statements}
+        output(2, x);
+        halt();
+      }
+    `;
+
+    const result = new HighLevelCompiler({ language: 'c' }).compile(source);
+
+    expect(result.success).toBe(true);
+    const addresses = new Set((result.assembly!.match(/0x[0-9a-f]{2}/g) || []));
+    // x, y, plus the temps of the deepest expression
+    expect(addresses.size).toBeLessThanOrEqual(5);
+    expect(result.assembly).toContain('OUT 2');
+  });
+
+  test('should use immediate forms and keep left-deep expressions in A', () => {
+    const source = `
+      uint8 g = 2;
+
+      void main() {
+        uint8 a = input(0);
+        output(1, (a + 5) & 0x0F | g);
+        if (10 < a) {
+          output(2, 7 - a);
+        }
+        halt();
+      }
+    `;
+
+    const result = new HighLevelCompiler({ language: 'c' }).compile(source);
+
+    expect(result.success).toBe(true);
+    const body = result.assembly!.slice(result.assembly!.indexOf('FUNC_MAIN:'));
+    expect(body).toMatch(/ADI 5\n\s*ANI 15\n\s*OR 0x80 .*\n\s*OUT 1/);
+    // 10 < a is tested as a >= 11
+    expect(body).toContain('SUI 11');
+    // a itself is the only variable written
+    expect(new Set(body.match(/STA 0x[0-9a-f]{2}/g))).toEqual(new Set(['STA 0x81']));
+  });
+
+  test('should keep values live across calls out of the callee\'s reach', () => {
+    const source = `
+      uint8 inc(uint8 a) {
+        return a + 1;
+      }
+
+      void main() {
+        uint8 x = 3;
+        x = x + inc(x);
+        halt();
+      }
+    `;
+
+    const result = new HighLevelCompiler({ language: 'c' }).compile(source);
+
+    expect(result.success).toBe(true);
+    const assembly = result.assembly!;
+    const callee = assembly.slice(assembly.indexOf('FUNC_INC:'), assembly.indexOf('FUNC_MAIN:'));
+    const written = new Set((callee.match(/STA 0x[0-9a-f]{2}/g) || []).map((store) => store.slice(4)));
+    // The left operand x is read back from memory right after the call
+    const afterCall = assembly.slice(assembly.indexOf('CALL FUNC_INC'));
+    const operand = afterCall.match(/(?:LDA|ADD) (0x[0-9a-f]{2})/)![1];
+    expect(written.has(operand)).toBe(false);
+  });
+
+  test('should keep a swapped value apart from the one it saved', () => {
+    // b is defined first, so the saved copy prefers b's slot 0 while b is rewritten
+    const source = `
+      void main() {
+        uint8 a;
+        uint8 b = input(1);
+        a = input(0);
+        uint8 n = input(2);
+        while (n != 0) { uint8 t = a; a = b; b = t; n = n - 1; }
+        output(0, a);
+        output(1, b);
+      }
+    `;
+
+    for (const level of [0, 1] as const) {
+      const result = new HighLevelCompiler({ language: 'c', optimizationLevel: level, outputFormat: 'bin' }).compile(source);
+
+      expect(result.success).toBe(true);
+      const run = runBinary(result.binary!, { inputs: { 0: [3], 1: [9], 2: [1] } });
+      expect(run.outputs).toEqual([{ port: 0, value: 9 }, { port: 1, value: 3 }]);
+    }
+  });
+
+  test('should end counted loops on a decrement and one conditional jump', () => {
+    const source = `
+      void main() {
+        uint8 n = input(0);
+        uint8 i;
+        for (i = 0; i < 25; i = i + 1) {
+          output(1, n);
+        }
+        halt();
+      }
+    `;
+
+    const result = new HighLevelCompiler({ language: 'c', optimizationLevel: 1 }).compile(source);
+
+    expect(result.success).toBe(true);
+    const lines = result.assembly!.split('\n').map((line) => line.replace(/;.*$/, '').trim()).filter((line) => line !== '');
+    const loop = lines.indexOf('OUT 1');
+    expect(lines.slice(loop + 1, loop + 4)).toEqual(['LDA 0x81', 'SUI 1', 'STA 0x81']);
+    expect(lines[loop + 4]).toMatch(/^JNZ /);
+    expect(lines).toContain('LDI 25');
+    expect(lines.filter((line) => line.startsWith('JMP'))).toEqual([]);
+  });
+
+  test('should branch on comparison flags without materializing 0/1', () => {
+    const source = `
+      void main() {
+        uint8 a = input(0);
+        uint8 b = input(1);
+        if (a < b) {
+          output(1, a);
+        }
+        if (a == 7) {
+          output(2, b);
+        }
+        halt();
+      }
+    `;
+
+    const result = new HighLevelCompiler({ language: 'c', optimizationLevel: 1 }).compile(source);
+
+    expect(result.success).toBe(true);
+    const lines = result.assembly!.split('\n').map((line) => line.replace(/;.*$/, '').trim()).filter((line) => line !== '');
+    const less = lines.findIndex((line) => line.startsWith('SUB '));
+    expect(lines[less + 1]).toMatch(/^J(N?C) /);
+    const equal = lines.indexOf('SUI 7');
+    expect(lines[equal + 1]).toMatch(/^JN?Z /);
+    expect(lines).not.toContain('LDI 1');
+  });
+
+  test('should link only the runtime routines a program uses', () => {
+    const source = `
+      void main() {
+        uint8 a = input(0);
+        uint8 b = input(1);
+        output(0, a * b);
+        output(1, a % b);
+        output(2, a * 4);
+        halt();
+      }
+    `;
+
+    const o0 = new HighLevelCompiler({ language: 'c', optimizationLevel: 0 }).compile(source);
+    const o1 = new HighLevelCompiler({ language: 'c', optimizationLevel: 1 }).compile(source);
+
+    expect(o0.success).toBe(true);
+    expect(o0.assembly).toMatch(/CALL RT_MUL8[\s\S]*CALL RT_DIV8[\s\S]*CALL RT_MUL8/);
+    expect(o0.assembly).toMatch(/^RT_MUL8:$/m);
+    expect(o0.assembly).toMatch(/^RT_DIV8:$/m);
+    expect(o0.assembly).not.toMatch(/RT_SDIV8|RT_SHL8|RT_SHR8|RT_SAR8/);
+    // a * 4 becomes two doublings
+    expect(o1.assembly!.match(/CALL RT_MUL8/g)!.length).toBe(1);
+  });
+
+  test('should keep frames off the runtime routines\' scratch', () => {
+    const source = `
+      uint8 scale(uint8 a, uint8 b) {
+        uint8 keep = a + 1;
+        uint8 p = a * b;
+        return p + keep;
+      }
+      void main() {
+        uint8 k = input(2);
+        output(0, scale(input(0), input(1)));
+        output(1, k);
+      }
+    `;
+
+    for (const level of [0, 1] as const) {
+      const result = new HighLevelCompiler({ language: 'c', optimizationLevel: level, outputFormat: 'bin' }).compile(source);
+
+      expect(result.success).toBe(true);
+      const assembly = result.assembly!;
+      const routine = assembly.slice(assembly.indexOf('RT_MUL8:'));
+      const clobbered = new Set((routine.match(/STA 0x[0-9a-f]{2}/gi) || []).map((store) => Number(store.slice(4))));
+      // Everything read back after the multiply must have survived it
+      const afterCall = assembly.slice(assembly.indexOf('CALL RT_MUL8'), assembly.indexOf('RT_MUL8:'));
+      const read = (afterCall.match(/(?:LDA|ADD) 0x[0-9a-f]{2}/gi) || []).map((load) => Number(load.slice(4)));
+      expect(read.length).toBeGreaterThan(0);
+      expect(read.filter((address) => clobbered.has(address))).toEqual([]);
+      const run = runBinary(result.binary!, { inputs: { 0: [6], 1: [7], 2: [5] } });
+      expect(run.outputs).toEqual([{ port: 0, value: 49 }, { port: 1, value: 5 }]);
+    }
+  });
+
+  test('should carry between the bytes of 16-bit values', () => {
+    const source = `
+      uint16 total = 0x1234;
+      void main() {
+        uint8 step = input(0);
+        while (total < 1000) {
+          total = total + step;
+        }
+        halt();
+      }
+    `;
+
+    const result = new HighLevelCompiler({ language: 'c', optimizationLevel: 1 }).compile(source);
+
+    expect(result.success).toBe(true);
+    // Little-endian initial value
+    expect(result.assembly).toMatch(/LDI 52[\s\S]*?STA 0x80[^\n]*\n\s+LDI 18\s+STA 0x81/);
+    expect(result.assembly).toMatch(/JNC (\w+)\s+ADI 1\s+; Carry\n\1:/);
+    // High bytes first; the low bytes only decide when those are equal
+    expect(result.assembly).toMatch(/SUI 3 +; Compare \(lt\)\s+JNZ (\w+)\s+LDA 0x80[^\n]*\n\s+SUI 232\n\1:/);
+  });
+
+  test('should compare int8 values as signed', () => {
+    const source = `
+      void main() {
+        int8 x = input(0);
+        if (x < 0) {
+          output(1, 1);
+        }
+        halt();
+      }
+    `;
+
+    const result = new HighLevelCompiler({ language: 'c', optimizationLevel: 0 }).compile(source);
+
+    expect(result.success).toBe(true);
+    expect(result.assembly).toMatch(/XRI 128/);
+  });
+
+  test('should index arrays through B without patching code', () => {
+    const source = `
+      uint8 squares[8];
+      void main() {
+        for (uint8 i = 0; i < 8; i = i + 1) {
+          squares[i] = i * i;
+        }
+        output(0, squares[input(0)]);
+        halt();
+      }
+    `;
+
+    const result = new HighLevelCompiler({ language: 'c', optimizationLevel: 1, outputFormat: 'bin' }).compile(source);
+
+    expect(result.success).toBe(true);
+    // The counter stays in B, so the store needs no MOV
+    expect(result.assembly).toMatch(/CALL RT_MUL8 +; mul\s+STX 0x80 +; Store squares/);
+    expect(result.assembly).toMatch(/IN 0\s+MOV B, A +; Index\s+LDX 0x80/);
+    const run = runBinary(result.binary!, { inputs: { 0: [7] } });
+    expect(run.halted).toBe(true);
+    expect(run.outputs).toEqual([{ port: 0, value: 49 }]);
+  });
+
+  test('should keep loop indexes in B across runtime routines but not calls', () => {
+    const source = `
+      uint8 buf[8];
+      uint8 mix(uint8 a, uint8 b) { uint8 c = a ^ b; c = c + (a & 3); c = c ^ (b | 5); c = c + a; c = c - b; return c + 1; }
+      void main() {
+        uint8 sum = 0;
+        for (uint8 i = 0; i < 8; i = i + 1) { buf[i] = input(0); }
+        for (uint8 i = 0; i < 8; i = i + 1) { sum = sum + buf[i] * buf[i]; }
+        for (uint8 i = 0; i < 4; i = i + 1) { output(1, mix(buf[i], sum)); }
+        output(0, mix(sum, 1));
+      }
+    `;
+
+    const result = new HighLevelCompiler({ language: 'c', optimizationLevel: 1, outputFormat: 'bin' }).compile(source);
+
+    expect(result.success).toBe(true);
+    // The first two counters only live in B; RT_MUL8 leaves it alone, the call to mix does not
+    expect(result.assembly).toMatch(/IN 0\s+STX 0x80 +; Store buf\s+MOV A, B/);
+    expect(result.assembly).toMatch(/CALL RT_MUL8 +; mul[\s\S]*?MOV A, B +; i\.1/);
+    expect(result.assembly).toMatch(/MOV B, A +; Index\s+LDX 0x80 +; Load buf[\s\S]*CALL FUNC_MIX/);
+    expect(result.assembly!.match(/; Index/g)!.length).toBe(1);
+    const run = runBinary(result.binary!, { inputs: { 0: [1, 2, 3, 4, 5, 6, 7, 8] } });
+    expect(run.outputs).toEqual([
+      { port: 1, value: 57 }, { port: 1, value: 84 }, { port: 1, value: 87 }, { port: 1, value: 62 }, { port: 0, value: 148 }
+    ]);
+  });
+
+  test('should reject recursion outside tail position', () => {
+    const source = `
+      uint8 f(uint8 n) { if (n == 0) { return 0; } return n + f(n - 1); }
+      void main() { output(0, f(10)); }
+    `;
+
+    for (const level of [0, 1, 2] as const) {
+      const result = new HighLevelCompiler({ language: 'c', optimizationLevel: level }).compile(source);
+
+      expect(result.success).toBe(false);
+      expect(result.errors.join('\n')).toContain('f: recursive call to f is not in tail position');
+    }
+  });
+
+  test('should jump to functions called in tail position', () => {
+    const source = `
+      uint8 even(uint8 n) { if (n == 0) { return 1; } return odd(n - 1); }
+      uint8 odd(uint8 n) { if (n == 0) { return 0; } return even(n - 1); }
+      void main() { output(0, even(input(0))); }
+    `;
+
+    for (const level of [0, 1] as const) {
+      const result = new HighLevelCompiler({ language: 'c', optimizationLevel: level, outputFormat: 'bin' }).compile(source);
+
+      expect(result.success).toBe(true);
+      expect(result.assembly).toMatch(/JMP FUNC_EVEN +; Tail call/);
+      expect(result.assembly).not.toContain('CALL FUNC_ODD');
+      const run = runBinary(result.binary!, { inputs: { 0: [41] } });
+      expect(run.outputs).toEqual([{ port: 0, value: 0 }]);
+      // MAIN -> main -> even; the 41 calls after that reuse the return address
+      expect(run.maxStackDepth).toBe(2);
+    }
+  });
+
+  test('should dispatch switches through jump tables or compare trees', () => {
+    const source = `
+      uint8 decode(uint8 op) {
+        uint8 r = 0;
+        switch (op) {
+          case 1: r = 10; break;
+          case 2: r = 20; break;
+          case 3: r = 30;
+          case 4: r = r + 1; break;
+          case 5: return 50;
+          case 6: r = 60; break;
+          default: r = 99;
+        }
+        return r;
+      }
+      uint8 sparse(uint8 v) {
+        switch (v) { case 3: return 1; case 40: return 2; case 77: return 3; case 120: return 4; case 200: return 5; case 250: return 6; }
+        return 0;
+      }
+      void main() {
+        uint8 n = 0;
+        while (n < 8) { output(0, decode(n)); n = n + 1; }
+        output(1, sparse(input(0)));
+      }
+    `;
+
+    for (const level of [0, 1] as const) {
+      const result = new HighLevelCompiler({ language: 'c', optimizationLevel: level, outputFormat: 'bin' }).compile(source);
+
+      expect(result.success).toBe(true);
+      // Only the dense switch gets a table, even once inlined into main
+      expect(result.assembly).toMatch(/ADI FUNC_\w+_T0 +; Jump table\s+PUSH\s+RET/);
+      expect(result.assembly!.match(/; Jump table/g)!.length).toBe(1);
+      const run = runBinary(result.binary!, { inputs: { 0: [200] } });
+      expect(run.outputs.map((out) => out.value)).toEqual([99, 10, 20, 31, 1, 50, 60, 99, 5]);
+    }
+
+    expect(new HighLevelCompiler({ language: 'c' }).compile('void main() { break; }').success).toBe(false);
+  });
+
+  test('should optimize hot blocks from a profile of emulator runs', () => {
+    const compile = (source: string, options: object) =>
+      new HighLevelCompiler({ language: 'c', optimizationLevel: 1, outputFormat: 'bin', ...options }).compile(source);
+    const guide = (source: string, inputs: () => Record<number, number[]>) => {
+      const generate = compile(source, { profileGenerate: true });
+      expect(generate.success).toBe(true);
+      const profile = recordProfile(generate.blockMap!, generate.binary!, runBinary(generate.binary!, { inputs: inputs() }).executions);
+      // A map from another build would credit the wrong blocks
+      const stale = generate.binary!.slice();
+      stale[0] ^= 1;
+      expect(() => recordProfile(generate.blockMap!, stale, [])).toThrow('Block map does not belong to this image');
+      const plain = compile(source, {});
+      const guided = compile(source, { profile });
+      const before = runBinary(plain.binary!, { inputs: inputs() });
+      const after = runBinary(guided.binary!, { inputs: inputs() });
+      expect(after.outputs).toEqual(before.outputs);
+      expect(after.cycles).toBeLessThan(before.cycles);
+      return { profile, plain: plain.assembly!, guided: guided.assembly! };
+    };
+
+    const branchy = guide(`
+      void main() {
+        uint8 n = input(0);
+        uint8 s = 0;
+        for (uint8 i = 0; i < n; i = i + 1) {
+          if (input(1) == 0) { s = s + 7; output(2, s); } else { s = s + i; }
+        }
+        output(0, s);
+      }
+    `, () => ({ 0: [20], 1: [0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5, 0, 9] }));
+    expect(branchy.profile.runs).toBe(1);
+    expect(branchy.profile.counts['main.bb0']).toBe(1);
+    // The frequent then-branch falls through to the loop latch instead of jumping
+    expect(branchy.plain).toMatch(/OUT 2\s+JMP/);
+    expect(branchy.guided).not.toMatch(/OUT 2\s+JMP/);
+
+    const loops = guide(`
+      uint8 mix(uint8 a, uint8 b) { uint8 t = a + b; t = t ^ 3; return t + a; }
+      void main() {
+        uint8 n = input(0);
+        uint8 s = mix(n, 1);
+        uint8 i;
+        uint8 k = 0;
+        for (i = 0; i < n; i = i + 1) { s = mix(s, i); }
+        for (i = 0; i < 4; i = i + 1) { k = k + input(1); }
+        output(0, s);
+        output(1, k);
+      }
+    `, () => ({ 0: [30], 1: [1, 2, 3, 4] }));
+    expect(loops.profile.counts['mix.bb0']).toBe(31);
+    // The second loop ran often enough to be hot, so it gets the -O2 unrolling budget
+    expect(loops.plain.match(/IN 1/g)!.length).toBe(1);
+    expect(loops.guided.match(/IN 1/g)!.length).toBe(4);
+  });
+});
@@ -8,7 +8,7 @@
  * Language Features Supported:
  * 
  * Type System:
- * - Primitive types: uint8, int8, bool, void
+ * - Primitive types: uint8, int8, uint16, int16, bool, void
  * - Strong static typing with compile-time checking
  * - Automatic type promotion and safe casting
  * - Const-correctness for read-only variables
@@ -74,6 +74,11 @@ import { CTokenizer } from './c-tokenizer';
 import { CParser } from './c-parser';
 import { CToAssemblyGenerator } from './c-generator';
 import { CPU8BitCompiler } from '../compiler';
+import { AssemblyItem, buildParseResult, renderAssembly } from '../assembly-stream';
+import { PhaseTimer, TimeReport, measure } from '../time-report';
+import { ASTNode, NodeType } from './ast';
+import { OptimizationLevel } from '../ir/pass-manager';
+import { BlockMap, BlockProfile, imageHash } from '../ir/profile';
 
 export interface HighLevelCompilerOptions {
   language: 'c';
@@ -81,19 +86,39 @@ export interface HighLevelCompilerOptions {
   outputDir?: string;
   verbose?: boolean;
   keepAssembly?: boolean;
+  /** Record per-phase time, heap and counts (--time-report) */
+  timeReport?: boolean;
+  /**
+   * IR pass pipeline (-O): 0 none, 1 the full pipeline, 2 the same passes
+   * with the larger INLINE_BUDGETS/UNROLL_BUDGETS (see pass-manager.ts)
+   */
+  optimizationLevel?: OptimizationLevel;
+  /** Keep the IR after passes for getIRDump() (--dump-ir) */
+  dumpIR?: boolean;
+  /** Label every block and return its address in blockMap (--profile-generate) */
+  profileGenerate?: boolean;
+  /** Block counts recorded with a profileGenerate build (--profile-use) */
+  profile?: BlockProfile | null;
 }
 
 export interface HighLevelCompileResult {
   success: boolean;
+  /** Assembly listing; rendered on first access unless already printed */
   assembly?: string;
   binary?: Uint8Array;
   errors: string[];
   warnings: string[];
   outputFiles: string[];
+  /** Address of every block, with profileGenerate; also written to `<filename>.blocks.json` */
+  blockMap?: BlockMap;
 }
 
 export class HighLevelCompiler {
   private options: Required<HighLevelCompilerOptions>;
+  private assemblyCompiler: CPU8BitCompiler;
+  private lastTimeReport: TimeReport | null = null;
+  private lastIRDump: string | null = null;
+  private blockLabels: { label: string; origin: string }[] = [];
 
   constructor(options: HighLevelCompilerOptions) {
     this.options = {
@@ -101,8 +126,34 @@ export class HighLevelCompiler {
       outputFormat: options.outputFormat || 'bin',
       outputDir: options.outputDir || '.',
       verbose: options.verbose || false,
-      keepAssembly: options.keepAssembly || false
+      keepAssembly: options.keepAssembly || false,
+      timeReport: options.timeReport || false,
+      optimizationLevel: options.optimizationLevel || 0,
+      dumpIR: options.dumpIR || false,
+      profileGenerate: options.profileGenerate || false,
+      profile: options.profile || null
     };
+
+    this.assemblyCompiler = new CPU8BitCompiler({
+      outputFormat: this.options.outputFormat === 'both' ? 'both' : 
+                   this.options.outputFormat === 'hex' ? 'hex' : 'bin',
+      outputDir: this.options.outputDir,
+      verbose: false // We handle verbosity ourselves
+    });
+  }
+
+  /**
+   * Phase timings of the last compile(), when timeReport is enabled
+   */
+  getTimeReport(): TimeReport | null {
+    return this.lastTimeReport;
+  }
+
+  /**
+   * IR text of the last compile() after passes, when dumpIR is enabled
+   */
+  getIRDump(): string | null {
+    return this.lastIRDump;
   }
 
   compile(sourceCode: string, filename?: string): HighLevelCompileResult {
@@ -113,36 +164,49 @@ export class HighLevelCompiler {
       outputFiles: []
     };
 
+    const timer = this.options.timeReport ? new PhaseTimer(sourceCode) : null;
+    this.lastTimeReport = null;
+    this.lastIRDump = null;
+
     try {
-      // Step 1: Parse high-level language to AST
-      let assembly: string;
+      // Step 1: Parse high-level language to an instruction stream
+      let items: AssemblyItem[];
       
       switch (this.options.language) {
         case 'c':
-          assembly = this.compileCLike(sourceCode);
+          items = this.compileCLike(sourceCode, timer);
           break;
         default:
           throw new Error(`Unsupported language: ${this.options.language}`);
       }
 
-      result.assembly = assembly;
+      // Assembly text is only rendered when something asks for it
+      let assembly: string | undefined;
+      const renderListing = () => {
+        if (assembly === undefined) {
+          assembly = renderAssembly(items);
+        }
+        return assembly;
+      };
+      Object.defineProperty(result, 'assembly', {
+        get: renderListing,
+        enumerable: true,
+        configurable: true
+      });
 
       if (this.options.verbose) {
         console.log('Generated assembly code:');
-        console.log(assembly);
+        console.log(renderListing());
         console.log('');
       }
 
-      // Step 2: Compile assembly to binary if needed
+      // Step 2: Assemble the stream directly, without re-parsing text
       if (this.options.outputFormat !== 'asm') {
-        const assemblyCompiler = new CPU8BitCompiler({
-          outputFormat: this.options.outputFormat === 'both' ? 'both' : 
-                       this.options.outputFormat === 'hex' ? 'hex' : 'bin',
-          outputDir: this.options.outputDir,
-          verbose: false // We handle verbosity ourselves
-        });
-
-        const assemblyResult = assemblyCompiler.compile(assembly, filename);
+        const parseResult = measure(timer, 'stream', () => buildParseResult(items), (parsed) => ({
+          instructions: parsed.instructions.length,
+          labels: parsed.labels.size
+        }));
+        const assemblyResult = this.assemblyCompiler.assemble(parseResult, filename, timer);
         
         if (!assemblyResult.success) {
           result.errors.push(...assemblyResult.errors.map(err => `Assembly compilation: ${err}`));
@@ -151,6 +215,22 @@ export class HighLevelCompiler {
 
         result.binary = assemblyResult.binary;
         result.outputFiles.push(...assemblyResult.outputFiles);
+
+        if (this.options.profileGenerate) {
+          const blockMap: BlockMap = {
+            image: imageHash(assemblyResult.binary!),
+            blocks: this.blockLabels.map(({ label, origin }) => ({ origin, address: parseResult.labels.get(label)! }))
+          };
+          result.blockMap = blockMap;
+          if (filename) {
+            const fs = require('fs');
+            const path = require('path');
+
+            const mapPath = path.join(this.options.outputDir, filename + '.blocks.json');
+            fs.writeFileSync(mapPath, JSON.stringify(blockMap, null, 2));
+            result.outputFiles.push(mapPath);
+          }
+        }
       }
 
       // Save assembly file if requested or if output format is asm
@@ -160,7 +240,7 @@ export class HighLevelCompiler {
           const path = require('path');
           
           const asmPath = path.join(this.options.outputDir, filename + '.s');
-          fs.writeFileSync(asmPath, assembly);
+          measure(timer, 'listing', () => fs.writeFileSync(asmPath, renderListing()), () => ({ items: items.length }));
           result.outputFiles.push(asmPath);
           
           if (this.options.verbose) {
@@ -175,23 +255,27 @@ export class HighLevelCompiler {
     } catch (error) {
       result.errors.push(`Compilation failed: ${error}`);
       return result;
+    } finally {
+      this.lastTimeReport = timer ? timer.getReport() : null;
     }
   }
 
-  private compileCLike(sourceCode: string): string {
+  private compileCLike(sourceCode: string, timer: PhaseTimer | null): AssemblyItem[] {
     if (this.options.verbose) {
       console.log('Tokenizing C-like source...');
     }
     
     const tokenizer = new CTokenizer(sourceCode);
-    const tokens = tokenizer.tokenize();
+    const tokens = measure(timer, 'c-tokenize', () => tokenizer.tokenize(), (result) => ({ tokens: result.length }));
 
     if (this.options.verbose) {
       console.log('Parsing C-like tokens...');
     }
 
     const parser = new CParser(tokens);
-    const parseResult = parser.parse();
+    const parseResult = measure(timer, 'c-parse', () => parser.parse(), (parsed) => ({
+      astNodes: countAstNodes(parsed.ast)
+    }));
 
     if (parseResult.errors.length > 0) {
       throw new Error(`Parse errors: ${parseResult.errors.join(', ')}`);
@@ -201,13 +285,42 @@ export class HighLevelCompiler {
       console.log('Generating assembly from AST...');
     }
 
-    const generator = new CToAssemblyGenerator();
-    return generator.generate(parseResult.ast);
+    const generator = new CToAssemblyGenerator({
+      optimizationLevel: this.options.optimizationLevel,
+      dumpIR: this.options.dumpIR,
+      timer,
+      profileGenerate: this.options.profileGenerate,
+      profile: this.options.profile
+    });
+    const items = generator.generateItems(parseResult.ast);
+    this.lastIRDump = generator.getIRDump();
+    this.blockLabels = generator.getBlockLabels();
+    return items;
   }
 
 
 }
 
+/**
+ * Counts AST nodes (objects tagged with a NodeType) reachable from `root`
+ */
+function countAstNodes(root: ASTNode): number {
+  const nodeTypes = new Set<string>(Object.values(NodeType));
+  let count = 0;
+  const visit = (value: any): void => {
+    if (Array.isArray(value)) {
+      value.forEach(visit);
+    } else if (value && typeof value === 'object') {
+      if (nodeTypes.has(value.type)) {
+        count++;
+      }
+      Object.values(value).forEach(visit);
+    }
+  };
+  visit(root);
+  return count;
+}
+
 // Factory function for easier usage
 export function createHighLevelCompiler(language: 'c', options: Partial<HighLevelCompilerOptions> = {}): HighLevelCompiler {
   return new HighLevelCompiler({
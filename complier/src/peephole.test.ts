@@ -0,0 +1,67 @@
+import { PeepholeOptimizer, parsePeepholeRules } from './peephole';
+import { AssemblyItem, renderAssembly } from './assembly-stream';
+
+const ins = (instruction: string, ...operands: (string | number)[]): AssemblyItem =>
+  ({ kind: 'instruction', instruction, operands });
+const label = (name: string): AssemblyItem => ({ kind: 'label', name });
+
+const lines = (items: AssemblyItem[]) =>
+  renderAssembly(items).split('\n').map((line) => line.replace(/;.*$/, '').trim()).filter((line) => line !== '');
+
+describe('PeepholeOptimizer', () => {
+  test('should rewrite to a fixpoint and count hits per rule', () => {
+    const optimizer = new PeepholeOptimizer();
+    const items = [
+      label('MAIN'),
+      ins('LDI', 255),
+      ins('CALL', 'FUNC_MAIN'),
+      ins('HLT'),
+      label('FUNC_MAIN'),
+      ins('IN', 0),
+      ins('STA', 0x80),
+      { kind: 'comment', text: 'between', indent: true } as AssemblyItem,
+      ins('LDA', 0x80),
+      ins('JMP', 'FUNC_MAIN_L0'),
+      label('FUNC_MAIN_L0'),
+      ins('OUT', 1),
+      ins('HLT'),
+      ins('RET')
+    ];
+
+    const result = optimizer.optimize(items);
+    const stats = optimizer.getStats();
+
+    expect(lines(result)).toEqual(['MAIN:', 'CALL FUNC_MAIN', 'HLT', 'FUNC_MAIN:', 'IN 0', 'STA 0x80', 'OUT 1', 'HLT']);
+    expect(stats.hits['dead-load-at-call']).toBe(1);
+    expect(stats.hits['store-reload']).toBe(1);
+    expect(stats.hits['jump-to-next']).toBe(1);
+    expect(stats.hits['unreachable-hlt']).toBe(1);
+    expect(stats.removed).toBe(4);
+    expect(items.length).toBe(14);
+  });
+
+  test('should only drop a test when no path reads the carry', () => {
+    const optimizer = new PeepholeOptimizer({ keepLabels: ['L', 'M'] });
+    const zeroOnly = [ins('ANI', 3), ins('ORI', 0), ins('JZ', 'L'), ins('RET'), label('L'), ins('RET')];
+    const carryLater = [ins('ANI', 3), ins('ORI', 0), ins('JZ', 'M'), ins('RET'), label('M'), ins('JC', 'M')];
+
+    expect(lines(optimizer.optimize(zeroOnly))).toEqual(['ANI 3', 'JZ L', 'RET', 'L:', 'RET']);
+    expect(lines(optimizer.optimize(carryLater))).toContain('ORI 0');
+  });
+
+  test('should parse custom rules and report malformed ones', () => {
+    const rules = parsePeepholeRules(`
+      # Negating twice
+      neg-neg: NOT ; ADI 1 ; NOT ; ADI 1 => if flags-dead
+      swap-jz: JZ $t ; JMP $f ; $t: => JNZ $f ; #3
+    `);
+    expect(rules.map((rule) => rule.name)).toEqual(['neg-neg', 'swap-jz']);
+    expect(rules[0].guard).toBe('flags-dead');
+
+    const result = new PeepholeOptimizer({ rules }).optimize([ins('JZ', 'T'), ins('JMP', 'F'), label('T'), label('F')]);
+    expect(lines(result)).toEqual(['JNZ F', 'F:']);
+
+    expect(() => parsePeepholeRules('bad: LDA $a => LDA $a ; STA $a')).toThrow(/line 1: replacement must be shorter/);
+    expect(() => parsePeepholeRules('x: NOP => if maybe')).toThrow(/unknown condition/);
+  });
+});
@@ -0,0 +1,418 @@
+/**
+ * Peephole Optimizer for Generated Assembly
+ *
+ * Rewrites short instruction sequences in the structured assembly stream
+ * of the C code generator, before it is assembled. Rules are written in a
+ * small text DSL, one per line:
+ *
+ *     store-reload:   STA $a ; LDA $a          => #1
+ *     jump-over-jz:   JZ $t ; JMP $f ; $t:     => JNZ $f ; #3
+ *     drop-test:      ADD|ADI $x ; ORI 0       => #1            if carry-dead
+ *
+ * - A pattern is a `;`-separated sequence of instructions and labels.
+ *   `LDI|LDA` matches either mnemonic, `*` any instruction, `$name:` any
+ *   label. Operands are literals or `$name` variables; a variable matches
+ *   the same operand everywhere in the rule.
+ * - The replacement lists what the match becomes: `#n` keeps the n-th
+ *   matched item as it was (comment included), otherwise instructions and
+ *   labels are built from the variables. It may be empty.
+ * - `if flags-dead` / `if carry-dead` only apply the rule when no path from
+ *   the end of the match reads Z or C (respectively C) before setting it.
+ * - The replacement must have fewer items than the pattern, so rewriting
+ *   always terminates.
+ *
+ * Comments and blank lines are transparent to patterns; directives end a
+ * sequence. Rules are tried at every position until a whole pass changes
+ * nothing. Between passes, labels nothing refers to are dropped (except
+ * the ones the caller keeps, e.g. entry points), which exposes sequences
+ * that were split by a label.
+ *
+ * The rules rely on conventions of generated code: callees never read A
+ * or the flags they are called with, and code after RET, HLT or JMP is
+ * only reached through a label. Straight-line rules can also come from
+ * the superoptimizer (superopt.ts), which proves them over every input.
+ *
+ * @fileoverview Table-driven peephole rewriting to a fixpoint
+ */
+
+import { AssemblyItem, InstructionItem, LabelItem } from './assembly-stream';
+
+export type PeepholeGuard = 'flags-dead' | 'carry-dead';
+
+export type OperandPattern = { kind: 'literal'; value: string | number } | { kind: 'variable'; name: string };
+
+export type PatternItem =
+  | { kind: 'instruction'; mnemonics: string[] | null; operands: OperandPattern[] }
+  | { kind: 'label'; name: string };
+
+export type ReplacementItem =
+  | { kind: 'keep'; index: number }
+  | { kind: 'instruction'; instruction: string; operands: OperandPattern[] }
+  | { kind: 'label'; name: string };
+
+export interface PeepholeRule {
+  name: string;
+  pattern: PatternItem[];
+  replacement: ReplacementItem[];
+  guard: PeepholeGuard | null;
+}
+
+export interface PeepholeOptions {
+  /** Rules as DSL text or parsed (default: DEFAULT_PEEPHOLE_RULES) */
+  rules?: string | PeepholeRule[];
+  /** Labels kept even when nothing in the stream refers to them */
+  keepLabels?: string[];
+  /** Upper bound on rewrite passes */
+  maxPasses?: number;
+}
+
+export interface PeepholeStats {
+  /** Applications per rule name */
+  hits: Record<string, number>;
+  /** Instructions removed, net of any added */
+  removed: number;
+  passes: number;
+}
+
+/**
+ * Rules found by the superoptimizer (`cpu8bit superopt`, see superopt.ts)
+ * in compiled programs, each proven equivalent over every input under its
+ * guard; part of DEFAULT_PEEPHOLE_RULES
+ */
+export const SUPEROPTIMIZED_PEEPHOLE_RULES = `
+negate-load:         LDA $a ; NOT ; ADI 1            => LDI 0 ; SUB $a if carry-dead
+add-reloaded:        STA $a ; LDA $b ; ADD $a        => #1 ; ADD $b
+and-reloaded:        STA $a ; LDA $b ; AND $a        => #1 ; AND $b
+or-reloaded:         STA $a ; LDA $b ; OR $a         => #1 ; OR $b
+xor-reloaded:        STA $a ; LDA $b ; XOR $a        => #1 ; XOR $b
+stored-sub-test:     SUI $k ; STA $a ; SUI 0         => #1 ; #2       if carry-dead
+stored-add-test:     ADI $k ; STA $a ; SUI 0         => #1 ; #2       if carry-dead
+zero-store-test:     LDI 0 ; STA $a ; LDA $b ; SUI 0 => #1 ; #2 ; ADD $b
+`;
+
+/**
+ * Rules applied to generator output
+ */
+export const DEFAULT_PEEPHOLE_RULES = `
+# A already holds the value, or is overwritten before it is read
+store-reload:        STA $a ; LDA $a                 => #1
+load-store:          LDA $a ; STA $a                 => #1
+double-store:        STA $a ; STA $a                 => #2
+dead-load:           LDI|LDA $x ; LDI|LDA $y         => #2
+dead-load-before-in: LDI|LDA $x ; IN $p              => #2
+dead-load-at-call:   LDI|LDA $x ; CALL $f            => #2
+
+# Control flow
+jump-to-next:        JMP|JZ|JNZ|JC|JNC $l ; $l:      => #2
+jz-over-jmp:         JZ $t ; JMP $f ; $t:            => JNZ $f ; #3
+jnz-over-jmp:        JNZ $t ; JMP $f ; $t:           => JZ $f ; #3
+jc-over-jmp:         JC $t ; JMP $f ; $t:            => JNC $f ; #3
+jnc-over-jmp:        JNC $t ; JMP $f ; $t:           => JC $f ; #3
+unreachable-jmp:     JMP $l ; *                      => #1
+unreachable-ret:     RET ; *                         => #1
+unreachable-hlt:     HLT ; *                         => #1
+
+# Arithmetic that cancels out or only sets flags
+double-not:          NOT ; NOT                       =>
+double-negate:       NOT ; ADI 1 ; NOT ; ADI 1       =>                if flags-dead
+add-zero:            ADI|SUI|ORI|XRI 0               =>                if flags-dead
+and-all:             ANI 255                         =>                if flags-dead
+redundant-test:      ADD|ADI|SUB|SUI|AND|ANI|OR|ORI|XOR|XRI $x ; ORI 0 => #1 if carry-dead
+stored-test:         ADD|ADI|SUB|SUI|AND|ANI|OR|ORI|XOR|XRI $x ; STA $a ; ORI 0 => #1 ; #2 if carry-dead
+
+# Found by the superoptimizer
+${SUPEROPTIMIZED_PEEPHOLE_RULES}`;
+
+const FLAG_WRITERS = new Set(['ADD', 'ADI', 'SUB', 'SUI', 'AND', 'ANI', 'OR', 'ORI', 'XOR', 'XRI']);
+const FLAG_READERS: Record<string, 'Z' | 'C'> = { JZ: 'Z', JNZ: 'Z', JC: 'C', JNC: 'C' };
+
+/**
+ * Parses rules in the DSL described in the file header; throws with the
+ * line number on malformed rules
+ */
+export function parsePeepholeRules(text: string): PeepholeRule[] {
+  const rules: PeepholeRule[] = [];
+  const names = new Set<string>();
+
+  text.split('\n').forEach((raw, index) => {
+    const line = raw.replace(/#(?!\d).*$/, '').trim();
+    if (line === '') return;
+    const fail = (message: string): never => {
+      throw new Error(`Peephole rule line ${index + 1}: ${message}`);
+    };
+
+    const match = line.match(/^([\w-]+)\s*:\s*(.*?)\s*=>\s*(.*?)\s*(?:\bif\s+([\w-]+))?$/);
+    if (!match) fail(`expected "name: pattern => replacement"`);
+    const [, name, patternText, replacementText, guardText] = match!;
+    if (names.has(name)) fail(`duplicate rule ${name}`);
+    if (guardText !== undefined && guardText !== 'flags-dead' && guardText !== 'carry-dead') {
+      fail(`unknown condition ${guardText}`);
+    }
+
+    const pattern = splitItems(patternText).map((item) => parsePatternItem(item, fail));
+    if (pattern.length === 0) fail('empty pattern');
+    const replacement = splitItems(replacementText).map((item) => parseReplacementItem(item, pattern.length, fail));
+    if (replacement.length >= pattern.length) fail('replacement must be shorter than the pattern');
+
+    names.add(name);
+    rules.push({ name, pattern, replacement, guard: (guardText as PeepholeGuard) || null });
+  });
+  return rules;
+}
+
+function splitItems(text: string): string[] {
+  return text.split(';').map((item) => item.trim()).filter((item) => item !== '');
+}
+
+function parseOperand(text: string): OperandPattern {
+  if (text.startsWith('$')) return { kind: 'variable', name: text.slice(1) };
+  const number = /^(0x[0-9a-f]+|\d+)$/i.test(text) ? Number(text) : NaN;
+  return { kind: 'literal', value: isNaN(number) ? text : number };
+}
+
+function parseInstruction(text: string): { mnemonic: string; operands: OperandPattern[] } {
+  const space = text.search(/\s/);
+  const mnemonic = space < 0 ? text : text.slice(0, space);
+  const rest = space < 0 ? '' : text.slice(space).trim();
+  const operands = rest === '' ? [] : rest.split(',').map((operand) => parseOperand(operand.trim()));
+  return { mnemonic: mnemonic.toUpperCase(), operands };
+}
+
+function parsePatternItem(text: string, fail: (message: string) => never): PatternItem {
+  if (text.endsWith(':')) {
+    if (!text.startsWith('$')) fail(`label patterns must be variables: ${text}`);
+    return { kind: 'label', name: text.slice(1, -1) };
+  }
+  const { mnemonic, operands } = parseInstruction(text);
+  if (mnemonic === '*') return { kind: 'instruction', mnemonics: null, operands: [] };
+  return { kind: 'instruction', mnemonics: mnemonic.split('|'), operands };
+}
+
+function parseReplacementItem(text: string, patternLength: number, fail: (message: string) => never): ReplacementItem {
+  const keep = text.match(/^#(\d+)$/);
+  if (keep) {
+    const index = Number(keep[1]) - 1;
+    if (index < 0 || index >= patternLength) fail(`${text} is outside the pattern`);
+    return { kind: 'keep', index };
+  }
+  if (text.endsWith(':')) {
+    if (!text.startsWith('$')) fail(`labels must be variables: ${text}`);
+    return { kind: 'label', name: text.slice(1, -1) };
+  }
+  const { mnemonic, operands } = parseInstruction(text);
+  if (!/^[A-Z]+$/.test(mnemonic)) fail(`replacement needs a single mnemonic: ${text}`);
+  return { kind: 'instruction', instruction: mnemonic, operands };
+}
+
+export class PeepholeOptimizer {
+  private rules: PeepholeRule[];
+  private options: Required<Omit<PeepholeOptions, 'rules'>>;
+  private stats: PeepholeStats = { hits: {}, removed: 0, passes: 0 };
+  private items: AssemblyItem[] = [];
+  private labelPositions: Map<string, number> | null = null;
+
+  constructor(options: PeepholeOptions = {}) {
+    const rules = options.rules !== undefined ? options.rules : DEFAULT_PEEPHOLE_RULES;
+    this.rules = typeof rules === 'string' ? parsePeepholeRules(rules) : rules;
+    this.options = {
+      keepLabels: options.keepLabels || ['MAIN'],
+      maxPasses: options.maxPasses || 32
+    };
+  }
+
+  /**
+   * Returns the rewritten stream; the input array is not modified
+   */
+  optimize(items: AssemblyItem[]): AssemblyItem[] {
+    this.items = items.slice();
+    this.labelPositions = null;
+    this.stats = { hits: {}, removed: 0, passes: 0 };
+    for (const rule of this.rules) {
+      this.stats.hits[rule.name] = 0;
+    }
+    const before = countInstructions(this.items);
+
+    let changed = true;
+    while (changed && this.stats.passes < this.options.maxPasses) {
+      this.stats.passes++;
+      changed = this.rewritePass();
+      changed = this.removeUnusedLabels() || changed;
+    }
+
+    this.stats.removed = before - countInstructions(this.items);
+    return this.items;
+  }
+
+  getStats(): PeepholeStats {
+    return { ...this.stats, hits: { ...this.stats.hits } };
+  }
+
+  private rewritePass(): boolean {
+    let changed = false;
+    for (let position = 0; position < this.items.length; position++) {
+      const kind = this.items[position].kind;
+      if (kind !== 'instruction' && kind !== 'label') continue;
+
+      for (const rule of this.rules) {
+        if (this.tryRule(rule, position)) {
+          this.stats.hits[rule.name]++;
+          changed = true;
+          // Look again from the same place; earlier items may now match too
+          position = Math.max(-1, position - 1 - this.maxPatternLength());
+          break;
+        }
+      }
+    }
+    return changed;
+  }
+
+  private maxPatternLength(): number {
+    return this.rules.reduce((longest, rule) => Math.max(longest, rule.pattern.length), 0);
+  }
+
+  private tryRule(rule: PeepholeRule, start: number): boolean {
+    const positions: number[] = [];
+    const bindings = new Map<string, string | number>();
+
+    let position = start;
+    for (const pattern of rule.pattern) {
+      position = this.nextSignificant(position);
+      if (position < 0 || !matchItem(pattern, this.items[position], bindings)) return false;
+      positions.push(position);
+      position++;
+    }
+
+    const end = positions[positions.length - 1] + 1;
+    if (rule.guard && this.flagsLive(end, rule.guard === 'carry-dead' ? ['C'] : ['Z', 'C'])) {
+      return false;
+    }
+
+    const matched = positions.map((index) => this.items[index]);
+    const replacement = rule.replacement.map((item) => build(item, matched, bindings));
+
+    // Matched items go; comments between them stay after the replacement
+    for (let i = positions.length - 1; i >= 0; i--) {
+      this.items.splice(positions[i], 1);
+    }
+    this.items.splice(start, 0, ...replacement);
+    this.labelPositions = null;
+    return true;
+  }
+
+  /**
+   * Index of the first instruction or label at or after `position`, or -1
+   * at the end of the stream or a directive
+   */
+  private nextSignificant(position: number): number {
+    for (; position < this.items.length; position++) {
+      const kind = this.items[position].kind;
+      if (kind === 'instruction' || kind === 'label') return position;
+      if (kind === 'directive') return -1;
+    }
+    return -1;
+  }
+
+  /**
+   * Whether any of `flags` can be read, on some path from `start`, before
+   * being set
+   */
+  private flagsLive(start: number, flags: ('Z' | 'C')[]): boolean {
+    const visited = new Set<number>();
+    const work = [start];
+
+    while (work.length > 0) {
+      let position = work.pop()!;
+      for (; position < this.items.length; position++) {
+        if (visited.has(position)) break;
+        visited.add(position);
+        const item = this.items[position];
+        if (item.kind === 'directive') return true;
+        if (item.kind !== 'instruction') continue;
+
+        const mnemonic = item.instruction;
+        if (FLAG_WRITERS.has(mnemonic) || mnemonic === 'RET' || mnemonic === 'HLT' || mnemonic === 'CALL') break;
+        if (FLAG_READERS[mnemonic] && flags.includes(FLAG_READERS[mnemonic])) return true;
+        if (mnemonic === 'JMP' || FLAG_READERS[mnemonic]) {
+          const target = this.labelPosition(item.operands[0]);
+          if (target === undefined) return true;
+          work.push(target);
+          if (mnemonic === 'JMP') break;
+        }
+      }
+    }
+    return false;
+  }
+
+  private labelPosition(operand: string | number): number | undefined {
+    if (!this.labelPositions) {
+      this.labelPositions = new Map();
+      this.items.forEach((item, index) => {
+        if (item.kind === 'label') this.labelPositions!.set(item.name, index);
+      });
+    }
+    return typeof operand === 'string' ? this.labelPositions.get(operand) : undefined;
+  }
+
+  private removeUnusedLabels(): boolean {
+    const referenced = new Set<string>(this.options.keepLabels);
+    for (const item of this.items) {
+      if (item.kind !== 'instruction') continue;
+      for (const operand of item.operands) {
+        if (typeof operand === 'string') referenced.add(operand);
+      }
+    }
+
+    const kept = this.items.filter((item) => item.kind !== 'label' || referenced.has(item.name));
+    if (kept.length === this.items.length) return false;
+    this.items = kept;
+    this.labelPositions = null;
+    return true;
+  }
+}
+
+function matchOperand(pattern: OperandPattern, operand: string | number, bindings: Map<string, string | number>): boolean {
+  if (pattern.kind === 'literal') return pattern.value === operand;
+  if (bindings.has(pattern.name)) return bindings.get(pattern.name) === operand;
+  bindings.set(pattern.name, operand);
+  return true;
+}
+
+function matchItem(pattern: PatternItem, item: AssemblyItem, bindings: Map<string, string | number>): boolean {
+  if (pattern.kind === 'label') {
+    return item.kind === 'label' && matchOperand({ kind: 'variable', name: pattern.name }, item.name, bindings);
+  }
+  if (item.kind !== 'instruction') return false;
+  if (pattern.mnemonics === null) return true;
+  if (!pattern.mnemonics.includes(item.instruction) || pattern.operands.length !== item.operands.length) return false;
+  return pattern.operands.every((operand, index) => matchOperand(operand, item.operands[index], bindings));
+}
+
+function build(item: ReplacementItem, matched: AssemblyItem[], bindings: Map<string, string | number>): AssemblyItem {
+  const resolve = (operand: OperandPattern): string | number => {
+    if (operand.kind === 'literal') return operand.value;
+    if (!bindings.has(operand.name)) throw new Error(`Peephole replacement uses unbound $${operand.name}`);
+    return bindings.get(operand.name)!;
+  };
+
+  switch (item.kind) {
+    case 'keep':
+      return matched[item.index];
+    case 'label': {
+      const label: LabelItem = { kind: 'label', name: String(resolve({ kind: 'variable', name: item.name })) };
+      return label;
+    }
+    case 'instruction': {
+      const instruction: InstructionItem = { kind: 'instruction', instruction: item.instruction, operands: item.operands.map(resolve) };
+      return instruction;
+    }
+  }
+}
+
+function countInstructions(items: AssemblyItem[]): number {
+  return items.filter((item) => item.kind === 'instruction').length;
+}
+
+// Factory function for easier usage
+export function optimizePeephole(items: AssemblyItem[], options: PeepholeOptions = {}): AssemblyItem[] {
+  return new PeepholeOptimizer(options).optimize(items);
+}
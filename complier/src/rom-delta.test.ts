@@ -0,0 +1,74 @@
+import * as fs from 'fs';
+import * as os from 'os';
+import * as path from 'path';
+import { diffImages, formatDeltaHex, formatPageScript, parseIntelHex } from './rom-delta';
+import { generateIntelHex } from './compiler';
+import { compileFile } from './cli';
+
+describe('ROM delta', () => {
+  const image = (length: number, seed: number) =>
+    new Uint8Array(Array.from({ length }, (_value, i) => (i * 7 + seed) & 0xFF));
+
+  test('should emit only the pages that changed', () => {
+    const previous = image(256, 1);
+    const next = previous.slice();
+    next[70] ^= 0xFF;
+    next[200] ^= 0x01;
+
+    const delta = diffImages(previous, next);
+
+    expect(delta.totalPages).toBe(4);
+    expect(delta.pages.map((page) => page.address)).toEqual([64, 192]);
+    expect(delta.pages[0].changedBytes).toBe(1);
+    expect(Array.from(delta.pages[0].data)).toEqual(Array.from(next.slice(64, 128)));
+  });
+
+  test('should erase the tail of a shrinking image', () => {
+    const previous = image(100, 3);
+    const next = previous.slice(0, 80);
+
+    const delta = diffImages(previous, next);
+
+    expect(delta.pages.map((page) => page.page)).toEqual([1]);
+    expect(Array.from(delta.pages[0].data.slice(16))).toEqual(new Array(48).fill(0xFF));
+  });
+
+  test('should write page checksums and a delta HEX that loads back', () => {
+    const next = image(128, 5);
+    const delta = diffImages(new Uint8Array(0), next, { pageSize: 64 });
+    const reloaded = parseIntelHex(formatDeltaHex(delta));
+
+    expect(Array.from(reloaded)).toEqual(Array.from(next));
+    const sum = Array.from(next.slice(0, 64)).reduce((total, byte) => total + byte, 0) & 0xFFFF;
+    expect(formatPageScript(delta)).toContain(`PAGE 0x0000 64 SUM16 0x${sum.toString(16).padStart(4, '0').toUpperCase()}`);
+  });
+
+  test('should parse full images and reject corrupt records', () => {
+    const binary = image(40, 9);
+    expect(Array.from(parseIntelHex(generateIntelHex(binary)))).toEqual(Array.from(binary));
+    expect(() => parseIntelHex(':0100000001FF\n')).toThrow('Checksum mismatch');
+  });
+
+  test('should diff against the previous image of the same output format', () => {
+    const workDir = fs.mkdtempSync(path.join(os.tmpdir(), 'cpu8bit-delta-'));
+    const input = path.join(workDir, 'prog.s');
+    const messages: string[] = [];
+    const log = console.log;
+    console.log = (...args: any[]) => { messages.push(args.join(' ')); };
+    const build = (source: string, format: string, delta: boolean) => {
+      fs.writeFileSync(input, source);
+      return compileFile(input, { output: workDir, format, language: 'auto', optimize: '0', delta, pageSize: '64' });
+    };
+
+    try {
+      build('LDI 42\nHLT\n', 'hex', false);
+      build('LDI 7\nHLT\n', 'bin', false);
+      // The stale .bin must not win over the .hex the hex build wrote
+      expect(build('LDI 42\nHLT\n', 'hex', true).exitCode).toBe(0);
+    } finally {
+      console.log = log;
+    }
+
+    expect(messages).toContain('Delta: 0 of 1 page(s) changed');
+  });
+});
@@ -0,0 +1,173 @@
+/**
+ * Page-Aware Delta ROM Images
+ *
+ * The 28C256 writes 64 bytes per page cycle, so reprogramming after a small
+ * fix only needs the pages that changed. This module diffs a new image
+ * against the previous build and emits:
+ *
+ * - A delta Intel HEX file holding only the changed pages. Each page is
+ *   written in full, so a page write never leaves stale bytes behind.
+ * - A page script listing every changed page with its 16-bit sum, so the
+ *   programmer can verify each page right after writing it without
+ *   reading the whole chip back.
+ *
+ * Bytes past the end of the shorter image compare as erased (`fill`), so a
+ * program that shrinks still clears its old tail.
+ *
+ * @fileoverview Changed-page diffing, delta HEX and verify script output
+ */
+
+import * as fs from 'fs';
+import * as path from 'path';
+import { intelHexRecords } from './compiler';
+
+export interface DeltaOptions {
+  /** EEPROM page size in bytes */
+  pageSize?: number;
+  /** Byte value of erased/unprogrammed locations */
+  fill?: number;
+}
+
+export interface PageDelta {
+  /** Page index (address / pageSize) */
+  page: number;
+  address: number;
+  /** New contents of the whole page */
+  data: Uint8Array;
+  /** Sum of page bytes mod 65536, for verify-after-write */
+  checksum: number;
+  /** Bytes that differ from the previous image */
+  changedBytes: number;
+}
+
+export interface RomDelta {
+  pageSize: number;
+  /** Pages spanned by the larger of the two images */
+  totalPages: number;
+  pages: PageDelta[];
+}
+
+export function diffImages(previous: Uint8Array, next: Uint8Array, options: DeltaOptions = {}): RomDelta {
+  const pageSize = options.pageSize || 64;
+  const fill = options.fill !== undefined ? options.fill : 0xFF;
+  const length = Math.max(previous.length, next.length);
+  const totalPages = Math.ceil(length / pageSize);
+  const pages: PageDelta[] = [];
+
+  for (let page = 0; page < totalPages; page++) {
+    const address = page * pageSize;
+    const data = new Uint8Array(pageSize).fill(fill);
+    let changedBytes = 0;
+
+    for (let i = 0; i < pageSize; i++) {
+      const offset = address + i;
+      const before = offset < previous.length ? previous[offset] : fill;
+      const after = offset < next.length ? next[offset] : fill;
+      data[i] = after;
+      if (before !== after) {
+        changedBytes++;
+      }
+    }
+
+    if (changedBytes > 0) {
+      pages.push({ page, address, data, checksum: pageChecksum(data), changedBytes });
+    }
+  }
+
+  return { pageSize, totalPages, pages };
+}
+
+export function pageChecksum(data: Uint8Array): number {
+  let sum = 0;
+  for (const byte of data) {
+    sum = (sum + byte) & 0xFFFF;
+  }
+  return sum;
+}
+
+/**
+ * Intel HEX containing only the changed pages
+ */
+export function formatDeltaHex(delta: RomDelta): string {
+  const lines: string[] = [];
+  for (const page of delta.pages) {
+    lines.push(...intelHexRecords(page.data, page.address));
+  }
+  lines.push(':00000001FF');
+  return lines.join('\n') + '\n';
+}
+
+/**
+ * Programming script: one line per changed page with its verify checksum
+ */
+export function formatPageScript(delta: RomDelta): string {
+  const lines: string[] = [];
+  lines.push(`; ${delta.pages.length} of ${delta.totalPages} page(s) changed, ${delta.pageSize}-byte pages`);
+  lines.push('; PAGE <address> <length> SUM16 <sum of page bytes mod 65536>');
+
+  for (const page of delta.pages) {
+    const address = page.address.toString(16).padStart(4, '0').toUpperCase();
+    const checksum = page.checksum.toString(16).padStart(4, '0').toUpperCase();
+    lines.push(`PAGE 0x${address} ${page.data.length} SUM16 0x${checksum}    ; ${page.changedBytes} byte(s) changed`);
+  }
+  return lines.join('\n') + '\n';
+}
+
+/**
+ * Parses Intel HEX data records (type 00) into a flat image
+ */
+export function parseIntelHex(text: string, fill: number = 0xFF): Uint8Array {
+  const records: { address: number; data: number[] }[] = [];
+  let end = 0;
+
+  text.split(/\r?\n/).forEach((line, index) => {
+    const record = line.trim();
+    if (record.length === 0) return;
+    if (!/^:([0-9A-Fa-f]{2})+$/.test(record)) {
+      throw new Error(`Line ${index + 1}: Invalid Intel HEX record`);
+    }
+
+    const bytes = record.slice(1).match(/../g)!.map((pair) => parseInt(pair, 16));
+    const count = bytes[0];
+    if (bytes.length !== count + 5) {
+      throw new Error(`Line ${index + 1}: Record length mismatch`);
+    }
+    if (bytes.reduce((sum, byte) => sum + byte, 0) % 256 !== 0) {
+      throw new Error(`Line ${index + 1}: Checksum mismatch`);
+    }
+    if (bytes[3] !== 0x00) return;
+
+    const address = (bytes[1] << 8) | bytes[2];
+    records.push({ address, data: bytes.slice(4, 4 + count) });
+    end = Math.max(end, address + count);
+  });
+
+  const image = new Uint8Array(end).fill(fill);
+  for (const record of records) {
+    image.set(record.data, record.address);
+  }
+  return image;
+}
+
+/**
+ * Reads a .bin or Intel HEX (.hex) image
+ */
+export function readImage(filePath: string): Uint8Array {
+  if (path.extname(filePath).toLowerCase() === '.hex') {
+    return parseIntelHex(fs.readFileSync(filePath, 'utf-8'));
+  }
+  return new Uint8Array(fs.readFileSync(filePath));
+}
+
+/**
+ * Writes `<basePath>.delta.hex` and `<basePath>.pages`; returns their paths
+ */
+export function writeDelta(previous: Uint8Array, next: Uint8Array, basePath: string, options: DeltaOptions = {}): { delta: RomDelta; files: string[] } {
+  const delta = diffImages(previous, next, options);
+  const hexPath = basePath + '.delta.hex';
+  const scriptPath = basePath + '.pages';
+
+  fs.writeFileSync(hexPath, formatDeltaHex(delta));
+  fs.writeFileSync(scriptPath, formatPageScript(delta));
+  return { delta, files: [hexPath, scriptPath] };
+}
@@ -0,0 +1,69 @@
+import { Superoptimizer, harvestSequences } from './superopt';
+import { SUPEROPTIMIZED_PEEPHOLE_RULES } from './peephole';
+import { AssemblyItem } from './assembly-stream';
+
+const ins = (instruction: string, ...operands: (string | number)[]): AssemblyItem =>
+  ({ kind: 'instruction', instruction, operands });
+
+describe('Superoptimizer', () => {
+  test('should find the shortest equivalent, guarded only as far as needed', () => {
+    const optimizer = new Superoptimizer();
+
+    expect(optimizer.optimize('NOT ; NOT').rules.map((rule) => [rule.replacement, rule.guard])).toEqual([['', null]]);
+    expect(optimizer.optimize('MOV B, A ; MOV A, B').rules[0].rule).toMatch(/^super-mov-mov: +MOV B, A ; MOV A, B +=> #1$/);
+
+    // ~(~a + 1) is a - 1, but ADI sets the flags where NOT does not
+    const decrement = optimizer.optimize('NOT ; ADI 1 ; NOT').rules;
+    expect(decrement.map((rule) => [rule.replacement, rule.guard])).toEqual([['ADI 255', 'flags-dead']]);
+
+    // Dropping both needs dead flags; ADI 0 still sets Z like the pair
+    const cancel = optimizer.optimize('ADI $k ; SUI $k').rules;
+    expect(cancel.map((rule) => [rule.replacement, rule.guard])).toEqual([['', 'flags-dead'], ['ADI 0', 'carry-dead']]);
+    expect(cancel[1].bytesSaved).toBe(2);
+  });
+
+  test('should verify over every input, including aliased addresses', () => {
+    const optimizer = new Superoptimizer();
+
+    expect(optimizer.verify('LDI 0 ; STA $a ; LDA $b ; SUI 0', '#1 ; #2 ; ADD $b')).toBe('none');
+    expect(optimizer.verify('ADD $x ; ORI 0', '#1')).toBe('carry-dead');
+    // Equal only when $a and $b are the same byte
+    expect(optimizer.verify('STA $a ; LDA $b', '#1')).toBe(false);
+    expect(optimizer.verify('XRI $k ; XRI $k', '')).toBe('flags-dead');
+    // A dropped store of 0 must not pass because the state started at 0
+    expect(optimizer.verify('LDI 0 ; STA $a ; LDI 1', 'LDI 1')).toBe(false);
+    expect(optimizer.verify('LDI 0 ; MOV B, A ; LDI 1', 'LDI 1')).toBe(false);
+    expect(() => optimizer.verify('NOT', 'LDI $k')).toThrow(/does not bind/);
+    expect(() => optimizer.optimize('JMP $l ; NOP')).toThrow(/straight-line/);
+  });
+
+  test('should harvest straight-line windows with abstracted operands', () => {
+    const items: AssemblyItem[] = [
+      ins('LDA', 0x80), ins('ADI', 7), ins('STA', 0x80),
+      { kind: 'label', name: 'L' },
+      ins('LDA', 0x81), ins('ADI', 9), ins('STA', 0x81),
+      ins('JZ', 'L'),
+      ins('ANI', 255), ins('NOT')
+    ];
+    const harvested = harvestSequences(items, 3);
+
+    expect(harvested[0]).toEqual({ pattern: 'ADI $k0 ; STA $a0', count: 2 });
+    expect(harvested.map((sequence) => sequence.pattern)).toContain('LDA $a0 ; ADI $k0 ; STA $a0');
+    expect(harvested.map((sequence) => sequence.pattern)).toContain('ANI 255 ; NOT');
+    expect(harvested.every((sequence) => !sequence.pattern.includes('JZ'))).toBe(true);
+  });
+
+  test('should prove the rules it contributed to the peephole optimizer', () => {
+    const optimizer = new Superoptimizer();
+    const strength = [null, 'carry-dead', 'flags-dead'];
+    const lines = SUPEROPTIMIZED_PEEPHOLE_RULES.split('\n').map((line) => line.replace(/#(?!\d).*$/, '').trim()).filter((line) => line !== '');
+
+    expect(lines.length).toBeGreaterThan(0);
+    for (const line of lines) {
+      const [, pattern, replacement, guard] = line.match(/^[\w-]+:\s*(.*?)\s*=>\s*(.*?)\s*(?:\bif\s+([\w-]+))?$/)!;
+      const needed = optimizer.verify(pattern, replacement);
+      expect(needed).not.toBe(false);
+      expect(strength.indexOf(needed === 'none' ? null : needed)).toBeLessThanOrEqual(strength.indexOf(guard || null));
+    }
+  });
+});
@@ -0,0 +1,734 @@
+/**
+ * Superoptimizer for Straight-Line Instruction Sequences
+ *
+ * Offline search for the shortest instruction sequence equivalent to a
+ * target snippet, emitted as a rule in the peephole DSL (see peephole.ts).
+ * The straight-line instructions (loads, stores, the ALU operations, NOT
+ * and MOV between A and B) only touch 8-bit state, so equivalence can be
+ * checked over every input instead of sampled:
+ *
+ * - Candidates of up to `maxLength` instructions, and fewer than the
+ *   target has, are enumerated from the target's operands and a few
+ *   constants
+ * - Each candidate first runs against the target on 256 sample states;
+ *   the survivors are run over the whole input space: A, B and each
+ *   memory operand if either sequence reads it, and every immediate
+ *   variable. B and cells that are never read start at 0 and again at
+ *   0xA5, so a dropped store shows up even when it writes one of them.
+ *   Memory operands are also tried aliasing the same byte. The
+ *   incoming flags are never read, so they are settled without running
+ * - A candidate that only differs in the flags becomes a rule guarded by
+ *   `if carry-dead` or `if flags-dead`
+ *
+ * The shortest verified candidate wins, then the one with the weakest
+ * guard, then the fewest cycles (instructionCycles()).
+ *
+ * `harvestSequences()` collects targets from generated code: runs of these
+ * instructions with memory addresses and immediates replaced by variables
+ * (0, 1, 128 and 255 stay literal). `cpu8bit superopt` compiles C programs,
+ * harvests their output and prints the rules found; they are reviewed and
+ * added to DEFAULT_PEEPHOLE_RULES.
+ *
+ * @fileoverview Exhaustively verified search for peephole rules
+ */
+
+import { AssemblyItem, InstructionItem } from './assembly-stream';
+import { instructionBytes, instructionCycles } from './instruction-set';
+import { PeepholeGuard, PeepholeRule, PeepholeOptimizer, DEFAULT_PEEPHOLE_RULES, parsePeepholeRules } from './peephole';
+import { createRandom } from './bench/corpus';
+import { CTokenizer } from './languages/c-tokenizer';
+import { CParser } from './languages/c-parser';
+import { CToAssemblyGenerator } from './languages/c-generator';
+import { OptimizationLevel } from './ir/pass-manager';
+
+export interface SuperoptimizerOptions {
+  /** Longest replacement searched, in instructions */
+  maxLength?: number;
+  /** Immediates tried besides the target's own */
+  constants?: number[];
+  /**
+   * Most 8-bit inputs a target may read (A, B if read, memory operands,
+   * immediates); verification visits 256^n states
+   */
+  maxInputs?: number;
+}
+
+export interface SuperoptimizedRule {
+  /** Equivalent sequence, possibly empty */
+  replacement: string;
+  guard: PeepholeGuard | null;
+  /** The rule in the peephole DSL */
+  rule: string;
+  bytesSaved: number;
+  cyclesSaved: number;
+}
+
+export interface SuperoptimizerResult {
+  /** Target snippet, normalized */
+  target: string;
+  /** The shortest replacement, then longer ones needing a weaker guard */
+  rules: SuperoptimizedRule[];
+  /** Why the target was not searched */
+  skipped?: string;
+}
+
+export interface ProgramSearchOptions extends SuperoptimizerOptions {
+  /** Level the programs are compiled at; from 1 the existing rules have run */
+  optimizationLevel?: OptimizationLevel;
+  /** Only search sequences seen at least this often */
+  minCount?: number;
+}
+
+export interface HarvestedSequence {
+  pattern: string;
+  /** Occurrences in the harvested code */
+  count: number;
+}
+
+type Operand =
+  | { kind: 'constant'; value: number }
+  | { kind: 'immediate'; index: number }
+  | { kind: 'memory'; index: number }
+  /** MOV: the destination register */
+  | { kind: 'register'; name: 'A' | 'B' };
+
+interface Op {
+  instruction: string;
+  operand: Operand | null;
+}
+
+interface Snippet {
+  ops: Op[];
+  immediates: string[];
+  memories: string[];
+}
+
+interface Candidate {
+  ops: Op[];
+  /** Index into GUARDS */
+  guard: number;
+  cycles: number;
+}
+
+const IMMEDIATE_INSTRUCTIONS = ['LDI', 'ADI', 'SUI', 'ANI', 'ORI', 'XRI'];
+const MEMORY_INSTRUCTIONS = ['LDA', 'STA', 'ADD', 'SUB', 'AND', 'OR', 'XOR'];
+const MEMORY_READS = new Set(['LDA', 'ADD', 'SUB', 'AND', 'OR', 'XOR']);
+const FLAG_WRITERS = new Set(['ADI', 'ADD', 'SUI', 'SUB', 'ANI', 'AND', 'ORI', 'OR', 'XRI', 'XOR']);
+/** Immediates kept literal when harvesting; most identities hinge on them */
+const SPECIAL_CONSTANTS = [0, 1, 128, 255];
+
+// State layout: registers, flags, then one byte per memory cell
+const A = 0;
+const B = 1;
+const Z = 2;
+const C = 3;
+const MEMORY = 4;
+
+/** States run side by side: each value of A when verifying, or samples */
+const LANES = 256;
+
+interface State {
+  /** Per slot of the layout above, one value per lane */
+  slots: Int32Array[];
+  immediates: Int32Array[];
+}
+
+/** Runs a compiled sequence on every lane of a state in place */
+type Program = (state: State) => void;
+
+/** Differences allowed by a guard, from none to both flags */
+const GUARDS: (PeepholeGuard | null)[] = [null, 'carry-dead', 'flags-dead'];
+
+function parseSnippet(text: string, names: Snippet = { ops: [], immediates: [], memories: [] }): Snippet {
+  const snippet: Snippet = { ops: [], immediates: names.immediates.slice(), memories: names.memories.slice() };
+  const variable = (list: string[], other: string[], name: string): number => {
+    if (other.includes(name)) throw new Error(`$${name} is used as both an address and an immediate`);
+    if (!list.includes(name)) list.push(name);
+    return list.indexOf(name);
+  };
+
+  for (const part of text.split(';').map((item) => item.trim()).filter((item) => item !== '')) {
+    const [mnemonic, ...rest] = part.split(/[\s,]+/);
+    const instruction = mnemonic.toUpperCase();
+    const operand = rest[0];
+
+    if (instruction === 'NOT' && rest.length === 0) {
+      snippet.ops.push({ instruction, operand: null });
+    } else if (instruction === 'MOV' && rest.length === 2 && rest[0] !== rest[1] && /^[AB]$/.test(rest[0]) && /^[AB]$/.test(rest[1])) {
+      snippet.ops.push({ instruction, operand: { kind: 'register', name: rest[0] as 'A' | 'B' } });
+    } else if (IMMEDIATE_INSTRUCTIONS.includes(instruction) && rest.length === 1) {
+      snippet.ops.push({
+        instruction,
+        operand: operand.startsWith('$')
+          ? { kind: 'immediate', index: variable(snippet.immediates, snippet.memories, operand.slice(1)) }
+          : { kind: 'constant', value: parseConstant(operand, part) }
+      });
+    } else if (MEMORY_INSTRUCTIONS.includes(instruction) && rest.length === 1 && operand.startsWith('$')) {
+      snippet.ops.push({ instruction, operand: { kind: 'memory', index: variable(snippet.memories, snippet.immediates, operand.slice(1)) } });
+    } else {
+      throw new Error(`Not a straight-line instruction the superoptimizer handles: ${part}`);
+    }
+  }
+  return snippet;
+}
+
+function parseConstant(text: string, part: string): number {
+  const value = Number(text);
+  if (!/^(0x[0-9a-f]+|\d+)$/i.test(text) || value > 0xFF) throw new Error(`Expected a byte or a $variable: ${part}`);
+  return value;
+}
+
+function renderOp(op: Op, snippet: Snippet): string {
+  const operand = op.operand;
+  if (!operand) return op.instruction;
+  switch (operand.kind) {
+    case 'constant': return `${op.instruction} ${operand.value}`;
+    case 'immediate': return `${op.instruction} $${snippet.immediates[operand.index]}`;
+    case 'memory': return `${op.instruction} $${snippet.memories[operand.index]}`;
+    case 'register': return `MOV ${operand.name}, ${operand.name === 'A' ? 'B' : 'A'}`;
+  }
+}
+
+function renderOps(ops: Op[], snippet: Snippet): string {
+  return ops.map((op) => renderOp(op, snippet)).join(' ; ');
+}
+
+function cost(ops: Op[]): { bytes: number; cycles: number } {
+  return {
+    bytes: ops.reduce((total, op) => total + instructionBytes(op.instruction), 0),
+    cycles: ops.reduce((total, op) => total + instructionCycles(op.instruction), 0)
+  };
+}
+
+function createState(cells: number, immediates: number): State {
+  const lanes = () => new Int32Array(LANES);
+  return { slots: Array.from({ length: MEMORY + cells }, lanes), immediates: Array.from({ length: immediates }, lanes) };
+}
+
+function copySlots(from: State, to: State): void {
+  from.slots.forEach((lanes, slot) => to.slots[slot].set(lanes));
+}
+
+/**
+ * Compiles `ops` to closures with operand slots resolved; `cells` maps
+ * memory variables to cells. Each instruction is a loop over the lanes,
+ * so verification pays for dispatch once per 256 states.
+ */
+function compile(ops: Op[], cells: number[]): Program {
+  const steps = ops.map((op) => compileOp(op, cells));
+  return (state) => {
+    for (let i = 0; i < steps.length; i++) steps[i](state);
+  };
+}
+
+function compileOp(op: Op, cells: number[]): Program {
+  const operand = op.operand;
+  const constant = operand !== null && operand.kind === 'constant' ? new Int32Array(LANES).fill(operand.value) : null;
+  const slot = operand !== null && operand.kind === 'memory' ? MEMORY + cells[operand.index] : B;
+  const source = (state: State): Int32Array =>
+    constant !== null ? constant : operand !== null && operand.kind === 'immediate' ? state.immediates[operand.index] : state.slots[slot];
+
+  switch (op.instruction) {
+    case 'LDI': case 'LDA':
+      return (state) => state.slots[A].set(source(state));
+    case 'STA':
+      return (state) => state.slots[slot].set(state.slots[A]);
+    case 'ADI': case 'ADD':
+      return (state) => {
+        const [a, , z, c] = state.slots;
+        const value = source(state);
+        for (let i = 0; i < LANES; i++) {
+          const sum = a[i] + value[i];
+          c[i] = sum > 0xFF ? 1 : 0;
+          a[i] = sum & 0xFF;
+          z[i] = a[i] === 0 ? 1 : 0;
+        }
+      };
+    case 'SUI': case 'SUB':
+      return (state) => {
+        const [a, , z, c] = state.slots;
+        const value = source(state);
+        for (let i = 0; i < LANES; i++) {
+          c[i] = a[i] < value[i] ? 1 : 0;
+          a[i] = (a[i] - value[i]) & 0xFF;
+          z[i] = a[i] === 0 ? 1 : 0;
+        }
+      };
+    case 'ANI': case 'AND': case 'ORI': case 'OR': case 'XRI': case 'XOR': {
+      const kind = op.instruction[0];
+      return (state) => {
+        const [a, , z, c] = state.slots;
+        const value = source(state);
+        for (let i = 0; i < LANES; i++) {
+          a[i] = kind === 'A' ? a[i] & value[i] : kind === 'O' ? a[i] | value[i] : a[i] ^ value[i];
+          z[i] = a[i] === 0 ? 1 : 0;
+          c[i] = 0;
+        }
+      };
+    }
+    case 'NOT':
+      return (state) => {
+        const a = state.slots[A];
+        for (let i = 0; i < LANES; i++) a[i] = ~a[i] & 0xFF;
+      };
+    case 'MOV':
+      return operand !== null && operand.kind === 'register' && operand.name === 'B'
+        ? (state) => state.slots[B].set(state.slots[A])
+        : (state) => state.slots[A].set(state.slots[B]);
+    default:
+      throw new Error(`Cannot run ${op.instruction}`);
+  }
+}
+
+function sameLanes(x: Int32Array, y: Int32Array): boolean {
+  for (let i = 0; i < LANES; i++) {
+    if (x[i] !== y[i]) return false;
+  }
+  return true;
+}
+
+/**
+ * Index into GUARDS of the weakest guard under which the two end states
+ * agree in every lane, or -1 if they differ in A, B or memory
+ */
+function agreement(x: State, y: State): number {
+  for (let slot = 0; slot < x.slots.length; slot++) {
+    if (slot !== Z && slot !== C && !sameLanes(x.slots[slot], y.slots[slot])) return -1;
+  }
+  return !sameLanes(x.slots[Z], y.slots[Z]) ? 2 : !sameLanes(x.slots[C], y.slots[C]) ? 1 : 0;
+}
+
+/**
+ * Guard needed for the incoming flags alone. No instruction reads the
+ * flags and each writes both or neither, so if only one sequence writes
+ * them, some incoming flags tell the two apart; otherwise they never do,
+ * and states can start with both clear.
+ */
+function flagWriteGuard(target: Op[], ops: Op[]): number {
+  const writesFlags = (sequence: Op[]) => sequence.some((op) => FLAG_WRITERS.has(op.instruction));
+  return writesFlags(target) === writesFlags(ops) ? 0 : 2;
+}
+
+/**
+ * Every way of letting memory variables alias: cells[variable] per
+ * partition (restricted growth strings)
+ */
+function partitions(count: number): number[][] {
+  const result: number[][] = [];
+  const extend = (cells: number[], classes: number) => {
+    if (cells.length === count) {
+      result.push(cells);
+      return;
+    }
+    for (let cell = 0; cell <= classes; cell++) {
+      extend([...cells, cell], Math.max(classes, cell + 1));
+    }
+  };
+  extend([], 0);
+  return result;
+}
+
+/** Starting values of B and cells that no sequence reads */
+const UNREAD_SEEDS = [0, 0xA5];
+
+/** Whether `ops` reads B (MOV A, B) */
+function readsB(ops: Op[]): boolean {
+  return ops.some((op) => op.operand !== null && op.operand.kind === 'register' && op.operand.name === 'A');
+}
+
+/**
+ * Inputs an 8-bit value is enumerated for: A, B if read, and the memory
+ * cells read (per partition); immediates come on top
+ */
+function readInputs(sequences: Op[][], cells: number[]): { readsB: boolean; cells: number[] } {
+  const read = new Set<number>();
+  for (const ops of sequences) {
+    for (const op of ops) {
+      if (op.operand && op.operand.kind === 'memory' && MEMORY_READS.has(op.instruction)) read.add(cells[op.operand.index]);
+    }
+  }
+  return { readsB: sequences.some(readsB), cells: [...read].sort((x, y) => x - y) };
+}
+
+export class Superoptimizer {
+  private options: Required<SuperoptimizerOptions>;
+
+  constructor(options: SuperoptimizerOptions = {}) {
+    this.options = {
+      maxLength: options.maxLength !== undefined ? options.maxLength : 3,
+      constants: options.constants || [0, 1, 255],
+      maxInputs: options.maxInputs || 3
+    };
+  }
+
+  /**
+   * Searches for the shortest sequence equivalent to `target`, e.g.
+   * `NOT ; ADI 1 ; NOT` (operands `$name` are variables). When that one
+   * needs a guard, longer replacements with a weaker guard follow, as long
+   * as they are shorter than the target.
+   */
+  optimize(target: string, name?: string): SuperoptimizerResult {
+    const snippet = parseSnippet(target);
+    const normalized = renderOps(snippet.ops, snippet);
+    const result: SuperoptimizerResult = { target: normalized, rules: [] };
+
+    const inputs = 1 + (readsB(snippet.ops) ? 1 : 0) + snippet.immediates.length + snippet.memories.length;
+    if (inputs > this.options.maxInputs) {
+      result.skipped = `${inputs} inputs, more than ${this.options.maxInputs}`;
+      return result;
+    }
+
+    const pool = this.candidatePool(snippet);
+    const layouts = partitions(snippet.memories.length);
+    const samples = layouts.map((cells) => this.sampleStates(snippet, cells));
+    const targetCost = cost(snippet.ops);
+    const baseName = name || ruleName(snippet);
+
+    // Guards at least this strong are covered by a shorter rule already
+    let covered = GUARDS.length;
+    const better = (candidate: Candidate, than: Candidate | null) => candidate.guard < covered &&
+      (than === null || candidate.guard < than.guard || (candidate.guard === than.guard && candidate.cycles < than.cycles));
+    const limit = Math.min(this.options.maxLength, snippet.ops.length - 1);
+    for (let length = 0; length <= limit && covered > 0; length++) {
+      let best = null as Candidate | null;
+      this.enumerate(pool, length, (ops) => {
+        const candidate: Candidate = { ops, guard: this.checkSamples(snippet, ops, layouts, samples), cycles: cost(ops).cycles };
+        if (candidate.guard < 0 || !better(candidate, best)) return;
+        // Samples can only miss differences, so verifying may need a stricter guard
+        candidate.guard = this.checkAll(snippet, ops, layouts);
+        if (candidate.guard >= 0 && better(candidate, best)) {
+          best = { ...candidate, ops: ops.slice() };
+        }
+      });
+      if (best === null) continue;
+
+      const replacementCost = cost(best.ops);
+      const guard = GUARDS[best.guard];
+      const ruleIndex = result.rules.length;
+      result.rules.push({
+        replacement: renderOps(best.ops, snippet),
+        guard,
+        rule: formatRule(ruleIndex === 0 ? baseName : `${baseName}-${ruleIndex + 1}`, normalized, keepMatched(snippet, best.ops), guard),
+        bytesSaved: targetCost.bytes - replacementCost.bytes,
+        cyclesSaved: targetCost.cycles - replacementCost.cycles
+      });
+      covered = best.guard;
+    }
+    return result;
+  }
+
+  /**
+   * Weakest guard under which `replacement` is equivalent to `target` over
+   * all inputs ('none' if it always is), or false. `#n` in the replacement
+   * stands for the target's n-th instruction, as in the peephole DSL.
+   */
+  verify(target: string, replacement: string): PeepholeGuard | 'none' | false {
+    const snippet = parseSnippet(target);
+    const resolved = replacement.split(';').map((item) => item.trim()).filter((item) => item !== '').map((item) => {
+      if (!/^#\d+$/.test(item)) return item;
+      const kept = snippet.ops[Number(item.slice(1)) - 1];
+      if (!kept) throw new Error(`${item} is outside the target`);
+      return renderOp(kept, snippet);
+    }).join(' ; ');
+    const parsed = parseSnippet(resolved, snippet);
+    if (parsed.immediates.length > snippet.immediates.length || parsed.memories.length > snippet.memories.length) {
+      throw new Error(`Replacement uses variables the target does not bind: ${replacement}`);
+    }
+    const guard = this.checkAll(snippet, parsed.ops, partitions(snippet.memories.length));
+    return guard < 0 ? false : GUARDS[guard] || 'none';
+  }
+
+  /**
+   * Index into GUARDS of the weakest guard under which `ops` matches the
+   * target on every input, or -1
+   */
+  private checkAll(target: Snippet, ops: Op[], layouts: number[][]): number {
+    let weakest = flagWriteGuard(target.ops, ops);
+    for (const cells of layouts) {
+      const reads = readInputs([target.ops, ops], cells);
+      const slots = [...(reads.readsB ? [B] : []), ...reads.cells.map((cell) => MEMORY + cell)];
+      const cellCount = Math.max(0, ...cells) + 1;
+      // Written-only state must end up the same whatever it held before
+      const unread = [B, ...Array.from({ length: cellCount }, (_, cell) => MEMORY + cell)].filter((slot) => !slots.includes(slot));
+      const start = createState(cellCount, target.immediates.length);
+      const x = { ...createState(cellCount, 0), immediates: start.immediates };
+      const y = { ...createState(cellCount, 0), immediates: start.immediates };
+      start.slots[A].forEach((_, lane) => { start.slots[A][lane] = lane; });
+      const runTarget = compile(target.ops, cells);
+      const runCandidate = compile(ops, cells);
+      // One digit per input besides A: the slots, then the immediates
+      const digits = new Array<number>(slots.length + start.immediates.length).fill(0);
+
+      for (const seed of unread.length > 0 ? UNREAD_SEEDS : [0]) {
+        unread.forEach((slot) => start.slots[slot].fill(seed));
+        for (;;) {
+          slots.forEach((slot, i) => start.slots[slot].fill(digits[i]));
+          start.immediates.forEach((lanes, i) => lanes.fill(digits[slots.length + i]));
+          copySlots(start, x);
+          copySlots(start, y);
+          runTarget(x);
+          runCandidate(y);
+          const guard = agreement(x, y);
+          if (guard < 0) return -1;
+          weakest = Math.max(weakest, guard);
+
+          let digit = 0;
+          while (digit < digits.length && digits[digit] === 0xFF) digits[digit++] = 0;
+          if (digit === digits.length) break;
+          digits[digit]++;
+        }
+      }
+    }
+    return weakest;
+  }
+
+  private candidatePool(snippet: Snippet): Op[] {
+    const pool: Op[] = [{ instruction: 'NOT', operand: null }];
+    const immediates: Operand[] = [
+      ...snippet.immediates.map((_, index): Operand => ({ kind: 'immediate', index })),
+      ...[...new Set([
+        ...this.options.constants,
+        ...snippet.ops.map((op) => op.operand && op.operand.kind === 'constant' ? op.operand.value : -1).filter((value) => value >= 0)
+      ])].map((value): Operand => ({ kind: 'constant', value }))
+    ];
+    for (const instruction of IMMEDIATE_INSTRUCTIONS) {
+      for (const operand of immediates) pool.push({ instruction, operand });
+    }
+    for (const instruction of MEMORY_INSTRUCTIONS) {
+      snippet.memories.forEach((_, index) => pool.push({ instruction, operand: { kind: 'memory', index } }));
+    }
+    pool.push({ instruction: 'MOV', operand: { kind: 'register', name: 'A' } });
+    pool.push({ instruction: 'MOV', operand: { kind: 'register', name: 'B' } });
+
+    // The target's own instructions first: among equal candidates the first
+    // found wins, and kept instructions keep their comments
+    const own = new Map<string, Op>();
+    for (const op of [...snippet.ops, ...pool]) {
+      const text = renderOp(op, snippet);
+      if (!own.has(text)) own.set(text, op);
+    }
+    return [...own.values()];
+  }
+
+  private enumerate(pool: Op[], length: number, visit: (ops: Op[]) => void): void {
+    const ops: Op[] = [];
+    const extend = () => {
+      if (ops.length === length) {
+        visit(ops);
+        return;
+      }
+      for (const op of pool) {
+        ops.push(op);
+        extend();
+        ops.pop();
+      }
+    };
+    extend();
+  }
+
+  /**
+   * One lane per sample state; the first lanes draw from the edge values
+   */
+  private sampleStates(snippet: Snippet, cells: number[]): { start: State; x: State; y: State } {
+    const random = createRandom(1);
+    const cellCount = Math.max(0, ...cells) + 1;
+    const start = createState(cellCount, snippet.immediates.length);
+    for (const lanes of [...start.slots.filter((_, slot) => slot !== Z && slot !== C), ...start.immediates]) {
+      for (let lane = 0; lane < LANES; lane++) {
+        lanes[lane] = lane < 16 ? SPECIAL_CONSTANTS[Math.floor(random() * SPECIAL_CONSTANTS.length)] : Math.floor(random() * 256);
+      }
+    }
+    return {
+      start,
+      x: { ...createState(cellCount, 0), immediates: start.immediates },
+      y: { ...createState(cellCount, 0), immediates: start.immediates }
+    };
+  }
+
+  private checkSamples(snippet: Snippet, ops: Op[], layouts: number[][], samples: { start: State; x: State; y: State }[]): number {
+    let weakest = flagWriteGuard(snippet.ops, ops);
+    for (let layout = 0; layout < layouts.length; layout++) {
+      const { start, x, y } = samples[layout];
+      copySlots(start, x);
+      copySlots(start, y);
+      compile(snippet.ops, layouts[layout])(x);
+      compile(ops, layouts[layout])(y);
+      const guard = agreement(x, y);
+      if (guard < 0) return -1;
+      weakest = Math.max(weakest, guard);
+    }
+    return weakest;
+  }
+}
+
+function ruleName(snippet: Snippet): string {
+  return `super-${snippet.ops.map((op) => op.instruction.toLowerCase()).join('-')}`;
+}
+
+/**
+ * Replacement text with `#n` for instructions kept from the target, so
+ * their comments survive the rewrite
+ */
+function keepMatched(snippet: Snippet, ops: Op[]): string {
+  const targetTexts = snippet.ops.map((op) => renderOp(op, snippet));
+  const used = new Set<number>();
+  return ops.map((op) => {
+    const text = renderOp(op, snippet);
+    const index = targetTexts.findIndex((candidate, i) => candidate === text && !used.has(i));
+    if (index < 0) return text;
+    used.add(index);
+    return `#${index + 1}`;
+  }).join(' ; ');
+}
+
+/**
+ * One rule line in the layout of DEFAULT_PEEPHOLE_RULES
+ */
+export function formatRule(name: string, pattern: string, replacement: string, guard: PeepholeGuard | null): string {
+  const line = `${`${name}: `.padEnd(21)}${`${pattern} `.padEnd(32)}=> ${replacement}`;
+  return guard ? `${`${line} `.padEnd(70)}if ${guard}` : line.trimEnd();
+}
+
+/**
+ * Straight-line windows of 2..maxLength instructions in generated code,
+ * with operands abstracted to variables, most frequent first. Labels,
+ * directives and other instructions end a window; comments do not.
+ */
+export function harvestSequences(items: AssemblyItem[], maxLength: number = 4): HarvestedSequence[] {
+  const counts = new Map<string, number>();
+  let run: { instruction: string; operands: (string | number)[] }[] = [];
+
+  const flush = () => {
+    for (let start = 0; start < run.length; start++) {
+      for (let end = start + 2; end <= Math.min(run.length, start + maxLength); end++) {
+        const pattern = abstractWindow(run.slice(start, end));
+        counts.set(pattern, (counts.get(pattern) || 0) + 1);
+      }
+    }
+    run = [];
+  };
+
+  for (const item of items) {
+    if (item.kind === 'comment' || item.kind === 'blank') continue;
+    if (item.kind === 'instruction' && isStraightLine(item.instruction, item.operands)) {
+      run.push(item);
+    } else {
+      flush();
+    }
+  }
+  flush();
+
+  return [...counts.entries()]
+    .map(([pattern, count]) => ({ pattern, count }))
+    .sort((x, y) => y.count - x.count || x.pattern.localeCompare(y.pattern));
+}
+
+function isStraightLine(instruction: string, operands: (string | number)[]): boolean {
+  if (instruction === 'NOT') return true;
+  if (instruction === 'MOV') return operands.length === 2 && operands[0] !== operands[1] && operands.every((operand) => operand === 'A' || operand === 'B');
+  return (IMMEDIATE_INSTRUCTIONS.includes(instruction) || MEMORY_INSTRUCTIONS.includes(instruction)) && operands.length === 1;
+}
+
+function abstractWindow(window: { instruction: string; operands: (string | number)[] }[]): string {
+  const memories: (string | number)[] = [];
+  const immediates: (string | number)[] = [];
+  const variable = (list: (string | number)[], prefix: string, operand: string | number) => {
+    if (!list.includes(operand)) list.push(operand);
+    return `$${prefix}${list.indexOf(operand)}`;
+  };
+
+  return window.map((item) => {
+    const operand = item.operands[0];
+    if (item.instruction === 'NOT') return 'NOT';
+    if (item.instruction === 'MOV') return `MOV ${item.operands.join(', ')}`;
+    if (MEMORY_INSTRUCTIONS.includes(item.instruction)) return `${item.instruction} ${variable(memories, 'a', operand)}`;
+    if (typeof operand === 'number' && SPECIAL_CONSTANTS.includes(operand)) return `${item.instruction} ${operand}`;
+    return `${item.instruction} ${variable(immediates, 'k', operand)}`;
+  }).join(' ; ');
+}
+
+/**
+ * Flags read after a match, in code that allows `guard`: C and Z (an
+ * unknown jump target), only Z, or none
+ */
+const FLAG_READS: Record<string, AssemblyItem[]> = {
+  none: [{ kind: 'instruction', instruction: 'JC', operands: ['UNKNOWN'] }],
+  'carry-dead': [
+    { kind: 'instruction', instruction: 'JZ', operands: ['L'] },
+    { kind: 'instruction', instruction: 'HLT', operands: [] },
+    { kind: 'label', name: 'L' },
+    { kind: 'instruction', instruction: 'HLT', operands: [] }
+  ],
+  'flags-dead': [{ kind: 'instruction', instruction: 'HLT', operands: [] }]
+};
+
+/**
+ * Whether `rules` already shrink `target` to the size of `found` wherever
+ * `found` applies: tried on the target with distinct operands, followed by
+ * code reading the flags its guard allows to change
+ */
+function alreadyCovered(target: string, found: SuperoptimizedRule, rules: PeepholeRule[]): boolean {
+  const snippet = parseSnippet(target);
+  const instantiated = snippet.ops.map((op): InstructionItem => {
+    const operand = op.operand;
+    const operands: (string | number)[] =
+      operand === null ? [] :
+      operand.kind === 'register' ? [operand.name, operand.name === 'A' ? 'B' : 'A'] :
+      operand.kind === 'memory' ? [0x80 + operand.index] :
+      operand.kind === 'immediate' ? [3 + 6 * operand.index] :
+      [operand.value];
+    return { kind: 'instruction', instruction: op.instruction, operands };
+  });
+  const reads = FLAG_READS[found.guard || 'none'];
+  const optimized = new PeepholeOptimizer({ rules, keepLabels: ['L'] }).optimize([...instantiated, ...reads]);
+  const left = optimized.filter((item) => item.kind === 'instruction').length - reads.filter((item) => item.kind === 'instruction').length;
+  const size = found.replacement === '' ? 0 : found.replacement.split(';').length;
+  return left <= size;
+}
+
+/**
+ * Compiles C sources, harvests their straight-line sequences and searches
+ * the frequent ones, shortest first. Rules that DEFAULT_PEEPHOLE_RULES or
+ * a rule found earlier already imply are dropped.
+ */
+export function superoptimizePrograms(
+  sources: string[],
+  options: ProgramSearchOptions = {}
+): { sequence: HarvestedSequence; result: SuperoptimizerResult }[] {
+  const generator = new CToAssemblyGenerator({ optimizationLevel: options.optimizationLevel !== undefined ? options.optimizationLevel : 1 });
+  const optimizer = new Superoptimizer(options);
+  const maxLength = (options.maxLength !== undefined ? options.maxLength : 3) + 1;
+
+  const counts = new Map<string, number>();
+  for (const source of sources) {
+    const parsed = new CParser(new CTokenizer(source).tokenize()).parse();
+    if (parsed.errors.length > 0) {
+      throw new Error(`Parse errors: ${parsed.errors.join(', ')}`);
+    }
+    for (const sequence of harvestSequences(generator.generateItems(parsed.ast), maxLength)) {
+      counts.set(sequence.pattern, (counts.get(sequence.pattern) || 0) + sequence.count);
+    }
+  }
+
+  const rules = parsePeepholeRules(DEFAULT_PEEPHOLE_RULES);
+  const found: { sequence: HarvestedSequence; result: SuperoptimizerResult }[] = [];
+  const length = (pattern: string) => pattern.split(';').length;
+  const targets = [...counts.entries()]
+    .filter(([, count]) => count >= (options.minCount || 1))
+    .sort((x, y) => length(x[0]) - length(y[0]) || y[1] - x[1] || x[0].localeCompare(y[0]));
+
+  for (const [pattern, count] of targets) {
+    const result = optimizer.optimize(pattern);
+    result.rules = result.rules.filter((rule) => !alreadyCovered(result.target, rule, rules));
+    if (result.rules.length === 0) continue;
+    result.rules.forEach((rule) => rules.push(...parsePeepholeRules(rule.rule)));
+    found.push({ sequence: { pattern, count }, result });
+  }
+  return found;
+}
+
+// Factory function for easier usage
+export function superoptimize(targets: string[], options: SuperoptimizerOptions = {}): SuperoptimizerResult[] {
+  const optimizer = new Superoptimizer(options);
+  return targets.map((target) => optimizer.optimize(target));
+}
@@ -0,0 +1,109 @@
+/**
+ * Per-Phase Time Report
+ *
+ * Measures each compiler phase (tokenizing, parsing, code generation, ...)
+ * for `--time-report` / `--stats`:
+ * - Wall time from a monotonic clock
+ * - Heap delta (`heapUsed` after minus before; negative when GC ran)
+ * - Phase-specific item counts (tokens, AST nodes, labels, bytes)
+ * - Throughput in source lines per second
+ *
+ * Reports print as a table and serialize to JSON for trend tracking.
+ *
+ * @fileoverview Phase timing, allocation and count collection
+ */
+
+export interface PhaseStats {
+  name: string;
+  wallMs: number;
+  heapDeltaBytes: number;
+  linesPerSec: number;
+  counts: Record<string, number>;
+}
+
+export interface TimeReport {
+  sourceLines: number;
+  totalMs: number;
+  phases: PhaseStats[];
+}
+
+/**
+ * Lines of a source text; a trailing newline ends the last line rather than
+ * starting another. Shared with the benchmarks so their lines/sec agree.
+ */
+export function countSourceLines(sourceCode: string): number {
+  if (sourceCode.length === 0) return 0;
+  const lines = sourceCode.split('\n').length;
+  return sourceCode.endsWith('\n') ? lines - 1 : lines;
+}
+
+export class PhaseTimer {
+  private sourceLines: number;
+  private phases: PhaseStats[] = [];
+
+  constructor(sourceCode: string) {
+    this.sourceLines = countSourceLines(sourceCode);
+  }
+
+  /**
+   * Runs one phase and records it; `count` extracts item counts from its result
+   */
+  measure<T>(name: string, run: () => T, count?: (result: T) => Record<string, number>): T {
+    const heapBefore = process.memoryUsage().heapUsed;
+    const started = process.hrtime.bigint();
+
+    const result = run();
+
+    const wallMs = Number(process.hrtime.bigint() - started) / 1e6;
+    const heapDeltaBytes = process.memoryUsage().heapUsed - heapBefore;
+
+    this.phases.push({
+      name,
+      wallMs,
+      heapDeltaBytes,
+      linesPerSec: wallMs > 0 ? Math.round(this.sourceLines / (wallMs / 1000)) : 0,
+      counts: count ? count(result) : {}
+    });
+    return result;
+  }
+
+  getReport(): TimeReport {
+    return {
+      sourceLines: this.sourceLines,
+      totalMs: this.phases.reduce((total, phase) => total + phase.wallMs, 0),
+      phases: this.phases.slice()
+    };
+  }
+}
+
+/**
+ * Runs `run` as a timed phase when a timer is active
+ */
+export function measure<T>(
+  timer: PhaseTimer | null,
+  name: string,
+  run: () => T,
+  count?: (result: T) => Record<string, number>
+): T {
+  return timer ? timer.measure(name, run, count) : run();
+}
+
+export function formatTimeReport(report: TimeReport, title: string): string {
+  const lines: string[] = [];
+  lines.push(`Time report: ${title} (${report.sourceLines} lines)`);
+  lines.push(`  ${'Phase'.padEnd(14)}${'Wall ms'.padStart(10)}${'Heap KB'.padStart(11)}${'Lines/s'.padStart(12)}  Counts`);
+
+  for (const phase of report.phases) {
+    const heapKb = phase.heapDeltaBytes / 1024;
+    const counts = Object.entries(phase.counts).map(([key, value]) => `${key}=${value}`).join(' ');
+    lines.push(
+      `  ${phase.name.padEnd(14)}` +
+      `${phase.wallMs.toFixed(3).padStart(10)}` +
+      `${((heapKb >= 0 ? '+' : '') + heapKb.toFixed(1)).padStart(11)}` +
+      `${String(phase.linesPerSec).padStart(12)}  ${counts}`
+    );
+  }
+
+  lines.push(`  ${'total'.padEnd(14)}${report.totalMs.toFixed(3).padStart(10)}`);
+  return lines.join('\n');
+}
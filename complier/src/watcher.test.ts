@@ -0,0 +1,190 @@
+import * as fs from 'fs';
+import * as os from 'os';
+import * as path from 'path';
+import { Tokenizer } from './tokenizer';
+import { Parser } from './parser';
+import { IncrementalParser } from './incremental';
+import { loadSource } from './includes';
+import { BuildWatcher } from './watcher';
+import { CPU8BitCompiler } from './compiler';
+
+const PROGRAM = `
+.ORG 0x00
+MAIN:
+    LDI 10
+LOOP:   SUI 1
+    JNZ LOOP
+    .DB 0x42
+    CALL DONE
+.ORG 0x20
+DONE:
+    HLT
+`;
+
+describe('IncrementalParser', () => {
+  test('should produce the same parse as a full Parser run', () => {
+    const expected = new Parser(new Tokenizer(PROGRAM).tokenize()).parse();
+    const actual = new IncrementalParser().parse(PROGRAM);
+
+    expect(actual.instructions).toEqual(expected.instructions);
+    expect(actual.directives).toEqual(expected.directives);
+    expect(Array.from(actual.labels.entries())).toEqual(Array.from(expected.labels.entries()));
+    expect(actual.errors).toEqual([]);
+  });
+
+  test('should only re-parse edited lines', () => {
+    const parser = new IncrementalParser();
+    parser.parse(PROGRAM);
+
+    const edited = PROGRAM.replace('LDI 10', 'LDI 20\n    NOP');
+    const result = parser.parse(edited);
+
+    expect(parser.getStats().parsed).toBe(2);
+    expect(result.labels.get('LOOP')).toBe(3);
+    expect(result.instructions[1]).toEqual({ instruction: 'NOP', operands: [], line: 5 });
+  });
+
+  test('should place a label before .ORG on the same line at the running address', () => {
+    const source = 'LDI 1\nSTART: .ORG 0x10 ENTRY: NOP\nJMP START\n';
+    const expected = new Parser(new Tokenizer(source).tokenize()).parse();
+    const actual = new IncrementalParser().parse(source);
+
+    expect(Array.from(actual.labels.entries())).toEqual(Array.from(expected.labels.entries()));
+    expect(actual.labels.get('START')).toBe(2);
+    expect(actual.labels.get('ENTRY')).toBe(0x10);
+  });
+
+  test('should report duplicate labels across lines', () => {
+    const result = new IncrementalParser().parse('A:\nNOP\nA:\n');
+    expect(result.errors).toHaveLength(1);
+  });
+});
+
+describe('BuildWatcher', () => {
+  let workDir: string;
+
+  beforeEach(() => {
+    workDir = fs.mkdtempSync(path.join(os.tmpdir(), 'cpu8bit-watch-'));
+    fs.writeFileSync(path.join(workDir, 'io.s'), 'OUT 1\n');
+    fs.writeFileSync(path.join(workDir, 'a.s'), 'LDI 1\n.INCLUDE "io.s"\nHLT\n');
+    fs.writeFileSync(path.join(workDir, 'b.s'), 'LDI 2\nHLT\n');
+  });
+
+  afterEach(() => fs.rmSync(workDir, { recursive: true, force: true }));
+
+  test('should expand includes and report the dependency closure', () => {
+    const loaded = loadSource(path.join(workDir, 'a.s'));
+    expect(loaded.source).toBe('LDI 1\nOUT 1\n\nHLT\n');
+    expect(loaded.dependencies).toEqual([path.join(workDir, 'a.s'), path.join(workDir, 'io.s')]);
+  });
+
+  test('should rebuild only targets whose dependencies changed', () => {
+    const log = console.log;
+    console.log = () => {};
+    const watcher = new BuildWatcher(
+      [path.join(workDir, 'a.s'), path.join(workDir, 'b.s')],
+      () => new CPU8BitCompiler({ outputDir: workDir, incremental: true })
+    );
+
+    try {
+      watcher.start();
+
+      fs.writeFileSync(path.join(workDir, 'io.s'), 'OUT 2\n');
+      watcher.notifyChange(path.join(workDir, 'io.s'));
+      watcher.notifyChange(path.join(workDir, 'b.s')); // touched, unchanged
+      const rebuilt = watcher.flush();
+
+      expect(rebuilt).toEqual([path.join(workDir, 'a.s')]);
+      expect(Array.from(fs.readFileSync(path.join(workDir, 'a.bin')))).toEqual([0x13, 1, 0x61, 2, 0xFF]);
+    } finally {
+      watcher.close();
+      console.log = log;
+    }
+  });
+
+  test('should rebuild once a missing include appears', () => {
+    const log = console.log;
+    const error = console.error;
+    console.log = () => {};
+    console.error = () => {};
+    fs.writeFileSync(path.join(workDir, 'c.s'), 'LDI 3\n.INCLUDE "late.s"\nHLT\n');
+    const watcher = new BuildWatcher(
+      [path.join(workDir, 'c.s')],
+      () => new CPU8BitCompiler({ outputDir: workDir, incremental: true })
+    );
+
+    try {
+      watcher.start();
+      expect(fs.existsSync(path.join(workDir, 'c.bin'))).toBe(false);
+
+      fs.writeFileSync(path.join(workDir, 'late.s'), 'OUT 3\n');
+      watcher.notifyChange(path.join(workDir, 'late.s'));
+
+      expect(watcher.flush()).toEqual([path.join(workDir, 'c.s')]);
+      expect(Array.from(fs.readFileSync(path.join(workDir, 'c.bin')))).toEqual([0x13, 3, 0x61, 3, 0xFF]);
+    } finally {
+      watcher.close();
+      console.log = log;
+      console.error = error;
+    }
+  });
+
+  test('should re-create compilers when an extra dependency changes', () => {
+    const log = console.log;
+    console.log = () => {};
+    const profilePath = path.join(workDir, 'b.profile.json');
+    fs.writeFileSync(profilePath, '{ "runs": 0, "counts": {} }\n');
+    let created = 0;
+    const watcher = new BuildWatcher(
+      [path.join(workDir, 'b.s')],
+      () => {
+        created++;
+        return new CPU8BitCompiler({ outputDir: workDir, incremental: true });
+      },
+      { extraDependencies: [profilePath] }
+    );
+
+    try {
+      watcher.start();
+      fs.writeFileSync(profilePath, '{ "runs": 1, "counts": {} }\n');
+      watcher.notifyChange(profilePath);
+
+      expect(watcher.flush()).toEqual([path.join(workDir, 'b.s')]);
+      expect(created).toBe(2);
+    } finally {
+      watcher.close();
+      console.log = log;
+    }
+  });
+
+  test('should report a missing profile as a build error and build once it appears', () => {
+    const log = console.log;
+    const error = console.error;
+    console.log = () => {};
+    console.error = () => {};
+    const profilePath = path.join(workDir, 'late.profile.json');
+    const watcher = new BuildWatcher(
+      [path.join(workDir, 'b.s')],
+      () => {
+        JSON.parse(fs.readFileSync(profilePath, 'utf-8'));
+        return new CPU8BitCompiler({ outputDir: workDir, incremental: true });
+      },
+      { extraDependencies: [profilePath] }
+    );
+
+    try {
+      watcher.start();
+      expect(fs.existsSync(path.join(workDir, 'b.bin'))).toBe(false);
+
+      fs.writeFileSync(profilePath, '{ "runs": 1, "counts": {} }\n');
+      watcher.notifyChange(profilePath);
+
+      expect(watcher.flush()).toEqual([path.join(workDir, 'b.s')]);
+      expect(fs.existsSync(path.join(workDir, 'b.bin'))).toBe(true);
+    } finally {
+      watcher.close();
+      console.log = log;
+      console.error = error;
+    }
+  });
+});
@@ -0,0 +1,241 @@
+/**
+ * Watch Mode Build Driver
+ *
+ * Keeps one compiler instance per input alive and rebuilds outputs when any
+ * file in their dependency closure (the input plus its includes, and any
+ * extra files such as a --profile-use profile) changes. A build that fails
+ * on a missing include keeps watching for that file.
+ *
+ * Rebuild policy:
+ * - File events are debounced; a burst of saves triggers one rebuild
+ * - Events whose file content did not actually change are ignored
+ * - Only targets whose dependency closure contains a changed file rebuild
+ * - Assembly compilers are created with `incremental` so unchanged lines
+ *   reuse their tokens and parse results from the previous build; binary
+ *   generation still covers the whole program
+ * - C inputs are full rebuilds: tokenizing, parsing, IR passes and
+ *   lowering all run again on every change
+ *
+ * Directories (not files) are watched so editors that save by rename keep
+ * being tracked.
+ *
+ * @fileoverview Dependency-tracked incremental rebuilds
+ */
+
+import * as fs from 'fs';
+import * as path from 'path';
+import { loadSource } from './includes';
+import { IncrementalStats } from './incremental';
+import { TimeReport, formatTimeReport } from './time-report';
+
+/**
+ * Minimal compiler surface shared by CPU8BitCompiler and HighLevelCompiler
+ */
+export interface FileCompiler {
+  compile(sourceCode: string, filename?: string): { success: boolean; binary?: Uint8Array; errors: string[]; outputFiles: string[] };
+  getIncrementalStats?(): IncrementalStats | null;
+  getTimeReport?(): TimeReport | null;
+  getIRDump?(): string | null;
+}
+
+export interface WatchOptions {
+  /** Quiet period after the last file event before rebuilding */
+  debounceMs?: number;
+  /**
+   * Files besides the sources that every compiler reads when it is created
+   * (a --profile-use profile); a change re-creates the compilers
+   */
+  extraDependencies?: string[];
+}
+
+interface WatchTarget {
+  inputPath: string;
+  /** Created by the first build that needs it; null until then or after a reload */
+  compiler: FileCompiler | null;
+  dependencies: string[];
+}
+
+export class BuildWatcher {
+  private options: Required<WatchOptions>;
+  private createCompiler: (inputPath: string) => FileCompiler;
+  private targets: WatchTarget[];
+  /** Last seen contents of every watched file */
+  private contents: Map<string, string> = new Map();
+  private watchers: Map<string, fs.FSWatcher> = new Map();
+  private pending: Set<string> = new Set();
+  private timer: NodeJS.Timeout | null = null;
+
+  constructor(inputs: string[], createCompiler: (inputPath: string) => FileCompiler, options: WatchOptions = {}) {
+    this.options = {
+      debounceMs: options.debounceMs !== undefined && !isNaN(options.debounceMs) ? options.debounceMs : 50,
+      extraDependencies: (options.extraDependencies || []).map((file) => path.resolve(file))
+    };
+    this.createCompiler = createCompiler;
+    this.targets = inputs.map((input) => ({
+      inputPath: path.resolve(input),
+      compiler: null,
+      dependencies: [path.resolve(input), ...this.options.extraDependencies]
+    }));
+  }
+
+  start(): void {
+    for (const target of this.targets) {
+      this.build(target);
+    }
+    this.updateWatchers();
+    console.log(`Watching ${this.contents.size} file(s) for changes...`);
+  }
+
+  close(): void {
+    if (this.timer) {
+      clearTimeout(this.timer);
+      this.timer = null;
+    }
+    for (const watcher of this.watchers.values()) {
+      watcher.close();
+    }
+    this.watchers.clear();
+  }
+
+  /**
+   * Records a change to `filePath` and schedules a debounced rebuild
+   */
+  notifyChange(filePath: string): void {
+    this.pending.add(path.resolve(filePath));
+
+    if (this.timer) {
+      clearTimeout(this.timer);
+    }
+    this.timer = setTimeout(() => {
+      this.timer = null;
+      this.flush();
+    }, this.options.debounceMs);
+  }
+
+  /**
+   * Rebuilds every target affected by the pending changes.
+   * Returns the input paths that were rebuilt.
+   */
+  flush(): string[] {
+    const changed = new Set<string>();
+    for (const file of this.pending) {
+      const current = readIfExists(file);
+      if (current === null || current !== this.contents.get(file)) {
+        changed.add(file);
+      }
+    }
+    this.pending.clear();
+
+    const reload = this.options.extraDependencies.some((file) => changed.has(file));
+    const rebuilt: string[] = [];
+    for (const target of this.targets) {
+      if (target.dependencies.some((dependency) => changed.has(dependency))) {
+        this.build(target, reload);
+        rebuilt.push(target.inputPath);
+      }
+    }
+
+    if (rebuilt.length > 0) {
+      this.updateWatchers();
+    }
+    return rebuilt;
+  }
+
+  private build(target: WatchTarget, reload: boolean = false): void {
+    const name = path.relative(process.cwd(), target.inputPath) || target.inputPath;
+    const started = process.hrtime.bigint();
+
+    // Kept even if loading fails, so fixing a missing include rebuilds
+    const dependencies: string[] = [];
+    let source: string | null = null;
+    let errors: string[] = [];
+    if (reload) {
+      target.compiler = null;
+    }
+    try {
+      source = loadSource(target.inputPath, dependencies).source;
+      // Creating a compiler reads the extra dependencies, which may be
+      // missing or half-written; that fails this build, not the watcher
+      if (!target.compiler) {
+        target.compiler = this.createCompiler(target.inputPath);
+      }
+    } catch (error) {
+      errors = [`${error}`];
+    }
+
+    target.dependencies = [...dependencies, ...this.options.extraDependencies];
+    for (const dependency of target.dependencies) {
+      this.contents.set(dependency, readIfExists(dependency) || '');
+    }
+
+    if (errors.length === 0) {
+      try {
+        const result = target.compiler!.compile(source!, path.parse(target.inputPath).name);
+        errors = result.success ? [] : result.errors;
+      } catch (error) {
+        errors = [`${error}`];
+      }
+    }
+
+    const elapsedMs = Number(process.hrtime.bigint() - started) / 1e6;
+    const time = new Date().toLocaleTimeString();
+
+    if (errors.length > 0) {
+      console.error(`[${time}] ${name}: build failed in ${elapsedMs.toFixed(2)} ms`);
+      errors.forEach((error) => console.error(`  ${error}`));
+      return;
+    }
+
+    const compiler = target.compiler!;
+    const stats = compiler.getIncrementalStats ? compiler.getIncrementalStats() : null;
+    const detail = stats ? ` (${stats.parsed} line(s) parsed, ${stats.reused} reused)` : '';
+    console.log(`[${time}] ${name}: built in ${elapsedMs.toFixed(2)} ms${detail}`);
+
+    const report = compiler.getTimeReport ? compiler.getTimeReport() : null;
+    if (report) {
+      console.log(formatTimeReport(report, name));
+    }
+  }
+
+  /**
+   * Watches the directory of every dependency, dropping directories that
+   * no target depends on anymore
+   */
+  private updateWatchers(): void {
+    const watched = new Set<string>();
+    for (const target of this.targets) {
+      for (const dependency of target.dependencies) {
+        watched.add(dependency);
+      }
+    }
+
+    const directories = new Set(Array.from(watched, (file) => path.dirname(file)));
+    for (const [directory, watcher] of this.watchers) {
+      if (!directories.has(directory)) {
+        watcher.close();
+        this.watchers.delete(directory);
+      }
+    }
+
+    for (const directory of directories) {
+      if (this.watchers.has(directory) || !fs.existsSync(directory)) continue;
+
+      const watcher = fs.watch(directory, (_event, filename) => {
+        if (!filename) return;
+        const file = path.join(directory, filename.toString());
+        if (this.targets.some((target) => target.dependencies.includes(file))) {
+          this.notifyChange(file);
+        }
+      });
+      this.watchers.set(directory, watcher);
+    }
+  }
+}
+
+function readIfExists(filePath: string): string | null {
+  try {
+    return fs.readFileSync(filePath, 'utf-8');
+  } catch {
+    return null;
+  }
+}